@@ -21,12 +21,13 @@
 /**
  * @file        main.c
  * @brief       Configures and starts the RTC and demonstrates the use of the alarms.
- * @details     The RTC is enabled and the sub-second alarm set to trigger every 250 ms.
- *              P2.25 (LED0) is toggled each time the sub-second alarm triggers.  The
- *              time-of-day alarm is set to 2 seconds.  When the time-of-day alarm
- *              triggers, the rate of the sub-second alarm is switched to 500 ms.  The
- *              time-of-day alarm is then rearmed for another 2 sec.  Pressing SW2 will
- *              output the current value of the RTC to the console UART.
+ * @details     The RTC is enabled and a timer of the RTC wheel (common/rtc_wheel.h),
+ *              which runs on the sub-second alarm, set to expire every 250 ms.
+ *              P2.25 (LED0) is toggled each time the timer expires.  The time-of-day
+ *              alarm is set to 10 seconds.  When the time-of-day alarm triggers, the
+ *              period of the timer is switched to 500 ms.  The time-of-day alarm is
+ *              then rearmed for another 10 sec.  Pressing SW2 will output the current
+ *              value of the RTC to the console UART.
  */
 
 /***** Includes *****/
@@ -40,6 +41,8 @@
 #include "pb.h"
 #include "mxc_delay.h"
 #include "gpio.h"
+#include "rtc_time.h"
+#include "rtc_wheel.h"
 
 /***** Definitions *****/
 #define LED_ALARM 0
@@ -49,14 +52,6 @@
 #define SUBSECOND_MSEC_0 250
 #define SUBSECOND_MSEC_1 500
 
-#define MSEC_TO_RSSA(x) \
-    (0 - ((x * 4096) /  \
-          1000)) /* Converts a time in milleseconds to the equivalent RSSA register value. */
-
-#define SECS_PER_MIN 60
-#define SECS_PER_HR (60 * SECS_PER_MIN)
-#define SECS_PER_DAY (24 * SECS_PER_HR)
-
 // Parameters for GPIO pins
 #define MXC_GPIO_PIN_SSEC MXC_GPIO_PIN_7
 #define MXC_GPIO_PORT_RTC MXC_GPIO2
@@ -65,8 +60,18 @@ mxc_gpio_cfg_t gpio_out_ssec;
 
 /***** Globals *****/
 int ss_interval = SUBSECOND_MSEC_0;
+rtc_timer_t blink_timer;
 
 /***** Functions *****/
+void blinkExpired(void *arg, uint32_t ticks)
+{
+    (void)arg;
+    (void)ticks;
+
+    LED_Toggle(LED_ALARM);
+    MXC_GPIO_OutToggle(MXC_GPIO_PORT_RTC, MXC_GPIO_PIN_SSEC);
+}
+
 void RTC_IRQHandler(void)
 {
     uint32_t time;
@@ -74,9 +79,8 @@ void RTC_IRQHandler(void)
 
     /* Check sub-second alarm flag. */
     if (flags & MXC_F_RTC_CTRL_SSEC_ALARM) {
-        LED_Toggle(LED_ALARM);
-        MXC_GPIO_OutToggle(MXC_GPIO_PORT_RTC, MXC_GPIO_PIN_SSEC);
         MXC_RTC_ClearFlags(MXC_F_RTC_CTRL_SSEC_ALARM);
+        rtc_wheel_alarm();
     }
 
     /* Check time-of-day alarm flag. */
@@ -96,20 +100,17 @@ void RTC_IRQHandler(void)
 
         while (MXC_RTC_EnableInt(MXC_F_RTC_CTRL_TOD_ALARM_IE) == E_BUSY) {}
 
-        // Toggle the sub-second alarm interval.
+        // Toggle the blink interval.
         if (ss_interval == SUBSECOND_MSEC_0) {
             ss_interval = SUBSECOND_MSEC_1;
         } else {
             ss_interval = SUBSECOND_MSEC_0;
         }
 
-        while (MXC_RTC_DisableInt(MXC_F_RTC_CTRL_SSEC_ALARM_IE) == E_BUSY) {}
-
-        if (MXC_RTC_SetSubsecondAlarm(MSEC_TO_RSSA(ss_interval)) != E_NO_ERROR) {
+        if (rtc_wheel_start(&blink_timer, RTC_WHEEL_MS_TO_TICKS(ss_interval),
+                            RTC_WHEEL_MS_TO_TICKS(ss_interval)) != E_NO_ERROR) {
             /* Handle Error */
         }
-
-        while (MXC_RTC_EnableInt(MXC_F_RTC_CTRL_SSEC_ALARM_IE) == E_BUSY) {}
     }
 
     return;
@@ -117,44 +118,28 @@ void RTC_IRQHandler(void)
 
 void printTime(void)
 {
-    int day, hr, min, err;
-    uint32_t sec, rtc_readout;
-    double subsec;
-
-    do {
-        err = MXC_RTC_GetSubSeconds(&rtc_readout);
-    } while (err != E_NO_ERROR);
-    subsec = rtc_readout / 4096.0;
-
-    do {
-        err = MXC_RTC_GetSeconds(&rtc_readout);
-    } while (err != E_NO_ERROR);
-    sec = rtc_readout;
-
-    day = sec / SECS_PER_DAY;
-    sec -= day * SECS_PER_DAY;
-
-    hr = sec / SECS_PER_HR;
-    sec -= hr * SECS_PER_HR;
-
-    min = sec / SECS_PER_MIN;
-    sec -= min * SECS_PER_MIN;
+    rtc_time_t now;
+    char str[RTC_TIME_STR_LEN];
 
-    subsec += sec;
+    if (rtc_time_get(&now) != E_NO_ERROR) {
+        printf("\nCurrent Time (dd:hh:mm:ss): RTC busy\n");
+        return;
+    }
 
-    printf("\nCurrent Time (dd:hh:mm:ss): %02d:%02d:%02d:%05.2f\n", day, hr, min, subsec);
+    rtc_time_format(str, sizeof(str), &now, 2);
+    printf("\nCurrent Time (dd:hh:mm:ss): %s\n", str);
 }
 
 // *****************************************************************************
 int main(void)
 {
     printf("\n*************************** RTC Example ****************************\n\n");
-    printf("The RTC is enabled and the sub-second alarm set to trigger every %d ms.\n",
+    printf("The RTC is enabled and a timer on the sub-second alarm set to expire every %d ms.\n",
            SUBSECOND_MSEC_0);
-    printf("(LED 1) is toggled each time the sub-second alarm triggers.\n\n");
+    printf("(LED 1) is toggled each time the timer expires.\n\n");
     printf("The time-of-day alarm is set to %d seconds.  When the time-of-day alarm\n",
            TIME_OF_DAY_SEC);
-    printf("triggers, the rate of the sub-second alarm is switched to %d ms.\n\n",
+    printf("triggers, the period of the timer is switched to %d ms.\n\n",
            SUBSECOND_MSEC_1);
     printf("(LED 2) is toggled each time the time-of-day alarm triggers.\n\n");
     printf("The time-of-day alarm is then rearmed for another %d sec.  Pressing PB1\n",
@@ -189,27 +174,29 @@ int main(void)
         return E_BUSY;
     }
 
-    if (MXC_RTC_DisableInt(MXC_F_RTC_CTRL_SSEC_ALARM_IE) == E_BUSY) {
+    if (MXC_RTC_SquareWaveStart(MXC_RTC_F_512HZ) == E_BUSY) {
         return E_BUSY;
     }
 
-    if (MXC_RTC_SetSubsecondAlarm(MSEC_TO_RSSA(SUBSECOND_MSEC_0)) != E_NO_ERROR) {
-        printf("Failed RTC_SetSubsecondAlarm\n");
+    if (MXC_RTC_Start() != E_NO_ERROR) {
+        printf("Failed RTC_Start\n");
         printf("Example Failed\n");
 
         while (1) {}
     }
 
-    if (MXC_RTC_EnableInt(MXC_F_RTC_CTRL_SSEC_ALARM_IE) == E_BUSY) {
-        return E_BUSY;
-    }
+    // the wheel takes over the sub-second alarm
+    if (rtc_wheel_init() != E_NO_ERROR) {
+        printf("Failed rtc_wheel_init\n");
+        printf("Example Failed\n");
 
-    if (MXC_RTC_SquareWaveStart(MXC_RTC_F_512HZ) == E_BUSY) {
-        return E_BUSY;
+        while (1) {}
     }
 
-    if (MXC_RTC_Start() != E_NO_ERROR) {
-        printf("Failed RTC_Start\n");
+    rtc_timer_init(&blink_timer, blinkExpired, NULL);
+    if (rtc_wheel_start(&blink_timer, RTC_WHEEL_MS_TO_TICKS(SUBSECOND_MSEC_0),
+                        RTC_WHEEL_MS_TO_TICKS(SUBSECOND_MSEC_0)) != E_NO_ERROR) {
+        printf("Failed rtc_wheel_start\n");
         printf("Example Failed\n");
 
         while (1) {}
@@ -232,6 +219,9 @@ int main(void)
 
 
     while (1) {
+        // expired timers
+        rtc_wheel_run();
+
         if (PB_Get(0)) {
             /* Show the time elapsed. */
             printTime();
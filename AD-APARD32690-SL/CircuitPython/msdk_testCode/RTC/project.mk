@@ -30,3 +30,10 @@
 # For more information on how sing process works, see
 # https://www.analog.com/en/education/education-library/videos/6313214207112.html
 SBT=0
+
+# coherent RTC reads and integer-only time formatting (common/rtc_time.h)
+SRCS += ../../../../common/rtc_time.c
+IPATH += ../../../../common
+
+# software timers on the RTC sub-second alarm (common/rtc_wheel.h)
+SRCS += ../../../../common/rtc_wheel.c
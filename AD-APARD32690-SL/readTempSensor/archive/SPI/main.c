@@ -40,6 +40,8 @@
 #include "dma.h"
 #include "led.h"
 
+#include "completion.h"
+
 /***** Preprocessors *****/
 //#define MASTERSYNC 1
 #define MASTERASYNC 1
@@ -62,7 +64,7 @@
 /***** Globals *****/
 uint16_t rx_data[DATA_LEN];
 uint16_t tx_data[DATA_LEN];
-volatile int SPI_FLAG;
+completion_t spi_done; // completed by SPI_Callback
 volatile uint8_t DMA_FLAG = 0;
 
 /***** Functions *****/
@@ -84,7 +86,7 @@ void DMA1_IRQHandler(void)
 
 void SPI_Callback(mxc_spi_req_t *req, int error)
 {
-    SPI_FLAG = error;
+    complete(&spi_done, error);
 }
 
 int main(void)
@@ -105,6 +107,8 @@ int main(void)
     spi_pins.ss2 = FALSE;
     spi_pins.vddioh = MXC_GPIO_VSSEL_VDDIOH;
 
+    init_completion(&spi_done);
+
     for (i = 1; i < 17; i++) {
         if (i == 1) { // Sending out 2 to 16 bits
             continue;
@@ -134,7 +138,7 @@ int main(void)
         req.txCnt = 0;
         req.rxCnt = 0;
         req.completeCB = (spi_complete_cb_t)SPI_Callback;
-        SPI_FLAG = 1;
+        reinit_completion(&spi_done);
 
         retVal = MXC_SPI_SetDataSize(SPI, i);
 
@@ -156,7 +160,7 @@ int main(void)
         NVIC_EnableIRQ(SPI_IRQ);
         MXC_SPI_MasterTransactionAsync(&req);
 
-        while (SPI_FLAG == 1) {}
+        wait_for_completion(&spi_done);
 
 
 
@@ -34,4 +34,8 @@ SBT=0
 DEBUG=1
 
 METHOD ?= MASTERSYNC
-PROJ_CFLAGS += -D$(METHOD)
\ No newline at end of file
+PROJ_CFLAGS += -D$(METHOD)
+
+# shared modules (completion, ...)
+VPATH += ../../../../common
+IPATH += ../../../../common
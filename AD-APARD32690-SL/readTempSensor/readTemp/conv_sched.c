@@ -0,0 +1,283 @@
+/**
+ * @file    conv_sched.c
+ * @brief   MAX31723 conversion scheduling aligned with the RTC alarms
+ */
+
+/***** Includes *****/
+#include <string.h>
+
+#include "lp.h"
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "rtc.h"
+#include "rtc_time.h"
+#include "rtc_wheel.h"
+#include "conv_sched.h"
+#include "cycle_counter.h"
+
+/***** Definitions *****/
+#define CONV_SCHED_MS_TO_TICKS(ms) \
+    ((((ms) * CONV_SCHED_TICKS_PER_SEC) + 999) / 1000) // rounded up
+
+/***** Globals *****/
+static max31723_t *sched_sensor;
+
+static volatile bool due; // a 1SHOT conversion should be started
+static bool paused; // another sampler owns the sensor
+#ifdef CONV_ONESHOT
+static rtc_timer_t lead_timer; // starts the conversion ahead of the alarm
+static rtc_timer_t ready_timer; // ends the wait for a conversion started late
+#endif
+static volatile bool converting; // a late conversion has no result yet
+static volatile uint32_t alarm_ticks; // time-of-day alarm armed last
+static volatile uint32_t trigger_ticks; // trigger of the next periodic sample
+
+static bool timing_started;
+static uint32_t start_ticks; // RTC time the accounting started at
+static uint32_t wake_cycle; // DWT count at the last wake-up
+static conv_sched_stats_t sched_stats;
+
+/***** Functions *****/
+#ifdef CONV_ONESHOT
+// maximum conversion time at the resolution in the sensor's configuration cache
+static uint32_t conv_ticks(void)
+{
+    return CONV_SCHED_MS_TO_TICKS(MAX31723_CONV_MS(MAX31723_CFG_GET_RES(sched_sensor->config)));
+}
+#endif
+
+bool conv_sched_now(uint32_t *ticks)
+{
+    rtc_time_t now;
+
+    if (rtc_time_get(&now) != E_NO_ERROR) {
+        return false;
+    }
+    *ticks = rtc_time_ticks(&now);
+    return true;
+}
+
+#ifdef CONV_ONESHOT
+static void lead_expired(void *arg, uint32_t ticks)
+{
+    (void)arg;
+    (void)ticks;
+    due = true;
+}
+
+static void ready_expired(void *arg, uint32_t ticks)
+{
+    (void)arg;
+    (void)ticks;
+    converting = false;
+}
+
+// starts the lead timer for a conversion ahead of alarm_ticks
+static void arm_lead(uint32_t now)
+{
+    uint32_t lead = conv_ticks() + CONV_SCHED_MS_TO_TICKS(CONV_SCHED_GUARD_MS);
+    uint32_t start = alarm_ticks - lead;
+
+    if ((int32_t)(start - now) <= 0) {
+        // too close to the alarm: convert now, conv_sched_ready() holds the
+        // read until the result is in
+        sched_stats.late++;
+        due = true;
+        return;
+    }
+
+    if (rtc_wheel_start_at(&lead_timer, start, 0) != E_NO_ERROR) {
+        sched_stats.late++;
+        due = true;
+    }
+}
+#endif
+
+void conv_sched_init(max31723_t *sensor)
+{
+    sched_sensor = sensor;
+
+    due = false;
+    paused = false;
+    converting = false;
+    alarm_ticks = 0;
+    trigger_ticks = 0;
+    timing_started = false;
+    memset(&sched_stats, 0x00, sizeof(sched_stats));
+    sched_stats.latency_min = UINT32_MAX;
+#ifdef CONV_ONESHOT
+    rtc_timer_init(&lead_timer, lead_expired, NULL);
+    rtc_timer_init(&ready_timer, ready_expired, NULL);
+#endif
+
+    cycle_counter_enable();
+}
+
+void conv_sched_arm(uint32_t alarm_sec)
+{
+    uint32_t now;
+
+    if (!conv_sched_now(&now)) {
+        return;
+    }
+
+    // the accounting covers the time the RTC runs
+    if (!timing_started) {
+        timing_started = true;
+        start_ticks = now;
+        wake_cycle = cycle_counter_read();
+    }
+
+#ifndef CONV_ONESHOT
+    // the sample read after this call belongs to the alarm that just fired
+    trigger_ticks = alarm_ticks;
+#endif
+
+    alarm_ticks = alarm_sec * CONV_SCHED_TICKS_PER_SEC;
+
+#ifdef CONV_ONESHOT
+    if (!paused) {
+        arm_lead(now);
+    }
+#endif
+}
+
+int conv_sched_pause(void)
+{
+    paused = true;
+    due = false;
+    converting = false;
+
+#ifdef CONV_ONESHOT
+    rtc_wheel_stop(&lead_timer);
+    rtc_wheel_stop(&ready_timer);
+
+    // leave shutdown: continuous conversions
+    return max31723_write_config(sched_sensor, sched_sensor->config & ~MAX31723_CFG_SD);
+#else
+    return E_NO_ERROR;
+#endif
+}
+
+int conv_sched_resume(void)
+{
+    paused = false;
+
+#ifdef CONV_ONESHOT
+    uint32_t now;
+    int retVal = max31723_write_config(sched_sensor, sched_sensor->config | MAX31723_CFG_SD);
+
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+    // the next time-of-day alarm was armed while paused
+    if (conv_sched_now(&now)) {
+        arm_lead(now);
+    }
+#endif
+
+    return E_NO_ERROR;
+}
+
+bool conv_sched_due(void)
+{
+    return due;
+}
+
+bool conv_sched_ready(void)
+{
+    return !converting;
+}
+
+int conv_sched_start(void)
+{
+    int retVal = E_NO_ERROR;
+
+    due = false;
+
+#ifdef CONV_ONESHOT
+    uint32_t now;
+    bool timed = conv_sched_now(&now);
+
+    if (timed) {
+        trigger_ticks = now;
+    }
+
+    // the sensor clears 1SHOT once the result is in the temperature register
+    retVal = max31723_write_config(sched_sensor, sched_sensor->config | MAX31723_CFG_1SHOT);
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+    sched_stats.conversions++;
+
+    // started late, the result comes after the alarm: until then a read
+    // returns the previous one
+    if (timed && (int32_t)(now + conv_ticks() - alarm_ticks) > 0) {
+        converting = true;
+        if (rtc_wheel_start_at(&ready_timer, now + conv_ticks(), 0) == E_NO_ERROR) {
+            sched_stats.held++;
+        } else {
+            converting = false;
+        }
+    }
+#endif
+
+    return retVal;
+}
+
+void conv_sched_sample(const sample_t *sample)
+{
+    uint32_t ticks = sample->rtc_seconds * CONV_SCHED_TICKS_PER_SEC + sample->subseconds;
+    uint32_t latency = ticks - trigger_ticks;
+
+    sched_stats.samples++;
+    sched_stats.latency_total += latency;
+    if (latency < sched_stats.latency_min) {
+        sched_stats.latency_min = latency;
+    }
+    if (latency > sched_stats.latency_max) {
+        sched_stats.latency_max = latency;
+    }
+}
+
+void conv_sched_sleep(void)
+{
+    sched_stats.awake_cycles += cycle_counter_read() - wake_cycle;
+    __WFI();
+    wake_cycle = cycle_counter_read();
+}
+
+void conv_sched_standby(void)
+{
+    sched_stats.awake_cycles += cycle_counter_read() - wake_cycle;
+    MXC_LP_EnterStandbyMode();
+    wake_cycle = cycle_counter_read();
+}
+
+void conv_sched_get_stats(conv_sched_stats_t *stats)
+{
+    uint32_t now;
+    uint64_t elapsed_cycles;
+
+    *stats = sched_stats;
+    stats->awake_cycles += cycle_counter_read() - wake_cycle;
+
+    if (!timing_started || !conv_sched_now(&now) || now == start_ticks) {
+        return;
+    }
+
+    stats->elapsed_ticks = now - start_ticks;
+    elapsed_cycles = (uint64_t)stats->elapsed_ticks * SystemCoreClock / CONV_SCHED_TICKS_PER_SEC;
+    stats->awake_pct_x100 = (uint32_t)(stats->awake_cycles * 10000 / elapsed_cycles);
+
+#ifdef CONV_ONESHOT
+    stats->sensor_pct_x100 =
+        (uint32_t)((uint64_t)stats->conversions * conv_ticks() * 10000 / stats->elapsed_ticks);
+#else
+    stats->sensor_pct_x100 = 10000;
+#endif
+    if (stats->sensor_pct_x100 > 10000) {
+        stats->sensor_pct_x100 = 10000;
+    }
+}
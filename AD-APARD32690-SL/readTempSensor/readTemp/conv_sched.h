@@ -0,0 +1,128 @@
+/**
+ * @file    conv_sched.h
+ * @brief   MAX31723 conversion scheduling aligned with the RTC alarms
+ * @details CONV_CONTINUOUS keeps the sensor converting nonstop and reads the
+ *          latest result at each time-of-day alarm. CONV_ONESHOT shuts the
+ *          sensor down and arms the RTC sub-second alarm so that a 1SHOT
+ *          conversion starts the conversion time (plus a small guard) before
+ *          each time-of-day alarm; the alarm then reads the finished result.
+ *          Between samples the sensor is idle and the core sleeps.
+ *
+ *          The mode is chosen at compile time (CONV_MODE in project.mk).
+ *          The scheduler also keeps the figures that compare both modes: the
+ *          trigger-to-sample latency of the periodic samples and the share of
+ *          time the core and the sensor are active.
+ */
+
+#ifndef CONV_SCHED_H_
+#define CONV_SCHED_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "max31723.h"
+#include "sample_ring.h"
+
+/***** Definitions *****/
+#if !defined(CONV_CONTINUOUS) && !defined(CONV_ONESHOT)
+#define CONV_ONESHOT 1
+#endif
+
+// configuration register for the selected mode
+#ifdef CONV_ONESHOT
+#define CONV_SCHED_CONFIG(bits) (MAX31723_CFG_SD | MAX31723_CFG_RES(bits))
+#else
+#define CONV_SCHED_CONFIG(bits) MAX31723_CFG_RES(bits)
+#endif
+
+#define CONV_SCHED_TICKS_PER_SEC 4096 // RTC sub-second resolution
+
+// the 1SHOT write waits for the main loop, which may be printing one sample
+#define CONV_SCHED_GUARD_MS 10
+
+typedef struct {
+    uint32_t conversions; // 1SHOT conversions started
+    uint32_t late; // alarms armed too late to lead by the conversion time
+    uint32_t held; // late conversions the reads waited for
+    uint32_t samples; // periodic samples measured
+    uint32_t latency_min; // trigger to sample, RTC ticks
+    uint32_t latency_max;
+    uint64_t latency_total;
+    uint64_t awake_cycles; // core cycles outside conv_sched_sleep()
+    uint32_t elapsed_ticks; // RTC ticks covered by awake_cycles
+    uint32_t sensor_pct_x100; // share of time the sensor converts, 0.01 %
+    uint32_t awake_pct_x100; // share of time the core runs, 0.01 %
+} conv_sched_stats_t;
+
+/***** Functions *****/
+/*
+ * Prepares the scheduler for sensor. The configuration register must already
+ * hold CONV_SCHED_CONFIG(bits); the lead follows the resolution in the
+ * driver's configuration cache.
+ */
+void conv_sched_init(max31723_t *sensor);
+
+/*
+ * Schedules the conversion for the time-of-day alarm at alarm_sec. Call it
+ * whenever that alarm is set, from main() or the RTC ISR. In CONV_ONESHOT
+ * mode it starts a timer of the RTC wheel, which must be initialized, and
+ * rtc_wheel_run() then marks the conversion as due.
+ */
+void conv_sched_arm(uint32_t alarm_sec);
+
+/*
+ * Hands the sensor to another sampler: no more
+ * conversions are scheduled and, in CONV_ONESHOT mode, the sensor converts
+ * continuously. conv_sched_arm() still tracks the time-of-day alarm.
+ * conv_sched_resume() restores the scheduling from the next alarm on.
+ * Both use blocking driver calls.
+ */
+int conv_sched_pause(void);
+int conv_sched_resume(void);
+
+/*
+ * True when a conversion is due and conv_sched_start() should be called.
+ */
+bool conv_sched_due(void);
+
+/*
+ * Starts the due 1SHOT conversion with a driver call, so it must run in
+ * thread mode while no other transfer is in flight.
+ */
+int conv_sched_start(void);
+
+/*
+ * False while a 1SHOT conversion started too late for its alarm is still
+ * running: a read now would return the previous result, so the triggers wait.
+ * A timer of the RTC wheel ends the wait, the core may sleep meanwhile.
+ */
+bool conv_sched_ready(void);
+
+/*
+ * Current RTC time in CONV_SCHED_TICKS_PER_SEC ticks; false when the RTC
+ * stayed busy. Only reads the RTC, so it is safe from any handler.
+ */
+bool conv_sched_now(uint32_t *ticks);
+
+/*
+ * Records the latency of a periodic sample taken for the last trigger.
+ */
+void conv_sched_sample(const sample_t *sample);
+
+/*
+ * Sleeps with WFI and counts the time awake since the last wake-up.
+ * Call it with interrupts masked, like a bare __WFI().
+ */
+void conv_sched_sleep(void);
+
+/*
+ * Like conv_sched_sleep(), in STANDBY: every clock but the RTC's stops and
+ * only the wake-up sources enabled with MXC_LP_Enable*Wakeup() end it. The
+ * UART, SPI and the TMRs on the fast clocks must be idle.
+ */
+void conv_sched_standby(void);
+
+void conv_sched_get_stats(conv_sched_stats_t *stats);
+
+#endif // CONV_SCHED_H_
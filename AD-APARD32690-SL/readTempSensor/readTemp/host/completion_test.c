@@ -0,0 +1,144 @@
+/**
+ * @file    completion_test.c
+ * @brief   Test of the timed completion wait (common/completion.c)
+ * @details Runs completion.c on the simulated core and TMR3:
+ *
+ *          - a timed wait without completion_timer_init() is refused
+ *          - a completion before the deadline ends the wait at once, with its
+ *            status, and the deadline timer does not fire afterwards
+ *          - without a completion the wait ends at the deadline with
+ *            E_TIME_OUT, from 10 us up to 60 s (past the 35 s the cycle
+ *            counter holds at 120 MHz)
+ *          - the core sleeps through every wait instead of spinning
+ *
+ *          Prints COMPLETION PASS and exits with 0 when every case passed.
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "completion.h"
+#include "hal_sim.h"
+#include "sim_test.h"
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "nvic_table.h"
+#include "tmr.h"
+
+/***** Definitions *****/
+#define WAIT_TMR MXC_TMR3
+#define WAIT_IRQ TMR3_IRQn
+#define DONE_IRQ TMR5_IRQn // "transaction" interrupt that calls complete()
+#define DONE_STATUS E_COMM_ERR // passed through by the wait
+#define SLACK_NS SIM_US(3) // timer tick, exception entry and wake-up
+#define AWAKE_MAX_NS SIM_US(5) // core time per wait: setup and one wake-up
+
+/***** Globals *****/
+static completion_t done;
+
+/***** Functions *****/
+static void done_handler(void)
+{
+    complete(&done, DONE_STATUS);
+}
+
+static void done_event(void *arg)
+{
+    (void)arg;
+    sim_raise_irq(DONE_IRQ);
+}
+
+// one timed wait; the completion comes after complete_ns (0: never)
+static int timed_wait(uint32_t timeout_us, uint64_t complete_ns, uint64_t *took_ns,
+                      uint64_t *awake_ns)
+{
+    uint64_t start = sim_now();
+    uint64_t awake = sim_get_stats()->awake_ns;
+    int retVal;
+
+    reinit_completion(&done);
+    if (complete_ns != 0) {
+        sim_schedule(start + complete_ns, done_event, NULL);
+    }
+    retVal = wait_for_completion_timeout(&done, timeout_us);
+    *took_ns = sim_now() - start;
+    *awake_ns = sim_get_stats()->awake_ns - awake;
+
+    return retVal;
+}
+
+static void test_no_timer(void)
+{
+    printf("before completion_timer_init()\n");
+
+    reinit_completion(&done);
+    sim_check(wait_for_completion_timeout(&done, 100) == E_BAD_STATE, "a timed wait is refused");
+}
+
+static void test_early(void)
+{
+    uint32_t deadline_irqs;
+    uint64_t took, awake;
+    int retVal;
+
+    printf("completion before the deadline\n");
+
+    retVal = timed_wait(1000, SIM_US(200), &took, &awake);
+    deadline_irqs = sim_get_stats()->irqs[WAIT_IRQ];
+    sim_advance(SIM_MS(2));
+
+    printf("  returned after %u ns, %u ns awake\n", (unsigned)took, (unsigned)awake);
+    sim_check(retVal == DONE_STATUS, "returns the completion's status");
+    sim_check(took >= SIM_US(200) && took <= SIM_US(200) + SLACK_NS, "returns at the completion");
+    sim_check(awake <= AWAKE_MAX_NS, "sleeps until then");
+    sim_check(sim_get_stats()->irqs[WAIT_IRQ] == deadline_irqs, "the deadline timer is stopped");
+}
+
+static void test_deadlines(void)
+{
+    static const uint32_t timeouts_us[] = { 10, 500, 100000, 60000000 };
+    bool on_time = true;
+    bool asleep = true;
+    bool timed_out = true;
+
+    printf("no completion\n");
+
+    for (unsigned i = 0; i < sizeof(timeouts_us) / sizeof(timeouts_us[0]); i++) {
+        uint64_t expected = SIM_US((uint64_t)timeouts_us[i]);
+        uint64_t took, awake;
+        int retVal = timed_wait(timeouts_us[i], 0, &took, &awake);
+
+        printf("  %u us: returned after %llu ns, %u ns awake\n", (unsigned)timeouts_us[i],
+               (unsigned long long)took, (unsigned)awake);
+        timed_out = timed_out && (retVal == E_TIME_OUT);
+        // rounded down to a tick of the timer (APB / 64)
+        on_time = on_time && (took + SLACK_NS >= expected) && (took <= expected + SLACK_NS);
+        asleep = asleep && (awake <= AWAKE_MAX_NS);
+    }
+    sim_check(timed_out, "E_TIME_OUT");
+    sim_check(on_time, "at the deadline, also past 35 s");
+    sim_check(asleep, "sleeps until then");
+}
+
+static int completion_main(void)
+{
+    init_completion(&done);
+    MXC_NVIC_SetVector(DONE_IRQ, done_handler);
+    NVIC_EnableIRQ(DONE_IRQ);
+
+    test_no_timer();
+    sim_check(completion_timer_init(WAIT_TMR) == E_NO_ERROR, "completion_timer_init()");
+    test_early();
+    test_deadlines();
+
+    return 0;
+}
+
+int main(void)
+{
+    sim_init(120 * SIM_NS_PER_SEC);
+    sim_console_config(0, false);
+
+    return sim_test_run("COMPLETION", completion_main);
+}
@@ -0,0 +1,310 @@
+/**
+ * @file    debounce_test.c
+ * @brief   Test of the timer-based GPIO debouncing (common/debounce.c)
+ * @details Runs debounce.c on the simulated GPIO ports and TMR1 with three
+ *          pins on three ports, windows of 100 ms (like SW2), 20 ms and 5 ms.
+ *          A generator drives bouncing edge trains onto them, the edges spaced
+ *          at random but always closer than the pin's window:
+ *
+ *          - one pin at a time: a bouncing press and release are each
+ *            reported once, with the settled level, one window after the last
+ *            bounce
+ *          - an even number of edges (a glitch) is not reported, and is
+ *            counted
+ *          - all three pins at once, the trains overlapping, so edges arrive
+ *            while the timer is armed for another pin's window, earlier or
+ *            later than the one they open: each pin is still reported once,
+ *            at its own time
+ *          - an edge that arrives after the armed window has expired but
+ *            before the timer handler ran (interrupts masked) neither loses
+ *            the window nor reports twice
+ *
+ *          Prints DEBOUNCE PASS and exits with 0 when every case passed.
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "debounce.h"
+#include "hal_sim.h"
+#include "sim_test.h"
+#include "gpio.h"
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "nvic_table.h"
+#include "tmr.h"
+
+/***** Definitions *****/
+#define DEB_TMR MXC_TMR1
+#define PINS 3
+#define GAP_MIN_NS SIM_US(20) // time between two bounces
+#define GAP_MAX_NS SIM_US(1500)
+#define BOUNCES 10 // edges after the first one of a train
+#define EARLY_NS SIM_US(2) // timer tick rounding of the window; ticks_per_ms
+                             // is truncated too, the window is up to 0.1 % short
+#define LATE_NS SIM_US(10) // tick rounding, exception entries
+#define QUIET_NS SIM_MS(150) // longer than any window
+
+typedef struct {
+    const char *name;
+    int port;
+    uint32_t mask;
+    uint32_t window_us;
+    mxc_gpio_cfg_t cfg;
+    debounce_pin_t deb;
+
+    // the generator
+    bool level; // driven on the pin
+    int edges_left;
+    uint64_t last_edge_ns;
+
+    // what the callback saw
+    uint32_t reports;
+    bool reported_level;
+    uint64_t reported_ns;
+} test_pin_t;
+
+/***** Globals *****/
+static test_pin_t pins[PINS] = {
+    { "P1.27, 100 ms", 1, MXC_GPIO_PIN_27, 100000 },
+    { "P0.5, 20 ms", 0, MXC_GPIO_PIN_5, 20000 },
+    { "P2.7, 5 ms", 2, MXC_GPIO_PIN_7, 5000 },
+};
+static uint32_t seed = 1;
+
+/***** Functions *****/
+static uint32_t rand_next(void)
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+static void gpio_isr(void)
+{
+    for (int i = 0; i < PINS; i++) {
+        if (MXC_GPIO_GetFlags(MXC_GPIO_GET_GPIO(pins[i].port)) & pins[i].mask) {
+            MXC_GPIO_Handler(pins[i].port);
+        }
+    }
+}
+
+static void gpio_callback(void *cbdata)
+{
+    debounce_edge(cbdata);
+}
+
+static void changed(void *arg, bool level)
+{
+    test_pin_t *pin = arg;
+
+    pin->reports++;
+    pin->reported_level = level;
+    pin->reported_ns = sim_now();
+}
+
+static void drive(test_pin_t *pin, bool level)
+{
+    pin->level = level;
+    pin->last_edge_ns = sim_now();
+    sim_gpio_set_input(pin->port, pin->mask, level);
+}
+
+// one edge of a train, then the next one a bounce gap later
+static void edge_event(void *arg)
+{
+    test_pin_t *pin = arg;
+    uint64_t gap_max = SIM_US(pin->window_us) * 8 / 10;
+
+    if (gap_max > GAP_MAX_NS) {
+        gap_max = GAP_MAX_NS;
+    }
+
+    drive(pin, !pin->level);
+    if (--pin->edges_left > 0) {
+        sim_schedule(sim_now() + GAP_MIN_NS + rand_next() % (gap_max - GAP_MIN_NS + 1), edge_event,
+                     pin);
+    }
+}
+
+// edges toggles of the pin from at on, closer together than its window
+static void start_train(test_pin_t *pin, uint64_t at, int edges)
+{
+    pin->edges_left = edges;
+    pin->reports = 0;
+    sim_schedule(at, edge_event, pin);
+}
+
+// one report with the driven level, one window after the last edge
+static bool reported_once(const test_pin_t *pin)
+{
+    uint64_t due = pin->last_edge_ns + SIM_US(pin->window_us);
+    uint64_t early = EARLY_NS + SIM_US(pin->window_us) / 1000;
+
+    return pin->reports == 1 && pin->reported_level == pin->level &&
+           debounce_level(&pin->deb) == pin->level && pin->reported_ns + early >= due &&
+           pin->reported_ns <= due + LATE_NS && !pin->deb.pending;
+}
+
+static void test_one_pin(void)
+{
+    bool ok = true;
+    bool bounce_ok = true;
+
+    printf("one pin at a time\n");
+
+    for (int i = 0; i < PINS; i++) {
+        test_pin_t *pin = &pins[i];
+
+        for (int phase = 0; phase < 2; phase++) { // press, then release
+            uint64_t first;
+
+            start_train(pin, sim_now() + SIM_MS(1), 1 + BOUNCES);
+            first = sim_now() + SIM_MS(1);
+            sim_advance(QUIET_NS);
+
+            printf("  %-14s %s after %u edges: level %d at +%llu us\n", pin->name,
+                   phase ? "release" : "press", 1 + BOUNCES, pin->reported_level,
+                   (unsigned long long)(pin->reported_ns - pin->last_edge_ns) / 1000);
+            ok = ok && reported_once(pin);
+            // the bounce is measured on the timer from the first to the last edge
+            bounce_ok = bounce_ok &&
+                        pin->deb.stats.longest_us + 2 >= (pin->last_edge_ns - first) / 1000;
+        }
+    }
+    sim_check(ok, "each reported once, settled level, window after last edge");
+    sim_check(bounce_ok, "longest bounce measured");
+}
+
+static void test_glitches(void)
+{
+    bool ok = true;
+
+    printf("glitches\n");
+
+    for (int i = 0; i < PINS; i++) {
+        test_pin_t *pin = &pins[i];
+        uint32_t glitches = pin->deb.stats.glitches;
+        uint32_t changes = pin->deb.stats.changes;
+
+        start_train(pin, sim_now() + SIM_MS(1), 2 + BOUNCES);
+        sim_advance(QUIET_NS);
+
+        ok = ok && pin->reports == 0 && pin->deb.stats.glitches == glitches + 1 &&
+             pin->deb.stats.changes == changes && !pin->deb.pending;
+    }
+    sim_check(ok, "not reported, counted as glitches");
+}
+
+static void test_all_pins(void)
+{
+    static const int edges[PINS] = { 1 + 2 * BOUNCES, 1 + BOUNCES, 1 + 3 * BOUNCES };
+    static const uint32_t start_us[PINS] = { 0, 3000, 40000 };
+    bool ok = true;
+
+    printf("all pins at once\n");
+
+    for (int round = 0; round < 8; round++) {
+        uint64_t at = sim_now() + SIM_MS(1);
+
+        // P1.27 arms its 100 ms window first; the 5 ms and 20 ms windows of
+        // the others close before it, and P2.7 starts bouncing again after
+        // P0.5's window was armed
+        for (int i = 0; i < PINS; i++) {
+            start_train(&pins[i], at + SIM_US(start_us[i] + rand_next() % 2000), edges[i]);
+        }
+        sim_advance(SIM_MS(250));
+
+        for (int i = 0; i < PINS; i++) {
+            ok = ok && reported_once(&pins[i]);
+        }
+    }
+    sim_check(ok, "each reported once, at its own time");
+}
+
+static void test_late_edge(void)
+{
+    test_pin_t *pin = &pins[2];
+    uint32_t changes = pin->deb.stats.changes;
+    bool level = pin->level;
+
+    printf("edge after the window expired, before the timer handler\n");
+
+    // a glitch whose second edge comes when the window has run out, while
+    // the timer interrupt is still pending
+    pin->reports = 0;
+    drive(pin, !level);
+    sim_advance(SIM_MS(1));
+    __disable_irq();
+    sim_advance(SIM_US(pin->window_us) + SIM_MS(1));
+    drive(pin, level);
+    __enable_irq();
+    sim_advance(QUIET_NS);
+
+    sim_check(pin->deb.stats.changes == changes && pin->reports == 0 && !pin->deb.pending &&
+                  debounce_level(&pin->deb) == level,
+              "a glitch ending late is not reported");
+
+    // the same with a real change: reported once, with the level it settled on
+    pin->reports = 0;
+    drive(pin, !level);
+    sim_advance(SIM_MS(1));
+    __disable_irq();
+    sim_advance(SIM_US(pin->window_us) + SIM_MS(1));
+    drive(pin, level);
+    drive(pin, !level);
+    __enable_irq();
+    sim_advance(QUIET_NS);
+
+    sim_check(pin->deb.stats.changes == changes + 1 && pin->reports == 1 &&
+                  pin->reported_level == !level && !pin->deb.pending,
+              "a change with a late bounce is reported once");
+
+    start_train(pin, sim_now() + SIM_MS(1), 1 + BOUNCES);
+    sim_advance(QUIET_NS);
+    sim_check(reported_once(pin), "the next train is still reported on time");
+}
+
+static int debounce_main(void)
+{
+    sim_check(debounce_init(DEB_TMR) == E_NO_ERROR, "debounce_init()");
+
+    for (int i = 0; i < PINS; i++) {
+        test_pin_t *pin = &pins[i];
+        mxc_gpio_regs_t *port = MXC_GPIO_GET_GPIO(pin->port);
+
+        // pulled up, like SW2
+        drive(pin, true);
+        pin->cfg.port = port;
+        pin->cfg.mask = pin->mask;
+        pin->cfg.func = MXC_GPIO_FUNC_IN;
+        pin->cfg.pad = MXC_GPIO_PAD_PULL_UP;
+        MXC_GPIO_Config(&pin->cfg);
+
+        if (debounce_add(&pin->deb, port, pin->mask, pin->window_us, changed, pin) !=
+            E_NO_ERROR) {
+            sim_check(false, "debounce_add()");
+            return 0;
+        }
+        MXC_GPIO_RegisterCallback(&pin->cfg, gpio_callback, &pin->deb);
+        MXC_GPIO_IntConfig(&pin->cfg, MXC_GPIO_INT_BOTH);
+        MXC_GPIO_EnableInt(port, pin->mask);
+        MXC_NVIC_SetVector(MXC_GPIO_GET_IRQ(pin->port), gpio_isr);
+        NVIC_EnableIRQ(MXC_GPIO_GET_IRQ(pin->port));
+    }
+
+    test_one_pin();
+    test_glitches();
+    test_all_pins();
+    test_late_edge();
+
+    return 0;
+}
+
+int main(void)
+{
+    sim_init(60 * SIM_NS_PER_SEC);
+    sim_console_config(0, false);
+
+    return sim_test_run("DEBOUNCE", debounce_main);
+}
@@ -0,0 +1,1866 @@
+/**
+ * @file    hal_sim.c
+ * @brief   Simulated clock, interrupt controller and peripherals for the host build
+ */
+
+/***** Includes *****/
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "board.h"
+#include "dma.h"
+#include "gpio.h"
+#include "led.h"
+#include "lp.h"
+#include "mxc_delay.h"
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "nvic_table.h"
+#include "pb.h"
+#include "rtc.h"
+#include "spi.h"
+#include "tmr.h"
+#include "uart.h"
+
+#include "hal_sim.h"
+
+/***** Definitions *****/
+#define SIM_MAX_EVENTS 64
+#define SIM_MAX_ERRORS_PRINTED 10
+
+// simulated cost of the firmware's own work between two events
+#define SIM_HAL_CALL_NS 250 // one driver call
+#define SIM_DWT_READ_NS 25 // one DWT register access
+#define SIM_TMR_READ_NS 25 // one TMR register read over the APB
+#define SIM_IRQ_ENTRY_NS 200 // exception entry and exit, 24 cycles at 120 MHz
+#define SIM_WAKE_NS 500 // leaving WFI/WFE until the first handler runs
+
+#define SIM_RTC_HZ 4096 // sub-second resolution
+#define SIM_RTC_BUSY_NS 61035 // RTC register synchronization, two 32 kHz cycles
+#define SIM_RTC_RDY_NS 30518 // RDY low before each counter update, one 32 kHz cycle
+#define SIM_RTC_TOD_MASK 0xFFFFF // the alarm compares the low 20 bits of the seconds
+
+#define SIM_TMR_IBRO_HZ 7372800
+#define SIM_TMR_ERTCO_HZ 32768
+#define SIM_TMR_INRO_HZ 8000
+
+#define SIM_SPI_SS_COUNT 4
+#define SIM_SPI_SETUP_NS 2000 // chip-select setup and FIFO turnaround
+#define SIM_SPI_MAX_LEN 256
+#define SIM_SPI_GPIO_CS_COUNT 8 // devices with a GPIO chip enable, all ports
+
+typedef struct {
+    uint64_t at;
+    sim_event_fn fn;
+    void *arg;
+    bool used;
+} sim_event_t;
+
+typedef enum {
+    SIM_SPI_IDLE,
+    SIM_SPI_ASYNC,
+    SIM_SPI_DMA,
+} sim_spi_kind_t;
+
+typedef struct {
+    bool init;
+    unsigned int hz;
+    mxc_spi_mode_t mode;
+    int data_size;
+    unsigned int ss_polarity;
+    unsigned int link_hz; // fastest SCLK the wiring carries, 0 for no limit
+    const sim_spi_device_t *dev[SIM_SPI_SS_COUNT];
+    mxc_spi_req_t *active; // transaction in flight
+    sim_spi_kind_t kind;
+    bool done; // the transaction in flight has finished, IRQ not handled yet
+    uint8_t rx[SIM_SPI_MAX_LEN]; // bytes received, copied to the request at the end
+} sim_spi_port_t;
+
+// device whose chip enable is a GPIO output instead of a slave select pin
+typedef struct {
+    int spi_idx;
+    int port;
+    uint32_t mask;
+    bool selected;
+    const sim_spi_device_t *dev;
+} sim_spi_gpio_cs_t;
+
+typedef struct {
+    bool running;
+    uint64_t base_ns; // simulated time at which the counter held base_ticks
+    uint64_t base_ticks; // counter value in 1/4096 s
+    int32_t crystal_ppm;
+    int8_t trim;
+    uint32_t ie; // *_ALARM_IE bits
+    uint32_t flags; // *_ALARM bits
+    uint32_t ras;
+    uint32_t rssa;
+    uint64_t ssec_start; // counter value when the sub-second alarm was armed
+    uint64_t busy_until;
+    bool stuck; // RDY held low (sim_rtc_stick_busy())
+} sim_rtc_t;
+
+typedef struct {
+    bool init;
+    bool running;
+    mxc_tmr_mode_t mode;
+    uint32_t clock_hz; // source clock
+    bool lp_clock; // ERTCO or INRO, which keep running in STANDBY
+    mxc_tmr_pres_t pres;
+    uint64_t base_ns; // simulated time at which the counter held base_cnt
+    uint32_t base_cnt;
+    uint32_t cmp;
+    bool ie;
+    bool flag;
+} sim_tmr_t;
+
+typedef struct {
+    uint8_t fifo[MXC_UART_FIFO_DEPTH]; // fifo[head] is being shifted out
+    int head;
+    int count;
+    uint32_t int_en;
+    uint32_t int_fl;
+} sim_uart_t;
+
+typedef struct {
+    mxc_gpio_callback_fn fn;
+    void *cbdata;
+} sim_gpio_cb_t;
+
+/***** Globals *****/
+uint32_t SystemCoreClock = 120000000;
+CoreDebug_Type sim_coredebug;
+mxc_gpio_regs_t sim_gpio[SIM_GPIO_PORTS];
+mxc_spi_regs_t sim_spi[SIM_SPI_PORTS];
+mxc_tmr_regs_t sim_tmr[SIM_TMR_COUNT];
+mxc_uart_regs_t sim_uart[SIM_UART_COUNT];
+
+static DWT_Type sim_dwt;
+static struct timespec host_start;
+
+static uint64_t now_ns;
+static uint64_t end_ns;
+static jmp_buf end_jmp;
+static sim_stats_t stats;
+static sim_event_t events[SIM_MAX_EVENTS];
+static bool in_event;
+
+static uint32_t primask;
+static bool event_reg;
+static int isr_depth;
+static uint64_t irq_enabled;
+static uint64_t irq_pending;
+static uint64_t wake_sources; // IRQs that end STANDBY
+static void (*vectors[MXC_IRQ_COUNT])(void);
+
+static sim_spi_port_t spi_ports[SIM_SPI_PORTS];
+static sim_spi_gpio_cs_t spi_gpio_cs[SIM_SPI_GPIO_CS_COUNT];
+static int spi_gpio_cs_count;
+static sim_rtc_t rtc;
+static sim_tmr_t tmrs[SIM_TMR_COUNT];
+static sim_gpio_cb_t gpio_cb[SIM_GPIO_PORTS][32];
+static uint32_t gpio_out_changes[SIM_GPIO_PORTS][32];
+static uint32_t leds;
+
+static uint32_t console_baud;
+static bool console_quiet;
+static FILE *console_capture;
+static void (*console_watch)(uint8_t c);
+static sim_uart_t console_uart;
+
+// default handler names of the startup file; NULL when the firmware has none
+extern void SPI0_IRQHandler(void) __attribute__((weak));
+extern void SPI1_IRQHandler(void) __attribute__((weak));
+extern void SPI4_IRQHandler(void) __attribute__((weak));
+extern void RTC_IRQHandler(void) __attribute__((weak));
+extern void GPIO0_IRQHandler(void) __attribute__((weak));
+extern void GPIO1_IRQHandler(void) __attribute__((weak));
+extern void GPIO2_IRQHandler(void) __attribute__((weak));
+extern void DMA0_IRQHandler(void) __attribute__((weak));
+extern void DMA1_IRQHandler(void) __attribute__((weak));
+extern void DMA2_IRQHandler(void) __attribute__((weak));
+extern void DMA3_IRQHandler(void) __attribute__((weak));
+extern void TMR0_IRQHandler(void) __attribute__((weak));
+extern void TMR1_IRQHandler(void) __attribute__((weak));
+extern void TMR2_IRQHandler(void) __attribute__((weak));
+extern void TMR3_IRQHandler(void) __attribute__((weak));
+extern void TMR4_IRQHandler(void) __attribute__((weak));
+extern void TMR5_IRQHandler(void) __attribute__((weak));
+extern void UART0_IRQHandler(void) __attribute__((weak));
+
+/***** Simulation core *****/
+static uint64_t irq_bit(IRQn_Type irq)
+{
+    return 1ULL << (irq - SPI0_IRQn);
+}
+
+static uint64_t next_event_time(void)
+{
+    uint64_t next = UINT64_MAX;
+
+    for (int i = 0; i < SIM_MAX_EVENTS; i++) {
+        if (events[i].used && events[i].at < next) {
+            next = events[i].at;
+        }
+    }
+
+    return next;
+}
+
+static void run_due_events(void)
+{
+    if (in_event) {
+        return;
+    }
+
+    in_event = true;
+    for (;;) {
+        int due = -1;
+
+        for (int i = 0; i < SIM_MAX_EVENTS; i++) {
+            if (events[i].used && events[i].at <= now_ns &&
+                (due < 0 || events[i].at < events[due].at)) {
+                due = i;
+            }
+        }
+        if (due < 0) {
+            break;
+        }
+
+        events[due].used = false;
+        events[due].fn(events[due].arg);
+    }
+    in_event = false;
+}
+
+static void check_end(void)
+{
+    if (now_ns >= end_ns) {
+        longjmp(end_jmp, SIM_END_TIME_LIMIT + 1);
+    }
+}
+
+static int next_deliverable_irq(void)
+{
+    uint64_t ready = irq_enabled & irq_pending;
+
+    if (ready == 0) {
+        return -1;
+    }
+
+    // lowest number first, all priorities are equal
+    return SPI0_IRQn + __builtin_ctzll(ready);
+}
+
+static void advance_to(uint64_t t);
+
+// runs pending handlers unless masked or already in a handler (no nesting)
+static void dispatch(void)
+{
+    int irq;
+
+    while (primask == 0 && isr_depth == 0 && (irq = next_deliverable_irq()) >= 0) {
+        irq_pending &= ~irq_bit(irq);
+        stats.irqs[irq]++;
+
+        if (vectors[irq] == NULL) {
+            sim_error("IRQ %d has no handler, the board would hang in the default handler", irq);
+            longjmp(end_jmp, SIM_END_FAULT + 1);
+        }
+
+        isr_depth++;
+        advance_to(now_ns + SIM_IRQ_ENTRY_NS);
+        vectors[irq]();
+        isr_depth--;
+    }
+}
+
+static void advance_to(uint64_t t)
+{
+    while (now_ns < t) {
+        uint64_t next = next_event_time();
+
+        if (next > t) {
+            next = t;
+        }
+        if (next > end_ns) {
+            next = end_ns;
+        }
+        if (next > now_ns) {
+            stats.awake_ns += next - now_ns;
+            now_ns = next;
+        }
+
+        run_due_events();
+        check_end();
+        dispatch();
+    }
+}
+
+// jumps from event to event until one of irqs is pending and enabled
+static void sleep_until_irq(uint64_t irqs)
+{
+    while ((irq_enabled & irq_pending & irqs) == 0) {
+        uint64_t next = next_event_time();
+
+        if (next > end_ns) {
+            next = end_ns;
+        }
+        if (next > now_ns) {
+            stats.asleep_ns += next - now_ns;
+            now_ns = next;
+        }
+
+        run_due_events();
+        check_end();
+    }
+}
+
+static void hal_call(void)
+{
+    sim_advance(SIM_HAL_CALL_NS);
+}
+
+static uint64_t host_cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)(ts.tv_sec - host_start.tv_sec) * SIM_NS_PER_SEC + ts.tv_nsec -
+           host_start.tv_nsec;
+}
+
+/***** Simulation API *****/
+void sim_init(uint64_t limit_ns)
+{
+    now_ns = 0;
+    end_ns = limit_ns;
+    memset(&stats, 0x00, sizeof(stats));
+    memset(events, 0x00, sizeof(events));
+    in_event = false;
+
+    primask = 0;
+    event_reg = false;
+    isr_depth = 0;
+    irq_enabled = 0;
+    irq_pending = 0;
+    wake_sources = 0;
+
+    memset(vectors, 0x00, sizeof(vectors));
+    vectors[SPI0_IRQn] = SPI0_IRQHandler;
+    vectors[SPI1_IRQn] = SPI1_IRQHandler;
+    vectors[SPI4_IRQn] = SPI4_IRQHandler;
+    vectors[RTC_IRQn] = RTC_IRQHandler;
+    vectors[GPIO0_IRQn] = GPIO0_IRQHandler;
+    vectors[GPIO1_IRQn] = GPIO1_IRQHandler;
+    vectors[GPIO2_IRQn] = GPIO2_IRQHandler;
+    vectors[DMA0_IRQn] = DMA0_IRQHandler;
+    vectors[DMA1_IRQn] = DMA1_IRQHandler;
+    vectors[DMA2_IRQn] = DMA2_IRQHandler;
+    vectors[DMA3_IRQn] = DMA3_IRQHandler;
+    vectors[TMR0_IRQn] = TMR0_IRQHandler;
+    vectors[TMR1_IRQn] = TMR1_IRQHandler;
+    vectors[TMR2_IRQn] = TMR2_IRQHandler;
+    vectors[TMR3_IRQn] = TMR3_IRQHandler;
+    vectors[TMR4_IRQn] = TMR4_IRQHandler;
+    vectors[TMR5_IRQn] = TMR5_IRQHandler;
+    vectors[UART0_IRQn] = UART0_IRQHandler;
+
+    memset(&sim_dwt, 0x00, sizeof(sim_dwt));
+    memset(&sim_coredebug, 0x00, sizeof(sim_coredebug));
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &host_start);
+
+    memset(sim_gpio, 0x00, sizeof(sim_gpio));
+    memset(gpio_cb, 0x00, sizeof(gpio_cb));
+    memset(gpio_out_changes, 0x00, sizeof(gpio_out_changes));
+    for (int i = 0; i < SIM_GPIO_PORTS; i++) {
+        sim_gpio[i].idx = i;
+        sim_gpio[i].in = 0xFFFFFFFF; // board pull-ups
+    }
+
+    memset(spi_ports, 0x00, sizeof(spi_ports));
+    memset(spi_gpio_cs, 0x00, sizeof(spi_gpio_cs));
+    spi_gpio_cs_count = 0;
+    for (int i = 0; i < SIM_SPI_PORTS; i++) {
+        sim_spi[i].idx = i;
+    }
+
+    memset(&rtc, 0x00, sizeof(rtc));
+    memset(tmrs, 0x00, sizeof(tmrs));
+    for (int i = 0; i < SIM_TMR_COUNT; i++) {
+        sim_tmr[i].idx = i;
+    }
+    for (int i = 0; i < SIM_UART_COUNT; i++) {
+        sim_uart[i].idx = i;
+    }
+    memset(&console_uart, 0x00, sizeof(console_uart));
+    console_uart.int_fl = MXC_F_UART_INT_FL_TX_HE;
+    leds = 0;
+    console_baud = 115200;
+    console_quiet = false;
+    console_capture = NULL;
+    console_watch = NULL;
+}
+
+int sim_run(int (*entry)(void))
+{
+    int end = setjmp(end_jmp);
+
+    if (end != 0) {
+        return end - 1;
+    }
+
+    entry();
+    return SIM_END_RETURNED;
+}
+
+uint64_t sim_now(void)
+{
+    return now_ns;
+}
+
+void sim_advance(uint64_t ns)
+{
+    advance_to(now_ns + ns);
+}
+
+void sim_schedule(uint64_t at, sim_event_fn fn, void *arg)
+{
+    for (int i = 0; i < SIM_MAX_EVENTS; i++) {
+        if (!events[i].used) {
+            events[i].at = (at < now_ns) ? now_ns : at;
+            events[i].fn = fn;
+            events[i].arg = arg;
+            events[i].used = true;
+            return;
+        }
+    }
+
+    sim_error("event queue full");
+}
+
+void sim_cancel(sim_event_fn fn, void *arg)
+{
+    for (int i = 0; i < SIM_MAX_EVENTS; i++) {
+        if (events[i].used && events[i].fn == fn && events[i].arg == arg) {
+            events[i].used = false;
+        }
+    }
+}
+
+void sim_raise_irq(IRQn_Type irq)
+{
+    irq_pending |= irq_bit(irq);
+}
+
+void sim_error(const char *fmt, ...)
+{
+    va_list args;
+
+    if (stats.errors++ < SIM_MAX_ERRORS_PRINTED) {
+        fprintf(stderr, "SIM ERROR at %llu.%06llu s: ", (unsigned long long)(now_ns / SIM_NS_PER_SEC),
+                (unsigned long long)(now_ns % SIM_NS_PER_SEC / 1000));
+        va_start(args, fmt);
+        vfprintf(stderr, fmt, args);
+        va_end(args);
+        fprintf(stderr, "\n");
+    }
+}
+
+const sim_stats_t *sim_get_stats(void)
+{
+    return &stats;
+}
+
+void sim_console_config(uint32_t baud, bool quiet)
+{
+    console_baud = baud;
+    console_quiet = quiet;
+}
+
+void sim_console_capture(FILE *capture)
+{
+    console_capture = capture;
+}
+
+void sim_console_watch(void (*watch)(uint8_t c))
+{
+    console_watch = watch;
+}
+
+// a character leaving the console UART
+static void console_out(uint8_t c)
+{
+    if (!console_quiet) {
+        putchar(c);
+    }
+    if (console_capture != NULL) {
+        fputc(c, console_capture);
+    }
+    if (console_watch != NULL) {
+        console_watch(c);
+    }
+    stats.console_chars++;
+}
+
+// the MSDK's blocking stdio backend, or the one installed with -Wl,--wrap=_write
+extern int __wrap__write(int file, char *ptr, int len) __attribute__((weak));
+
+int sim_printf(const char *restrict format, ...)
+{
+    va_list args;
+    char *buf;
+    int len;
+
+    va_start(args, format);
+    len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if (len > 0) {
+        buf = malloc(len + 1);
+        va_start(args, format);
+        vsnprintf(buf, len + 1, format, args);
+        va_end(args);
+        if (__wrap__write != NULL) {
+            __wrap__write(1, buf, len);
+        } else {
+            // the MSDK's _write(): "\r\n" for '\n', waiting for room in the FIFO
+            for (int i = 0; i < len; i++) {
+                if (buf[i] == '\n') {
+                    MXC_UART_WriteCharacter(MXC_UART_GET_UART(CONSOLE_UART), '\r');
+                }
+                MXC_UART_WriteCharacter(MXC_UART_GET_UART(CONSOLE_UART), (uint8_t)buf[i]);
+            }
+        }
+        free(buf);
+    }
+
+    return len;
+}
+
+/***** Core *****/
+DWT_Type *sim_dwt_sync(void)
+{
+    sim_advance(SIM_DWT_READ_NS);
+
+    // simulated time plus the host CPU time the firmware used, both in core cycles
+    if ((sim_coredebug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk) &&
+        (sim_dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        uint64_t ns = now_ns + host_cpu_ns();
+        sim_dwt.CYCCNT = (uint32_t)(ns * (SystemCoreClock / 1000000) / 1000);
+    }
+
+    return &sim_dwt;
+}
+
+void NVIC_EnableIRQ(IRQn_Type irq)
+{
+    irq_enabled |= irq_bit(irq);
+    dispatch();
+}
+
+void NVIC_DisableIRQ(IRQn_Type irq)
+{
+    irq_enabled &= ~irq_bit(irq);
+}
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority)
+{
+    (void)irq;
+    (void)priority;
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type irq)
+{
+    sim_raise_irq(irq);
+    dispatch();
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type irq)
+{
+    irq_pending &= ~irq_bit(irq);
+}
+
+void MXC_NVIC_SetVector(IRQn_Type irq, void (*handler)(void))
+{
+    vectors[irq] = handler;
+}
+
+void NVIC_SetRAM(void) {}
+
+void __WFI(void)
+{
+    stats.wfi++;
+    sleep_until_irq(UINT64_MAX);
+    advance_to(now_ns + SIM_WAKE_NS);
+    dispatch();
+}
+
+void __WFE(void)
+{
+    stats.wfe++;
+
+    if (event_reg) {
+        event_reg = false;
+        return;
+    }
+
+    // any interrupt wakes WFE; SEV in its handler leaves the event register set
+    sleep_until_irq(UINT64_MAX);
+    advance_to(now_ns + SIM_WAKE_NS);
+    dispatch();
+}
+
+void __SEV(void)
+{
+    event_reg = true;
+}
+
+void __DSB(void) {}
+
+void __disable_irq(void)
+{
+    primask = 1;
+}
+
+void __enable_irq(void)
+{
+    primask = 0;
+    dispatch();
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    return primask;
+}
+
+void __set_PRIMASK(uint32_t mask)
+{
+    primask = mask & 1;
+    dispatch();
+}
+
+int MXC_Delay(uint32_t us)
+{
+    sim_advance(SIM_US(us));
+    return E_NO_ERROR;
+}
+
+/***** Board *****/
+int Board_Init(void)
+{
+    return E_NO_ERROR;
+}
+
+void LED_On(unsigned int idx)
+{
+    leds |= 1u << idx;
+}
+
+void LED_Off(unsigned int idx)
+{
+    leds &= ~(1u << idx);
+}
+
+void LED_Toggle(unsigned int idx)
+{
+    leds ^= 1u << idx;
+}
+
+int PB_Get(unsigned int pb)
+{
+    (void)pb;
+    return 0;
+}
+
+/***** GPIO *****/
+void sim_gpio_set_input(int port, uint32_t mask, bool level)
+{
+    mxc_gpio_regs_t *gpio = &sim_gpio[port];
+    uint32_t before = gpio->in & mask;
+    uint32_t edges;
+
+    if (level) {
+        gpio->in |= mask;
+        edges = ~before & mask & gpio->int_rising;
+    } else {
+        gpio->in &= ~mask;
+        edges = before & gpio->int_falling;
+    }
+
+    edges &= gpio->inten;
+    if (edges != 0) {
+        gpio->intfl |= edges;
+        sim_raise_irq(MXC_GPIO_GET_IRQ(port));
+    }
+}
+
+int MXC_GPIO_Config(const mxc_gpio_cfg_t *cfg)
+{
+    hal_call();
+    return E_NO_ERROR;
+}
+
+void MXC_GPIO_RegisterCallback(const mxc_gpio_cfg_t *cfg, mxc_gpio_callback_fn callback,
+                               void *cbdata)
+{
+    for (int pin = 0; pin < 32; pin++) {
+        if (cfg->mask & (1u << pin)) {
+            gpio_cb[cfg->port->idx][pin].fn = callback;
+            gpio_cb[cfg->port->idx][pin].cbdata = cbdata;
+        }
+    }
+}
+
+int MXC_GPIO_IntConfig(const mxc_gpio_cfg_t *cfg, mxc_gpio_int_pol_t pol)
+{
+    hal_call();
+
+    cfg->port->int_falling &= ~cfg->mask;
+    cfg->port->int_rising &= ~cfg->mask;
+    if (pol == MXC_GPIO_INT_FALLING || pol == MXC_GPIO_INT_BOTH) {
+        cfg->port->int_falling |= cfg->mask;
+    }
+    if (pol == MXC_GPIO_INT_RISING || pol == MXC_GPIO_INT_BOTH) {
+        cfg->port->int_rising |= cfg->mask;
+    }
+
+    return E_NO_ERROR;
+}
+
+void MXC_GPIO_EnableInt(mxc_gpio_regs_t *port, uint32_t mask)
+{
+    port->inten |= mask;
+}
+
+void MXC_GPIO_DisableInt(mxc_gpio_regs_t *port, uint32_t mask)
+{
+    port->inten &= ~mask;
+}
+
+uint32_t MXC_GPIO_GetFlags(mxc_gpio_regs_t *port)
+{
+    return port->intfl;
+}
+
+void MXC_GPIO_ClearFlags(mxc_gpio_regs_t *port, uint32_t flags)
+{
+    port->intfl &= ~flags;
+}
+
+void MXC_GPIO_Handler(unsigned int port)
+{
+    mxc_gpio_regs_t *gpio = &sim_gpio[port];
+    uint32_t stat = gpio->intfl & gpio->inten;
+
+    gpio->intfl &= ~stat;
+
+    for (int pin = 0; pin < 32; pin++) {
+        if ((stat & (1u << pin)) && gpio_cb[port][pin].fn != NULL) {
+            gpio_cb[port][pin].fn(gpio_cb[port][pin].cbdata);
+        }
+    }
+}
+
+uint32_t MXC_GPIO_InGet(mxc_gpio_regs_t *port, uint32_t mask)
+{
+    return port->in & mask;
+}
+
+static void spi_gpio_cs_update(const mxc_gpio_regs_t *port);
+
+static void gpio_out_write(mxc_gpio_regs_t *port, uint32_t out)
+{
+    uint32_t changed = port->out ^ out;
+
+    for (int pin = 0; pin < 32; pin++) {
+        if (changed & (1u << pin)) {
+            gpio_out_changes[port->idx][pin]++;
+        }
+    }
+
+    port->out = out;
+    spi_gpio_cs_update(port);
+}
+
+void MXC_GPIO_OutSet(mxc_gpio_regs_t *port, uint32_t mask)
+{
+    gpio_out_write(port, port->out | mask);
+}
+
+void MXC_GPIO_OutClr(mxc_gpio_regs_t *port, uint32_t mask)
+{
+    gpio_out_write(port, port->out & ~mask);
+}
+
+void MXC_GPIO_OutToggle(mxc_gpio_regs_t *port, uint32_t mask)
+{
+    gpio_out_write(port, port->out ^ mask);
+}
+
+uint32_t sim_gpio_out_changes(int port, uint32_t mask)
+{
+    uint32_t changes = 0;
+
+    for (int pin = 0; pin < 32; pin++) {
+        if (mask & (1u << pin)) {
+            changes += gpio_out_changes[port][pin];
+        }
+    }
+
+    return changes;
+}
+
+/***** RTC *****/
+static uint64_t rtc_ticks_at(uint64_t t)
+{
+    unsigned __int128 elapsed;
+    int64_t ppm;
+
+    if (!rtc.running) {
+        return rtc.base_ticks;
+    }
+
+    ppm = rtc.crystal_ppm + (int64_t)rtc.trim * SIM_RTC_TRIM_PPM;
+    elapsed = (unsigned __int128)(t - rtc.base_ns) * SIM_RTC_HZ * (1000000 + ppm);
+
+    return rtc.base_ticks + (uint64_t)(elapsed / (SIM_NS_PER_SEC * 1000000ULL));
+}
+
+// simulated time at which the counter reaches ticks
+static uint64_t rtc_time_of(uint64_t ticks)
+{
+    unsigned __int128 ns;
+    int64_t ppm = rtc.crystal_ppm + (int64_t)rtc.trim * SIM_RTC_TRIM_PPM;
+    uint64_t rate = (uint64_t)SIM_RTC_HZ * (1000000 + ppm);
+
+    ns = (unsigned __int128)(ticks - rtc.base_ticks) * SIM_NS_PER_SEC * 1000000ULL;
+
+    return rtc.base_ns + (uint64_t)((ns + rate - 1) / rate);
+}
+
+static void rtc_rebase(void)
+{
+    rtc.base_ticks = rtc_ticks_at(now_ns);
+    rtc.base_ns = now_ns;
+}
+
+static uint64_t rtc_ssec_period(void)
+{
+    return (rtc.rssa == 0) ? (1ULL << 32) : (uint64_t)(0 - rtc.rssa);
+}
+
+static void rtc_alarm_event(void *arg);
+
+// event arguments of the two alarms
+#define RTC_EVENT_TOD ((void *)0)
+#define RTC_EVENT_SSEC ((void *)1)
+
+static void rtc_reschedule(void)
+{
+    uint64_t ticks = rtc_ticks_at(now_ns);
+
+    sim_cancel(rtc_alarm_event, RTC_EVENT_TOD);
+    sim_cancel(rtc_alarm_event, RTC_EVENT_SSEC);
+    if (!rtc.running) {
+        return;
+    }
+
+    if (rtc.ie & MXC_F_RTC_CTRL_TOD_ALARM_IE) {
+        uint64_t sec = ticks / SIM_RTC_HZ;
+        uint64_t delta = (rtc.ras - sec) & SIM_RTC_TOD_MASK;
+
+        if (delta == 0) {
+            delta = SIM_RTC_TOD_MASK + 1;
+        }
+        sim_schedule(rtc_time_of((sec + delta) * SIM_RTC_HZ), rtc_alarm_event, RTC_EVENT_TOD);
+    }
+
+    if (rtc.ie & MXC_F_RTC_CTRL_SSEC_ALARM_IE) {
+        uint64_t period = rtc_ssec_period();
+        uint64_t n = (ticks - rtc.ssec_start) / period + 1;
+
+        sim_schedule(rtc_time_of(rtc.ssec_start + n * period), rtc_alarm_event, RTC_EVENT_SSEC);
+    }
+}
+
+static void rtc_alarm_event(void *arg)
+{
+    rtc.flags |= (arg == RTC_EVENT_SSEC) ? MXC_F_RTC_CTRL_SSEC_ALARM : MXC_F_RTC_CTRL_TOD_ALARM;
+    sim_raise_irq(RTC_IRQn);
+    rtc_reschedule();
+}
+
+// register writes wait for the previous one to synchronize, like the MSDK driver
+static void rtc_write_begin(void)
+{
+    hal_call();
+    if (now_ns < rtc.busy_until) {
+        sim_advance(rtc.busy_until - now_ns);
+    }
+}
+
+static void rtc_write_end(void)
+{
+    rtc.busy_until = now_ns + SIM_RTC_BUSY_NS;
+    rtc_reschedule();
+    sim_advance(SIM_RTC_BUSY_NS);
+}
+
+void sim_rtc_set_ppm(int32_t ppm)
+{
+    rtc_rebase();
+    rtc.crystal_ppm = ppm;
+    rtc_reschedule();
+}
+
+void sim_rtc_stick_busy(bool stuck)
+{
+    rtc.stuck = stuck;
+}
+
+uint64_t sim_rtc_ticks(void)
+{
+    return rtc_ticks_at(now_ns);
+}
+
+// RDY is low, and the counters unreadable, just before each update
+static bool rtc_rdy_low(void)
+{
+    if (!rtc.running) {
+        return false;
+    }
+    return rtc.stuck || rtc_time_of(rtc_ticks_at(now_ns) + 1) - now_ns <= SIM_RTC_RDY_NS;
+}
+
+int MXC_RTC_Init(uint32_t sec, uint16_t ssec)
+{
+    rtc_write_begin();
+    rtc.running = false;
+    rtc.base_ns = now_ns;
+    rtc.base_ticks = (uint64_t)sec * SIM_RTC_HZ + (ssec % SIM_RTC_HZ);
+    rtc.flags = 0;
+    rtc_write_end();
+    return E_NO_ERROR;
+}
+
+int MXC_RTC_Start(void)
+{
+    rtc_write_begin();
+    rtc_rebase();
+    rtc.running = true;
+    rtc_write_end();
+    return E_NO_ERROR;
+}
+
+int MXC_RTC_Stop(void)
+{
+    rtc_write_begin();
+    rtc_rebase();
+    rtc.running = false;
+    rtc_write_end();
+    return E_NO_ERROR;
+}
+
+int MXC_RTC_GetFlags(void)
+{
+    return rtc.flags;
+}
+
+int MXC_RTC_ClearFlags(int flags)
+{
+    rtc.flags &= ~flags;
+    return E_NO_ERROR;
+}
+
+int MXC_RTC_EnableInt(uint32_t mask)
+{
+    rtc_write_begin();
+    if ((mask & MXC_F_RTC_CTRL_SSEC_ALARM_IE) && !(rtc.ie & MXC_F_RTC_CTRL_SSEC_ALARM_IE)) {
+        rtc.ssec_start = rtc_ticks_at(now_ns);
+    }
+    rtc.ie |= mask;
+    rtc_write_end();
+    return E_NO_ERROR;
+}
+
+int MXC_RTC_DisableInt(uint32_t mask)
+{
+    rtc_write_begin();
+    rtc.ie &= ~mask;
+    rtc_write_end();
+    return E_NO_ERROR;
+}
+
+int MXC_RTC_GetSeconds(uint32_t *sec)
+{
+    hal_call();
+    if (rtc_rdy_low()) {
+        return E_BUSY;
+    }
+    *sec = (uint32_t)(rtc_ticks_at(now_ns) / SIM_RTC_HZ);
+    return E_NO_ERROR;
+}
+
+int MXC_RTC_GetSubSeconds(uint32_t *ssec)
+{
+    hal_call();
+    if (rtc_rdy_low()) {
+        return E_BUSY;
+    }
+    *ssec = (uint32_t)(rtc_ticks_at(now_ns) % SIM_RTC_HZ);
+    return E_NO_ERROR;
+}
+
+int MXC_RTC_GetTime(uint32_t *sec, uint32_t *subsec)
+{
+    uint64_t ticks;
+
+    hal_call();
+    if (rtc_rdy_low()) {
+        return E_BUSY;
+    }
+    ticks = rtc_ticks_at(now_ns);
+    *sec = (uint32_t)(ticks / SIM_RTC_HZ);
+    *subsec = (uint32_t)(ticks % SIM_RTC_HZ);
+    return E_NO_ERROR;
+}
+
+int MXC_RTC_SetTimeofdayAlarm(uint32_t ras)
+{
+    rtc_write_begin();
+    rtc.ras = ras & SIM_RTC_TOD_MASK;
+    rtc_write_end();
+    return E_NO_ERROR;
+}
+
+int MXC_RTC_SetSubsecondAlarm(uint32_t rssa)
+{
+    rtc_write_begin();
+    rtc.rssa = rssa;
+    rtc.ssec_start = rtc_ticks_at(now_ns);
+    rtc_write_end();
+    return E_NO_ERROR;
+}
+
+int MXC_RTC_SquareWaveStart(mxc_rtc_freq_sel_t fq)
+{
+    (void)fq;
+    hal_call();
+    return E_NO_ERROR;
+}
+
+int MXC_RTC_SquareWaveStop(void)
+{
+    hal_call();
+    return E_NO_ERROR;
+}
+
+int MXC_RTC_Trim(int8_t trm)
+{
+    rtc_write_begin();
+    rtc_rebase();
+    rtc.trim = trm;
+    rtc_write_end();
+    return E_NO_ERROR;
+}
+
+/***** TMR *****/
+static uint32_t tmr_clock_hz(mxc_tmr_clock_t clock)
+{
+    switch (clock) {
+    case MXC_TMR_APB_CLK:
+    case MXC_TMR_ISO_CLK:
+        return SystemCoreClock / 2;
+    case MXC_TMR_IBRO_CLK:
+        return SIM_TMR_IBRO_HZ;
+    case MXC_TMR_ERTCO_CLK:
+        return SIM_TMR_ERTCO_HZ;
+    case MXC_TMR_INRO_CLK:
+        return SIM_TMR_INRO_HZ;
+    default:
+        return 0;
+    }
+}
+
+// counter ticks since base_ns
+static uint64_t tmr_ticks_since(const sim_tmr_t *t)
+{
+    unsigned __int128 ticks = (unsigned __int128)(now_ns - t->base_ns) * t->clock_hz;
+
+    return (uint64_t)(ticks / (SIM_NS_PER_SEC << t->pres));
+}
+
+static void tmr_rebase(sim_tmr_t *t)
+{
+    if (t->running) {
+        t->base_cnt += (uint32_t)tmr_ticks_since(t);
+        t->base_ns = now_ns;
+    }
+}
+
+static void tmr_event(void *arg);
+
+// the counter passes the compare value one tick after it reaches it
+static void tmr_reschedule(int idx)
+{
+    sim_tmr_t *t = &tmrs[idx];
+    uint64_t elapsed, ticks;
+    unsigned __int128 ns;
+
+    sim_cancel(tmr_event, (void *)(intptr_t)idx);
+    if (!t->running) {
+        return;
+    }
+
+    elapsed = tmr_ticks_since(t);
+    ticks = (uint32_t)(t->cmp - (t->base_cnt + (uint32_t)elapsed) + 1);
+    if (ticks == 0) {
+        ticks = 1ULL << 32;
+    }
+    ns = (unsigned __int128)(elapsed + ticks) * (SIM_NS_PER_SEC << t->pres);
+    sim_schedule(t->base_ns + (uint64_t)((ns + t->clock_hz - 1) / t->clock_hz), tmr_event,
+                 (void *)(intptr_t)idx);
+}
+
+static void tmr_event(void *arg)
+{
+    int idx = (int)(intptr_t)arg;
+    sim_tmr_t *t = &tmrs[idx];
+
+    t->flag = true;
+    if (t->ie) {
+        sim_raise_irq(MXC_TMR_GET_IRQ(idx));
+    }
+
+    t->base_cnt = 1;
+    t->base_ns = now_ns;
+    if (t->mode == TMR_MODE_ONESHOT) {
+        t->running = false;
+    }
+    tmr_reschedule(idx);
+}
+
+int MXC_TMR_Init(mxc_tmr_regs_t *tmr, mxc_tmr_cfg_t *cfg, bool init_pins)
+{
+    sim_tmr_t *t = &tmrs[tmr->idx];
+
+    hal_call();
+
+    if ((cfg->mode != TMR_MODE_ONESHOT && cfg->mode != TMR_MODE_CONTINUOUS) ||
+        cfg->bitMode != TMR_BIT_MODE_32) {
+        sim_error("TMR%d: only 32-bit one-shot and continuous modes are simulated", tmr->idx);
+        return E_NOT_SUPPORTED;
+    }
+    if (tmr_clock_hz(cfg->clock) == 0) {
+        return E_BAD_PARAM;
+    }
+
+    sim_cancel(tmr_event, (void *)(intptr_t)tmr->idx);
+    memset(t, 0x00, sizeof(*t));
+    t->init = true;
+    t->mode = cfg->mode;
+    t->clock_hz = tmr_clock_hz(cfg->clock);
+    t->lp_clock = (cfg->clock == MXC_TMR_ERTCO_CLK || cfg->clock == MXC_TMR_INRO_CLK);
+    t->pres = cfg->pres;
+    t->base_cnt = 1;
+    t->cmp = cfg->cmp_cnt;
+
+    return E_NO_ERROR;
+}
+
+void MXC_TMR_Shutdown(mxc_tmr_regs_t *tmr)
+{
+    hal_call();
+    sim_cancel(tmr_event, (void *)(intptr_t)tmr->idx);
+    memset(&tmrs[tmr->idx], 0x00, sizeof(tmrs[0]));
+}
+
+void MXC_TMR_Start(mxc_tmr_regs_t *tmr)
+{
+    sim_tmr_t *t = &tmrs[tmr->idx];
+
+    hal_call();
+    if (!t->init) {
+        sim_error("TMR%d started before MXC_TMR_Init()", tmr->idx);
+        return;
+    }
+    if (!t->running) {
+        t->running = true;
+        t->base_ns = now_ns;
+        tmr_reschedule(tmr->idx);
+    }
+}
+
+void MXC_TMR_Stop(mxc_tmr_regs_t *tmr)
+{
+    sim_tmr_t *t = &tmrs[tmr->idx];
+
+    hal_call();
+    tmr_rebase(t);
+    t->running = false;
+    tmr_reschedule(tmr->idx);
+}
+
+// register reads take time, so an interrupt can come between two of them
+uint32_t MXC_TMR_GetCount(mxc_tmr_regs_t *tmr)
+{
+    sim_tmr_t *t = &tmrs[tmr->idx];
+
+    sim_advance(SIM_TMR_READ_NS);
+    return t->running ? t->base_cnt + (uint32_t)tmr_ticks_since(t) : t->base_cnt;
+}
+
+void MXC_TMR_SetCount(mxc_tmr_regs_t *tmr, uint32_t cnt)
+{
+    sim_tmr_t *t = &tmrs[tmr->idx];
+
+    hal_call();
+    t->base_cnt = cnt;
+    t->base_ns = now_ns;
+    tmr_reschedule(tmr->idx);
+}
+
+uint32_t MXC_TMR_GetCompare(mxc_tmr_regs_t *tmr)
+{
+    return tmrs[tmr->idx].cmp;
+}
+
+void MXC_TMR_SetCompare(mxc_tmr_regs_t *tmr, uint32_t cmp_cnt)
+{
+    sim_tmr_t *t = &tmrs[tmr->idx];
+
+    hal_call();
+    t->cmp = cmp_cnt;
+    tmr_reschedule(tmr->idx);
+}
+
+uint32_t MXC_TMR_GetFlags(mxc_tmr_regs_t *tmr)
+{
+    sim_advance(SIM_TMR_READ_NS);
+    return tmrs[tmr->idx].flag ? 1 : 0;
+}
+
+void MXC_TMR_ClearFlags(mxc_tmr_regs_t *tmr)
+{
+    tmrs[tmr->idx].flag = false;
+}
+
+void MXC_TMR_EnableInt(mxc_tmr_regs_t *tmr)
+{
+    tmrs[tmr->idx].ie = true;
+}
+
+void MXC_TMR_DisableInt(mxc_tmr_regs_t *tmr)
+{
+    tmrs[tmr->idx].ie = false;
+}
+
+uint32_t MXC_TMR_GetPeriod(mxc_tmr_regs_t *tmr, mxc_tmr_clock_t clock, uint32_t prescalar,
+                           uint32_t frequency)
+{
+    if (prescalar == 0 || frequency == 0) {
+        return 0;
+    }
+
+    return tmr_clock_hz(clock) / (prescalar * frequency);
+}
+
+/***** UART *****/
+// 8N1: ten bit times per character
+static uint64_t uart_char_ns(void)
+{
+    return (uint64_t)10 * SIM_NS_PER_SEC / console_baud;
+}
+
+static void uart_update_irq(void)
+{
+    if (console_uart.int_en & console_uart.int_fl) {
+        sim_raise_irq(MXC_UART_GET_IRQ(CONSOLE_UART));
+    }
+}
+
+static void uart_tx_event(void *arg)
+{
+    (void)arg;
+
+    console_out(console_uart.fifo[console_uart.head]);
+    console_uart.head = (console_uart.head + 1) % MXC_UART_FIFO_DEPTH;
+    console_uart.count--;
+
+    if (console_uart.count <= MXC_UART_FIFO_DEPTH / 2) {
+        console_uart.int_fl |= MXC_F_UART_INT_FL_TX_HE;
+        uart_update_irq();
+    }
+    if (console_uart.count > 0) {
+        sim_schedule(now_ns + uart_char_ns(), uart_tx_event, NULL);
+    }
+}
+
+static bool uart_check(const mxc_uart_regs_t *uart)
+{
+    if (uart->idx != CONSOLE_UART) {
+        sim_error("UART%d is not simulated", uart->idx);
+        return false;
+    }
+    return true;
+}
+
+static void uart_push(uint8_t c)
+{
+    // baud 0: sent at once
+    if (console_baud == 0) {
+        console_out(c);
+        return;
+    }
+
+    console_uart.fifo[(console_uart.head + console_uart.count) % MXC_UART_FIFO_DEPTH] = c;
+    if (console_uart.count++ == 0) {
+        sim_schedule(now_ns + uart_char_ns(), uart_tx_event, NULL);
+    }
+}
+
+int MXC_UART_WriteCharacterRaw(mxc_uart_regs_t *uart, uint8_t character)
+{
+    if (!uart_check(uart)) {
+        return E_NOT_SUPPORTED;
+    }
+    if (console_uart.count == MXC_UART_FIFO_DEPTH) {
+        return E_OVERFLOW;
+    }
+
+    uart_push(character);
+    return E_NO_ERROR;
+}
+
+int MXC_UART_WriteCharacter(mxc_uart_regs_t *uart, uint8_t character)
+{
+    if (!uart_check(uart)) {
+        return E_NOT_SUPPORTED;
+    }
+
+    // busy-waits until the shifter makes room
+    while (console_uart.count == MXC_UART_FIFO_DEPTH) {
+        sim_advance(next_event_time() - now_ns);
+    }
+
+    uart_push(character);
+    return E_NO_ERROR;
+}
+
+unsigned int MXC_UART_GetTXFIFOAvailable(mxc_uart_regs_t *uart)
+{
+    hal_call();
+    if (!uart_check(uart)) {
+        return 0;
+    }
+    return MXC_UART_FIFO_DEPTH - console_uart.count;
+}
+
+int MXC_UART_GetActive(mxc_uart_regs_t *uart)
+{
+    hal_call();
+    if (!uart_check(uart)) {
+        return E_NOT_SUPPORTED;
+    }
+    return (console_uart.count != 0) ? E_BUSY : E_NO_ERROR;
+}
+
+int MXC_UART_EnableInt(mxc_uart_regs_t *uart, unsigned int mask)
+{
+    if (!uart_check(uart)) {
+        return E_NOT_SUPPORTED;
+    }
+
+    console_uart.int_en |= mask;
+    uart_update_irq();
+    return E_NO_ERROR;
+}
+
+int MXC_UART_DisableInt(mxc_uart_regs_t *uart, unsigned int mask)
+{
+    if (!uart_check(uart)) {
+        return E_NOT_SUPPORTED;
+    }
+
+    console_uart.int_en &= ~mask;
+    return E_NO_ERROR;
+}
+
+unsigned int MXC_UART_GetFlags(mxc_uart_regs_t *uart)
+{
+    if (!uart_check(uart)) {
+        return 0;
+    }
+    return console_uart.int_fl;
+}
+
+int MXC_UART_ClearFlags(mxc_uart_regs_t *uart, unsigned int flags)
+{
+    if (!uart_check(uart)) {
+        return E_NOT_SUPPORTED;
+    }
+
+    console_uart.int_fl &= ~flags;
+    return E_NO_ERROR;
+}
+
+/***** SPI *****/
+static sim_spi_port_t *spi_port(mxc_spi_regs_t *spi)
+{
+    return &spi_ports[spi->idx];
+}
+
+static IRQn_Type spi_irq(int idx)
+{
+    switch (idx) {
+    case 0:
+        return SPI0_IRQn;
+    case 1:
+        return SPI1_IRQn;
+    default:
+        return SPI4_IRQn;
+    }
+}
+
+void sim_spi_attach(int spiIdx, int ssIdx, const sim_spi_device_t *dev)
+{
+    spi_ports[spiIdx].dev[ssIdx] = dev;
+}
+
+void sim_spi_set_link_hz(int spiIdx, unsigned int hz)
+{
+    spi_ports[spiIdx].link_hz = hz;
+}
+
+void sim_spi_attach_gpio(int spiIdx, int port, uint32_t mask, const sim_spi_device_t *dev)
+{
+    sim_spi_gpio_cs_t *cs;
+
+    if (spi_gpio_cs_count == SIM_SPI_GPIO_CS_COUNT) {
+        sim_error("%s: too many GPIO chip enables", dev->name);
+        return;
+    }
+
+    cs = &spi_gpio_cs[spi_gpio_cs_count++];
+    cs->spi_idx = spiIdx;
+    cs->port = port;
+    cs->mask = mask;
+    cs->selected = false;
+    cs->dev = dev;
+}
+
+// reports chip-enable edges of the devices on GPIO outputs of port
+static void spi_gpio_cs_update(const mxc_gpio_regs_t *port)
+{
+    for (int i = 0; i < spi_gpio_cs_count; i++) {
+        sim_spi_gpio_cs_t *cs = &spi_gpio_cs[i];
+        bool level = (sim_gpio[cs->port].out & cs->mask) != 0;
+        bool selected = (level == cs->dev->ce_active_high);
+
+        if (cs->port != port->idx || selected == cs->selected) {
+            continue;
+        }
+        if (spi_ports[cs->spi_idx].active != NULL) {
+            sim_error("%s: chip enable changed during a transaction", cs->dev->name);
+        }
+        cs->selected = selected;
+        if (cs->dev->select != NULL) {
+            cs->dev->select(cs->dev->ctx, selected);
+        }
+    }
+}
+
+static void spi_select(sim_spi_port_t *port, int ssIdx, bool active)
+{
+    const sim_spi_device_t *dev = port->dev[ssIdx];
+
+    if (dev != NULL && dev->select != NULL) {
+        dev->select(dev->ctx, active);
+    }
+}
+
+// checks the request, asserts chip select and shifts all bytes; returns the duration
+static int spi_start(mxc_spi_req_t *req, uint64_t *duration)
+{
+    sim_spi_port_t *port = spi_port(req->spi);
+    const sim_spi_device_t *dev;
+    uint32_t len = (req->txLen > req->rxLen) ? req->txLen : req->rxLen;
+
+    if (!port->init) {
+        sim_error("SPI%d transaction before MXC_SPI_Init()", req->spi->idx);
+        return E_UNINITIALIZED;
+    }
+    if (port->active != NULL) {
+        return E_BUSY;
+    }
+    if (req->ssIdx < 0 || req->ssIdx >= SIM_SPI_SS_COUNT || len > SIM_SPI_MAX_LEN) {
+        sim_error("SPI%d request with ssIdx %d, length %u", req->spi->idx, req->ssIdx,
+                  (unsigned)len);
+        return E_BAD_PARAM;
+    }
+
+    // a GPIO chip enable shares MISO with the slave selects
+    dev = port->dev[req->ssIdx];
+    for (int i = 0; i < spi_gpio_cs_count; i++) {
+        if (spi_gpio_cs[i].spi_idx != port - spi_ports || !spi_gpio_cs[i].selected) {
+            continue;
+        }
+        if (dev != NULL) {
+            sim_error("%s and %s selected together, MISO contention", dev->name,
+                      spi_gpio_cs[i].dev->name);
+        }
+        dev = spi_gpio_cs[i].dev;
+    }
+
+    if (dev != NULL) {
+        if (port->hz > dev->max_hz) {
+            sim_error("%s: SCLK %u Hz above its %u Hz limit", dev->name, port->hz, dev->max_hz);
+        }
+        if (!(dev->mode_mask & (1u << port->mode))) {
+            sim_error("%s: SPI mode %d not supported", dev->name, port->mode);
+        }
+        if (port->data_size != 8) {
+            sim_error("%s: %d-bit frames, the device expects 8", dev->name, port->data_size);
+        }
+        if ((port->ss_polarity != 0) != dev->ce_active_high) {
+            sim_error("%s: chip select polarity does not match the device", dev->name);
+        }
+    }
+
+    spi_select(port, req->ssIdx, true);
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t mosi = (req->txData != NULL && i < req->txLen) ? req->txData[i] : 0x00;
+        uint8_t miso = (dev != NULL) ? dev->exchange(dev->ctx, mosi) : 0xFF;
+
+        // too fast for the wiring: MISO is sampled one bit late
+        if (port->link_hz != 0 && port->hz > port->link_hz) {
+            miso = (miso >> 1) | 0x80;
+        }
+
+        port->rx[i] = miso;
+    }
+
+    port->active = req;
+    port->done = false;
+    stats.spi_transactions++;
+    stats.spi_bytes += len;
+
+    *duration = SIM_SPI_SETUP_NS + (uint64_t)len * 8 * SIM_NS_PER_SEC / port->hz;
+    return E_NO_ERROR;
+}
+
+// deasserts chip select and hands the received bytes to the request
+static void spi_finish(sim_spi_port_t *port)
+{
+    mxc_spi_req_t *req = port->active;
+
+    if (req->ssDeassert) {
+        spi_select(port, req->ssIdx, false);
+    }
+    if (req->rxData != NULL) {
+        memcpy(req->rxData, port->rx, req->rxLen);
+    }
+    req->txCnt = req->txLen;
+    req->rxCnt = req->rxLen;
+}
+
+static void spi_done_event(void *arg)
+{
+    sim_spi_port_t *port = arg;
+
+    if (port->active == NULL) {
+        return; // aborted
+    }
+
+    spi_finish(port);
+    port->done = true;
+
+    if (port->kind == SIM_SPI_DMA) {
+        // TX and RX channels both complete
+        sim_raise_irq(DMA0_IRQn);
+        sim_raise_irq(DMA1_IRQn);
+    } else {
+        sim_raise_irq(spi_irq(port - spi_ports));
+    }
+}
+
+// completion in interrupt context, the callback may start the next transaction
+static void spi_complete(sim_spi_port_t *port)
+{
+    mxc_spi_req_t *req = port->active;
+
+    port->active = NULL;
+    port->done = false;
+    port->kind = SIM_SPI_IDLE;
+
+    if (req->completeCB != NULL) {
+        req->completeCB(req, E_NO_ERROR);
+    }
+}
+
+int MXC_SPI_Init(mxc_spi_regs_t *spi, int masterMode, int quadModeUsed, int numSlaves,
+                 unsigned ssPolarity, unsigned int hz, mxc_spi_pins_t pins)
+{
+    sim_spi_port_t *port = spi_port(spi);
+
+    hal_call();
+
+    if (hz == 0 || !masterMode) {
+        return E_BAD_PARAM;
+    }
+
+    port->init = true;
+    port->hz = hz;
+    port->mode = SPI_MODE_0;
+    port->data_size = 8;
+    port->ss_polarity = ssPolarity;
+    port->active = NULL;
+    port->kind = SIM_SPI_IDLE;
+    return E_NO_ERROR;
+}
+
+int MXC_SPI_Shutdown(mxc_spi_regs_t *spi)
+{
+    spi_port(spi)->init = false;
+    return E_NO_ERROR;
+}
+
+int MXC_SPI_SetMode(mxc_spi_regs_t *spi, mxc_spi_mode_t spiMode)
+{
+    hal_call();
+    spi_port(spi)->mode = spiMode;
+    return E_NO_ERROR;
+}
+
+int MXC_SPI_SetDataSize(mxc_spi_regs_t *spi, int dataSize)
+{
+    hal_call();
+    if (dataSize < 1 || dataSize > 16) {
+        return E_BAD_PARAM;
+    }
+    spi_port(spi)->data_size = dataSize;
+    return E_NO_ERROR;
+}
+
+int MXC_SPI_GetDataSize(mxc_spi_regs_t *spi)
+{
+    return spi_port(spi)->data_size;
+}
+
+int MXC_SPI_SetWidth(mxc_spi_regs_t *spi, mxc_spi_width_t spiWidth)
+{
+    hal_call();
+    return (spiWidth == SPI_WIDTH_STANDARD) ? E_NO_ERROR : E_NOT_SUPPORTED;
+}
+
+int MXC_SPI_SetFrequency(mxc_spi_regs_t *spi, unsigned int hz)
+{
+    hal_call();
+    if (hz == 0) {
+        return E_BAD_PARAM;
+    }
+    spi_port(spi)->hz = hz;
+    return E_NO_ERROR;
+}
+
+unsigned int MXC_SPI_GetFrequency(mxc_spi_regs_t *spi)
+{
+    return spi_port(spi)->hz;
+}
+
+int MXC_SPI_SetSlave(mxc_spi_regs_t *spi, int ssIdx)
+{
+    return (ssIdx >= 0 && ssIdx < SIM_SPI_SS_COUNT) ? E_NO_ERROR : E_BAD_PARAM;
+}
+
+int MXC_SPI_GetActive(mxc_spi_regs_t *spi)
+{
+    return (spi_port(spi)->active != NULL) ? E_BUSY : E_NO_ERROR;
+}
+
+int MXC_SPI_AbortTransmission(mxc_spi_regs_t *spi)
+{
+    sim_spi_port_t *port = spi_port(spi);
+
+    if (port->active != NULL) {
+        sim_cancel(spi_done_event, port);
+        spi_select(port, port->active->ssIdx, false);
+        port->active = NULL;
+        port->done = false;
+        port->kind = SIM_SPI_IDLE;
+    }
+    return E_NO_ERROR;
+}
+
+void MXC_SPI_ClearRXFIFO(mxc_spi_regs_t *spi) {}
+
+int MXC_SPI_MasterTransaction(mxc_spi_req_t *req)
+{
+    sim_spi_port_t *port = spi_port(req->spi);
+    uint64_t duration;
+    int retVal;
+
+    hal_call();
+
+    retVal = spi_start(req, &duration);
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+    // the driver polls the FIFOs, interrupts still run meanwhile
+    sim_advance(duration);
+    spi_finish(port);
+    port->active = NULL;
+
+    return E_NO_ERROR;
+}
+
+int MXC_SPI_MasterTransactionAsync(mxc_spi_req_t *req)
+{
+    sim_spi_port_t *port = spi_port(req->spi);
+    uint64_t duration;
+    int retVal;
+
+    hal_call();
+
+    retVal = spi_start(req, &duration);
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+    port->kind = SIM_SPI_ASYNC;
+    sim_schedule(now_ns + duration, spi_done_event, port);
+    return E_NO_ERROR;
+}
+
+int MXC_SPI_MasterTransactionDMA(mxc_spi_req_t *req)
+{
+    sim_spi_port_t *port = spi_port(req->spi);
+    uint64_t duration;
+    int retVal;
+
+    hal_call();
+
+    retVal = spi_start(req, &duration);
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+    port->kind = SIM_SPI_DMA;
+    sim_schedule(now_ns + duration, spi_done_event, port);
+    return E_NO_ERROR;
+}
+
+void MXC_SPI_AsyncHandler(mxc_spi_regs_t *spi)
+{
+    sim_spi_port_t *port = spi_port(spi);
+
+    if (port->kind == SIM_SPI_ASYNC && port->done) {
+        spi_complete(port);
+    }
+}
+
+/***** DMA *****/
+int MXC_DMA_Init(void)
+{
+    return E_NO_ERROR;
+}
+
+int MXC_DMA_AcquireChannel(void)
+{
+    return 0;
+}
+
+int MXC_DMA_ReleaseChannel(int ch)
+{
+    return E_NO_ERROR;
+}
+
+void MXC_DMA_Handler(void)
+{
+    for (int i = 0; i < SIM_SPI_PORTS; i++) {
+        if (spi_ports[i].kind == SIM_SPI_DMA && spi_ports[i].done) {
+            spi_complete(&spi_ports[i]);
+        }
+    }
+}
+
+/***** Low power *****/
+void MXC_LP_ClearWakeStatus(void) {}
+
+void MXC_LP_EnableRTCAlarmWakeup(void)
+{
+    wake_sources |= irq_bit(RTC_IRQn);
+}
+
+void MXC_LP_DisableRTCAlarmWakeup(void)
+{
+    wake_sources &= ~irq_bit(RTC_IRQn);
+}
+
+void MXC_LP_EnableGPIOWakeup(const mxc_gpio_cfg_t *wu_pins)
+{
+    wake_sources |= irq_bit(MXC_GPIO_GET_IRQ(MXC_GPIO_GET_IDX(wu_pins->port)));
+}
+
+void MXC_LP_DisableGPIOWakeup(const mxc_gpio_cfg_t *wu_pins)
+{
+    wake_sources &= ~irq_bit(MXC_GPIO_GET_IRQ(MXC_GPIO_GET_IDX(wu_pins->port)));
+}
+
+void MXC_LP_EnterSleepMode(void)
+{
+    __WFI();
+}
+
+// what STANDBY stops mid-way is lost on the board: reported, not modelled
+static bool standby_check(void)
+{
+    bool ok = true;
+
+    if (console_uart.count != 0) {
+        sim_error("STANDBY with %d characters left in the console UART FIFO",
+                  console_uart.count);
+        ok = false;
+    }
+    for (int i = 0; i < SIM_SPI_PORTS; i++) {
+        if (spi_ports[i].active != NULL) {
+            sim_error("SPI%d: STANDBY during a transaction", i);
+            ok = false;
+        }
+    }
+    for (int i = 0; i < SIM_TMR_COUNT; i++) {
+        if (tmrs[i].running && !tmrs[i].lp_clock) {
+            sim_error("TMR%d: STANDBY stops its clock while it runs", i);
+            ok = false;
+        }
+    }
+    if ((wake_sources & irq_enabled) == 0) {
+        sim_error("STANDBY without an enabled wake-up source, the board would not wake");
+        ok = false;
+    }
+    return ok;
+}
+
+void MXC_LP_EnterStandbyMode(void)
+{
+    uint64_t start;
+
+    hal_call();
+    if (!standby_check()) {
+        return;
+    }
+
+    stats.standbys++;
+    start = now_ns;
+    sleep_until_irq(wake_sources);
+    stats.standby_ns += now_ns - start;
+
+    advance_to(now_ns + SIM_STANDBY_WAKE_NS);
+    dispatch();
+}
@@ -0,0 +1,175 @@
+/**
+ * @file    hal_sim.h
+ * @brief   Simulated clock, interrupt controller and peripherals for the host build
+ * @details The firmware runs unmodified against the fake MSDK headers in
+ *          include/. Time only moves when the firmware spends it: a bus
+ *          transfer, a busy wait, printing, a DWT read, or sleeping in
+ *          WFI/WFE or STANDBY (which jump straight to the next scheduled
+ *          event).
+ *          Interrupts are serviced whenever simulated time passes in thread
+ *          mode with PRIMASK clear, so ISRs interleave with main() the way they
+ *          do on the board, only at call boundaries instead of any instruction.
+ */
+
+#ifndef HAL_SIM_H_
+#define HAL_SIM_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mxc_device.h"
+#include "spi.h"
+
+/***** Definitions *****/
+#define SIM_NS_PER_SEC 1000000000ULL
+#define SIM_MS(ms) ((uint64_t)(ms) * 1000000ULL)
+#define SIM_US(us) ((uint64_t)(us) * 1000ULL)
+
+// RTC frequency correction per MXC_RTC_Trim() step
+#define SIM_RTC_TRIM_PPM 1
+
+// leaving STANDBY until the first handler runs: the IPO restarts and settles
+#define SIM_STANDBY_WAKE_NS 20000
+
+// how sim_run() ended
+#define SIM_END_TIME_LIMIT 0 // the time limit was reached
+#define SIM_END_RETURNED 1 // the firmware's main() returned
+#define SIM_END_FAULT 2 // unhandled interrupt, the board would hang
+
+typedef void (*sim_event_fn)(void *arg);
+
+/*
+ * A device on a simulated SPI bus. select() reports chip-select edges,
+ * exchange() shifts one byte in each direction.
+ */
+typedef struct {
+    const char *name;
+    unsigned int max_hz; // fastest SCLK the device accepts
+    uint8_t mode_mask; // supported SPI modes, bit n for SPI_MODE_n
+    bool ce_active_high; // chip enable polarity
+    void (*select)(void *ctx, bool active);
+    uint8_t (*exchange)(void *ctx, uint8_t mosi);
+    void *ctx;
+} sim_spi_device_t;
+
+typedef struct {
+    uint64_t awake_ns; // time the core ran
+    uint64_t asleep_ns; // time the core slept in WFI/WFE
+    uint32_t wfi; // WFI executed
+    uint32_t wfe; // WFE executed
+    uint32_t standbys; // MXC_LP_EnterStandbyMode() calls that slept
+    uint64_t standby_ns; // part of asleep_ns spent in STANDBY
+    uint32_t irqs[MXC_IRQ_COUNT]; // handlers run, per IRQ number
+    uint32_t spi_transactions;
+    uint32_t spi_bytes;
+    uint32_t console_chars;
+    uint32_t errors; // protocol violations reported with sim_error()
+} sim_stats_t;
+
+/***** Functions *****/
+/*
+ * Resets the simulated board; the run ends at end_ns.
+ */
+void sim_init(uint64_t end_ns);
+
+/*
+ * Runs entry (the firmware's main()) until it returns or the time limit is
+ * reached. Returns SIM_END_*.
+ */
+int sim_run(int (*entry)(void));
+
+uint64_t sim_now(void);
+
+/*
+ * Spends ns of simulated time awake (bus transfer, busy wait, ...).
+ */
+void sim_advance(uint64_t ns);
+
+/*
+ * Calls fn(arg) at simulated time at. Events run in time order, from the
+ * simulation loop, never from inside another event.
+ */
+void sim_schedule(uint64_t at, sim_event_fn fn, void *arg);
+
+/*
+ * Removes the scheduled events that match fn and arg.
+ */
+void sim_cancel(sim_event_fn fn, void *arg);
+
+void sim_raise_irq(IRQn_Type irq);
+
+/*
+ * Reports a protocol violation (wrong SPI mode, transaction while busy, ...).
+ * The run continues; any error fails the run.
+ */
+void sim_error(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+const sim_stats_t *sim_get_stats(void);
+
+/*
+ * Connects dev to chip select ssIdx of SPI instance spiIdx.
+ */
+void sim_spi_attach(int spiIdx, int ssIdx, const sim_spi_device_t *dev);
+
+/*
+ * Limits the clock the wiring of SPI instance spiIdx carries: above hz, the
+ * bytes read are shifted by one bit. 0 removes the limit (default).
+ */
+void sim_spi_set_link_hz(int spiIdx, unsigned int hz);
+
+/*
+ * Connects dev to SPI instance spiIdx with its chip enable on the GPIO output
+ * mask of port. The firmware selects it with MXC_GPIO_OutSet/OutClr and a
+ * slave select that has no device attached.
+ */
+void sim_spi_attach_gpio(int spiIdx, int port, uint32_t mask, const sim_spi_device_t *dev);
+
+/*
+ * Drives the input level of the pins in mask, firing edge interrupts.
+ */
+void sim_gpio_set_input(int port, uint32_t mask, bool level);
+
+/*
+ * Level changes the firmware drove on the output pins in mask, all pins added.
+ */
+uint32_t sim_gpio_out_changes(int port, uint32_t mask);
+
+/*
+ * Frequency error of the 32 kHz crystal in ppm (positive runs fast).
+ * MXC_RTC_Trim() corrects it in steps of SIM_RTC_TRIM_PPM.
+ */
+void sim_rtc_set_ppm(int32_t ppm);
+
+/*
+ * Holds the RTC's RDY bit low, so every counter read returns E_BUSY, until
+ * called with false. For testing the firmware's bounded retries.
+ */
+void sim_rtc_stick_busy(bool stuck);
+
+/*
+ * The RTC counter in 1/4096 s, read without a driver call (no time spent,
+ * never busy): the reference for tests.
+ */
+uint64_t sim_rtc_ticks(void);
+
+/*
+ * Printing speed of the console; 0 makes printing free.
+ * quiet drops the firmware's output (the time is still spent).
+ */
+void sim_console_config(uint32_t baud, bool quiet);
+
+/*
+ * Copies everything the firmware sends on the console, text and binary
+ * telemetry alike, to capture; NULL stops copying.
+ */
+void sim_console_capture(FILE *capture);
+
+/*
+ * Hands every character the firmware sends on the console to watch, as it
+ * leaves the UART; NULL stops it.
+ */
+void sim_console_watch(void (*watch)(uint8_t c));
+
+#endif // HAL_SIM_H_
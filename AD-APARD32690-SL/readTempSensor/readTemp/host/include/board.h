@@ -0,0 +1,15 @@
+/**
+ * @file    board.h
+ * @brief   Host simulation stand-in for the MSDK board header
+ */
+
+#ifndef BOARD_H_
+#define BOARD_H_
+
+#include "mxc_device.h"
+
+#define CONSOLE_UART 0 // stdout
+
+int Board_Init(void);
+
+#endif // BOARD_H_
@@ -0,0 +1,19 @@
+/**
+ * @file    dma.h
+ * @brief   Host simulation stand-in for the MSDK DMA driver
+ * @details Only what the SPI driver's DMA mode needs: a finished SPI DMA
+ *          transaction raises DMA0_IRQn and DMA1_IRQn, and MXC_DMA_Handler()
+ *          runs the request's completion callback.
+ */
+
+#ifndef DMA_H_
+#define DMA_H_
+
+#include "mxc_device.h"
+
+int MXC_DMA_Init(void);
+int MXC_DMA_AcquireChannel(void);
+int MXC_DMA_ReleaseChannel(int ch);
+void MXC_DMA_Handler(void);
+
+#endif // DMA_H_
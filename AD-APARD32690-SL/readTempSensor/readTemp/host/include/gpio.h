@@ -0,0 +1,107 @@
+/**
+ * @file    gpio.h
+ * @brief   Host simulation stand-in for the MSDK GPIO driver
+ * @details Input levels are driven by the simulation (see sim_gpio_set_input()
+ *          in hal_sim.h); edges that match the configured polarity set the
+ *          port's interrupt flags and pend GPIOn_IRQn.
+ */
+
+#ifndef GPIO_H_
+#define GPIO_H_
+
+/***** Includes *****/
+#include "mxc_device.h"
+
+/***** Definitions *****/
+#define SIM_GPIO_PORTS 4
+
+typedef struct {
+    int idx; // port number
+    uint32_t out; // output levels
+    uint32_t in; // input levels
+    uint32_t inten; // interrupt enables
+    uint32_t intfl; // interrupt flags
+    uint32_t int_falling; // pins that interrupt on a falling edge
+    uint32_t int_rising; // pins that interrupt on a rising edge
+} mxc_gpio_regs_t;
+
+extern mxc_gpio_regs_t sim_gpio[SIM_GPIO_PORTS];
+
+#define MXC_GPIO0 (&sim_gpio[0])
+#define MXC_GPIO1 (&sim_gpio[1])
+#define MXC_GPIO2 (&sim_gpio[2])
+#define MXC_GPIO3 (&sim_gpio[3])
+
+#define MXC_GPIO_PIN_0 (1u << 0)
+#define MXC_GPIO_PIN_1 (1u << 1)
+#define MXC_GPIO_PIN_2 (1u << 2)
+#define MXC_GPIO_PIN_3 (1u << 3)
+#define MXC_GPIO_PIN_4 (1u << 4)
+#define MXC_GPIO_PIN_5 (1u << 5)
+#define MXC_GPIO_PIN_6 (1u << 6)
+#define MXC_GPIO_PIN_7 (1u << 7)
+#define MXC_GPIO_PIN_27 (1u << 27)
+
+#define MXC_GPIO_GET_IDX(p) ((p)->idx)
+#define MXC_GPIO_GET_GPIO(i) (&sim_gpio[i])
+#define MXC_GPIO_GET_IRQ(i) ((IRQn_Type)(GPIO0_IRQn + (i)))
+
+typedef enum {
+    MXC_GPIO_FUNC_IN,
+    MXC_GPIO_FUNC_OUT,
+    MXC_GPIO_FUNC_ALT1,
+    MXC_GPIO_FUNC_ALT2,
+    MXC_GPIO_FUNC_ALT3,
+} mxc_gpio_func_t;
+
+typedef enum {
+    MXC_GPIO_PAD_NONE,
+    MXC_GPIO_PAD_PULL_UP,
+    MXC_GPIO_PAD_PULL_DOWN,
+} mxc_gpio_pad_t;
+
+typedef enum {
+    MXC_GPIO_VSSEL_VDDIO,
+    MXC_GPIO_VSSEL_VDDIOH,
+} mxc_gpio_vssel_t;
+
+typedef enum {
+    MXC_GPIO_DRVSTR_0,
+    MXC_GPIO_DRVSTR_1,
+    MXC_GPIO_DRVSTR_2,
+    MXC_GPIO_DRVSTR_3,
+} mxc_gpio_drvstr_t;
+
+typedef enum {
+    MXC_GPIO_INT_FALLING,
+    MXC_GPIO_INT_RISING,
+    MXC_GPIO_INT_BOTH,
+} mxc_gpio_int_pol_t;
+
+typedef struct {
+    mxc_gpio_regs_t *port;
+    uint32_t mask;
+    mxc_gpio_func_t func;
+    mxc_gpio_pad_t pad;
+    mxc_gpio_vssel_t vssel;
+    mxc_gpio_drvstr_t drvstr;
+} mxc_gpio_cfg_t;
+
+typedef void (*mxc_gpio_callback_fn)(void *cbdata);
+
+/***** Functions *****/
+int MXC_GPIO_Config(const mxc_gpio_cfg_t *cfg);
+void MXC_GPIO_RegisterCallback(const mxc_gpio_cfg_t *cfg, mxc_gpio_callback_fn callback,
+                               void *cbdata);
+int MXC_GPIO_IntConfig(const mxc_gpio_cfg_t *cfg, mxc_gpio_int_pol_t pol);
+void MXC_GPIO_EnableInt(mxc_gpio_regs_t *port, uint32_t mask);
+void MXC_GPIO_DisableInt(mxc_gpio_regs_t *port, uint32_t mask);
+uint32_t MXC_GPIO_GetFlags(mxc_gpio_regs_t *port);
+void MXC_GPIO_ClearFlags(mxc_gpio_regs_t *port, uint32_t flags);
+void MXC_GPIO_Handler(unsigned int port);
+uint32_t MXC_GPIO_InGet(mxc_gpio_regs_t *port, uint32_t mask);
+void MXC_GPIO_OutSet(mxc_gpio_regs_t *port, uint32_t mask);
+void MXC_GPIO_OutClr(mxc_gpio_regs_t *port, uint32_t mask);
+void MXC_GPIO_OutToggle(mxc_gpio_regs_t *port, uint32_t mask);
+
+#endif // GPIO_H_
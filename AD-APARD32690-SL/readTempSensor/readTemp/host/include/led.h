@@ -0,0 +1,18 @@
+/**
+ * @file    led.h
+ * @brief   Host simulation stand-in for the MSDK LED driver
+ */
+
+#ifndef LED_H_
+#define LED_H_
+
+#define LED1 0
+#define LED2 1
+#define LED_RED LED1
+#define LED_GREEN LED2
+
+void LED_On(unsigned int idx);
+void LED_Off(unsigned int idx);
+void LED_Toggle(unsigned int idx);
+
+#endif // LED_H_
@@ -0,0 +1,24 @@
+/**
+ * @file    lp.h
+ * @brief   Host simulation stand-in for the MSDK low-power driver
+ */
+
+#ifndef LP_H_
+#define LP_H_
+
+#include "gpio.h"
+
+void MXC_LP_ClearWakeStatus(void);
+void MXC_LP_EnableRTCAlarmWakeup(void);
+void MXC_LP_DisableRTCAlarmWakeup(void);
+void MXC_LP_EnableGPIOWakeup(const mxc_gpio_cfg_t *wu_pins);
+void MXC_LP_DisableGPIOWakeup(const mxc_gpio_cfg_t *wu_pins);
+
+/*
+ * SLEEP is WFI. STANDBY stops every clock but the RTC's (and the INRO) and
+ * keeps the SRAM; only the enabled wake-up sources end it.
+ */
+void MXC_LP_EnterSleepMode(void);
+void MXC_LP_EnterStandbyMode(void);
+
+#endif // LP_H_
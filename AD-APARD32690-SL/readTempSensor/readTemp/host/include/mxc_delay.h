@@ -0,0 +1,19 @@
+/**
+ * @file    mxc_delay.h
+ * @brief   Host simulation stand-in for the MSDK delay functions
+ * @details MXC_Delay() is a busy wait: the simulated clock advances and
+ *          interrupts are still serviced, unless called from a handler.
+ */
+
+#ifndef MXC_DELAY_H_
+#define MXC_DELAY_H_
+
+#include <stdint.h>
+
+#define MXC_DELAY_SEC(s) ((s) * 1000000UL)
+#define MXC_DELAY_MSEC(ms) ((ms) * 1000UL)
+#define MXC_DELAY_USEC(us) (us)
+
+int MXC_Delay(uint32_t us);
+
+#endif // MXC_DELAY_H_
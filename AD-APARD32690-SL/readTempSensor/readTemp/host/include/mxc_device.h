@@ -0,0 +1,84 @@
+/**
+ * @file    mxc_device.h
+ * @brief   Host simulation stand-in for the MSDK device header
+ * @details Core intrinsics (WFI, WFE, SEV, PRIMASK), the NVIC and the DWT cycle
+ *          counter are implemented by hal_sim.c on top of the simulated clock.
+ */
+
+#ifndef MXC_DEVICE_H_
+#define MXC_DEVICE_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mxc_errors.h"
+
+/***** Definitions *****/
+// the simulation models the AD-APARD32690-SL
+#define TARGET_NUM 32690
+#define TARGET_REV 0x4131
+
+#define TRUE 1
+#define FALSE 0
+
+typedef enum {
+    SPI0_IRQn = 16,
+    SPI1_IRQn,
+    SPI4_IRQn,
+    RTC_IRQn,
+    GPIO0_IRQn,
+    GPIO1_IRQn,
+    GPIO2_IRQn,
+    DMA0_IRQn,
+    DMA1_IRQn,
+    DMA2_IRQn,
+    DMA3_IRQn,
+    TMR0_IRQn,
+    TMR1_IRQn,
+    TMR2_IRQn,
+    TMR3_IRQn,
+    TMR4_IRQn,
+    TMR5_IRQn,
+    UART0_IRQn,
+    MXC_IRQ_COUNT
+} IRQn_Type;
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+#define DWT_CTRL_CYCCNTENA_Msk (1u << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk (1u << 24)
+
+// every access to DWT refreshes CYCCNT from the simulated clock
+#define DWT (sim_dwt_sync())
+#define CoreDebug (&sim_coredebug)
+
+extern CoreDebug_Type sim_coredebug;
+extern uint32_t SystemCoreClock;
+
+/***** Functions *****/
+DWT_Type *sim_dwt_sync(void);
+
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+void NVIC_SetPendingIRQ(IRQn_Type irq);
+void NVIC_ClearPendingIRQ(IRQn_Type irq);
+
+void __WFI(void);
+void __WFE(void);
+void __SEV(void);
+void __DSB(void);
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+
+#endif // MXC_DEVICE_H_
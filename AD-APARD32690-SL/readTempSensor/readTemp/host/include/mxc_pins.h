@@ -0,0 +1,4 @@
+/**
+ * @file    mxc_pins.h
+ * @brief   Host simulation stand-in for the MSDK pin definitions (unused)
+ */
@@ -0,0 +1,14 @@
+/**
+ * @file    nvic_table.h
+ * @brief   Host simulation stand-in for the MSDK vector table API
+ */
+
+#ifndef NVIC_TABLE_H_
+#define NVIC_TABLE_H_
+
+#include "mxc_device.h"
+
+void MXC_NVIC_SetVector(IRQn_Type irq, void (*handler)(void));
+void NVIC_SetRAM(void);
+
+#endif // NVIC_TABLE_H_
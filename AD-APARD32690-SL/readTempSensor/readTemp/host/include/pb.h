@@ -0,0 +1,11 @@
+/**
+ * @file    pb.h
+ * @brief   Host simulation stand-in for the MSDK push button driver
+ */
+
+#ifndef PB_H_
+#define PB_H_
+
+int PB_Get(unsigned int pb);
+
+#endif // PB_H_
@@ -0,0 +1,49 @@
+/**
+ * @file    rtc.h
+ * @brief   Host simulation stand-in for the MSDK RTC driver
+ * @details The seconds and 12-bit sub-seconds counters run from the simulated
+ *          clock. Like the MSDK driver, every write (alarms, interrupt
+ *          enables, start/stop, trim) waits for the RTC to synchronize, two
+ *          32 kHz cycles, so it costs about 61 us of simulated time. Reads of
+ *          the counters return E_BUSY while RDY is low, during the 32 kHz
+ *          cycle before each sub-second update.
+ */
+
+#ifndef RTC_H_
+#define RTC_H_
+
+/***** Includes *****/
+#include "mxc_device.h"
+
+/***** Definitions *****/
+#define MXC_F_RTC_CTRL_TOD_ALARM_IE (1u << 1)
+#define MXC_F_RTC_CTRL_SSEC_ALARM_IE (1u << 2)
+#define MXC_F_RTC_CTRL_RDY_IE (1u << 5)
+#define MXC_F_RTC_CTRL_TOD_ALARM (1u << 6)
+#define MXC_F_RTC_CTRL_SSEC_ALARM (1u << 7)
+
+typedef enum {
+    MXC_RTC_F_1HZ,
+    MXC_RTC_F_512HZ,
+    MXC_RTC_F_4KHZ,
+    MXC_RTC_F_32KHZ,
+} mxc_rtc_freq_sel_t;
+
+/***** Functions *****/
+int MXC_RTC_Init(uint32_t sec, uint16_t ssec);
+int MXC_RTC_Start(void);
+int MXC_RTC_Stop(void);
+int MXC_RTC_GetFlags(void);
+int MXC_RTC_ClearFlags(int flags);
+int MXC_RTC_EnableInt(uint32_t mask);
+int MXC_RTC_DisableInt(uint32_t mask);
+int MXC_RTC_GetSeconds(uint32_t *sec);
+int MXC_RTC_GetSubSeconds(uint32_t *ssec);
+int MXC_RTC_GetTime(uint32_t *sec, uint32_t *subsec);
+int MXC_RTC_SetTimeofdayAlarm(uint32_t ras);
+int MXC_RTC_SetSubsecondAlarm(uint32_t rssa);
+int MXC_RTC_SquareWaveStart(mxc_rtc_freq_sel_t fq);
+int MXC_RTC_SquareWaveStop(void);
+int MXC_RTC_Trim(int8_t trm);
+
+#endif // RTC_H_
@@ -0,0 +1,96 @@
+/**
+ * @file    spi.h
+ * @brief   Host simulation stand-in for the MSDK SPI driver (spi-v1 API)
+ * @details Transactions are exchanged with the simulated devices on the bus
+ *          (see sim_spi_attach() in hal_sim.h). A transaction takes the
+ *          simulated time its bits need at the configured clock; asynchronous
+ *          transactions finish in the SPI IRQ, DMA transactions in the DMA IRQ.
+ */
+
+#ifndef SPI_H_
+#define SPI_H_
+
+/***** Includes *****/
+#include "mxc_device.h"
+#include "gpio.h"
+
+/***** Definitions *****/
+#define SIM_SPI_PORTS 5
+
+typedef struct {
+    int idx; // instance number
+} mxc_spi_regs_t;
+
+extern mxc_spi_regs_t sim_spi[SIM_SPI_PORTS];
+
+#define MXC_SPI0 (&sim_spi[0])
+#define MXC_SPI1 (&sim_spi[1])
+#define MXC_SPI4 (&sim_spi[4])
+
+#define MXC_SPI_GET_IDX(p) ((p)->idx)
+
+#define MXC_SPI_TYPE_MASTER 1
+#define MXC_SPI_TYPE_SLAVE 0
+#define MXC_SPI_INTERFACE_STANDARD 0
+
+typedef struct {
+    bool clock;
+    bool ss0;
+    bool ss1;
+    bool ss2;
+    bool miso;
+    bool mosi;
+    bool sdio2;
+    bool sdio3;
+    mxc_gpio_vssel_t vddioh;
+} mxc_spi_pins_t;
+
+typedef void (*spi_complete_cb_t)(void *req, int result);
+
+typedef struct _mxc_spi_req_t {
+    mxc_spi_regs_t *spi;
+    int ssIdx;
+    int ssDeassert;
+    uint8_t *txData;
+    uint8_t *rxData;
+    uint32_t txLen;
+    uint32_t rxLen;
+    uint32_t txCnt;
+    uint32_t rxCnt;
+    spi_complete_cb_t completeCB;
+} mxc_spi_req_t;
+
+typedef enum {
+    SPI_MODE_0,
+    SPI_MODE_1,
+    SPI_MODE_2,
+    SPI_MODE_3,
+} mxc_spi_mode_t;
+
+typedef enum {
+    SPI_WIDTH_3WIRE,
+    SPI_WIDTH_STANDARD,
+    SPI_WIDTH_DUAL,
+    SPI_WIDTH_QUAD,
+} mxc_spi_width_t;
+
+/***** Functions *****/
+int MXC_SPI_Init(mxc_spi_regs_t *spi, int masterMode, int quadModeUsed, int numSlaves,
+                 unsigned ssPolarity, unsigned int hz, mxc_spi_pins_t pins);
+int MXC_SPI_Shutdown(mxc_spi_regs_t *spi);
+int MXC_SPI_SetMode(mxc_spi_regs_t *spi, mxc_spi_mode_t spiMode);
+int MXC_SPI_SetDataSize(mxc_spi_regs_t *spi, int dataSize);
+int MXC_SPI_GetDataSize(mxc_spi_regs_t *spi);
+int MXC_SPI_SetWidth(mxc_spi_regs_t *spi, mxc_spi_width_t spiWidth);
+int MXC_SPI_SetFrequency(mxc_spi_regs_t *spi, unsigned int hz);
+unsigned int MXC_SPI_GetFrequency(mxc_spi_regs_t *spi);
+int MXC_SPI_SetSlave(mxc_spi_regs_t *spi, int ssIdx);
+int MXC_SPI_GetActive(mxc_spi_regs_t *spi);
+int MXC_SPI_AbortTransmission(mxc_spi_regs_t *spi);
+void MXC_SPI_ClearRXFIFO(mxc_spi_regs_t *spi);
+int MXC_SPI_MasterTransaction(mxc_spi_req_t *req);
+int MXC_SPI_MasterTransactionAsync(mxc_spi_req_t *req);
+int MXC_SPI_MasterTransactionDMA(mxc_spi_req_t *req);
+void MXC_SPI_AsyncHandler(mxc_spi_regs_t *spi);
+
+#endif // SPI_H_
@@ -0,0 +1,109 @@
+/**
+ * @file    tmr.h
+ * @brief   Host simulation stand-in for the MSDK TMR driver
+ * @details 32-bit one-shot and continuous modes only. The counter runs from
+ *          the simulated clock at the selected source divided by the
+ *          prescaler; reaching the compare value sets the flag, pends TMRn_IRQn
+ *          when the interrupt is enabled and reloads the counter with 1
+ *          (one-shot mode also stops the timer).
+ */
+
+#ifndef TMR_H_
+#define TMR_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mxc_device.h"
+
+/***** Definitions *****/
+#define SIM_TMR_COUNT 6
+
+typedef struct {
+    int idx; // instance number
+} mxc_tmr_regs_t;
+
+extern mxc_tmr_regs_t sim_tmr[SIM_TMR_COUNT];
+
+#define MXC_TMR0 (&sim_tmr[0])
+#define MXC_TMR1 (&sim_tmr[1])
+#define MXC_TMR2 (&sim_tmr[2])
+#define MXC_TMR3 (&sim_tmr[3])
+#define MXC_TMR4 (&sim_tmr[4])
+#define MXC_TMR5 (&sim_tmr[5])
+
+#define MXC_TMR_GET_IDX(p) ((p)->idx)
+#define MXC_TMR_GET_IRQ(i) ((IRQn_Type)(TMR0_IRQn + (i)))
+
+// divide by 2^n
+typedef enum {
+    TMR_PRES_1,
+    TMR_PRES_2,
+    TMR_PRES_4,
+    TMR_PRES_8,
+    TMR_PRES_16,
+    TMR_PRES_32,
+    TMR_PRES_64,
+    TMR_PRES_128,
+    TMR_PRES_256,
+    TMR_PRES_512,
+    TMR_PRES_1024,
+    TMR_PRES_2048,
+    TMR_PRES_4096,
+} mxc_tmr_pres_t;
+
+typedef enum {
+    TMR_MODE_ONESHOT,
+    TMR_MODE_CONTINUOUS,
+    TMR_MODE_COUNTER,
+    TMR_MODE_PWM,
+    TMR_MODE_CAPTURE,
+    TMR_MODE_COMPARE,
+    TMR_MODE_GATED,
+    TMR_MODE_CAPTURE_COMPARE,
+} mxc_tmr_mode_t;
+
+typedef enum {
+    TMR_BIT_MODE_32,
+    TMR_BIT_MODE_16A,
+    TMR_BIT_MODE_16B,
+} mxc_tmr_bit_mode_t;
+
+// APB and ISO run at 60 MHz, IBRO at 7.3728 MHz, ERTCO at 32.768 kHz and
+// INRO at 8 kHz; the simulation has no external clock
+typedef enum {
+    MXC_TMR_APB_CLK,
+    MXC_TMR_EXT_CLK,
+    MXC_TMR_IBRO_CLK,
+    MXC_TMR_ISO_CLK,
+    MXC_TMR_ERTCO_CLK,
+    MXC_TMR_INRO_CLK,
+} mxc_tmr_clock_t;
+
+typedef struct {
+    mxc_tmr_pres_t pres;
+    mxc_tmr_mode_t mode;
+    mxc_tmr_bit_mode_t bitMode;
+    mxc_tmr_clock_t clock;
+    uint32_t cmp_cnt;
+    unsigned int pol;
+} mxc_tmr_cfg_t;
+
+/***** Functions *****/
+int MXC_TMR_Init(mxc_tmr_regs_t *tmr, mxc_tmr_cfg_t *cfg, bool init_pins);
+void MXC_TMR_Shutdown(mxc_tmr_regs_t *tmr);
+void MXC_TMR_Start(mxc_tmr_regs_t *tmr);
+void MXC_TMR_Stop(mxc_tmr_regs_t *tmr);
+uint32_t MXC_TMR_GetCount(mxc_tmr_regs_t *tmr);
+void MXC_TMR_SetCount(mxc_tmr_regs_t *tmr, uint32_t cnt);
+uint32_t MXC_TMR_GetCompare(mxc_tmr_regs_t *tmr);
+void MXC_TMR_SetCompare(mxc_tmr_regs_t *tmr, uint32_t cmp_cnt);
+uint32_t MXC_TMR_GetFlags(mxc_tmr_regs_t *tmr);
+void MXC_TMR_ClearFlags(mxc_tmr_regs_t *tmr);
+void MXC_TMR_EnableInt(mxc_tmr_regs_t *tmr);
+void MXC_TMR_DisableInt(mxc_tmr_regs_t *tmr);
+uint32_t MXC_TMR_GetPeriod(mxc_tmr_regs_t *tmr, mxc_tmr_clock_t clock, uint32_t prescalar,
+                           uint32_t frequency);
+
+#endif // TMR_H_
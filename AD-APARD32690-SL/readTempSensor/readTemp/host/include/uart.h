@@ -0,0 +1,60 @@
+/**
+ * @file    uart.h
+ * @brief   Host simulation stand-in for the MSDK UART driver
+ * @details Only the console UART is simulated: its TX FIFO
+ *          (MXC_UART_FIFO_DEPTH characters) shifts one character out to stdout
+ *          every ten bit times at the console baud rate, and sets the TX
+ *          half-empty flag whenever a character leaves it at or below half
+ *          full. printf() goes through the same FIFO, see sim_console.h.
+ */
+
+#ifndef UART_H_
+#define UART_H_
+
+/***** Includes *****/
+#include <stdint.h>
+
+#include "mxc_device.h"
+
+/***** Definitions *****/
+#define SIM_UART_COUNT 4
+#define MXC_UART_FIFO_DEPTH 8
+
+// interrupt enable and flag bits
+#define MXC_F_UART_INT_EN_TX_HE (1u << 6)
+#define MXC_F_UART_INT_FL_TX_HE (1u << 6)
+
+typedef struct {
+    int idx; // instance number
+} mxc_uart_regs_t;
+
+extern mxc_uart_regs_t sim_uart[SIM_UART_COUNT];
+
+#define MXC_UART_GET_UART(i) (&sim_uart[i])
+#define MXC_UART_GET_IDX(p) ((p)->idx)
+#define MXC_UART_GET_IRQ(i) ((IRQn_Type)(UART0_IRQn + (i)))
+
+/***** Functions *****/
+/*
+ * Waits for room in the TX FIFO.
+ */
+int MXC_UART_WriteCharacter(mxc_uart_regs_t *uart, uint8_t character);
+
+/*
+ * E_OVERFLOW when the TX FIFO is full.
+ */
+int MXC_UART_WriteCharacterRaw(mxc_uart_regs_t *uart, uint8_t character);
+
+unsigned int MXC_UART_GetTXFIFOAvailable(mxc_uart_regs_t *uart);
+
+/*
+ * E_BUSY while characters are left to send.
+ */
+int MXC_UART_GetActive(mxc_uart_regs_t *uart);
+
+int MXC_UART_EnableInt(mxc_uart_regs_t *uart, unsigned int mask);
+int MXC_UART_DisableInt(mxc_uart_regs_t *uart, unsigned int mask);
+unsigned int MXC_UART_GetFlags(mxc_uart_regs_t *uart);
+int MXC_UART_ClearFlags(mxc_uart_regs_t *uart, unsigned int flags);
+
+#endif // UART_H_
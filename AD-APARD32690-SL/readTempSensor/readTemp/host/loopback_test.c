@@ -0,0 +1,234 @@
+/**
+ * @file    loopback_test.c
+ * @brief   Loopback test of the non-blocking console (common/console_tx.c)
+ * @details Runs console_tx.c on the simulated console UART and reads back
+ *          what the UART shifted out, from a capture of the console stream.
+ *          Each case checks the bytes received against the bytes written and
+ *          the module's counters:
+ *
+ *          - printf() latency with the ring against the blocking backend
+ *          - BLOCK: everything arrives in order, also with interrupts masked
+ *          - DROP_NEWEST: the bytes accepted arrive, the rest is counted
+ *          - OVERWRITE_OLDEST: the most recent bytes arrive, in order
+ *          - "\r\n" for '\n' through the stdio entry point
+ *
+ *          Prints LOOPBACK PASS and exits with 0 when every case passed.
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "console_tx.h"
+#include "hal_sim.h"
+#include "sim_test.h"
+
+/***** Definitions *****/
+#define STREAM_LEN 6000 // bytes per case, several rings' worth
+#define LINE_LEN 80 // one printf() line
+
+int __wrap__write(int file, char *ptr, int len);
+
+/***** Globals *****/
+static FILE *capture;
+static char *capture_buf;
+static size_t capture_len;
+static size_t case_start; // capture offset where the current case begins
+static uint8_t stream[STREAM_LEN];
+
+/***** Functions *****/
+static void begin_case(const char *name, console_tx_policy_t policy)
+{
+    printf("%s\n", name);
+    fflush(capture);
+    case_start = capture_len;
+    console_tx_init(MXC_UART_GET_UART(CONSOLE_UART), policy);
+}
+
+// bytes received since begin_case(), once everything is sent
+static const uint8_t *received(size_t *len)
+{
+    console_tx_flush();
+    fflush(capture);
+    *len = capture_len - case_start;
+    return (const uint8_t *)capture_buf + case_start;
+}
+
+static uint64_t time_line(bool ring)
+{
+    static char line[LINE_LEN + 1];
+    uint64_t start;
+
+    memset(line, 'x', LINE_LEN - 1);
+    line[LINE_LEN - 1] = '\n';
+
+    start = sim_now();
+    if (ring) {
+        __wrap__write(1, line, LINE_LEN);
+    } else {
+        for (int i = 0; i < LINE_LEN; i++) {
+            MXC_UART_WriteCharacter(MXC_UART_GET_UART(CONSOLE_UART), (uint8_t)line[i]);
+        }
+    }
+    return sim_now() - start;
+}
+
+static void test_latency(void)
+{
+    uint64_t blocking, ring;
+
+    begin_case("printf() latency, one 80-character line", CONSOLE_TX_BLOCK);
+    blocking = time_line(false);
+    console_tx_flush();
+    ring = time_line(true);
+    console_tx_flush();
+    printf("  blocking %llu us, ring %llu us\n", (unsigned long long)(blocking / 1000),
+           (unsigned long long)(ring / 1000));
+    sim_check(ring * 100 < blocking, "the ring returns at least 100 times sooner");
+}
+
+// writes the stream in chunks of 1 - 300 bytes without waiting in between
+static size_t write_chunks(void)
+{
+    size_t accepted = 0;
+    uint32_t rng = 1;
+
+    for (size_t pos = 0; pos < STREAM_LEN;) {
+        size_t n;
+
+        rng = rng * 1103515245 + 12345;
+        n = 1 + (rng >> 16) % 300;
+        if (n > STREAM_LEN - pos) {
+            n = STREAM_LEN - pos;
+        }
+        accepted += console_tx_write(&stream[pos], n);
+        pos += n;
+    }
+
+    return accepted;
+}
+
+static void test_block(bool masked)
+{
+    console_tx_stats_t stats;
+    const uint8_t *rx;
+    size_t len, accepted;
+
+    begin_case(masked ? "BLOCK, interrupts masked" : "BLOCK", CONSOLE_TX_BLOCK);
+    if (masked) {
+        __disable_irq();
+    }
+    accepted = write_chunks();
+    if (masked) {
+        __enable_irq();
+    }
+    rx = received(&len);
+    console_tx_get_stats(&stats);
+
+    sim_check(accepted == STREAM_LEN, "every byte accepted");
+    sim_check(len == STREAM_LEN && memcmp(rx, stream, len) == 0, "every byte received, in order");
+    sim_check(stats.blocked > 0 && stats.dropped == 0 && stats.overwritten == 0,
+              "writers waited, nothing lost");
+    sim_check(stats.high_water == CONSOLE_TX_SIZE, "the ring filled up");
+}
+
+static void test_drop(void)
+{
+    console_tx_stats_t stats;
+    const uint8_t *rx;
+    size_t len, accepted;
+
+    begin_case("DROP_NEWEST", CONSOLE_TX_DROP_NEWEST);
+    accepted = console_tx_write(stream, STREAM_LEN);
+    rx = received(&len);
+    console_tx_get_stats(&stats);
+
+    // the ring plus what moved on to the UART FIFO meanwhile
+    sim_check(accepted >= CONSOLE_TX_SIZE && accepted <= CONSOLE_TX_SIZE + MXC_UART_FIFO_DEPTH,
+              "a ring's worth accepted");
+    sim_check(len == accepted && memcmp(rx, stream, len) == 0,
+              "the accepted bytes received, in order");
+    sim_check(stats.dropped == STREAM_LEN - accepted, "the rest counted as dropped");
+}
+
+static void test_overwrite(void)
+{
+    console_tx_stats_t stats;
+    const uint8_t *rx;
+    size_t len, accepted, i, j;
+
+    begin_case("OVERWRITE_OLDEST", CONSOLE_TX_OVERWRITE_OLDEST);
+    accepted = write_chunks();
+    rx = received(&len);
+    console_tx_get_stats(&stats);
+
+    // received in order: a subsequence of the stream
+    for (i = 0, j = 0; i < len && j < STREAM_LEN; j++) {
+        if (rx[i] == stream[j]) {
+            i++;
+        }
+    }
+
+    sim_check(accepted == STREAM_LEN, "every byte accepted");
+    sim_check(len == STREAM_LEN - stats.overwritten && stats.overwritten > 0,
+              "received = written - overwritten");
+    sim_check(i == len, "the bytes received keep their order");
+    sim_check(len >= CONSOLE_TX_SIZE &&
+                  memcmp(rx + len - CONSOLE_TX_SIZE, stream + STREAM_LEN - CONSOLE_TX_SIZE,
+                         CONSOLE_TX_SIZE) == 0,
+              "the most recent ring's worth received");
+}
+
+static void test_crlf(void)
+{
+    char text[] = "a\nbc\n\nd";
+    const uint8_t *rx;
+    size_t len;
+
+    begin_case("stdio entry point", CONSOLE_TX_BLOCK);
+    sim_check(__wrap__write(1, text, strlen(text)) == (int)strlen(text),
+              "returns the length written");
+    rx = received(&len);
+    sim_check(len == 10 && memcmp(rx, "a\r\nbc\r\n\r\nd", 10) == 0, "'\\n' sent as \"\\r\\n\"");
+}
+
+static int loopback_main(void)
+{
+    for (int i = 0; i < STREAM_LEN; i++) {
+        stream[i] = (uint8_t)(i * 7 + i / 251);
+    }
+
+    test_latency();
+    test_block(false);
+    test_block(true);
+    test_drop();
+    test_overwrite();
+    test_crlf();
+
+    return 0;
+}
+
+int main(void)
+{
+    int retVal;
+
+    capture = open_memstream(&capture_buf, &capture_len);
+    if (capture == NULL) {
+        perror("open_memstream");
+        return 2;
+    }
+
+    sim_init(60 * SIM_NS_PER_SEC);
+    sim_console_config(115200, true);
+    sim_console_capture(capture);
+
+    retVal = sim_test_run("LOOPBACK", loopback_main);
+
+    fclose(capture);
+    free(capture_buf);
+
+    return retVal;
+}
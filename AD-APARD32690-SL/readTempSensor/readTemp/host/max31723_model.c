@@ -0,0 +1,239 @@
+/**
+ * @file    max31723_model.c
+ * @brief   Register-level model of the MAX31723 for the host build
+ */
+
+/***** Includes *****/
+#include <string.h>
+
+#include "max31723_model.h"
+
+/***** Definitions *****/
+#define MAX31723_MODEL_MAX_HZ 5000000
+#define MAX31723_MODEL_MODES ((1u << SPI_MODE_1) | (1u << SPI_MODE_3)) // CPHA = 1
+
+#define MAX31723_MODEL_WRITE 0x80
+#define MAX31723_MODEL_ADDR_MASK 0x7F
+
+// register addresses
+#define REG_CONFIG 0x00
+#define REG_TEMP_LSB 0x01
+#define REG_TEMP_MSB 0x02
+
+#define MAX31723_MODEL_MIN_MC -55000
+#define MAX31723_MODEL_MAX_MC 125000
+
+/***** Functions *****/
+static uint8_t resolution_bits(const max31723_model_t *m)
+{
+    return 9 + ((m->reg[REG_CONFIG] & MAX31723_MODEL_R_MASK) >> MAX31723_MODEL_R_SHIFT);
+}
+
+// 25, 50, 100 or 200 ms for 9 to 12 bits
+static uint64_t conversion_ns(const max31723_model_t *m)
+{
+    return SIM_MS(25) << (resolution_bits(m) - 9);
+}
+
+int32_t max31723_model_ambient(const max31723_model_t *m, uint64_t now)
+{
+    int64_t mc = m->ambient_mc + (int64_t)m->ramp_mc_per_min * (int64_t)now / (int64_t)SIM_MS(60000);
+
+    if (m->step_mc != 0 && now >= m->step_at) {
+        mc += m->step_mc;
+    }
+
+    if (mc < MAX31723_MODEL_MIN_MC) {
+        mc = MAX31723_MODEL_MIN_MC;
+    }
+    if (mc > MAX31723_MODEL_MAX_MC) {
+        mc = MAX31723_MODEL_MAX_MC;
+    }
+    return (int32_t)mc;
+}
+
+// 2's complement Q8.8, truncated to the selected resolution
+static uint16_t convert(const max31723_model_t *m, uint64_t now)
+{
+    int32_t q8 = (int32_t)(((int64_t)max31723_model_ambient(m, now) * 256) / 1000);
+    uint16_t unused = (uint16_t)((1u << (16 - resolution_bits(m))) - 1);
+
+    return (uint16_t)q8 & (uint16_t)~unused;
+}
+
+static void store_temp(max31723_model_t *m, uint16_t temp)
+{
+    m->reg[REG_TEMP_LSB] = (uint8_t)temp;
+    m->reg[REG_TEMP_MSB] = (uint8_t)(temp >> 8);
+}
+
+static void conversion_event(void *arg);
+
+static void start_conversion(max31723_model_t *m)
+{
+    sim_cancel(conversion_event, m);
+    m->converting = true;
+    m->conv_end = sim_now() + conversion_ns(m);
+    sim_schedule(m->conv_end, conversion_event, m);
+}
+
+static void conversion_event(void *arg)
+{
+    max31723_model_t *m = arg;
+    uint16_t temp = convert(m, sim_now());
+
+    m->converting = false;
+    m->results[m->conversions % MAX31723_MODEL_RESULTS].at = sim_now();
+    m->results[m->conversions % MAX31723_MODEL_RESULTS].bits = resolution_bits(m);
+    m->conversions++;
+
+    // the temperature register is not updated while CE is active
+    if (m->selected) {
+        m->held = true;
+        m->held_temp = temp;
+        m->held_updates++;
+    } else {
+        store_temp(m, temp);
+    }
+
+    if (m->reg[REG_CONFIG] & MAX31723_MODEL_1SHOT) {
+        m->reg[REG_CONFIG] &= ~MAX31723_MODEL_1SHOT;
+    }
+    if (!(m->reg[REG_CONFIG] & MAX31723_MODEL_SD)) {
+        start_conversion(m);
+    }
+}
+
+static void write_config(max31723_model_t *m, uint8_t value)
+{
+    uint8_t before = m->reg[REG_CONFIG];
+
+    value &= MAX31723_MODEL_CONFIG_MASK;
+
+    // 1SHOT only starts a conversion while shut down
+    if (!(value & MAX31723_MODEL_SD) || m->converting) {
+        value &= ~MAX31723_MODEL_1SHOT;
+    }
+    m->reg[REG_CONFIG] = value;
+
+    if (!(value & MAX31723_MODEL_SD)) {
+        // leaving shutdown or changing the resolution restarts the conversion
+        if (!m->converting || ((before ^ value) & MAX31723_MODEL_R_MASK)) {
+            start_conversion(m);
+        }
+    } else if (value & MAX31723_MODEL_1SHOT) {
+        start_conversion(m);
+    }
+    // entering shutdown lets the running conversion finish
+}
+
+// the armed step, after the LSB went out in this CE window
+static void step_now(max31723_model_t *m, uint8_t lsb)
+{
+    m->step_armed = false;
+    m->step_pending = true;
+    m->step_lsb = lsb;
+    m->step_before = (uint16_t)(m->reg[REG_TEMP_MSB] << 8) | m->reg[REG_TEMP_LSB];
+    m->step_at = sim_now();
+
+    // a conversion finishes now, whether one was running or not
+    sim_cancel(conversion_event, m);
+    conversion_event(m);
+}
+
+static void select(void *ctx, bool active)
+{
+    max31723_model_t *m = ctx;
+
+    m->selected = active;
+    m->addressed = false;
+    m->step_pending = false;
+
+    if (!active && m->held) {
+        m->held = false;
+        store_temp(m, m->held_temp);
+    }
+}
+
+static uint8_t exchange(void *ctx, uint8_t mosi)
+{
+    max31723_model_t *m = ctx;
+    uint8_t miso = 0xFF;
+
+    if (!m->selected) {
+        return miso;
+    }
+
+    if (!m->addressed) {
+        m->addressed = true;
+        m->write = (mosi & MAX31723_MODEL_WRITE) != 0;
+        m->addr = mosi & MAX31723_MODEL_ADDR_MASK;
+        return miso;
+    }
+
+    if (m->addr < MAX31723_MODEL_REGS) {
+        if (m->write) {
+            if (m->addr == REG_CONFIG) {
+                write_config(m, mosi);
+            } else if (m->addr > REG_TEMP_MSB) {
+                m->reg[m->addr] = mosi; // thresholds; the temperature is read only
+            }
+        } else {
+            miso = m->reg[m->addr];
+            if (m->addr == REG_TEMP_MSB) {
+                m->reads++;
+            }
+            if (m->addr == REG_TEMP_LSB && m->step_armed) {
+                step_now(m, miso);
+            } else if (m->addr == REG_TEMP_MSB && m->step_pending) {
+                m->step_pending = false;
+                m->step_done = true;
+                m->step_read = (uint16_t)(miso << 8) | m->step_lsb;
+            }
+        }
+    }
+
+    // the address auto-increments and wraps from 06h to 00h
+    m->addr = (m->addr + 1) % MAX31723_MODEL_REGS;
+    return miso;
+}
+
+void max31723_model_init(max31723_model_t *m, const char *name, int32_t ambient_mc,
+                         int32_t ramp_mc_per_min)
+{
+    memset(m, 0x00, sizeof(*m));
+
+    m->ambient_mc = ambient_mc;
+    m->ramp_mc_per_min = ramp_mc_per_min;
+
+    // power-on thresholds: +80 C and +75 C
+    m->reg[4] = 80;
+    m->reg[6] = 75;
+
+    m->dev.name = name;
+    m->dev.max_hz = MAX31723_MODEL_MAX_HZ;
+    m->dev.mode_mask = MAX31723_MODEL_MODES;
+    m->dev.ce_active_high = true;
+    m->dev.select = select;
+    m->dev.exchange = exchange;
+    m->dev.ctx = m;
+
+    start_conversion(m);
+}
+
+void max31723_model_step_in_burst(max31723_model_t *m, int32_t step_mc)
+{
+    m->step_mc = step_mc;
+    m->step_at = UINT64_MAX; // set when it happens
+    m->step_armed = true;
+}
+
+void max31723_model_attach(max31723_model_t *m, int spiIdx, int ssIdx)
+{
+    sim_spi_attach(spiIdx, ssIdx, &m->dev);
+}
+
+void max31723_model_attach_gpio(max31723_model_t *m, int spiIdx, int port, uint32_t mask)
+{
+    sim_spi_attach_gpio(spiIdx, port, mask, &m->dev);
+}
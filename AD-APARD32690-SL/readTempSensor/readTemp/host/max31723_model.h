@@ -0,0 +1,104 @@
+/**
+ * @file    max31723_model.h
+ * @brief   Register-level model of the MAX31723 for the host build
+ * @details Registers 00h-06h with the read/write addresses of the datasheet
+ *          (write = address | 80h), address auto-increment within one
+ *          chip-enable window, continuous and one-shot conversions with the
+ *          9-12 bit conversion times, and the temperature register held while
+ *          CE is active (a conversion that finishes meanwhile is copied in at
+ *          CE release).
+ */
+
+#ifndef MAX31723_MODEL_H_
+#define MAX31723_MODEL_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hal_sim.h"
+
+/***** Definitions *****/
+#define MAX31723_MODEL_REGS 7
+
+// configuration register bits
+#define MAX31723_MODEL_SD (1u << 0) // shutdown, no continuous conversions
+#define MAX31723_MODEL_R_SHIFT 1 // resolution, 9 + R bits
+#define MAX31723_MODEL_R_MASK (3u << 1)
+#define MAX31723_MODEL_TM (1u << 3) // thermostat interrupt mode
+#define MAX31723_MODEL_1SHOT (1u << 4) // one conversion while shut down
+#define MAX31723_MODEL_CONFIG_MASK 0x1F // bits 7:5 read back as 0
+
+#define MAX31723_MODEL_RESULTS 32 // latest conversions kept for the checks
+
+// one finished conversion
+typedef struct {
+    uint64_t at; // simulated time it finished
+    uint8_t bits; // resolution
+} max31723_model_result_t;
+
+typedef struct {
+    uint8_t reg[MAX31723_MODEL_REGS]; // config, T LSB, T MSB, TH LSB, TH MSB, TL LSB, TL MSB
+    bool selected;
+    bool addressed; // the address byte of this CE window was received
+    bool write;
+    uint8_t addr;
+
+    bool converting;
+    uint64_t conv_end;
+    bool held; // a result finished while CE was active
+    uint16_t held_temp;
+
+    int32_t ambient_mc; // ambient temperature at time 0, milli-degrees C
+    int32_t ramp_mc_per_min; // ambient temperature change per minute
+    int32_t step_mc; // added to the ambient from step_at on
+    uint64_t step_at;
+
+    max31723_model_result_t results[MAX31723_MODEL_RESULTS]; // by conversions, oldest overwritten
+
+    bool step_armed; // see max31723_model_step_in_burst()
+    bool step_pending; // stepped in this CE window, the MSB is not read yet
+    bool step_done;
+    uint8_t step_lsb; // temperature LSB read before the step
+    uint16_t step_read; // LSB and MSB read in the window of the step
+    uint16_t step_before; // temperature register when the step came
+
+    uint32_t conversions;
+    uint32_t reads; // temperature MSB reads
+    uint32_t held_updates; // results delayed by an active CE
+
+    sim_spi_device_t dev;
+} max31723_model_t;
+
+/***** Functions *****/
+/*
+ * Powers the model up (configuration 00h: continuous 9-bit conversions) at the
+ * current simulated time.
+ */
+void max31723_model_init(max31723_model_t *m, const char *name, int32_t ambient_mc,
+                         int32_t ramp_mc_per_min);
+
+/*
+ * Connects the model to chip select ssIdx of SPI instance spiIdx.
+ */
+void max31723_model_attach(max31723_model_t *m, int spiIdx, int ssIdx);
+
+/*
+ * Connects the model to SPI instance spiIdx with CE on GPIO port/mask.
+ */
+void max31723_model_attach_gpio(max31723_model_t *m, int spiIdx, int port, uint32_t mask);
+
+/*
+ * Ambient temperature at simulated time now, milli-degrees C.
+ */
+int32_t max31723_model_ambient(const max31723_model_t *m, uint64_t now);
+
+/*
+ * In the next CE window that reads the temperature LSB, right after the LSB
+ * is shifted out: steps the ambient by step_mc and finishes a conversion, so
+ * that a result lands between the LSB and the MSB of the burst. step_read and
+ * step_before tell afterwards what the master read and what it should have.
+ */
+void max31723_model_step_in_burst(max31723_model_t *m, int32_t step_mc);
+
+#endif // MAX31723_MODEL_H_
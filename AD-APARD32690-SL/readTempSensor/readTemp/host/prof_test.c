@@ -0,0 +1,180 @@
+/**
+ * @file    prof_test.c
+ * @brief   Test of the profiling probes (common/prof.c)
+ * @details Runs prof.c on the simulated DWT with a table of its own:
+ *
+ *          - passes of known lengths land in the right histogram buckets,
+ *            the last one open-ended, with exact runs, min, max and total
+ *          - prof_init() clears a used table and keeps the names
+ *          - PROF_BEGIN()/PROF_END() around busy waits measure them (shortest
+ *            and average pass) to within a few microseconds, also when an
+ *            interrupt with a probe of its own preempts the pass
+ *
+ *          Prints PROF PASS and exits with 0 when every case passed.
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "hal_sim.h"
+#include "sim_test.h"
+#include "mxc_delay.h"
+#include "mxc_device.h"
+#include "nvic_table.h"
+#include "prof.h"
+
+/***** Definitions *****/
+#define TEST_PROBES(X)             \
+    X(PROBE_FIXED, "fixed ticks")  \
+    X(PROBE_WAIT, "busy wait")     \
+    X(PROBE_OUTER, "preempted")    \
+    X(PROBE_HANDLER, "handler")
+
+typedef enum { TEST_PROBES(PROF_ID) PROBE_COUNT } probe_id_t;
+
+#define PREEMPT_IRQ TMR5_IRQn
+#define WAIT_US 300
+#define HANDLER_US 40
+#define PASSES 20
+#define SLICES 10 // of a preempted pass
+#define SLACK_US 10 // DWT reads, exception entry and the host CPU time the DWT adds
+
+/***** Globals *****/
+prof_probe_t prof_table[PROBE_COUNT] = { TEST_PROBES(PROF_ENTRY) };
+
+/***** Functions *****/
+static bool within_us(uint32_t ticks, uint32_t us)
+{
+    uint32_t tpu = prof_ticks_per_us();
+
+    return ticks >= us * tpu && ticks <= (us + SLACK_US) * tpu;
+}
+
+// the host CPU time in the simulated DWT makes the odd pass longer: check means
+static uint32_t avg_ticks(const prof_probe_t *p)
+{
+    return (uint32_t)(p->total_ticks / p->count);
+}
+
+static void preempt_handler(void)
+{
+    PROF_BEGIN(PROBE_HANDLER);
+    MXC_Delay(MXC_DELAY_USEC(HANDLER_US));
+    PROF_END(PROBE_HANDLER);
+}
+
+static void preempt_event(void *arg)
+{
+    (void)arg;
+    sim_raise_irq(PREEMPT_IRQ);
+}
+
+static void test_buckets(void)
+{
+    static const struct {
+        uint32_t ns;
+        int bucket;
+    } cases[] = {
+        { 0, 0 },           { 500, 0 },        { 999, 0 },       { 1000, 1 },
+        { 1999, 1 },        { 2000, 2 },       { 3999, 2 },      { 100000, 7 },
+        { 8191000, 13 },    { 16384000, 15 },  { 30000000, 15 },
+    };
+    const prof_probe_t *p = &prof_table[PROBE_FIXED];
+    uint32_t tpu = prof_ticks_per_us();
+    uint32_t expected[PROF_BUCKETS] = { 0 };
+    uint64_t total = 0;
+    bool ok = true;
+
+    printf("histogram buckets\n");
+
+    for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        uint32_t ticks = (uint32_t)((uint64_t)cases[i].ns * tpu / 1000);
+
+        prof_add(&prof_table[PROBE_FIXED], ticks);
+        expected[cases[i].bucket]++;
+        total += ticks;
+    }
+    for (int b = 0; b < PROF_BUCKETS; b++) {
+        if (p->hist[b] != expected[b]) {
+            printf("  bucket %d: %u, expected %u\n", b, (unsigned)p->hist[b],
+                   (unsigned)expected[b]);
+            ok = false;
+        }
+    }
+    sim_check(ok, "under 1 us, powers of two and the open last bucket");
+    sim_check(p->count == sizeof(cases) / sizeof(cases[0]) && p->min_ticks == 0 &&
+                  p->max_ticks == 30000 * tpu && p->total_ticks == total,
+              "runs, min, max and total");
+
+    prof_init(prof_table, PROBE_COUNT);
+    ok = (p->count == 0 && p->min_ticks == UINT32_MAX && p->max_ticks == 0 &&
+          p->total_ticks == 0 && p->name != NULL);
+    for (int b = 0; b < PROF_BUCKETS; b++) {
+        ok = ok && (p->hist[b] == 0);
+    }
+    sim_check(ok, "prof_init() clears the probe and keeps its name");
+}
+
+static void test_timing(void)
+{
+    const prof_probe_t *wait = &prof_table[PROBE_WAIT];
+    const prof_probe_t *outer = &prof_table[PROBE_OUTER];
+    const prof_probe_t *handler = &prof_table[PROBE_HANDLER];
+
+    printf("passes on the DWT, %u ticks per us\n", (unsigned)prof_ticks_per_us());
+
+    for (int i = 0; i < PASSES; i++) {
+        PROF_BEGIN(PROBE_WAIT);
+        MXC_Delay(MXC_DELAY_USEC(WAIT_US));
+        PROF_END(PROBE_WAIT);
+    }
+
+    /*
+     * The handler runs in the middle of each pass, which includes it. A delay
+     * ends at a deadline and would absorb the handler, so the pass is work in
+     * slices, one of which the handler holds up.
+     */
+    MXC_NVIC_SetVector(PREEMPT_IRQ, preempt_handler);
+    NVIC_EnableIRQ(PREEMPT_IRQ);
+    for (int i = 0; i < PASSES; i++) {
+        PROF_BEGIN(PROBE_OUTER);
+        sim_schedule(sim_now() + SIM_US(WAIT_US / 2), preempt_event, NULL);
+        for (int j = 0; j < SLICES; j++) {
+            MXC_Delay(MXC_DELAY_USEC(WAIT_US / SLICES));
+        }
+        PROF_END(PROBE_OUTER);
+    }
+    NVIC_DisableIRQ(PREEMPT_IRQ);
+
+    prof_print(prof_table, PROBE_COUNT);
+
+    sim_check(wait->count == PASSES && within_us(wait->min_ticks, WAIT_US) &&
+                  within_us(avg_ticks(wait), WAIT_US),
+              "busy waits measured to within the slack");
+    sim_check(wait->hist[9] == PASSES, "all of them in the 256-512 us bucket");
+    sim_check(handler->count == PASSES && within_us(handler->min_ticks, HANDLER_US) &&
+                  within_us(avg_ticks(handler), HANDLER_US),
+              "handler passes measured on their own");
+    sim_check(outer->count == PASSES && within_us(outer->min_ticks, WAIT_US + HANDLER_US) &&
+                  within_us(avg_ticks(outer), WAIT_US + HANDLER_US),
+              "preempted passes include the handler");
+}
+
+static int prof_main(void)
+{
+    prof_init(prof_table, PROBE_COUNT);
+
+    test_buckets();
+    test_timing();
+
+    return 0;
+}
+
+int main(void)
+{
+    sim_init(10 * SIM_NS_PER_SEC);
+    sim_console_config(0, false);
+
+    return sim_test_run("PROF", prof_main);
+}
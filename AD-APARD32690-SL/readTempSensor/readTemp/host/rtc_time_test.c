@@ -0,0 +1,228 @@
+/**
+ * @file    rtc_time_test.c
+ * @brief   Test of the RTC snapshot and formatter (common/rtc_time.c)
+ * @details Runs rtc_time.c on the simulated RTC and compares every snapshot
+ *          with the counter before and after the call (sim_rtc_ticks()):
+ *
+ *          - reads started at every phase of the sub-second ticks, RDY windows
+ *            included, are coherent and take a bounded time
+ *          - an interrupt that preempts the reads across a second rollover
+ *            breaks the old sub-seconds-then-seconds read but not the snapshot
+ *          - with RDY stuck low the snapshot gives up within its bound
+ *          - the formatter's fields, decimals, truncation and day rollover
+ *
+ *          Prints RTC TIME PASS and exits with 0 when every case passed.
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal_sim.h"
+#include "sim_test.h"
+#include "mxc_delay.h"
+#include "mxc_errors.h"
+#include "nvic_table.h"
+#include "rtc.h"
+#include "rtc_time.h"
+
+/***** Definitions *****/
+#define PREEMPT_IRQ TMR5_IRQn
+#define PREEMPT_US 100 // handler run that carries the reads across the rollover
+#define TICK_NS (SIM_NS_PER_SEC / RTC_TIME_TICKS_PER_SEC)
+// RTC_TIME_TRIES tries of three reads and a 31 us wait, with margin
+#define SNAPSHOT_MAX_NS SIM_US(RTC_TIME_TRIES * 35)
+
+/***** Functions *****/
+static void preempt_handler(void)
+{
+    MXC_Delay(MXC_DELAY_USEC(PREEMPT_US));
+}
+
+static void preempt_event(void *arg)
+{
+    (void)arg;
+    sim_raise_irq(PREEMPT_IRQ);
+}
+
+// the counter did not move backwards or past the reference around the read
+static bool coherent(uint64_t before, uint32_t sec, uint32_t subsec, uint64_t after)
+{
+    uint64_t ticks = (uint64_t)sec * RTC_TIME_TICKS_PER_SEC + subsec;
+
+    return before <= ticks && ticks <= after;
+}
+
+// the way printTime() used to read the RTC
+static void naive_read(uint32_t *sec, uint32_t *subsec)
+{
+    while (MXC_RTC_GetSubSeconds(subsec) != E_NO_ERROR) {}
+    while (MXC_RTC_GetSeconds(sec) != E_NO_ERROR) {}
+}
+
+// waits until about 40 us before the next second rollover, clear of RDY
+static void approach_rollover(void)
+{
+    while (sim_rtc_ticks() % RTC_TIME_TICKS_PER_SEC != RTC_TIME_TICKS_PER_SEC - 1) {
+        MXC_Delay(MXC_DELAY_USEC(1));
+    }
+    MXC_Delay(MXC_DELAY_USEC(TICK_NS / 1000 - 42));
+}
+
+static void test_phases(void)
+{
+    uint64_t worst_ns = 0;
+    uint32_t bad = 0;
+    uint32_t busy = 0;
+    uint32_t reads = 0;
+
+    printf("snapshots across every phase of the sub-second ticks\n");
+
+    // 2.5 s of reads, started 1.3 us apart to walk through the RDY windows
+    while (sim_rtc_ticks() < (uint64_t)RTC_TIME_TICKS_PER_SEC * 5 / 2) {
+        uint64_t before = sim_rtc_ticks();
+        uint64_t start = sim_now();
+        rtc_time_t t;
+
+        if (rtc_time_get(&t) != E_NO_ERROR) {
+            busy++;
+        } else if (!coherent(before, t.sec, t.subsec, sim_rtc_ticks())) {
+            bad++;
+        }
+        if (sim_now() - start > worst_ns) {
+            worst_ns = sim_now() - start;
+        }
+        reads++;
+        MXC_Delay(MXC_DELAY_USEC(1));
+    }
+
+    printf("  %u reads, longest %u ns\n", (unsigned)reads, (unsigned)worst_ns);
+    sim_check(busy == 0, "every read succeeded");
+    sim_check(bad == 0, "every snapshot lies between the references");
+    sim_check(worst_ns <= SNAPSHOT_MAX_NS, "bounded time, also through RDY windows");
+}
+
+static void test_forced_rollover(void)
+{
+    uint32_t naive_bad = 0;
+    uint32_t snapshot_bad = 0;
+
+    printf("a %d us interrupt between the reads, at a second rollover\n", PREEMPT_US);
+
+    MXC_NVIC_SetVector(PREEMPT_IRQ, preempt_handler);
+    NVIC_EnableIRQ(PREEMPT_IRQ);
+
+    // the interrupt lands at every point of the read sequence
+    for (uint64_t delay = 0; delay <= 1500; delay += 50) {
+        uint32_t sec, subsec;
+        uint64_t before;
+        rtc_time_t t;
+
+        approach_rollover();
+        before = sim_rtc_ticks();
+        sim_schedule(sim_now() + delay, preempt_event, NULL);
+        naive_read(&sec, &subsec);
+        if (!coherent(before, sec, subsec, sim_rtc_ticks())) {
+            naive_bad++;
+        }
+
+        approach_rollover();
+        before = sim_rtc_ticks();
+        sim_schedule(sim_now() + delay, preempt_event, NULL);
+        if (rtc_time_get(&t) != E_NO_ERROR || !coherent(before, t.sec, t.subsec, sim_rtc_ticks())) {
+            snapshot_bad++;
+        }
+    }
+
+    NVIC_DisableIRQ(PREEMPT_IRQ);
+
+    printf("  sub-seconds then seconds: %u torn reads, snapshot: %u\n", (unsigned)naive_bad,
+           (unsigned)snapshot_bad);
+    sim_check(naive_bad > 0, "the old read order tears (the case is provoked)");
+    sim_check(snapshot_bad == 0, "the snapshot never tears");
+}
+
+static void test_stuck_busy(void)
+{
+    rtc_time_t t = { 12345, 678 };
+    uint64_t start;
+    int retVal;
+
+    printf("RDY stuck low\n");
+
+    sim_rtc_stick_busy(true);
+    start = sim_now();
+    retVal = rtc_time_get(&t);
+    start = sim_now() - start;
+    sim_rtc_stick_busy(false);
+
+    printf("  gave up after %u ns\n", (unsigned)start);
+    sim_check(retVal == E_BUSY, "returns E_BUSY");
+    sim_check(t.sec == 12345 && t.subsec == 678, "leaves the time unchanged");
+    sim_check(start <= SNAPSHOT_MAX_NS, "gives up within the bound");
+}
+
+static void test_format(void)
+{
+    static const struct {
+        uint32_t sec;
+        uint16_t subsec;
+        int decimals;
+        const char *expected;
+    } cases[] = {
+        { 0, 0, 2, "00:00:00:00.00" },
+        { 5, 2048, 2, "00:00:00:05.50" },
+        { 59, 4095, 2, "00:00:00:59.99" }, // truncated, never 60.00
+        { 3599, 4095, 4, "00:00:59:59.9997" },
+        { 86399, 4095, 0, "00:23:59:59" },
+        { 86400, 0, 1, "01:00:00:00.0" },
+        { 100 * 86400 + 3723, 1, 6, "100:01:02:03.000244" },
+        { 0xFFFFFFFF, 4095, 6, "49710:06:28:15.999755" },
+    };
+    char str[RTC_TIME_STR_LEN];
+    bool ok = true;
+
+    printf("formatter\n");
+
+    for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        rtc_time_t t = { cases[i].sec, cases[i].subsec };
+        int n = rtc_time_format(str, sizeof(str), &t, cases[i].decimals);
+
+        if (n != (int)strlen(cases[i].expected) || strcmp(str, cases[i].expected) != 0) {
+            printf("  %u.%04u s: \"%s\", expected \"%s\"\n", (unsigned)t.sec, (unsigned)t.subsec,
+                   (n < 0) ? "" : str, cases[i].expected);
+            ok = false;
+        }
+    }
+    sim_check(ok, "fields, decimals, truncation and day rollover");
+
+    {
+        rtc_time_t t = { 0xFFFFFFFF, 4095 };
+
+        sim_check(rtc_time_format(str, RTC_TIME_STR_LEN - 1, &t, RTC_TIME_MAX_DECIMALS) == -1 &&
+                      rtc_time_format(str, sizeof(str), &t, RTC_TIME_MAX_DECIMALS + 1) == -1,
+                  "rejects a short buffer and too many decimals");
+    }
+}
+
+static int rtc_time_main(void)
+{
+    MXC_RTC_Init(0, 0);
+    MXC_RTC_Start();
+
+    test_phases();
+    test_forced_rollover();
+    test_stuck_busy();
+    test_format();
+
+    return 0;
+}
+
+int main(void)
+{
+    sim_init(60 * SIM_NS_PER_SEC);
+    sim_console_config(0, false);
+
+    return sim_test_run("RTC TIME", rtc_time_main);
+}
@@ -0,0 +1,220 @@
+/**
+ * @file    rtc_trim_test.c
+ * @brief   Test of the RTC trim calibration (common/rtc_trim.c)
+ * @details Runs rtc_trim.c on the simulated RTC and TMR2 (APB clock) with
+ *          several crystal errors: a 10 s measurement, the trim applied, and a
+ *          second measurement that must find the RTC on time to within its
+ *          uncertainty. Around every edge stamp another interrupt holds the
+ *          core for 1 - 8 us every 5 - 40 us, so some stamps are preempted
+ *          across the edge and must wait for the next one.
+ *
+ *          Then windows of 1 - 600 s (prescaled reference), a crystal beyond
+ *          the trim range, a finish after the counter wrapped and a reference
+ *          frequency that is wrong.
+ *
+ *          Prints RTC TRIM PASS and exits with 0 when every check passed.
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "hal_sim.h"
+#include "sim_test.h"
+#include "mxc_delay.h"
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "nvic_table.h"
+#include "rtc.h"
+#include "rtc_trim.h"
+#include "tmr.h"
+
+/***** Definitions *****/
+#define REF_TMR MXC_TMR2
+#define WINDOW_SEC 10
+#define NOISE_IRQ TMR5_IRQn
+#define NOISE_GAP_MIN_NS 5000
+#define NOISE_GAP_MAX_NS 40000
+#define NOISE_MIN_US 1
+#define NOISE_MAX_US 8
+
+/***** Globals *****/
+static uint32_t seed = 12345;
+static bool noisy; // noise interrupts scheduled
+static uint32_t noise_us; // length of the next one
+
+/***** Functions *****/
+static uint32_t rand_next(void)
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+static void noise_handler(void)
+{
+    MXC_Delay(noise_us);
+}
+
+// raises the noise interrupt and schedules the next one
+static void noise_event(void *arg)
+{
+    (void)arg;
+
+    if (!noisy) {
+        return;
+    }
+    noise_us = NOISE_MIN_US + rand_next() % (NOISE_MAX_US - NOISE_MIN_US + 1);
+    sim_raise_irq(NOISE_IRQ);
+    sim_schedule(sim_now() + NOISE_GAP_MIN_NS + rand_next() % (NOISE_GAP_MAX_NS - NOISE_GAP_MIN_NS),
+                 noise_event, NULL);
+}
+
+static void set_noise(bool on)
+{
+    noisy = on;
+    sim_cancel(noise_event, NULL);
+    if (on) {
+        sim_schedule(sim_now() + rand_next() % NOISE_GAP_MAX_NS, noise_event, NULL);
+    }
+}
+
+// stamps under noise, retried on E_BUSY like readTemp does
+static int start(uint32_t window_sec)
+{
+    int err;
+
+    set_noise(true);
+    while ((err = rtc_trim_start(window_sec)) == E_BUSY) {}
+    set_noise(false);
+    return err;
+}
+
+static int finish(int32_t *ppb)
+{
+    int err;
+
+    set_noise(true);
+    while ((err = rtc_trim_finish(ppb)) == E_BUSY) {}
+    set_noise(false);
+    return err;
+}
+
+static int measure(uint32_t window_sec, int32_t *ppb)
+{
+    int err = start(window_sec);
+
+    if (err != E_NO_ERROR) {
+        return err;
+    }
+    MXC_Delay(MXC_DELAY_SEC(window_sec));
+    return finish(ppb);
+}
+
+// measured within the uncertainty of the true error
+static bool within(int32_t ppb, int32_t true_ppm)
+{
+    rtc_trim_stats_t stats;
+    int32_t err;
+
+    rtc_trim_get_stats(&stats);
+    err = ppb - true_ppm * 1000;
+    return (err < 0 ? -err : err) <= (int32_t)stats.uncertainty_ppb;
+}
+
+// measure, trim, measure again
+static bool calibrate(int32_t crystal_ppm)
+{
+    rtc_trim_stats_t stats;
+    int32_t before = 0, after = 0;
+    bool ok;
+
+    sim_rtc_set_ppm(crystal_ppm);
+    rtc_trim_set(0);
+
+    ok = measure(WINDOW_SEC, &before) == E_NO_ERROR && within(before, crystal_ppm);
+    ok = ok && rtc_trim_apply(before) == E_NO_ERROR;
+    rtc_trim_get_stats(&stats);
+    ok = ok && stats.trim == -crystal_ppm;
+    ok = ok && measure(WINDOW_SEC, &after) == E_NO_ERROR && within(after, 0);
+
+    rtc_trim_get_stats(&stats);
+    printf("  crystal %+4d ppm: measured %+8d ppb, trim %+4d, then %+5d ppb (+/- %u)\n",
+           (int)crystal_ppm, (int)before, (int)stats.trim, (int)after,
+           (unsigned)stats.uncertainty_ppb);
+    return ok;
+}
+
+static int rtc_trim_main(void)
+{
+    static const int32_t crystals[] = { -87, -20, 0, 13, 100 };
+    static const uint32_t windows[] = { 1, 10, 100, 600 };
+    rtc_trim_stats_t stats;
+    int32_t ppb = 0;
+    int err;
+    bool ok;
+
+    MXC_RTC_Init(0, 0);
+    MXC_RTC_Start();
+    MXC_NVIC_SetVector(NOISE_IRQ, noise_handler);
+    NVIC_EnableIRQ(NOISE_IRQ);
+
+    sim_check(rtc_trim_finish(&ppb) == E_BAD_STATE, "rtc_trim_finish() before rtc_trim_init()");
+    sim_check(rtc_trim_init(REF_TMR, MXC_TMR_APB_CLK, 0) == E_NO_ERROR, "rtc_trim_init()");
+
+    printf("%d s windows, APB reference\n", WINDOW_SEC);
+    ok = true;
+    for (unsigned i = 0; i < sizeof(crystals) / sizeof(crystals[0]); i++) {
+        ok = calibrate(crystals[i]) && ok;
+    }
+    rtc_trim_get_stats(&stats);
+    printf("  %u edges passed while a stamp was preempted\n", (unsigned)stats.edges_rejected);
+    sim_check(ok, "every crystal measured, trimmed and on time after");
+    sim_check(stats.edges_rejected > 0, "stamps preempted across the edge (the case is provoked)");
+
+    printf("window length, crystal +37 ppm, untrimmed\n");
+    sim_rtc_set_ppm(37);
+    rtc_trim_set(0);
+    ok = true;
+    for (unsigned i = 0; i < sizeof(windows) / sizeof(windows[0]); i++) {
+        err = measure(windows[i], &ppb);
+        rtc_trim_get_stats(&stats);
+        printf("  %3u s: %+6d ppb (+/- %u), %u RTC ticks\n", (unsigned)windows[i], (int)ppb,
+               (unsigned)stats.uncertainty_ppb, (unsigned)stats.rtc_ticks);
+        ok = ok && err == E_NO_ERROR && within(ppb, 37);
+    }
+    sim_check(ok, "every window measures within its uncertainty");
+    sim_check(stats.uncertainty_ppb < 10, "600 s windows: under 0.01 ppm");
+
+    printf("crystal +200 ppm\n");
+    sim_rtc_set_ppm(200);
+    rtc_trim_set(0);
+    err = measure(WINDOW_SEC, &ppb);
+    sim_check(err == E_NO_ERROR && rtc_trim_apply(ppb) == E_OVERFLOW,
+              "beyond the trim range: E_OVERFLOW");
+    rtc_trim_get_stats(&stats);
+    sim_check(stats.trim == -RTC_TRIM_MAX && measure(WINDOW_SEC, &ppb) == E_NO_ERROR &&
+                  within(ppb, 200 - RTC_TRIM_MAX),
+              "trim at the end of its range, the rest measured");
+
+    sim_rtc_set_ppm(0);
+    rtc_trim_set(0);
+    start(1);
+    MXC_Delay(MXC_DELAY_SEC(80)); // the counter wraps after 71.6 s
+    sim_check(finish(&ppb) == E_OVERFLOW, "finished after the counter wrapped: E_OVERFLOW");
+    sim_check(finish(&ppb) == E_BAD_STATE, "finished twice: E_BAD_STATE");
+
+    // the reference reported 2 % faster than it runs
+    rtc_trim_init(REF_TMR, MXC_TMR_APB_CLK,
+                  MXC_TMR_GetPeriod(REF_TMR, MXC_TMR_APB_CLK, 1, 1) / 50 * 51);
+    sim_check(measure(1, &ppb) == E_BAD_STATE, "wrong reference frequency: E_BAD_STATE");
+
+    return 0;
+}
+
+int main(void)
+{
+    sim_init(4000 * SIM_NS_PER_SEC);
+    sim_console_config(0, false);
+
+    return sim_test_run("RTC TRIM", rtc_trim_main);
+}
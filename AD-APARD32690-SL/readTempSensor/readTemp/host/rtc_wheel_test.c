@@ -0,0 +1,386 @@
+/**
+ * @file    rtc_wheel_test.c
+ * @brief   Test of the RTC timer wheel (common/rtc_wheel.c)
+ * @details Runs rtc_wheel.c on the simulated RTC, with a main loop that sleeps
+ *          until the sub-second alarm and runs the callbacks like readTemp's.
+ *          Every callback compares the time it was due with the expected one
+ *          and with the RTC when it runs:
+ *
+ *          - 48 periodic timers, 244 us to 51 s, for 3 minutes: each expires
+ *            on its own grid, never early, with a bounded delay
+ *          - a callback that sometimes runs longer than its period: the
+ *            expiries it misses are merged, the grid is kept
+ *          - one-shot timers on both sides of every level boundary, up to
+ *            the longest delay (3 days)
+ *          - 200 one-shot timers started and stopped at random: a stopped
+ *            timer never runs
+ *          - periodic timers across the 32-bit RTC tick wrap (12 days)
+ *
+ *          Prints RTC WHEEL PASS and exits with 0 when every case passed.
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal_sim.h"
+#include "sim_test.h"
+#include "mxc_delay.h"
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "nvic_table.h"
+#include "rtc.h"
+#include "rtc_time.h"
+#include "rtc_wheel.h"
+
+/***** Definitions *****/
+#define PERIODIC_TIMERS 48
+#define PERIODIC_SEC 180
+#define CHURN_TIMERS 200
+#define CHURN_SEC 120
+#define WRAP_TIMERS 8
+#define OVERRUN_PERIOD 10 // ticks
+#define OVERRUN_CALLS 400
+// due to callback: the alarm's register writes and the callbacks due at the
+// same tick
+#define LATENCY_MAX_TICKS 8
+
+typedef struct {
+    rtc_timer_t timer;
+    uint32_t next; // tick the next callback is due at
+    uint32_t runs;
+    uint32_t bad; // wrong due time, early or late
+    bool stopped;
+} job_t;
+
+/***** Globals *****/
+static job_t jobs[CHURN_TIMERS];
+static uint32_t latency_worst;
+
+/***** Functions *****/
+static uint32_t now_ticks(void)
+{
+    rtc_time_t now;
+
+    while (rtc_time_get(&now) != E_NO_ERROR) {}
+    return rtc_time_ticks(&now);
+}
+
+void RTC_IRQHandler(void)
+{
+    if (MXC_RTC_GetFlags() & MXC_F_RTC_CTRL_SSEC_ALARM) {
+        MXC_RTC_ClearFlags(MXC_F_RTC_CTRL_SSEC_ALARM);
+        rtc_wheel_alarm();
+    }
+}
+
+static void end_fn(void *arg, uint32_t due)
+{
+    (void)due;
+    *(bool *)arg = true;
+}
+
+// main loop until the RTC reaches end (ticks), at most RTC_WHEEL_MAX_TICKS
+// per wait
+static void run_until(uint32_t end)
+{
+    rtc_timer_t end_timer;
+    volatile bool done = false;
+
+    rtc_timer_init(&end_timer, end_fn, (void *)&done);
+    while ((int32_t)(end - now_ticks()) > 0) {
+        uint32_t wait = end - now_ticks();
+
+        done = false;
+        if (rtc_wheel_start(&end_timer, (wait > RTC_WHEEL_MAX_TICKS) ? RTC_WHEEL_MAX_TICKS : wait,
+                            0) != E_NO_ERROR) {
+            sim_check(false, "the end timer starts");
+            return;
+        }
+        for (;;) {
+            rtc_wheel_run();
+            if (done) {
+                break;
+            }
+
+            __disable_irq();
+            if (!rtc_wheel_pending()) {
+                __WFI();
+            }
+            __enable_irq();
+        }
+    }
+}
+
+// due must be the expected time, and the callback not early or late
+static void job_fn(void *arg, uint32_t due)
+{
+    job_t *job = arg;
+    uint32_t late = now_ticks() - due;
+
+    if (due != job->next || job->stopped || (int32_t)late < 0 || late > LATENCY_MAX_TICKS) {
+        job->bad++;
+    }
+    if ((int32_t)late > 0 && late > latency_worst) {
+        latency_worst = late;
+    }
+    job->runs++;
+    job->next = due + job->timer.period;
+}
+
+static uint32_t rand_next(uint32_t *seed)
+{
+    *seed = *seed * 1664525 + 1013904223;
+    return *seed >> 8;
+}
+
+static void stop_all(int n)
+{
+    for (int i = 0; i < n; i++) {
+        rtc_wheel_stop(&jobs[i].timer);
+    }
+}
+
+static void test_periodic(void)
+{
+    uint32_t start = now_ticks() + 100;
+    uint32_t end = start + PERIODIC_SEC * RTC_WHEEL_TICKS_PER_SEC;
+    uint32_t missing = 0, bad = 0, total = 0;
+    rtc_wheel_stats_t stats;
+
+    printf("%d periodic timers for %d s\n", PERIODIC_TIMERS, PERIODIC_SEC);
+
+    latency_worst = 0;
+    for (int i = 0; i < PERIODIC_TIMERS; i++) {
+        // 1 tick to 73 s, across all levels
+        uint32_t period = 1 + (uint32_t)i * i * i * 2 + (uint32_t)i * 37;
+
+        memset(&jobs[i], 0x00, sizeof(jobs[i]));
+        rtc_timer_init(&jobs[i].timer, job_fn, &jobs[i]);
+        jobs[i].next = start + i;
+        rtc_wheel_start_at(&jobs[i].timer, start + i, period);
+    }
+
+    run_until(end);
+    stop_all(PERIODIC_TIMERS);
+
+    for (int i = 0; i < PERIODIC_TIMERS; i++) {
+        uint32_t period = jobs[i].timer.period;
+        uint32_t expected = (end - (start + i)) / period + 1;
+
+        // the last one may or may not have run at end
+        if (jobs[i].runs != expected && jobs[i].runs != expected - 1) {
+            missing++;
+        }
+        bad += jobs[i].bad;
+        total += jobs[i].runs;
+    }
+
+    rtc_wheel_get_stats(&stats);
+    printf("  %u callbacks, %u alarms, %u cascades, longest delay %u ticks\n", (unsigned)total,
+           (unsigned)stats.alarms, (unsigned)stats.cascaded, (unsigned)latency_worst);
+    sim_check(missing == 0, "every period ran once");
+    sim_check(bad == 0, "on the nominal grid, never early, bounded delay");
+    sim_check(stats.overruns == 0, "no period skipped");
+}
+
+static void test_levels(void)
+{
+    static const uint32_t delays[] = {
+        0, 1, 2, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 262145,
+        16777215, 16777216, 16777217, RTC_WHEEL_MAX_TICKS,
+    };
+    const int n = sizeof(delays) / sizeof(delays[0]);
+    rtc_timer_t extra;
+    uint32_t start = 0;
+    bool ok = true;
+
+    printf("one-shot timers at the level boundaries, up to %u ticks\n",
+           (unsigned)RTC_WHEEL_MAX_TICKS);
+
+    latency_worst = 0;
+    for (int i = 0; i < n; i++) {
+        // the wheel reads the RTC after this, so the delay stays in range
+        start = now_ticks();
+        memset(&jobs[i], 0x00, sizeof(jobs[i]));
+        rtc_timer_init(&jobs[i].timer, job_fn, &jobs[i]);
+        jobs[i].next = start + delays[i];
+        if (rtc_wheel_start_at(&jobs[i].timer, start + delays[i], 0) != E_NO_ERROR) {
+            ok = false;
+        }
+    }
+
+    run_until(start + RTC_WHEEL_MAX_TICKS + 10);
+
+    for (int i = 0; i < n; i++) {
+        if (jobs[i].runs != 1 || jobs[i].bad != 0) {
+            printf("  %u ticks: %u runs, %u bad\n", (unsigned)delays[i], (unsigned)jobs[i].runs,
+                   (unsigned)jobs[i].bad);
+            ok = false;
+        }
+    }
+    printf("  longest delay %u ticks\n", (unsigned)latency_worst);
+    sim_check(ok, "each ran once, at its tick");
+
+    rtc_timer_init(&extra, job_fn, &jobs[0]);
+    sim_check(rtc_wheel_start(&extra, RTC_WHEEL_MAX_TICKS + 1, 0) == E_BAD_PARAM &&
+                  rtc_wheel_start(&extra, 1, RTC_WHEEL_MAX_TICKS + 1) == E_BAD_PARAM &&
+                  !rtc_timer_active(&extra),
+              "rejects delays and periods beyond the wheel");
+}
+
+// every fourth call takes three and a half periods
+static void overrun_fn(void *arg, uint32_t due)
+{
+    job_t *job = arg;
+
+    if ((due - job->next) % OVERRUN_PERIOD != 0 || (int32_t)(due - job->next) < 0) {
+        job->bad++;
+    }
+    job->next = due + OVERRUN_PERIOD;
+    if (++job->runs % 4 == 0) {
+        MXC_Delay(MXC_DELAY_USEC(OVERRUN_PERIOD * 3500000 / RTC_WHEEL_TICKS_PER_SEC));
+    }
+}
+
+static void test_overrun(void)
+{
+    rtc_wheel_stats_t before, after;
+    job_t *job = &jobs[0];
+    uint32_t start = now_ticks() + 10;
+
+    printf("a periodic callback that overruns its period\n");
+
+    memset(job, 0x00, sizeof(*job));
+    rtc_timer_init(&job->timer, overrun_fn, job);
+    job->next = start;
+    rtc_wheel_get_stats(&before);
+    rtc_wheel_start_at(&job->timer, start, OVERRUN_PERIOD);
+
+    run_until(start + OVERRUN_CALLS * OVERRUN_PERIOD);
+    rtc_wheel_stop(&job->timer);
+    rtc_wheel_get_stats(&after);
+
+    printf("  %u callbacks, %u expiries merged\n", (unsigned)job->runs,
+           (unsigned)(after.overruns - before.overruns));
+    sim_check(job->bad == 0, "each callback on the grid, after the previous one");
+    sim_check(after.overruns - before.overruns > 0 &&
+                  job->runs + (after.overruns - before.overruns) >= OVERRUN_CALLS,
+              "missed expiries merged and counted, none lost");
+}
+
+static void churn_fn(void *arg, uint32_t due)
+{
+    uint32_t *seed = arg;
+
+    (void)due;
+
+    // stop a running timer or start an idle one, 20 at a time
+    for (int k = 0; k < 20; k++) {
+        job_t *job = &jobs[rand_next(seed) % CHURN_TIMERS];
+
+        if (rtc_timer_active(&job->timer)) {
+            rtc_wheel_stop(&job->timer);
+            job->stopped = true;
+        } else {
+            uint32_t delay = rand_next(seed) % (3 * RTC_WHEEL_TICKS_PER_SEC);
+
+            job->stopped = false;
+            job->next = now_ticks() + delay;
+            rtc_wheel_start(&job->timer, delay, 0);
+        }
+    }
+}
+
+static void test_churn(void)
+{
+    rtc_timer_t churn;
+    uint32_t seed = 7;
+    uint32_t bad = 0, runs = 0;
+
+    printf("%d one-shot timers started and stopped at random for %d s\n", CHURN_TIMERS,
+           CHURN_SEC);
+
+    latency_worst = 0;
+    for (int i = 0; i < CHURN_TIMERS; i++) {
+        memset(&jobs[i], 0x00, sizeof(jobs[i]));
+        rtc_timer_init(&jobs[i].timer, job_fn, &jobs[i]);
+    }
+    rtc_timer_init(&churn, churn_fn, &seed);
+    rtc_wheel_start(&churn, 1, RTC_WHEEL_MS_TO_TICKS(7));
+
+    run_until(now_ticks() + CHURN_SEC * RTC_WHEEL_TICKS_PER_SEC);
+    rtc_wheel_stop(&churn);
+    stop_all(CHURN_TIMERS);
+
+    for (int i = 0; i < CHURN_TIMERS; i++) {
+        bad += jobs[i].bad;
+        runs += jobs[i].runs;
+    }
+    printf("  %u callbacks, longest delay %u ticks\n", (unsigned)runs, (unsigned)latency_worst);
+    sim_check(runs > 0 && bad == 0, "stopped timers never ran, the others on time");
+}
+
+static void test_wrap(void)
+{
+    uint32_t start;
+
+    printf("periodic timers across the RTC tick wrap\n");
+
+    // 2^32 ticks wrap at 2^20 s; start 10 s before
+    MXC_RTC_Init(0x100000 - 10, 0);
+    MXC_RTC_Start();
+    rtc_wheel_init();
+
+    latency_worst = 0;
+    start = now_ticks() + 10;
+    for (int i = 0; i < WRAP_TIMERS; i++) {
+        uint32_t period = RTC_WHEEL_MS_TO_TICKS(100 + 433 * i);
+
+        memset(&jobs[i], 0x00, sizeof(jobs[i]));
+        rtc_timer_init(&jobs[i].timer, job_fn, &jobs[i]);
+        jobs[i].next = start;
+        rtc_wheel_start_at(&jobs[i].timer, start, period);
+    }
+
+    run_until(start + 20 * RTC_WHEEL_TICKS_PER_SEC);
+    stop_all(WRAP_TIMERS);
+
+    {
+        uint32_t bad = 0;
+        bool ran = true;
+
+        for (int i = 0; i < WRAP_TIMERS; i++) {
+            bad += jobs[i].bad;
+            ran = ran && (jobs[i].runs >= 20 * RTC_WHEEL_TICKS_PER_SEC / jobs[i].timer.period);
+        }
+        sim_check(ran && bad == 0 && (int32_t)now_ticks() > 0 && (int32_t)start < 0,
+                  "on the grid before and after the wrap");
+    }
+}
+
+static int rtc_wheel_main(void)
+{
+    MXC_RTC_Init(0, 0);
+    MXC_RTC_Start();
+    NVIC_EnableIRQ(RTC_IRQn);
+    rtc_wheel_init();
+
+    test_periodic();
+    test_overrun();
+    test_levels();
+    test_churn();
+    test_wrap();
+
+    return 0;
+}
+
+int main(void)
+{
+    // the longest one-shot timer needs 3 days
+    sim_init(4ULL * 24 * 3600 * SIM_NS_PER_SEC);
+    sim_console_config(0, false);
+
+    return sim_test_run("RTC WHEEL", rtc_wheel_main);
+}
@@ -0,0 +1,20 @@
+/**
+ * @file    sim_console.h
+ * @brief   Console for the firmware sources in the host build
+ * @details Force-included (-include) into every firmware source so that
+ *          printf() goes through sim_printf(). It hands the text to the stdio
+ *          backend the way newlib's _write() would: the MSDK's, which waits
+ *          for room in the simulated console UART's FIFO for every character,
+ *          or __wrap__write() when the firmware provides one (console_tx.c).
+ */
+
+#ifndef SIM_CONSOLE_H_
+#define SIM_CONSOLE_H_
+
+#include <stdio.h>
+
+int sim_printf(const char *restrict format, ...) __attribute__((format(printf, 1, 2)));
+
+#define printf sim_printf
+
+#endif // SIM_CONSOLE_H_
@@ -0,0 +1,513 @@
+/**
+ * @file    sim_main.c
+ * @brief   Host simulation of readTemp: scenario options, run and summary
+ * @details Builds the simulated board (MAX31723 on SPI4 slave select 0, SW2 on
+ *          P1.27; with -n, more MAX31723s on slave selects 1 - 2 and P1.6),
+ *          runs the firmware's main() until the time limit and prints where
+ *          the time went. SW2 presses and releases bounce for a pseudo-random
+ *          time, and -g adds short glitches while it is released.
+ *          The run passes when the firmware kept running until the limit, no
+ *          bus protocol violation was seen, every sensor was read, every
+ *          sample it reported (text, telemetry record or tokenized message)
+ *          is the ambient temperature at the end of one of the sensor's
+ *          recent conversions, truncated to that conversion's resolution, and
+ *          LED1 toggled once per press. With -j the sensor's ambient steps
+ *          between the LSB and the MSB of a burst read, and the two bytes
+ *          read must still belong to one conversion.
+ */
+
+/***** Includes *****/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hal_sim.h"
+#include "max31723_model.h"
+#include "tlm_frame.h"
+#include "tlog_msgs.h"
+
+/***** Definitions *****/
+// board wiring, must match main.c
+#define SIM_SENSOR_SPI 4
+#define SIM_SENSOR_CS_PORT 1 // chip enable of the fourth sensor (P1.6)
+#define SIM_SENSOR_CS_PIN (1u << 6)
+#define SIM_MAX_SENSORS 4
+#define SIM_SENSOR_STEP_MC 500 // each further sensor reads 0.5 C warmer
+#define SIM_SW2_PORT 1
+#define SIM_SW2_PIN (1u << 27)
+#define SIM_LED1_PORT 2 // toggled by each debounced press
+#define SIM_LED1_PIN (1u << 1)
+
+#define SIM_MAX_PRESSES 32
+#define SIM_PRESS_NS SIM_MS(150) // how long SW2 is held
+#define SIM_BOUNCE_MIN_NS SIM_US(20) // time between two contact bounces
+#define SIM_BOUNCE_MAX_NS SIM_US(1500)
+#define SIM_MAX_GLITCHES 16
+#define SIM_GLITCH_MIN_NS SIM_US(20) // how long a glitch pulls SW2 low
+#define SIM_GLITCH_MAX_NS SIM_US(500)
+#define SIM_GLITCH_CLEAR_NS SIM_MS(500) // glitches stay this far from presses
+#define SIM_STEP_MC 1500 // -j: changes the MSB and the LSB at any resolution
+#define SIM_CONSOLE_BLOCK 256 // console characters kept until a line end or delimiter
+
+// one press: the contact closes (low) and opens (high) at the press and at
+// the release, bounces times each, before it settles
+typedef struct {
+    uint64_t at;
+    int bounces;
+    int step; // next edge of the train
+} sim_press_t;
+
+/***** Globals *****/
+static max31723_model_t sensors[SIM_MAX_SENSORS];
+static int sensor_count = 1;
+static sim_press_t presses[SIM_MAX_PRESSES];
+static int press_count;
+static uint64_t rng_state = 1;
+
+// reported samples (see watch_console())
+static uint8_t console_block[SIM_CONSOLE_BLOCK];
+static size_t console_len;
+static uint32_t samples_ok;
+static uint32_t samples_bad;
+static int bad_sensor;
+static int16_t bad_temp;
+static bool stepped; // -j
+
+// the firmware's main(), renamed at compile time
+int readtemp_main(void);
+
+/***** Functions *****/
+static void usage(const char *prog)
+{
+    printf("usage: %s [options]\n", prog);
+    printf("  -t <s>       simulated run time in seconds (default 60)\n");
+    printf("  -p <s>       press SW2 at this time, repeatable\n");
+    printf("  -b <n>       contact bounces at each press and release (default 0)\n");
+    printf("  -g <n>       glitches on SW2 while released, up to %d (default 0)\n",
+           SIM_MAX_GLITCHES);
+    printf("  -s <seed>    seed of the bounce and glitch timing (default 1)\n");
+    printf("  -n <count>   MAX31723s on the bus, 1 - %d (default 1), must match FANOUT_SENSORS\n",
+           SIM_MAX_SENSORS);
+    printf("  -T <C>       ambient temperature at time 0 (default 25.0)\n");
+    printf("  -r <C/min>   ambient temperature ramp (default 0)\n");
+    printf("  -L <Hz>      fastest SCLK the sensor wiring carries (default no limit)\n");
+    printf("  -u <baud>    console speed, 0 = printing takes no time (default 115200)\n");
+    printf("  -P <ppm>     RTC crystal error (default 0)\n");
+    printf("  -j <s>       from this time, step the first sensor's ambient by %+.1f C between\n"
+           "               the LSB and the MSB of its next burst read\n",
+           SIM_STEP_MC / 1000.0);
+    printf("  -o <file>    copy the console output (text and telemetry) to file\n");
+    printf("  -q           hide the firmware's output, print the summary only\n");
+}
+
+// uniform in [lo, hi], from a fixed-seed LCG so that runs repeat
+static uint64_t sim_random(uint64_t lo, uint64_t hi)
+{
+    rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return lo + (rng_state >> 16) % (hi - lo + 1);
+}
+
+static void sw2_edge_event(void *arg)
+{
+    sim_gpio_set_input(SIM_SW2_PORT, SIM_SW2_PIN, arg != NULL);
+}
+
+// SW2 pulls the pin low while pressed. The press edge and each bounce after
+// it alternate low/high, as does the release edge (high) with its bounces;
+// each edge schedules the next one, so a press holds one event at a time.
+static void press_train_event(void *arg)
+{
+    sim_press_t *press = arg;
+    int edges = 1 + 2 * press->bounces; // per phase
+    int step = press->step++;
+    bool release = step >= edges;
+    int k = release ? step - edges : step;
+    bool level = ((k % 2) != 0) != release;
+
+    sim_gpio_set_input(SIM_SW2_PORT, SIM_SW2_PIN, level);
+
+    if (step + 1 == edges) {
+        sim_schedule(press->at + SIM_PRESS_NS, press_train_event, press);
+    } else if (step + 1 < 2 * edges) {
+        sim_schedule(sim_now() + sim_random(SIM_BOUNCE_MIN_NS, SIM_BOUNCE_MAX_NS),
+                     press_train_event, press);
+    }
+}
+
+static bool near_press(uint64_t t)
+{
+    for (int i = 0; i < press_count; i++) {
+        if (t + SIM_GLITCH_CLEAR_NS > presses[i].at &&
+            t < presses[i].at + SIM_PRESS_NS + SIM_GLITCH_CLEAR_NS) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// short low pulses while SW2 is released, shorter than any settle window
+static void schedule_glitches(int count, uint64_t end_ns)
+{
+    for (int i = 0; i < count; i++) {
+        uint64_t t;
+
+        do {
+            t = sim_random(SIM_NS_PER_SEC, end_ns - SIM_NS_PER_SEC);
+        } while (near_press(t));
+
+        sim_schedule(t, sw2_edge_event, NULL);
+        sim_schedule(t + sim_random(SIM_GLITCH_MIN_NS, SIM_GLITCH_MAX_NS), sw2_edge_event,
+                     (void *)1);
+    }
+}
+
+// what the sensor held after one of its recent conversions: the ambient at
+// its end in Q8.8, truncated to its resolution
+static bool sample_expected(const max31723_model_t *m, int16_t temp_q8)
+{
+    uint32_t count = (m->conversions < MAX31723_MODEL_RESULTS) ? m->conversions
+                                                               : MAX31723_MODEL_RESULTS;
+
+    for (uint32_t i = 1; i <= count; i++) {
+        const max31723_model_result_t *r =
+            &m->results[(m->conversions - i) % MAX31723_MODEL_RESULTS];
+        int32_t q8 = (int32_t)(((int64_t)max31723_model_ambient(m, r->at) * 256) / 1000);
+        uint16_t unused = (uint16_t)((1u << (16 - r->bits)) - 1);
+
+        if (((uint16_t)q8 & (uint16_t)~unused) == (uint16_t)temp_q8) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void check_sample(int sensor, int16_t temp_q8)
+{
+    // TLM_BENCH and TLOG_BENCH report a made-up sample before the RTC starts
+    if (sensor < 0 || sensor >= sensor_count || sim_rtc_ticks() == 0) {
+        return;
+    }
+    if (sample_expected(&sensors[sensor], temp_q8)) {
+        samples_ok++;
+    } else if (samples_bad++ == 0) {
+        bad_sensor = sensor;
+        bad_temp = temp_q8;
+    }
+}
+
+// a printed temperature, exact in Q8.8 at 4 decimals
+static int16_t parse_q8(const char *str)
+{
+    double c = atof(str) * 256;
+
+    return (int16_t)((c < 0) ? c - 0.5 : c + 0.5);
+}
+
+// "Final Temperature: 25.5000" (sensor 0) or "Sensor 2: 25.5000"
+static void check_text(const char *line)
+{
+    static const char final_temp[] = "Final Temperature: ";
+    int sensor;
+    int n;
+
+    if (strncmp(line, final_temp, sizeof(final_temp) - 1) == 0) {
+        check_sample(0, parse_q8(line + sizeof(final_temp) - 1));
+    } else if (sscanf(line, "Sensor %d: %n", &sensor, &n) == 1) {
+        check_sample(sensor, parse_q8(line + n));
+    }
+}
+
+// a telemetry record: a sample, or a tokenized sample message
+static void check_record(const tlm_record_t *rec)
+{
+    tlm_sample_t sample;
+    uint32_t args[TLOG_ARGS_MAX];
+    uint32_t id;
+    int nargs;
+
+    if (tlm_sample_decode(rec, &sample)) {
+        check_sample(0, sample.temp_q8);
+        return;
+    }
+    if (rec->type != TLM_REC_LOG) {
+        return;
+    }
+    nargs = tlog_unpack(rec->payload, rec->len, &id, args, TLOG_ARGS_MAX);
+    if ((id == TLOG_SAMPLE_SW2 || id == TLOG_SAMPLE_SW2_RTC || id == TLOG_SAMPLE_RTC ||
+         id == TLOG_SAMPLE_RTC_SW2) &&
+        nargs == 5) {
+        check_sample(0, (int16_t)args[4]);
+    } else if (id == TLOG_SENSOR_TEMP && nargs == 2) {
+        check_sample((int)args[0], (int16_t)args[1]);
+    }
+}
+
+// the console as it leaves the UART, split like tlm_decode: text lines, and
+// records between zero delimiters
+static void watch_console(uint8_t c)
+{
+    tlm_record_t rec;
+    bool text = true;
+
+    if (c == 0) {
+        if (console_len <= TLM_FRAME_MAX && tlm_frame_unpack(console_block, console_len, &rec)) {
+            check_record(&rec);
+        }
+        console_len = 0;
+        return;
+    }
+    if (c == '\n') {
+        // console_tx.c sends "\r\n"
+        size_t len = (console_len > 0 && console_block[console_len - 1] == '\r') ? console_len - 1
+                                                                                : console_len;
+
+        for (size_t i = 0; i < len; i++) {
+            text = text && console_block[i] >= 0x20 && console_block[i] <= 0x7E;
+        }
+        if (text) {
+            console_block[len] = '\0';
+            check_text((const char *)console_block);
+            console_len = 0;
+            return;
+        }
+    }
+    if (console_len < sizeof(console_block) - 1) {
+        console_block[console_len++] = c;
+    } else {
+        console_len = 0; // neither a line nor a frame
+    }
+}
+
+static void step_event(void *arg)
+{
+    (void)arg;
+    max31723_model_step_in_burst(&sensors[0], SIM_STEP_MC);
+}
+
+// -j: the two bytes of the burst that saw the step come from one result
+static bool step_ok(void)
+{
+    return !stepped || (sensors[0].step_done && sensors[0].step_read == sensors[0].step_before);
+}
+
+// first sensor whose temperature was never read, -1 if none
+static int unread_sensor(void)
+{
+    for (int i = 0; i < sensor_count; i++) {
+        if (sensors[i].reads == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static double percent(uint64_t part, uint64_t whole)
+{
+    return (whole == 0) ? 0.0 : 100.0 * (double)part / (double)whole;
+}
+
+// LED1 should toggle once per press, neither on bounces nor on glitches
+static bool presses_ok(void)
+{
+    return sim_gpio_out_changes(SIM_LED1_PORT, SIM_LED1_PIN) == (uint32_t)press_count;
+}
+
+static void print_summary(int end, double seconds)
+{
+    const sim_stats_t *s = sim_get_stats();
+    uint64_t total = s->awake_ns + s->asleep_ns;
+    static const char *const irq_names[MXC_IRQ_COUNT] = {
+        [SPI0_IRQn] = "SPI0", [SPI1_IRQn] = "SPI1", [SPI4_IRQn] = "SPI4",
+        [RTC_IRQn] = "RTC",   [GPIO0_IRQn] = "GPIO0", [GPIO1_IRQn] = "GPIO1",
+        [GPIO2_IRQn] = "GPIO2", [DMA0_IRQn] = "DMA0", [DMA1_IRQn] = "DMA1",
+        [DMA2_IRQn] = "DMA2", [DMA3_IRQn] = "DMA3", [TMR0_IRQn] = "TMR0",
+        [TMR1_IRQn] = "TMR1", [TMR2_IRQn] = "TMR2", [TMR3_IRQn] = "TMR3",
+        [TMR4_IRQn] = "TMR4", [TMR5_IRQn] = "TMR5", [UART0_IRQn] = "UART0",
+    };
+
+    printf("\n\n***** SIMULATION SUMMARY *****\n");
+    printf("Simulated time: %.3f s, awake %.2f%%, asleep %.2f%% (%u WFI, %u WFE)\n", seconds,
+           percent(s->awake_ns, total), percent(s->asleep_ns, total), (unsigned)s->wfi,
+           (unsigned)s->wfe);
+    if (s->standbys != 0) {
+        printf("STANDBY: %u times, %.2f%% of the time, %.1f us to wake up each time\n",
+               (unsigned)s->standbys, percent(s->standby_ns, total),
+               (double)SIM_STANDBY_WAKE_NS / 1000);
+    }
+    printf("SPI: %u transactions, %u bytes\n", (unsigned)s->spi_transactions,
+           (unsigned)s->spi_bytes);
+    for (int i = 0; i < sensor_count; i++) {
+        printf("%s: %u conversions, %u temperature reads, %u results held by CE\n",
+               sensors[i].dev.name, (unsigned)sensors[i].conversions, (unsigned)sensors[i].reads,
+               (unsigned)sensors[i].held_updates);
+    }
+    printf("SW2: %d presses, LED1 toggled %u times\n", press_count,
+           (unsigned)sim_gpio_out_changes(SIM_LED1_PORT, SIM_LED1_PIN));
+    printf("Samples: %u reported, %u not the sensor's temperature\n",
+           (unsigned)(samples_ok + samples_bad), (unsigned)samples_bad);
+    if (stepped) {
+        printf("Mid-burst step: %s, read %04X, register before the step %04X\n",
+               sensors[0].step_done ? "in a burst" : "not reached",
+               (unsigned)sensors[0].step_read, (unsigned)sensors[0].step_before);
+    }
+    printf("Console: %u characters\n", (unsigned)s->console_chars);
+    printf("IRQs:");
+    for (int i = 0; i < MXC_IRQ_COUNT; i++) {
+        if (s->irqs[i] != 0) {
+            printf(" %s %u", irq_names[i], (unsigned)s->irqs[i]);
+        }
+    }
+    printf("\n");
+
+    if (end == SIM_END_RETURNED) {
+        printf("\nSIM FAIL: main() returned (initialization error)\n");
+    } else if (end == SIM_END_FAULT) {
+        printf("\nSIM FAIL: unhandled interrupt\n");
+    } else if (s->errors != 0) {
+        printf("\nSIM FAIL: %u protocol errors\n", (unsigned)s->errors);
+    } else if (unread_sensor() >= 0) {
+        printf("\nSIM FAIL: %s was never read\n", sensors[unread_sensor()].dev.name);
+    } else if (!presses_ok()) {
+        printf("\nSIM FAIL: SW2 presses and LED1 toggles differ\n");
+    } else if (samples_ok == 0) {
+        printf("\nSIM FAIL: no sample reported\n");
+    } else if (samples_bad != 0) {
+        printf("\nSIM FAIL: %s reported %.4f C, no recent conversion gave that\n",
+               sensors[bad_sensor].dev.name, bad_temp / 256.0);
+    } else if (!step_ok()) {
+        printf("\nSIM FAIL: the burst read mixed bytes of two conversions\n");
+    } else {
+        printf("\nSIM PASS\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 60.0;
+    double ambient = 25.0;
+    double ramp = 0.0;
+    uint32_t baud = 115200;
+    unsigned int link_hz = 0;
+    int32_t ppm = 0;
+    uint64_t step_ns = 0;
+    int bounces = 0;
+    int glitches = 0;
+    bool quiet = false;
+    FILE *capture = NULL;
+    int opt;
+    int end;
+
+    while ((opt = getopt(argc, argv, "t:p:b:g:s:n:T:r:L:u:P:j:o:qh")) != -1) {
+        switch (opt) {
+        case 't':
+            seconds = atof(optarg);
+            break;
+        case 'p':
+            if (press_count < SIM_MAX_PRESSES) {
+                presses[press_count++].at = (uint64_t)(atof(optarg) * SIM_NS_PER_SEC);
+            }
+            break;
+        case 'b':
+            bounces = atoi(optarg);
+            break;
+        case 'g':
+            glitches = atoi(optarg);
+            if (glitches < 0 || glitches > SIM_MAX_GLITCHES) {
+                usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 's':
+            rng_state = (uint64_t)atoll(optarg);
+            break;
+        case 'n':
+            sensor_count = atoi(optarg);
+            if (sensor_count < 1 || sensor_count > SIM_MAX_SENSORS) {
+                usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 'T':
+            ambient = atof(optarg);
+            break;
+        case 'r':
+            ramp = atof(optarg);
+            break;
+        case 'L':
+            link_hz = (unsigned int)atol(optarg);
+            break;
+        case 'u':
+            baud = (uint32_t)atol(optarg);
+            break;
+        case 'P':
+            ppm = atoi(optarg);
+            break;
+        case 'j':
+            stepped = true;
+            step_ns = (uint64_t)(atof(optarg) * SIM_NS_PER_SEC);
+            break;
+        case 'o':
+            capture = fopen(optarg, "wb");
+            if (capture == NULL) {
+                perror(optarg);
+                return 2;
+            }
+            break;
+        case 'q':
+            quiet = true;
+            break;
+        default:
+            usage(argv[0]);
+            return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    sim_init((uint64_t)(seconds * SIM_NS_PER_SEC));
+    sim_console_config(baud, quiet);
+    sim_console_capture(capture);
+    sim_console_watch(watch_console);
+    sim_rtc_set_ppm(ppm);
+    sim_spi_set_link_hz(SIM_SENSOR_SPI, link_hz);
+
+    for (int i = 0; i < sensor_count; i++) {
+        static const char *const names[SIM_MAX_SENSORS] = {
+            "MAX31723", "MAX31723 SS1", "MAX31723 SS2", "MAX31723 P1.6",
+        };
+
+        max31723_model_init(&sensors[i], names[i],
+                            (int32_t)(ambient * 1000) + i * SIM_SENSOR_STEP_MC,
+                            (int32_t)(ramp * 1000));
+        if (i < 3) {
+            max31723_model_attach(&sensors[i], SIM_SENSOR_SPI, i);
+        } else {
+            max31723_model_attach_gpio(&sensors[i], SIM_SENSOR_SPI, SIM_SENSOR_CS_PORT,
+                                       SIM_SENSOR_CS_PIN);
+        }
+    }
+
+    for (int i = 0; i < press_count; i++) {
+        presses[i].bounces = bounces;
+        presses[i].step = 0;
+        sim_schedule(presses[i].at, press_train_event, &presses[i]);
+    }
+    if (stepped) {
+        sim_schedule(step_ns, step_event, NULL);
+    }
+    if (glitches > 0 && seconds > 3.0) {
+        schedule_glitches(glitches, (uint64_t)(seconds * SIM_NS_PER_SEC));
+    }
+
+    end = sim_run(readtemp_main);
+    fflush(stdout);
+    if (capture != NULL) {
+        fclose(capture);
+    }
+
+    print_summary(end, (double)sim_now() / SIM_NS_PER_SEC);
+
+    return (end == SIM_END_TIME_LIMIT && sim_get_stats()->errors == 0 && unread_sensor() < 0 &&
+            presses_ok() && samples_ok != 0 && samples_bad == 0 && step_ok())
+               ? 0
+               : 1;
+}
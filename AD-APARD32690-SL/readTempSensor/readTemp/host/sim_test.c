@@ -0,0 +1,38 @@
+/**
+ * @file    sim_test.c
+ * @brief   Checks and verdict of the host tests of the common modules
+ */
+
+/***** Includes *****/
+#include <stdio.h>
+
+#include "hal_sim.h"
+#include "sim_test.h"
+
+/***** Globals *****/
+static int failures;
+
+/***** Functions *****/
+void sim_check(bool ok, const char *what)
+{
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) {
+        failures++;
+    }
+}
+
+int sim_test_run(const char *name, int (*entry)(void))
+{
+    int end = sim_run(entry);
+
+    if (end != SIM_END_RETURNED) {
+        printf("the test did not finish (%d)\n", end);
+        failures++;
+    }
+    if (sim_get_stats()->errors != 0) {
+        failures++;
+    }
+
+    printf("\n%s %s\n", name, (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,27 @@
+/**
+ * @file    sim_test.h
+ * @brief   Checks and verdict of the host tests of the common modules
+ * @details A test sets up the simulation with sim_init() and
+ *          sim_console_config(), then hands its entry point to
+ *          sim_test_run(). Each sim_check() prints one line and counts a
+ *          failure; the run fails as well when the entry point did not return
+ *          or the simulation saw a protocol error.
+ */
+
+#ifndef SIM_TEST_H_
+#define SIM_TEST_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+
+/***** Functions *****/
+// prints what was checked, "ok" or "FAILED"
+void sim_check(bool ok, const char *what);
+
+/*
+ * Runs entry() on the simulated board and prints "<name> PASS" or
+ * "<name> FAIL". Returns the exit code of the test: 0 when every check passed.
+ */
+int sim_test_run(const char *name, int (*entry)(void));
+
+#endif // SIM_TEST_H_
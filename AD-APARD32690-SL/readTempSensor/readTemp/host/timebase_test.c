@@ -0,0 +1,326 @@
+/**
+ * @file    timebase_test.c
+ * @brief   Test of the 64-bit microsecond timebase (common/timebase.c)
+ * @details Runs timebase.c on the simulated TMR1 for 24 simulated minutes,
+ *          20 rollovers of its 32-bit counter, with the RTC crystal 100 ppm
+ *          fast and timebase_discipline() called every 5 s, like readTemp does.
+ *
+ *          Around each rollover main() reads the timebase in a tight loop,
+ *          half of the reads with interrupts masked, while another interrupt
+ *          reads it every 20 us, preempting main() between its register
+ *          reads. Every read must be at least as late as every read that
+ *          completed before it started, and must agree with the simulated
+ *          RTC to within its tick. A plain "upper word plus count" extension
+ *          of a second TMR runs alongside for comparison.
+ *
+ *          Prints TIMEBASE PASS and exits with 0 when every check passed.
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "hal_sim.h"
+#include "sim_test.h"
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "nvic_table.h"
+#include "rtc.h"
+#include "rtc_time.h"
+#include "timebase.h"
+#include "tmr.h"
+
+/***** Definitions *****/
+#define TB_TMR MXC_TMR1
+#define NAIVE_TMR MXC_TMR2 // same clock, extended without the flag or the sequence check
+#define WAKE_TMR MXC_TMR3 // one-shot: wakes main() for the next discipline or rollover
+#define READER_TMR MXC_TMR4 // interrupt reader
+#define RUN_SEC 1440
+#define ROLLOVERS 20 // 2^32 ticks at 60 MHz: 71.6 s
+#define RTC_PPM 100
+#define DISCIPLINE_US 5000000
+#define WINDOW_US 1000 // reads in a loop this long before and after each rollover
+#define READER_TICKS 1237 // about 20 us between interrupt reads
+#define JITTER_TICKS 1024 // on the start of the reads in a loop
+#define BLOCK_READS 4 // with interrupts masked, then twice as many enabled
+#define OFFSET_MAX_US 10 // timebase minus RTC at the edges, once the rate is known
+
+/***** Globals *****/
+static uint32_t seed = 12345;
+static uint32_t tmr_hz;
+
+static volatile uint64_t latest; // latest read completed, any context
+static uint32_t reads; // main() and interrupt reads
+static uint32_t irq_reads;
+static uint32_t pending_reads; // with the rollover not handled yet
+static uint32_t straddled_reads; // with the rollover handled in the middle
+static uint32_t backwards; // reads earlier than one completed before them
+static uint32_t rtc_mismatch; // reads more than a tick off the RTC
+static bool rtc_check; // rate measured and first offset removed
+
+static volatile uint64_t naive_hi;
+static volatile uint64_t naive_latest;
+static uint32_t naive_backwards;
+
+static volatile bool woke;
+
+/***** Functions *****/
+static uint32_t rand_next(void)
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+// a read at least as late as the ones completed before it, on the RTC's tick
+static void read_checked(void)
+{
+    uint64_t floor = latest, us;
+    uint32_t rtc, primask;
+    int32_t diff;
+
+    us = timebase_us();
+    rtc = (uint32_t)sim_rtc_ticks();
+
+    if (us < floor) {
+        backwards++;
+    }
+    if (rtc_check) {
+        diff = (int32_t)(timebase_rtc_ticks(us) - rtc);
+        if (diff < -1 || diff > 1) {
+            rtc_mismatch++;
+        }
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (us > latest) {
+        latest = us;
+    }
+    reads++;
+    __set_PRIMASK(primask);
+}
+
+static uint64_t naive_us(void)
+{
+    uint64_t hi = naive_hi;
+    uint32_t count = MXC_TMR_GetCount(NAIVE_TMR);
+
+    return (hi + count - 1) * 1000000 / tmr_hz;
+}
+
+static void naive_checked(void)
+{
+    uint64_t floor = naive_latest, us;
+    uint32_t primask;
+
+    us = naive_us();
+    if (us < floor) {
+        naive_backwards++;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (us > naive_latest) {
+        naive_latest = us;
+    }
+    __set_PRIMASK(primask);
+}
+
+static void naive_isr(void)
+{
+    MXC_TMR_ClearFlags(NAIVE_TMR);
+    naive_hi += UINT32_MAX;
+}
+
+static void reader_isr(void)
+{
+    MXC_TMR_ClearFlags(READER_TMR);
+    if (MXC_TMR_GetFlags(TB_TMR)) {
+        pending_reads++;
+    }
+    read_checked();
+    naive_checked();
+    irq_reads++;
+}
+
+static void wake_isr(void)
+{
+    MXC_TMR_ClearFlags(WAKE_TMR);
+    woke = true;
+}
+
+static void tmr_setup(mxc_tmr_regs_t *tmr, mxc_tmr_mode_t mode, uint32_t cmp,
+                      void (*handler)(void))
+{
+    mxc_tmr_cfg_t cfg;
+
+    cfg.pres = TMR_PRES_1;
+    cfg.mode = mode;
+    cfg.bitMode = TMR_BIT_MODE_32;
+    cfg.clock = MXC_TMR_APB_CLK;
+    cfg.cmp_cnt = cmp;
+    cfg.pol = 0;
+
+    MXC_TMR_Init(tmr, &cfg, false);
+    MXC_TMR_EnableInt(tmr);
+    MXC_NVIC_SetVector(MXC_TMR_GET_IRQ(MXC_TMR_GET_IDX(tmr)), handler);
+    NVIC_EnableIRQ(MXC_TMR_GET_IRQ(MXC_TMR_GET_IDX(tmr)));
+}
+
+static void sleep_ticks(uint32_t ticks)
+{
+    MXC_TMR_SetCount(WAKE_TMR, 1);
+    MXC_TMR_SetCompare(WAKE_TMR, (ticks > 0) ? ticks : 1);
+    woke = false;
+    MXC_TMR_Start(WAKE_TMR);
+
+    while (!woke) {
+        __disable_irq();
+        if (!woke) {
+            __WFI();
+        }
+        __enable_irq();
+    }
+}
+
+static uint32_t rollovers(void)
+{
+    timebase_stats_t stats;
+
+    timebase_get_stats(&stats);
+    return stats.overflows;
+}
+
+// reads in a loop from WINDOW_US before the rollover to WINDOW_US after it
+static void rollover_window(void)
+{
+    uint32_t before = rollovers();
+    uint64_t end = 0;
+
+    MXC_TMR_Start(READER_TMR);
+
+    while ((end == 0 || latest < end) && backwards == 0) {
+        // masked: a rollover meanwhile waits for its handler, the reads see the flag
+        __disable_irq();
+        for (int i = 0; i < BLOCK_READS; i++) {
+            if (MXC_TMR_GetFlags(TB_TMR)) {
+                pending_reads++;
+            }
+            read_checked();
+            naive_checked();
+        }
+        __enable_irq();
+
+        // enabled: the handler can run between the loads of a read
+        for (int i = 0; i < 2 * BLOCK_READS; i++) {
+            uint32_t count = rollovers();
+
+            read_checked();
+            if (rollovers() != count) {
+                straddled_reads++;
+            }
+        }
+        naive_checked();
+
+        if (end == 0 && rollovers() != before) {
+            end = latest + WINDOW_US;
+        }
+    }
+
+    MXC_TMR_Stop(READER_TMR);
+}
+
+static int timebase_main(void)
+{
+    uint64_t next_discipline = DISCIPLINE_US, start_ns;
+    uint32_t window_ticks, calls = 0;
+    timebase_stats_t stats;
+    rtc_time_t rtc;
+
+    sim_rtc_set_ppm(RTC_PPM);
+    MXC_RTC_Init(0, 0);
+    MXC_RTC_Start();
+
+    tmr_hz = MXC_TMR_GetPeriod(TB_TMR, MXC_TMR_APB_CLK, 1, 1);
+    window_ticks = (uint32_t)((uint64_t)tmr_hz * WINDOW_US / 1000000);
+
+    sim_check(timebase_init(TB_TMR) == E_NO_ERROR, "timebase_init()");
+    tmr_setup(NAIVE_TMR, TMR_MODE_CONTINUOUS, UINT32_MAX, naive_isr);
+    MXC_TMR_Start(NAIVE_TMR);
+    tmr_setup(READER_TMR, TMR_MODE_CONTINUOUS, READER_TICKS, reader_isr); // runs in the windows
+    tmr_setup(WAKE_TMR, TMR_MODE_ONESHOT, 1, wake_isr);
+
+    // cost of one read, against a coherent read of the RTC
+    start_ns = sim_now();
+    timebase_us();
+    printf("timebase_us() takes %u ns, rtc_time_get() ", (unsigned)(sim_now() - start_ns));
+    start_ns = sim_now();
+    while (rtc_time_get(&rtc) != E_NO_ERROR) {}
+    printf("%u ns\n", (unsigned)(sim_now() - start_ns));
+
+    while (timebase_discipline() != E_NO_ERROR) {}
+
+    printf("%d s, RTC %+d ppm, reads in a loop for %d ms around each rollover\n", RUN_SEC,
+           RTC_PPM, 2 * WINDOW_US / 1000);
+
+    // a read that went back may have jumped far ahead first: stop there
+    while (latest < (uint64_t)RUN_SEC * 1000000 && backwards == 0) {
+        uint32_t count, to_rollover;
+        uint64_t sleep;
+
+        read_checked();
+        if (latest >= next_discipline) {
+            timebase_discipline();
+            calls++;
+            rtc_check = (calls >= 2); // the offset of the nominal rate removed
+            next_discipline += DISCIPLINE_US;
+        }
+
+        count = MXC_TMR_GetCount(TB_TMR);
+        to_rollover = TIMEBASE_TMR_PERIOD - count;
+        if (to_rollover <= window_ticks + JITTER_TICKS) {
+            rollover_window();
+            continue;
+        }
+
+        sleep = (next_discipline - latest) * tmr_hz / 1000000;
+        if (sleep > to_rollover - window_ticks - JITTER_TICKS) {
+            // the loop meets the rollover at a different point of its reads each time
+            sleep = to_rollover - window_ticks - rand_next() % JITTER_TICKS;
+        }
+        sleep_ticks((uint32_t)sleep);
+    }
+
+    timebase_get_stats(&stats);
+    printf("  %u reads, %u from the interrupt, %u with the rollover pending, %u across its "
+           "handler\n",
+           (unsigned)reads, (unsigned)irq_reads, (unsigned)pending_reads,
+           (unsigned)straddled_reads);
+    printf("  %u rollovers, %u of %u disciplines, %u missed; offset up to %u us, "
+           "RTC rate %+d.%03d ppm\n",
+           (unsigned)stats.overflows, (unsigned)stats.disciplines, (unsigned)calls + 1,
+           (unsigned)stats.missed, (unsigned)stats.offset_max_us, (int)(stats.rate_ppb / 1000),
+           (int)((stats.rate_ppb < 0 ? -stats.rate_ppb : stats.rate_ppb) % 1000));
+    printf("  plain extension: %u reads went back\n", (unsigned)naive_backwards);
+
+    sim_check(stats.overflows == ROLLOVERS, "every rollover counted");
+    sim_check(backwards == 0, "no read earlier than one completed before it");
+    sim_check(rtc_mismatch == 0, "every read on the RTC's tick");
+    sim_check(irq_reads > 0 && pending_reads > 0 && straddled_reads > 0,
+              "reads preempted, across the handler, with the flag pending");
+    sim_check(stats.rate_ppb > (RTC_PPM - 1) * 1000 && stats.rate_ppb < (RTC_PPM + 1) * 1000,
+              "RTC rate measured to 1 ppm");
+    sim_check(stats.offset_max_us <= OFFSET_MAX_US && stats.steps == 0,
+              "timebase follows the RTC without steps");
+    sim_check(naive_backwards > 0, "the plain extension goes back (the case is provoked)");
+
+    return 0;
+}
+
+int main(void)
+{
+    sim_init((uint64_t)(RUN_SEC + 5) * SIM_NS_PER_SEC);
+    sim_console_config(0, false);
+
+    return sim_test_run("TIMEBASE", timebase_main);
+}
@@ -0,0 +1,211 @@
+/**
+ * @file    tlm_decode.c
+ * @brief   Decoder of readTemp's binary telemetry (TELEMETRY builds) into CSV
+ * @details Reads the console stream, from the board's serial port or a file
+ *          captured with the simulation's -o, and splits it at the zero
+ *          delimiters. Every block that holds a valid record becomes a CSV
+ *          line on stdout; printable text between the records is the
+ *          firmware's printf() output and is passed to stderr with -t, and
+ *          so are tokenized log messages (TOKENIZED_LOG builds), formatted with
+ *          readTemp's message table (../tlog_msgs.c).
+ *          Anything else is a corrupted frame, and a jump in the sequence
+ *          numbers counts the frames lost. Exits with 1 when either happened;
+ *          a frame cut off by the end of the stream is only reported.
+ *
+ *          tlm_decode [-t] [file]        (stdin without file)
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "temp_q8.h"
+#include "tlm_frame.h"
+#include "tlog_msgs.h"
+
+/***** Definitions *****/
+#define BLOCK_MAX 4096 // longer blocks can only be text
+#define TRIGGER_SW2 (1 << 0) // as in sample_ring.h
+#define TRIGGER_RTC (1 << 1)
+
+typedef struct {
+    uint32_t records[5]; // by type, [0] unknown types and messages
+    uint32_t text_bytes;
+    uint32_t bad_frames;
+    uint32_t truncated; // cut off by the end of the stream
+    uint32_t lost; // missing sequence numbers
+} decode_stats_t;
+
+/***** Globals *****/
+static bool echo_text;
+static decode_stats_t stats;
+static bool have_seq;
+static uint8_t next_seq;
+
+/***** Functions *****/
+static bool is_text(const uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if ((buf[i] < 0x20 || buf[i] > 0x7E) && buf[i] != '\n' && buf[i] != '\r' &&
+            buf[i] != '\t') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void print_temp(int16_t temp_q8)
+{
+    char str[TEMP_Q8_STR_LEN];
+
+    temp_q8_format(str, sizeof(str), temp_q8, 4);
+    printf("%s", str);
+}
+
+static void print_time(uint32_t sec, uint16_t subsec)
+{
+    printf("%u.%06u", (unsigned)sec, (unsigned)((uint64_t)subsec * 1000000 / 4096));
+}
+
+// a tokenized message, formatted like the firmware would
+static bool print_log(const tlm_record_t *rec)
+{
+    uint32_t args[TLOG_ARGS_MAX];
+    char line[TLOG_LINE_MAX];
+    uint32_t id;
+    int nargs = tlog_unpack(rec->payload, rec->len, &id, args, TLOG_ARGS_MAX);
+
+    if (nargs < 0 || id >= TLOG_COUNT || tlog_formats[id] == NULL ||
+        tlog_format(line, sizeof(line), tlog_formats[id], args, nargs) < 0) {
+        return false;
+    }
+    if (echo_text) {
+        fputs(line, stderr);
+    }
+    return true;
+}
+
+static void print_record(const tlm_record_t *rec)
+{
+    tlm_sample_t sample;
+    tlm_average_t avg;
+    tlm_alert_t alert;
+
+    if (tlm_sample_decode(rec, &sample)) {
+        printf("sample,%u,", rec->seq);
+        print_time(sample.rtc_seconds, sample.subseconds);
+        printf(",%s%s%s,", (sample.trigger_source & TRIGGER_SW2) ? "SW2" : "",
+               (sample.trigger_source == (TRIGGER_SW2 | TRIGGER_RTC)) ? "+" : "",
+               (sample.trigger_source & TRIGGER_RTC) ? "RTC" : "");
+        print_temp(sample.temp_q8);
+        printf(",,\n");
+        stats.records[TLM_REC_SAMPLE]++;
+    } else if (tlm_average_decode(rec, &avg)) {
+        printf("average,%u,", rec->seq);
+        print_time(avg.rtc_seconds, 0);
+        printf(",,");
+        print_temp(avg.temp_q8);
+        printf(",%u,\n", avg.count);
+        stats.records[TLM_REC_AVERAGE]++;
+    } else if (tlm_alert_decode(rec, &alert)) {
+        printf("alert,%u,", rec->seq);
+        print_time(alert.rtc_seconds, 0);
+        printf(",,");
+        print_temp(alert.temp_q8);
+        printf(",,%s\n", alert.high ? "high" : "clear");
+        stats.records[TLM_REC_ALERT]++;
+    } else if (rec->type == TLM_REC_LOG && print_log(rec)) {
+        stats.records[TLM_REC_LOG]++;
+    } else {
+        stats.records[0]++;
+    }
+}
+
+// one block between two delimiters; incomplete at the end of the stream
+static void decode_block(const uint8_t *buf, size_t len, bool complete)
+{
+    tlm_record_t rec;
+
+    if (len == 0) {
+        return;
+    }
+
+    if (complete && len <= TLM_FRAME_MAX && tlm_frame_unpack(buf, len, &rec)) {
+        if (have_seq && rec.seq != next_seq) {
+            stats.lost += (uint8_t)(rec.seq - next_seq);
+        }
+        have_seq = true;
+        next_seq = rec.seq + 1;
+        print_record(&rec);
+    } else if (is_text(buf, len)) {
+        stats.text_bytes += len;
+        if (echo_text) {
+            fwrite(buf, 1, len, stderr);
+        }
+    } else if (!complete) {
+        stats.truncated++;
+    } else {
+        stats.bad_frames++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t block[BLOCK_MAX];
+    size_t len = 0;
+    FILE *in = stdin;
+    int opt;
+    int c;
+
+    while ((opt = getopt(argc, argv, "th")) != -1) {
+        switch (opt) {
+        case 't':
+            echo_text = true;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-t] [file]\n", argv[0]);
+            fprintf(stderr, "  -t   pass the text and the log messages to stderr\n");
+            return (opt == 'h') ? 0 : 2;
+        }
+    }
+    if (optind < argc) {
+        in = fopen(argv[optind], "rb");
+        if (in == NULL) {
+            perror(argv[optind]);
+            return 2;
+        }
+    }
+
+    printf("record,seq,time_s,source,temp_c,count,alert\n");
+
+    while ((c = fgetc(in)) != EOF) {
+        if (c == 0) {
+            decode_block(block, len, true);
+            len = 0;
+        } else {
+            block[len++] = (uint8_t)c;
+            if (len == sizeof(block)) {
+                // too long for a frame
+                if (is_text(block, len)) {
+                    decode_block(block, len, false);
+                } else {
+                    stats.bad_frames++;
+                }
+                len = 0;
+            }
+        }
+    }
+    decode_block(block, len, false);
+
+    fprintf(stderr,
+            "tlm_decode: %u samples, %u averages, %u alerts, %u log messages, "
+            "%u unknown records, %u text bytes, %u bad frames, %u frames lost, %u truncated\n",
+            (unsigned)stats.records[TLM_REC_SAMPLE], (unsigned)stats.records[TLM_REC_AVERAGE],
+            (unsigned)stats.records[TLM_REC_ALERT], (unsigned)stats.records[TLM_REC_LOG],
+            (unsigned)stats.records[0],
+            (unsigned)stats.text_bytes, (unsigned)stats.bad_frames, (unsigned)stats.lost,
+            (unsigned)stats.truncated);
+
+    return (stats.bad_frames == 0 && stats.lost == 0) ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file    tlog_format_test.c
+ * @brief   Test of the tokenized log encoding and formatter (common/tlog_format.c)
+ * @details Checks tlog_format() and the argument encoding without the firmware:
+ *
+ *          - %d, %i, %u, %x, %X and %c with every flag, width and precision
+ *            against the host's snprintf(), on values from 0 to the 32-bit
+ *            limits
+ *          - the integer-only %q, %t and %b conversions
+ *          - every argument survives tlog_pack() and tlog_unpack() unchanged,
+ *            and small negative arguments take one or two bytes
+ *          - malformed payloads and argument counts are rejected
+ *
+ *          Prints TLOG FORMAT PASS and exits with 0 when every case passed.
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal_sim.h"
+#include "sim_test.h"
+#include "temp_q8.h"
+#include "tlog_format.h"
+
+/***** Definitions *****/
+#define ARRAY_LEN(a) (sizeof(a) / sizeof((a)[0]))
+
+/***** Globals *****/
+static const uint32_t values[] = {
+    0, 1, 7, 9, 10, 15, 16, 63, 64, 127, 128, 255, 1000, 8191, 8192, 65535,
+    0x7FFFFFFF, 0x80000000, 0xFFFFFFFF, 0xFFFFFFFE, 0u - 64, 0u - 65, 0u - 1000, 12345678,
+};
+
+/***** Functions *****/
+static void test_printf(void)
+{
+    static const char *const flags[] = { "",   "-",  "0",  "+",  " ", "#",
+                                         "-0", "+0", "- ", "#0", "-#" };
+    static const char convs[] = "diuxXc";
+    uint32_t cases = 0, wrong = 0;
+
+    for (size_t f = 0; f < ARRAY_LEN(flags); f++) {
+        for (int width = -1; width <= 12; width += 3) {
+            for (int prec = -1; prec <= 11; prec += 2) {
+                for (size_t c = 0; convs[c] != '\0'; c++) {
+                    for (size_t v = 0; v < ARRAY_LEN(values); v++) {
+                        char fmt[16], want[64], got[64];
+                        int len = sprintf(fmt, "%%%s", flags[f]);
+
+                        if (convs[c] == 'c' && (values[v] & 0xFF) == 0) {
+                            continue; // the '\0' ends the string
+                        }
+                        if (width >= 0) {
+                            len += sprintf(fmt + len, "%d", width);
+                        }
+                        if (prec >= 0 && convs[c] != 'c') {
+                            len += sprintf(fmt + len, ".%d", prec);
+                        }
+                        sprintf(fmt + len, "%c", convs[c]);
+
+                        if (convs[c] == 'd' || convs[c] == 'i') {
+                            snprintf(want, sizeof(want), fmt, (int)values[v]);
+                        } else if (convs[c] == 'c') {
+                            snprintf(want, sizeof(want), fmt, (int)(uint8_t)values[v]);
+                        } else {
+                            snprintf(want, sizeof(want), fmt, (unsigned)values[v]);
+                        }
+
+                        cases++;
+                        if (tlog_format(got, sizeof(got), fmt, &values[v], 1) < 0 ||
+                            strcmp(got, want) != 0) {
+                            if (wrong++ < 5) {
+                                printf("  %s of %u: \"%s\", printf \"%s\"\n", fmt,
+                                       (unsigned)values[v], got, want);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    printf("printf's conversions: %u cases, %u different\n", (unsigned)cases, (unsigned)wrong);
+    sim_check(wrong == 0, "like snprintf() for every flag, width and precision");
+}
+
+static void test_own(void)
+{
+    char out[TLOG_LINE_MAX];
+    uint32_t args[] = { (uint32_t)(int32_t)TEMP_Q8_FROM_C(-5.5), 3 * 4096 + 2048, 0xA5, 42 };
+
+    printf("integer-only conversions\n");
+
+    sim_check(tlog_format(out, sizeof(out), "%.4q|%05.2t|%b|%-4u|", args, 4) > 0 &&
+                  strcmp(out, "-5.5000|03.50|1010 0101|42  |") == 0,
+              "%q, %t, %b next to printf's");
+    sim_check(tlog_format(out, sizeof(out), "%u %u", args, 1) == -1 &&
+                  tlog_format(out, sizeof(out), "%u", args, 2) == -1 &&
+                  tlog_format(out, 8, "%s", args, 1) == -1 &&
+                  tlog_format(out, 4, "%u", &values[ARRAY_LEN(values) - 1], 1) == -1,
+              "rejects bad counts, conversions and buffers");
+}
+
+static void test_encoding(void)
+{
+    uint8_t payload[64];
+    uint32_t args[TLOG_ARGS_MAX];
+    uint32_t id;
+    bool same = true;
+    size_t len;
+
+    printf("encoding\n");
+
+    for (size_t i = 0; i + TLOG_ARGS_MAX <= ARRAY_LEN(values); i++) {
+        len = tlog_pack(payload, sizeof(payload), 33, &values[i], TLOG_ARGS_MAX);
+        same = same && len != 0 &&
+               tlog_unpack(payload, len, &id, args, TLOG_ARGS_MAX) == TLOG_ARGS_MAX && id == 33 &&
+               memcmp(args, &values[i], sizeof(args)) == 0;
+    }
+    sim_check(same, "every argument unpacks to the value packed");
+
+    {
+        const uint32_t small[] = { 0u - 1, 0u - 64, 63 };
+        const uint32_t two[] = { 0u - 65, 0u - 1000, 64, 1000 };
+
+        sim_check(tlog_pack(payload, sizeof(payload), 1, small, ARRAY_LEN(small)) ==
+                          1 + ARRAY_LEN(small) &&
+                      tlog_pack(payload, sizeof(payload), 1, two, ARRAY_LEN(two)) ==
+                          1 + 2 * ARRAY_LEN(two),
+                  "-64 to 63 take one byte, -8192 to 8191 two");
+    }
+
+    len = tlog_pack(payload, sizeof(payload), 1, values, 4);
+    payload[len - 1] |= 0x80;
+    sim_check(tlog_unpack(payload, len, &id, args, TLOG_ARGS_MAX) == -1 &&
+                  tlog_unpack(payload, len - 1, &id, args, 2) == -1 &&
+                  tlog_pack(payload, 4, 1, values, 4) == 0,
+              "rejects truncated and overlong payloads");
+}
+
+static int tlog_format_main(void)
+{
+    test_printf();
+    test_own();
+    test_encoding();
+
+    return 0;
+}
+
+int main(void)
+{
+    sim_init(60 * SIM_NS_PER_SEC);
+    sim_console_config(0, false);
+
+    return sim_test_run("TLOG FORMAT", tlog_format_main);
+}
@@ -0,0 +1,275 @@
+/**
+ * @file    tod_sched_test.c
+ * @brief   Test of the absolute time-of-day alarm schedule (common/tod_sched.c)
+ * @details Runs tod_sched.c on the simulated RTC for 24 simulated hours per
+ *          case, with a 5 s alarm and the same disturbances each time:
+ *
+ *          - another interrupt that holds the core for 0.2 - 1.8 s, at random
+ *            times (ISR latency)
+ *          - every 97th callback keeps main() busy for 12 s (overruns)
+ *
+ *          With TOD_SCHED_SKIP and TOD_SCHED_CATCH_UP every callback is on the
+ *          grid and the last one falls exactly 24 h after the first: zero
+ *          cumulative drift. The old handler, which rearmed the alarm at the
+ *          current second plus the period from the ISR, runs alongside for
+ *          comparison.
+ *
+ *          Prints TOD SCHED PASS and exits with 0 when every case passed.
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "hal_sim.h"
+#include "sim_test.h"
+#include "mxc_delay.h"
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "nvic_table.h"
+#include "rtc.h"
+#include "rtc_time.h"
+#include "tod_sched.h"
+
+/***** Definitions *****/
+#define PERIOD_SEC 5
+#define RUN_SEC (24 * 3600)
+#define ALARMS (RUN_SEC / PERIOD_SEC + 1) // first and last included
+#define STALL_IRQ TMR5_IRQn
+#define STALL_GAP_SEC 1200 // at most, between two stalls of the core
+#define STALL_MIN_MS 200
+#define STALL_MAX_MS 1800
+#define BUSY_EVERY 97 // callbacks
+#define BUSY_SEC 12 // main() held up for more than two periods
+
+typedef enum {
+    MODE_LEGACY, // rearm from the current second, in the ISR
+    MODE_SKIP,
+    MODE_CATCH_UP,
+} case_t;
+
+/***** Globals *****/
+static case_t mode;
+static uint32_t seed;
+static uint32_t run_end_sec; // no more disturbances after this
+static uint32_t stall_ms; // length of the next stall
+
+static uint32_t epoch;
+static uint32_t runs;
+static uint32_t last_sec; // nominal second of the last callback
+static uint32_t off_grid; // callbacks off the grid or out of order
+static uint32_t missing; // grid seconds passed without a callback (CATCH_UP)
+static uint64_t isr_max_ns; // longest RTC handler
+
+static volatile uint32_t legacy_alarm_sec; // second the old handler armed last
+static volatile uint32_t legacy_pending; // alarms the old handler saw
+static volatile uint32_t legacy_fired_sec;
+
+/***** Functions *****/
+static uint32_t rand_next(void)
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+static uint32_t now_sec(void)
+{
+    rtc_time_t now;
+
+    while (rtc_time_get(&now) != E_NO_ERROR) {}
+    return now.sec;
+}
+
+static void stall_handler(void)
+{
+    MXC_Delay(MXC_DELAY_MSEC(stall_ms));
+}
+
+// raises the stall interrupt and schedules the next one
+static void stall_event(void *arg)
+{
+    (void)arg;
+
+    if (now_sec() >= run_end_sec) {
+        return;
+    }
+    stall_ms = STALL_MIN_MS + rand_next() % (STALL_MAX_MS - STALL_MIN_MS);
+    sim_raise_irq(STALL_IRQ);
+    sim_schedule(sim_now() + SIM_MS(1000 + rand_next() % (STALL_GAP_SEC * 1000)), stall_event,
+                 NULL);
+}
+
+// the time-of-day part of readTemp's handler before tod_sched.c
+static void legacy_alarm(void)
+{
+    rtc_time_t now;
+
+    legacy_fired_sec = legacy_alarm_sec;
+    legacy_pending++;
+
+    while (MXC_RTC_DisableInt(MXC_F_RTC_CTRL_TOD_ALARM_IE) == E_BUSY) {}
+    if (rtc_time_get(&now) != E_NO_ERROR) {
+        now.sec = legacy_alarm_sec;
+    }
+    MXC_RTC_SetTimeofdayAlarm(now.sec + PERIOD_SEC);
+    legacy_alarm_sec = now.sec + PERIOD_SEC;
+    while (MXC_RTC_EnableInt(MXC_F_RTC_CTRL_TOD_ALARM_IE) == E_BUSY) {}
+}
+
+void RTC_IRQHandler(void)
+{
+    uint64_t start = sim_now();
+
+    if (MXC_RTC_GetFlags() & MXC_F_RTC_CTRL_TOD_ALARM) {
+        MXC_RTC_ClearFlags(MXC_F_RTC_CTRL_TOD_ALARM);
+        if (mode == MODE_LEGACY) {
+            legacy_alarm();
+        } else {
+            tod_sched_alarm();
+        }
+    }
+
+    if (sim_now() - start > isr_max_ns) {
+        isr_max_ns = sim_now() - start;
+    }
+}
+
+// checks sec against the grid and the previous callback
+static void alarm_fn(void *arg, uint32_t sec)
+{
+    (void)arg;
+
+    if ((sec - epoch) % PERIOD_SEC != 0 || (runs > 0 && (int32_t)(sec - last_sec) <= 0)) {
+        off_grid++;
+    } else if (runs > 0 && sec - last_sec != PERIOD_SEC && mode == MODE_CATCH_UP) {
+        missing += (sec - last_sec) / PERIOD_SEC - 1;
+    }
+    last_sec = sec;
+    runs++;
+
+    if (runs % BUSY_EVERY == 0 && sec + 60 < run_end_sec) {
+        MXC_Delay(MXC_DELAY_MSEC(BUSY_SEC * 1000));
+    }
+}
+
+// main loop for RUN_SEC from the epoch, plus half a period to serve the last alarm
+static void run_case(case_t m)
+{
+    mode = m;
+    seed = 12345;
+    runs = 0;
+    off_grid = 0;
+    missing = 0;
+    isr_max_ns = 0;
+    epoch = now_sec() + PERIOD_SEC;
+    run_end_sec = epoch + RUN_SEC;
+
+    if (m == MODE_LEGACY) {
+        legacy_pending = 0;
+        while (MXC_RTC_DisableInt(MXC_F_RTC_CTRL_TOD_ALARM_IE) == E_BUSY) {}
+        MXC_RTC_SetTimeofdayAlarm(epoch);
+        legacy_alarm_sec = epoch;
+        while (MXC_RTC_EnableInt(MXC_F_RTC_CTRL_TOD_ALARM_IE) == E_BUSY) {}
+    } else {
+        tod_sched_init(PERIOD_SEC, (m == MODE_SKIP) ? TOD_SCHED_SKIP : TOD_SCHED_CATCH_UP,
+                       alarm_fn, NULL);
+        tod_sched_start(epoch);
+    }
+    sim_schedule(sim_now() + SIM_MS(1000 + rand_next() % (STALL_GAP_SEC * 1000)), stall_event,
+                 NULL);
+
+    while (now_sec() < run_end_sec + PERIOD_SEC / 2) {
+        if (m == MODE_LEGACY) {
+            __disable_irq();
+            while (legacy_pending > 0) {
+                uint32_t sec = legacy_fired_sec;
+
+                legacy_pending--;
+                __enable_irq();
+                alarm_fn(NULL, sec);
+                __disable_irq();
+            }
+            __enable_irq();
+        } else {
+            tod_sched_run();
+        }
+
+        // wakes at the alarm, a stall or the end of the case
+        __disable_irq();
+        if (m == MODE_LEGACY ? legacy_pending == 0 : !tod_sched_pending()) {
+            __WFI();
+        }
+        __enable_irq();
+    }
+
+    while (MXC_RTC_DisableInt(MXC_F_RTC_CTRL_TOD_ALARM_IE) == E_BUSY) {}
+}
+
+static int tod_sched_main(void)
+{
+    static const char *const names[] = { "rearm from the current second, in the ISR",
+                                         "TOD_SCHED_SKIP", "TOD_SCHED_CATCH_UP" };
+    uint32_t legacy_runs = 0, legacy_off_grid = 0;
+    uint64_t legacy_isr_ns = 0;
+
+    MXC_RTC_Init(0, 0);
+    MXC_RTC_Start();
+    MXC_NVIC_SetVector(STALL_IRQ, stall_handler);
+    NVIC_EnableIRQ(STALL_IRQ);
+    NVIC_EnableIRQ(RTC_IRQn);
+
+    for (case_t m = MODE_LEGACY; m <= MODE_CATCH_UP; m++) {
+        tod_sched_stats_t stats;
+
+        printf("%s, %d s alarm for 24 h\n", names[m], PERIOD_SEC);
+
+        run_case(m);
+        sim_cancel(stall_event, NULL);
+
+        if (m == MODE_LEGACY) {
+            legacy_runs = runs;
+            legacy_off_grid = off_grid;
+            legacy_isr_ns = isr_max_ns;
+            printf("  %u alarms instead of %u, %u off the grid, the last %u s behind; handler up to "
+                   "%u us\n",
+                   (unsigned)runs, (unsigned)ALARMS, (unsigned)off_grid,
+                   (unsigned)(last_sec - (epoch + (runs - 1) * PERIOD_SEC)),
+                   (unsigned)(isr_max_ns / 1000));
+            continue;
+        }
+
+        tod_sched_get_stats(&stats);
+        printf("  %u callbacks, %u overruns, %u skipped, latest %u ms after its second; "
+               "handler up to %u us\n",
+               (unsigned)stats.runs, (unsigned)stats.overruns, (unsigned)stats.skipped,
+               (unsigned)(stats.late_max * 1000 / RTC_TIME_TICKS_PER_SEC),
+               (unsigned)(isr_max_ns / 1000));
+        sim_check(off_grid == 0, "every callback on the grid, in order");
+        sim_check(runs > 0 && last_sec == run_end_sec, "the last one exactly 24 h after the first");
+        sim_check(stats.overruns > 0, "overruns happened (the case is provoked)");
+        if (m == MODE_SKIP) {
+            sim_check(stats.runs + stats.skipped == ALARMS,
+                      "every alarm run or counted as skipped");
+        } else {
+            sim_check(stats.runs == ALARMS && missing == 0, "every alarm run, none skipped");
+        }
+        sim_check(stats.late_max < (BUSY_SEC + 2) * RTC_TIME_TICKS_PER_SEC,
+                  "latency bounded by the longest hold-up");
+        sim_check(isr_max_ns < legacy_isr_ns && isr_max_ns < SIM_US(5),
+                  "no RTC register writes or waits in the handler");
+    }
+
+    sim_check(legacy_runs < ALARMS && legacy_off_grid > 0,
+              "the old rearm drifts under the same latency (the case is provoked)");
+
+    return 0;
+}
+
+int main(void)
+{
+    // three cases of 24 h
+    sim_init(3ULL * (RUN_SEC + 3 * PERIOD_SEC) * SIM_NS_PER_SEC);
+    sim_console_config(0, false);
+
+    return sim_test_run("TOD SCHED", tod_sched_main);
+}
@@ -0,0 +1,168 @@
+/**
+ * @file    lp_sampler.c
+ * @brief   Periodic samples batched in SRAM across STANDBY, reported in bursts
+ */
+
+/***** Includes *****/
+#include <string.h>
+
+#include "lp.h"
+#include "mxc_device.h"
+#include "mxc_errors.h"
+
+#include "console_tx.h"
+#include "conv_sched.h"
+#include "cycle_counter.h"
+#include "lp_sampler.h"
+
+/***** Globals *****/
+static mxc_uart_regs_t *lp_uart;
+
+static sample_t batch[LP_BATCH_SAMPLES];
+static uint32_t batch_head; // oldest sample
+static uint32_t batch_count;
+static uint32_t report_left; // samples of the started report still to go
+static uint32_t report_start; // DWT count at its start
+static bool flushing; // all of it printed, the console still sending
+
+static bool awake_timed; // wake_cycle is set
+static bool reported; // the current wake-up reported a batch
+static uint32_t wake_cycle; // DWT count at the last wake-up
+static lp_sampler_stats_t lp_stats;
+
+/***** Functions *****/
+static bool console_busy(void)
+{
+#ifdef CONSOLE_TX
+    if (console_tx_pending() != 0) {
+        return true;
+    }
+#endif
+    return MXC_UART_GetActive(lp_uart) == E_BUSY;
+}
+
+int lp_sampler_init(mxc_uart_regs_t *uart)
+{
+    if (uart == NULL) {
+        return E_NULL_PTR;
+    }
+
+    lp_uart = uart;
+    batch_head = 0;
+    batch_count = 0;
+    report_left = 0;
+    flushing = false;
+    awake_timed = false;
+    reported = false;
+    memset(&lp_stats, 0x00, sizeof(lp_stats));
+
+    MXC_LP_ClearWakeStatus();
+    MXC_LP_EnableRTCAlarmWakeup();
+
+    return E_NO_ERROR;
+}
+
+bool lp_sampler_add(const sample_t *sample)
+{
+    if (batch_count < LP_BATCH_SAMPLES) {
+        batch[(batch_head + batch_count) % LP_BATCH_SAMPLES] = *sample;
+        batch_count++;
+    }
+    return batch_count == LP_BATCH_SAMPLES;
+}
+
+uint32_t lp_sampler_count(void)
+{
+    return batch_count;
+}
+
+// the report is out and the console drained
+static void report_done(void)
+{
+    uint32_t cycles = cycle_counter_read() - report_start;
+
+    lp_stats.reports++;
+    lp_stats.report_cycles += cycles;
+    if (cycles > lp_stats.report_max_cycles) {
+        lp_stats.report_max_cycles = cycles;
+    }
+    reported = true;
+}
+
+void lp_sampler_report(void)
+{
+    if (report_left == 0 && !flushing) {
+        report_start = cycle_counter_read();
+    }
+    // samples added while it goes out wait for the next one
+    report_left = batch_count;
+}
+
+bool lp_sampler_reporting(void)
+{
+    return report_left != 0;
+}
+
+bool lp_sampler_report_next(void (*report)(const sample_t *sample))
+{
+    if (report_left == 0) {
+        return false;
+    }
+
+    report(&batch[batch_head]);
+    batch_head = (batch_head + 1) % LP_BATCH_SAMPLES;
+    batch_count--;
+    lp_stats.reported++;
+    if (--report_left != 0) {
+        return true;
+    }
+
+    // the UART stops in STANDBY: whatever is still queued goes out first.
+    // CONSOLE_TX sends it from the UART interrupt while the core waits in
+    // SLEEP, and lp_sampler_sleep() ends the report; the FIFO alone is only
+    // waited for
+#ifdef CONSOLE_TX
+    flushing = true;
+#else
+    while (MXC_UART_GetActive(lp_uart) == E_BUSY) {}
+    report_done();
+#endif
+
+    return true;
+}
+
+void lp_sampler_sleep(bool busy)
+{
+    uint32_t cycles = cycle_counter_read() - wake_cycle;
+
+    if (flushing && !console_busy()) {
+        flushing = false;
+        report_done();
+    }
+
+    // the wake-ups that only took a sample; a report is counted on its own
+    if (awake_timed && !reported && !flushing) {
+        lp_stats.wakes++;
+        lp_stats.wake_cycles += cycles;
+        if (cycles > lp_stats.wake_max_cycles) {
+            lp_stats.wake_max_cycles = cycles;
+        }
+    }
+    reported = false;
+
+    if (busy || console_busy()) {
+        lp_stats.sleeps++;
+        conv_sched_sleep();
+    } else {
+        lp_stats.standbys++;
+        conv_sched_standby();
+    }
+
+    wake_cycle = cycle_counter_read();
+    awake_timed = true;
+}
+
+void lp_sampler_get_stats(lp_sampler_stats_t *stats)
+{
+    *stats = lp_stats;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file    lp_sampler.h
+ * @brief   Periodic samples batched in SRAM across STANDBY, reported in bursts
+ * @details With LP_SAMPLER (project.mk) the core waits for the RTC alarms in
+ *          STANDBY instead of SLEEP: every clock but the 32 kHz crystal's
+ *          stops, the SRAM and the peripheral registers keep their contents,
+ *          and the RTC alarm wakes the core within tens of microseconds. A
+ *          wake-up starts or reads a conversion, adds the sample to the batch
+ *          and goes back to sleep; the console is only used once
+ *          LP_BATCH_SAMPLES samples are in, to report them in one burst and
+ *          drain the UART before the next STANDBY. The burst prints one
+ *          sample per pass of the main loop, like the sample ring: a fast
+ *          trigger (trending) that falls due during it still gets its sample.
+ *
+ *          The batch is an ordinary array, since STANDBY retains all of the
+ *          SRAM. BACKUP would keep only the retained banks and wake through a
+ *          reset, running the SPI and sensor setup again at every alarm.
+ *
+ *          The module counts what the mode costs: the time awake per wake-up
+ *          without a report, and per report from its start until the console
+ *          is drained, the samples taken in between included.
+ */
+
+#ifndef LP_SAMPLER_H_
+#define LP_SAMPLER_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sample_ring.h"
+#include "uart.h"
+
+/***** Definitions *****/
+// samples reported together
+#ifndef LP_BATCH_SAMPLES
+#define LP_BATCH_SAMPLES 12
+#endif
+
+typedef struct {
+    uint32_t standbys; // sleeps in STANDBY
+    uint32_t sleeps; // in SLEEP instead: the console or a transfer was busy
+    uint32_t wakes; // wake-ups without a report
+    uint64_t wake_cycles; // core cycles awake over those
+    uint32_t wake_max_cycles;
+    uint32_t reports; // batches reported
+    uint32_t reported; // samples in them
+    uint64_t report_cycles; // core cycles from the start to the drained console
+    uint32_t report_max_cycles;
+} lp_sampler_stats_t;
+
+/***** Functions *****/
+/*
+ * Empties the batch and enables the RTC alarm wake-up. uart is the console,
+ * which must be idle before STANDBY.
+ */
+int lp_sampler_init(mxc_uart_regs_t *uart);
+
+/*
+ * Adds a sample to the batch. Returns true when the batch is full and must be
+ * reported before the next one.
+ */
+bool lp_sampler_add(const sample_t *sample);
+
+uint32_t lp_sampler_count(void);
+
+/*
+ * Starts reporting the samples now in the batch. They go out one per
+ * lp_sampler_report_next() call, so that the triggers due meanwhile are served
+ * between two of them; later samples are kept for the next report.
+ */
+void lp_sampler_report(void);
+
+// a started report still has samples to go
+bool lp_sampler_reporting(void);
+
+/*
+ * Calls report() for the oldest sample of the started report and removes it
+ * from the batch; after the last one, waits until the console has sent
+ * everything. Returns false when no report is going on.
+ */
+bool lp_sampler_report_next(void (*report)(const sample_t *sample));
+
+/*
+ * Sleeps until the next interrupt: in STANDBY, or in SLEEP when busy (a
+ * transfer in flight) or the console is still sending. Call it with
+ * interrupts masked, like conv_sched_sleep().
+ */
+void lp_sampler_sleep(bool busy);
+
+void lp_sampler_get_stats(lp_sampler_stats_t *stats);
+
+#endif // LP_SAMPLER_H_
@@ -25,61 +25,174 @@
 #include "rtc.h"
 #include "led.h"
 
+#include "completion.h"
+#include "console_tx.h"
+#include "conv_sched.h"
+#include "cycle_counter.h"
+#include "debounce.h"
+#include "irq_time.h"
+#include "lp_sampler.h"
+#include "max31723.h"
+#include "prof_probes.h"
+#include "rate_ctl.h"
+#include "rtc_time.h"
+#include "rtc_trim.h"
+#include "rtc_wheel.h"
+#include "sample_ring.h"
+#include "sensor_poll.h"
+#include "temp_acq.h"
+#include "telemetry.h"
+#include "timebase.h"
+#include "tod_sched.h"
+#include "temp_q8.h"
+#include "tlog_msgs.h"
+#include "trig_sched.h"
+#include "work_queue.h"
+
 
 /***** Preprocessors *****/
-#define MASTERSYNC 0
-#define MASTERASYNC 1
-//#define MASTERDMA 0
+// the transaction method (MASTERSYNC, MASTERASYNC or MASTERDMA) is set in
+// project.mk with METHOD; max31723.h falls back to MASTERASYNC on this board
+// the conversion mode (CONV_ONESHOT or CONV_CONTINUOUS) is set in project.mk
+// with CONV_MODE; conv_sched.h falls back to CONV_ONESHOT
 
 /***** Definitions *****/
-#define DATA_LEN 2 
+// burst read of the temperature registers in one chip-select window
+// set BURST_READ_CONFIG to 1 to also capture the configuration register
+#define BURST_READ_CONFIG 0
 
-// frequency = 100 kHz
+// frequency = 100 kHz, the safe start; characterizeLink() then raises it to
+// the fastest clock the wiring carries (up to MAX31723_MAX_HZ)
 #define SPI_SPEED 100000
-#define SPI MXC_SPI4
-// for async transasction
-#define SPI_IRQ SPI4_IRQn
-#define SS_IDX 0
 
 #define FTHR_Defined 0
 
+// MAX31723s polled round-robin on SPI4 (1 - 4): the first three on slave
+// selects 0 - 2, the fourth on FANOUT_CS_PIN; set FANOUT_SENSORS in project.mk
+#ifndef FANOUT_SENSORS
+#define FANOUT_SENSORS 1
+#endif
+#if FANOUT_SENSORS >= 3
+#define FANOUT_SS_MASK 0x7
+#else
+#define FANOUT_SS_MASK ((1 << FANOUT_SENSORS) - 1)
+#endif
+// (P1.6) chip enable of the fourth sensor, any free VDDIOH pin
+#define FANOUT_CS_PORT MXC_GPIO1
+#define FANOUT_CS_PIN MXC_GPIO_PIN_6
+// rounds per sensor count in the fan-out benchmark (FANOUT_BENCH)
+#define FANOUT_BENCH_ROUNDS 50
+
 /***** Temperature Sensor *****/
 // max conversion time is 200ms
 // resolution for the temperature reading (9 - 12 bits)
 #define TEMP_RES 12 
 
+// trending mode while the alert is active: sample period and lowest resolution
+// (25 ms at 9 bits is 8x the rate 12 bits allows)
+#define TREND_PERIOD_MS 25
+#define TREND_MIN_RES 9
+
+// decimals printed for a reading, 4 is exact for 12-bit resolution
+#define TEMP_DECIMALS 4
+// samples per method in the TLM_BENCH comparison
+#define TLM_BENCH_SAMPLES 16
+// messages per method in the TLOG_BENCH comparison
+#define TLOG_BENCH_MESSAGES 8
+
+// CONSOLE_TX: what a full console ring does; BLOCK loses no text
+#ifndef CONSOLE_TX_POLICY
+#define CONSOLE_TX_POLICY CONSOLE_TX_BLOCK
+#endif
+// alert when the temperature reaches TEMP_ALERT_HIGH_C, clear at TEMP_ALERT_LOW_C
+#define TEMP_ALERT_HIGH_C 30
+#define TEMP_ALERT_LOW_C 28
+// number of RTC samples averaged together (one minute at 5 s per sample)
+#define TEMP_AVG_SAMPLES 12
+
+// what the sample store loses when the printing falls behind:
+// SAMPLE_RING_DROP_NEWEST or SAMPLE_RING_OVERWRITE_OLDEST
+#define SAMPLE_STORE_POLICY SAMPLE_RING_DROP_NEWEST
+
 // (P1.27, SW2)
 #define IN_INTERRUPT_PORT MXC_GPIO1
 #define IN_INTERRUPT_PIN MXC_GPIO_PIN_27
+// SW2 must hold a level this long to count; the timer confirms it
+#define SW2_DEBOUNCE_MS 20
+#define DEBOUNCE_TMR MXC_TMR0
+// microsecond timestamps, kept on the RTC at each time-of-day alarm
+#define TIMEBASE_TMR MXC_TMR1
+// RTC_TRIM_CAL: the RTC is measured against TMR2 on RTC_TRIM_CLK (RTC_TRIM_REF_HZ,
+// 0 for the clock's nominal frequency) over RTC_TRIM_WINDOW_SEC, trimmed, and
+// measured again; RTC_TRIM writes a trim found earlier
+#define RTC_TRIM_TMR MXC_TMR2
+// deadlines of the timed waits (completion.h): a DMA acquisition that has not
+// finished after ACQ_IDLE_TIMEOUT_MS is given up on
+#define COMPLETION_TMR MXC_TMR3
+#define ACQ_IDLE_TIMEOUT_MS 100
+#ifndef RTC_TRIM_CLK
+#define RTC_TRIM_CLK MXC_TMR_APB_CLK
+#endif
+#ifndef RTC_TRIM_REF_HZ
+#define RTC_TRIM_REF_HZ 0
+#endif
+#ifndef RTC_TRIM_WINDOW_SEC
+#define RTC_TRIM_WINDOW_SEC 10
+#endif
+// LP_SAMPLER: STANDBY between the RTC alarms, samples reported in batches of
+// LP_BATCH_SAMPLES (lp_sampler.h). STANDBY stops the TMR clocks, so there is
+// no SW2 (debounce timer), no timebase and no trim calibration
+// trending brings no averages, and so no statistics: LP_SAMPLER prints them
+// with every LP_STATS_BATCHES-th batch instead
+#define LP_STATS_BATCHES 10
+#if defined(LP_SAMPLER) && defined(RTC_TRIM_CAL)
+#error "RTC_TRIM_CAL needs TMR2 running: calibrate without LP_SAMPLER and pass RTC_TRIM"
+#endif
+// an SW2 press this soon after the last SW2 sample reuses it (double press);
+// an on-demand read is late after SW2_DEADLINE_MS
+#define SW2_COALESCE_MS 250
+#define SW2_DEADLINE_MS 50
 // (P2.1, LED1)
 #define OUT_INTERRUPT_PORT MXC_GPIO2
 #define OUT_INTERRUPT_PIN MXC_GPIO_PIN_1
 
-// define SPI GPIO pins for setting the VDDIO
-#define MXC_GPIO_PORT MXC_GPIO1
-#define MXC_GPIO_PIN_SS MXC_GPIO_PIN_0
-#define MXC_GPIO_PIN_MOSI MXC_GPIO_PIN_1
-#define MXC_GPIO_PIN_MISO MXC_GPIO_PIN_2
-#define MXC_GPIO_PIN_SCLK MXC_GPIO_PIN_3
+/***** Globals *****/
+max31723_t sensor; // MAX31723 on SPI4, slave select 0
+#if FANOUT_SENSORS > 1
+max31723_t fanout_sensors[FANOUT_SENSORS - 1]; // the other polled sensors
+#endif
+max31723_t *poll_table[FANOUT_SENSORS]; // sensors in polling order
+work_queue_t work_queue; // work posted by the interrupt handlers, run by main()
+volatile bool trending = false; // periodic samples come from trend_timer
+rtc_timer_t trend_timer; // trending samples, on the RTC wheel
+#ifdef RTC_TRIM_CAL
+rtc_timer_t trim_timer; // end of the calibration window
+bool trim_checked; // the trim is applied, the window measures the result
+#endif
 
-// define SPI IO pins
-mxc_gpio_cfg_t gpio_spi_pins;
+temp_avg_t temp_avg; // running average of the RTC samples
+temp_threshold_t temp_alert; // high temperature alert with hysteresis
 
-/***** Globals *****/
-uint8_t rx_data[DATA_LEN];
-uint8_t tx_data[DATA_LEN];
-volatile int SPI_FLAG;
-volatile int ISR_SPI_FLAG = 0; // allow SW2 ISR to start an SPI transaction in main()
-volatile int RTC_SPI_FLAG = 0; // allow the RTC to start an SPI transaction in main()
-volatile uint8_t DMA_FLAG = 0;
-mxc_spi_req_t req; // SPI transaction request
+sample_ring_t sample_store; // samples waiting to be printed
+#ifdef LP_SAMPLER
+uint32_t trend_batches; // batches reported while trending
+#endif
 
-uint8_t temp_MSB; // most significant byte of temperature reading
-uint8_t temp_LSB; // least significant byte of temperature reading
+#ifdef IRQ_TIME_STATS
+irq_time_t gpio_irq_time;
+irq_time_t rtc_irq_time;
+#endif
+
+#ifdef BOOT_STATS
+uint32_t boot_start; // DWT cycles at main()
+uint32_t boot_rtc_cycles; // main() to the RTC start
+bool boot_reported;
+#endif
 
 // GPIO pins for interrupt
 mxc_gpio_cfg_t gpio_interrupt;
 mxc_gpio_cfg_t gpio_interrupt_status;
+debounce_pin_t sw2_debounce;
 
 
 
@@ -89,6 +202,8 @@ mxc_gpio_cfg_t gpio_interrupt_status;
 #define LED_TODA 1
 
 #define TIME_OF_DAY_SEC 5
+// alarms missed while main() was held up are skipped, not sampled late
+#define TIME_OF_DAY_POLICY TOD_SCHED_SKIP
 
 #define MSEC_TO_RSSA(x) \
     (0 - ((x * 4096) /  \
@@ -99,100 +214,938 @@ mxc_gpio_cfg_t gpio_interrupt_status;
 #define SECS_PER_DAY (24 * SECS_PER_HR)
 
 /***** Functions *****/
-void SPI_IRQHandler(void)
+/*
+ * Release time of a trigger raised now, in RTC ticks, from the timebase: no
+ * RTC register read, so no retries in the handler.
+ */
+uint32_t triggerStamp(void)
 {
-    MXC_SPI_AsyncHandler(SPI);
+    return timebase_rtc_ticks(timebase_us());
 }
 
-void SPI_Callback(mxc_spi_req_t *req, int error)
+/*
+ * Work items: arg holds the release time (RTC ticks) of a trigger, which the
+ * trigger scheduler merges or queues for the dispatcher.
+ */
+void sw2TriggerWork(void *arg)
 {
-    SPI_FLAG = error;
+    trig_sched_release(TRIGGER_SW2, (uint32_t)(uintptr_t)arg);
 }
 
+/*
+ * Time-of-day alarm, from tod_sched_run(): the sample is released at the
+ * alarm's nominal second. In one-shot mode the next conversion is started
+ * ahead of the next alarm; while trending the alarm is only tracked. The
+ * timebase follows the RTC from this wake-up too (a missed edge is made up
+ * for on the next alarm).
+ */
+void todAlarm(void *arg, uint32_t sec)
+{
+    (void)arg;
+    PROF_BEGIN(PROF_TOD_ALARM);
 
-void gpio_callback(void *cbdata)
+    if (!trending) {
+        trig_sched_release(TRIGGER_RTC, sec * TRIG_SCHED_TICKS_PER_SEC);
+    }
+    conv_sched_arm(sec + TIME_OF_DAY_SEC);
+#ifndef LP_SAMPLER
+    timebase_discipline();
+#endif
+    PROF_END(PROF_TOD_ALARM);
+}
+
+/*
+ * Trending timer, from rtc_wheel_run(): the sample is released at the
+ * timer's nominal expiry, however late this runs.
+ */
+void trendExpired(void *arg, uint32_t ticks)
+{
+    (void)arg;
+    trig_sched_release(TRIGGER_RTC, ticks);
+}
+
+#ifdef RTC_TRIM_CAL
+/*
+ * Measurement over RTC_TRIM_WINDOW_SEC from the next RTC edge, closed by
+ * trim_timer.
+ */
+void startTrimWindow(void)
+{
+    while (rtc_trim_start(RTC_TRIM_WINDOW_SEC) == E_BUSY) {}
+    rtc_wheel_start(&trim_timer, RTC_TRIM_WINDOW_SEC * RTC_WHEEL_TICKS_PER_SEC, 0);
+}
+
+/*
+ * Calibration window closed, from rtc_wheel_run(): the first one trims the
+ * RTC, the second one measures what is left.
+ */
+void trimExpired(void *arg, uint32_t ticks)
+{
+    rtc_trim_stats_t stats;
+    int32_t ppb;
+    uint32_t abs_ppb;
+    int retVal;
+
+    (void)arg;
+    (void)ticks;
+
+    while ((retVal = rtc_trim_finish(&ppb)) == E_BUSY) {}
+    if (retVal != E_NO_ERROR) {
+        printf("\nRTC Trim ERROR: %d\n", retVal);
+        return;
+    }
+
+    rtc_trim_get_stats(&stats);
+    abs_ppb = (ppb < 0) ? -ppb : ppb;
+    printf("\nRTC %c%u.%03u ppm (+/- %u ppb) over %u s with trim %d\n", (ppb < 0) ? '-' : '+',
+           (unsigned)(abs_ppb / 1000), (unsigned)(abs_ppb % 1000), (unsigned)stats.uncertainty_ppb,
+           (unsigned)RTC_TRIM_WINDOW_SEC, (int)stats.trim);
+    if (trim_checked) {
+        return;
+    }
+
+    retVal = rtc_trim_apply(ppb);
+    rtc_trim_get_stats(&stats);
+    printf("RTC trim set to %d%s\n", (int)stats.trim,
+           (retVal == E_OVERFLOW) ? " (end of range)" : "");
+    trim_checked = true;
+    startTrimWindow();
+}
+#endif
+
+/*
+ * Debounced SW2 level, from the debounce timer's handler: a press (low)
+ * toggles LED1 and triggers a sample.
+ */
+void sw2Changed(void *arg, bool level)
 {
-    // disable push button interrupt
-    NVIC_DisableIRQ(MXC_GPIO_GET_IRQ(MXC_GPIO_GET_IDX(IN_INTERRUPT_PORT)));
+    mxc_gpio_cfg_t *cfg = arg;
+
+    if (level) {
+        return; // released
+    }
 
-    mxc_gpio_cfg_t *cfg = cbdata;
+    PROF_BEGIN(PROF_SW2);
     MXC_GPIO_OutToggle(cfg->port, cfg->mask);
 
-    ISR_SPI_FLAG = 1;
+    // a full queue drops the trigger and counts it
+    work_post(&work_queue, sw2TriggerWork, (void *)(uintptr_t)triggerStamp());
+    PROF_END(PROF_SW2);
+}
+
+// any SW2 edge, bounces included: (re)start its settle window
+void gpio_callback(void *cbdata)
+{
+    debounce_edge(cbdata);
 }
 
 // To copy NVIC to RAM: NVIC_SetRAM() in "nvic_table.h"
 void gpio_isr(void)
 {
-    MXC_Delay(MXC_DELAY_MSEC(100)); // Debounce
+#ifdef IRQ_TIME_STATS
+    uint32_t start = irq_time_enter();
+#endif
+
     MXC_GPIO_Handler(MXC_GPIO_GET_IDX(IN_INTERRUPT_PORT));
+
+#ifdef IRQ_TIME_STATS
+    irq_time_exit(&gpio_irq_time, start);
+#endif
 }
 
 
 /***** Functions *****/
 void RTC_IRQHandler(void)
 {
-    uint32_t time;
     int flags = MXC_RTC_GetFlags();
+#ifdef IRQ_TIME_STATS
+    uint32_t start = irq_time_enter();
+#endif
+    PROF_BEGIN(PROF_RTC_IRQ);
 
+    /* Check sub-second alarm flag: RTC wheel timers (trending, one-shot conversion) due. */
+    if (flags & MXC_F_RTC_CTRL_SSEC_ALARM) {
+        MXC_RTC_ClearFlags(MXC_F_RTC_CTRL_SSEC_ALARM);
+        rtc_wheel_alarm();
+    }
 
     /* Check time-of-day alarm flag. */
     if (flags & MXC_F_RTC_CTRL_TOD_ALARM) {
         MXC_RTC_ClearFlags(MXC_F_RTC_CTRL_TOD_ALARM);
         LED_Toggle(LED_TODA);
-        RTC_SPI_FLAG = 1;
+        // main() rearms it on the TIME_OF_DAY_SEC grid, however late this
+        // handler runs; no RTC register writes here
+        tod_sched_alarm();
+    }
+
+    PROF_END(PROF_RTC_IRQ);
+#ifdef IRQ_TIME_STATS
+    irq_time_exit(&rtc_irq_time, start);
+#endif
+    return;
+}
+
+/*
+ * Splits an RTC time into the fields of TLOG_TIME_FMT: day, hour, minute and
+ * the RTC ticks within the minute (seconds and sub-seconds, for %t).
+ */
+void timeFields(uint32_t sec, uint32_t subsec_ticks, uint32_t fields[4])
+{
+    fields[0] = sec / SECS_PER_DAY;
+    sec -= fields[0] * SECS_PER_DAY;
+
+    fields[1] = sec / SECS_PER_HR;
+    sec -= fields[1] * SECS_PER_HR;
+
+    fields[2] = sec / SECS_PER_MIN;
+    sec -= fields[2] * SECS_PER_MIN;
+
+    fields[3] = sec * 4096 + subsec_ticks;
+}
+
+void printTimeOf(uint32_t sec, uint32_t subsec_ticks)
+{
+    uint32_t t[4];
+
+    timeFields(sec, subsec_ticks, t);
+    TLOG(TLOG_TIME, t[0], t[1], t[2], t[3]);
+}
 
-        // wait if RTC is busy
-        while (MXC_RTC_DisableInt(MXC_F_RTC_CTRL_TOD_ALARM_IE) == E_BUSY) {}
+void printTime(void)
+{
+    rtc_time_t now;
+
+    if (rtc_time_get(&now) != E_NO_ERROR) {
+        printf("\nCurrent Time: RTC busy\n");
+        return;
+    }
+
+    printTimeOf(now.sec, now.subsec);
+}
+
+void printSchedStats(void)
+{
+    conv_sched_stats_t stats;
+#ifndef LP_SAMPLER
+    timebase_stats_t timebase;
+#endif
+    uint32_t avg_ms = 0;
+
+    conv_sched_get_stats(&stats);
+    if (stats.samples != 0) {
+        avg_ms = (uint32_t)(stats.latency_total * 1000 /
+                            ((uint64_t)stats.samples * CONV_SCHED_TICKS_PER_SEC));
+    }
+
+#ifdef CONV_ONESHOT
+    printf("Conversions (one-shot): %u started, %u late, %u waited for\n",
+           (unsigned)stats.conversions, (unsigned)stats.late, (unsigned)stats.held);
+#else
+    printf("Conversions (continuous)\n");
+#endif
+    if (stats.samples != 0) {
+        printf("Trigger to sample: min %u ms, avg %u ms, max %u ms over %u samples\n",
+               (unsigned)(stats.latency_min * 1000 / CONV_SCHED_TICKS_PER_SEC), (unsigned)avg_ms,
+               (unsigned)(stats.latency_max * 1000 / CONV_SCHED_TICKS_PER_SEC),
+               (unsigned)stats.samples);
+    }
+    printf("Active time: core %u.%02u%%, sensor %u.%02u%%\n",
+           (unsigned)(stats.awake_pct_x100 / 100), (unsigned)(stats.awake_pct_x100 % 100),
+           (unsigned)(stats.sensor_pct_x100 / 100), (unsigned)(stats.sensor_pct_x100 % 100));
+
+#ifndef LP_SAMPLER
+    timebase_get_stats(&timebase);
+    printf("Timebase: %d us off the RTC (max %u us), RTC rate %+d ppb, %u edges missed\n",
+           (int)timebase.offset_us, (unsigned)timebase.offset_max_us, (int)timebase.rate_ppb,
+           (unsigned)timebase.missed);
+#endif
+}
 
-        /* Set a new alarm TIME_OF_DAY_SEC seconds from current time. */
-        /* Don't need to check busy here as it was checked in MXC_RTC_DisableInt() */
-        MXC_RTC_GetSeconds(&time);
+#ifdef LP_SAMPLER
+/*
+ * What STANDBY costs: time awake per wake-up that only took a sample, and per
+ * batch report until the console was drained.
+ */
+void printLowPowerStats(void)
+{
+    lp_sampler_stats_t stats;
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    uint32_t wake_us = 0, report_us = 0;
 
-        if (MXC_RTC_SetTimeofdayAlarm(time + TIME_OF_DAY_SEC) != E_NO_ERROR) {
-            /* Handle Error */
+    lp_sampler_get_stats(&stats);
+    if (stats.wakes != 0) {
+        wake_us = (uint32_t)(stats.wake_cycles / stats.wakes / cycles_per_us);
+    }
+    if (stats.reports != 0) {
+        report_us = (uint32_t)(stats.report_cycles / stats.reports / cycles_per_us);
+    }
+
+    printf("Low power: %u STANDBY, %u SLEEP; awake %u us per wake-up (max %u us), "
+           "%u reports of %u samples, %u.%03u ms each (max %u.%03u ms)\n",
+           (unsigned)stats.standbys, (unsigned)stats.sleeps, (unsigned)wake_us,
+           (unsigned)(stats.wake_max_cycles / cycles_per_us), (unsigned)stats.reports,
+           (unsigned)stats.reported, (unsigned)(report_us / 1000), (unsigned)(report_us % 1000),
+           (unsigned)(stats.report_max_cycles / cycles_per_us / 1000),
+           (unsigned)(stats.report_max_cycles / cycles_per_us % 1000));
+}
+#endif
+
+#ifdef IRQ_TIME_STATS
+void printIrqTime(void)
+{
+    work_queue_stats_t stats;
+
+    irq_time_print("GPIO", &gpio_irq_time);
+    irq_time_print("Debounce TMR", &debounce_irq_time);
+    irq_time_print("RTC", &rtc_irq_time);
+#if !defined(MASTERSYNC)
+    irq_time_print("SPI/DMA", &max31723_irq_time);
+#endif
+    work_queue_get_stats(&work_queue, &stats);
+    printf("Work queue: %u posted, %u run, high water %u/%d, %u dropped\n",
+           (unsigned)stats.posted, (unsigned)stats.run, (unsigned)stats.high_water,
+           WORK_QUEUE_SIZE, (unsigned)stats.dropped);
+}
+#endif
+
+void printStoreStats(void)
+{
+    sample_ring_stats_t stats;
+
+    sample_ring_get_stats(&sample_store, &stats);
+    printf("Sample store: %u samples, high water %u/%d, %u dropped, %u overwritten\n",
+           (unsigned)stats.pushed, (unsigned)stats.high_water, SAMPLE_RING_SIZE,
+           (unsigned)stats.dropped, (unsigned)stats.overwritten);
+}
+
+void printDebounceStats(void)
+{
+    const debounce_stats_t *stats = &sw2_debounce.stats;
+
+    printf("SW2: %u edges, %u level changes, %u glitches, longest bounce %u us\n",
+           (unsigned)stats->edges, (unsigned)stats->changes, (unsigned)stats->glitches,
+           (unsigned)stats->longest_us);
+}
+
+void printTriggerStats(void)
+{
+    static const struct {
+        uint8_t source;
+        const char *name;
+    } sources[] = { { TRIGGER_SW2, "SW2" }, { TRIGGER_RTC, "RTC" } };
+    trig_stats_t stats;
+
+    for (unsigned i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        trig_sched_get_stats(sources[i].source, &stats);
+        printf("%s triggers: %u released, %u coalesced, %u samples, %u missed, max latency %u us\n",
+               sources[i].name, (unsigned)stats.released, (unsigned)stats.coalesced,
+               (unsigned)stats.samples, (unsigned)stats.missed,
+               (unsigned)((uint64_t)stats.latency_max * 1000000 / TRIG_SCHED_TICKS_PER_SEC));
+    }
+}
+
+void printRate(tlog_id_t id)
+{
+    rate_ctl_t rate;
+    uint32_t mhz = rate_ctl_rate_mhz();
+
+    rate_ctl_get(&rate);
+    TLOG(id, rate.bits, rate.effective_period_ms, mhz / 1000, mhz % 1000, rate.changes);
+}
+
+/*
+ * Prepares the polled sensors: sensor (already configured) first, then the
+ * others in continuous TEMP_RES-bit conversions.
+ */
+int setupFanout(void)
+{
+    int retVal;
+
+    poll_table[0] = &sensor;
+#if FANOUT_SENSORS > 1
+    for (int i = 1; i < FANOUT_SENSORS; i++) {
+        max31723_t *dev = &fanout_sensors[i - 1];
+
+        if (i < MAX31723_SS_COUNT) {
+            max31723_init_ss(dev, i);
+        } else {
+            max31723_init_gpio_cs(dev, FANOUT_CS_PORT, FANOUT_CS_PIN);
         }
 
-        while (MXC_RTC_EnableInt(MXC_F_RTC_CTRL_TOD_ALARM_IE) == E_BUSY) {}
+        retVal = max31723_write_config(dev, MAX31723_CFG_RES(TEMP_RES));
+        if (retVal != E_NO_ERROR) {
+            return retVal;
+        }
+        poll_table[i] = dev;
     }
+#endif
 
-    return;
+    retVal = poll_init(poll_table, FANOUT_SENSORS);
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+    printf("\nPolling %d sensor(s) round-robin\n", FANOUT_SENSORS);
+    return E_NO_ERROR;
 }
 
-void printTime(void)
+#if FANOUT_SENSORS > 1
+/*
+ * Reads every polled sensor in one round and prints the results.
+ */
+void printFanout(void)
+{
+    int retVal;
+    temp_q8_t temp;
+
+#ifdef MASTERDMA
+    // the round shares the DMA channels with the acquisition engine
+    retVal = acq_wait_idle(ACQ_IDLE_TIMEOUT_MS * 1000);
+    if (retVal != E_NO_ERROR) {
+        printf("\nSPI DMA TIMEOUT: %d\n", retVal);
+        return;
+    }
+#endif
+
+    retVal = poll_read(FANOUT_SENSORS);
+    if (retVal != E_NO_ERROR) {
+        printf("\nSPI POLL ERROR: %d\n", retVal);
+    }
+
+    for (int i = 0; i < FANOUT_SENSORS; i++) {
+        if (poll_get(i, &temp) == E_NO_ERROR) {
+            TLOG(TLOG_SENSOR_TEMP, i, temp);
+        } else {
+            printf("Sensor %d: read error\n", i);
+        }
+    }
+}
+#endif
+
+/*
+ * Switches the periodic samples between the RTC time-of-day alarm (every
+ * TIME_OF_DAY_SEC at TEMP_RES) and trending mode (every TREND_PERIOD_MS from
+ * an RTC wheel timer, at the resolution rate_ctl picks for that period).
+ */
+void setTrending(bool on)
+{
+    int retVal;
+    rate_ctl_t rate;
+
+#ifdef MASTERDMA
+    // the driver's blocking calls must not overlap a DMA acquisition
+    retVal = acq_wait_idle(ACQ_IDLE_TIMEOUT_MS * 1000);
+    if (retVal != E_NO_ERROR) {
+        printf("\nSPI DMA TIMEOUT: %d\n", retVal);
+        return;
+    }
+#endif
+
+    if (on) {
+        retVal = conv_sched_pause();
+        if (retVal == E_NO_ERROR) {
+            retVal = rate_ctl_request(TREND_PERIOD_MS, TREND_MIN_RES);
+        }
+        if (retVal != E_NO_ERROR) {
+            printf("\nTRENDING MODE ERROR: %d\n", retVal);
+            return;
+        }
+
+        rate_ctl_get(&rate);
+        trending = true;
+        trig_sched_config(TRIGGER_RTC, 0, 0, rate.effective_period_ms);
+        // rounded up to whole RTC ticks, on a grid from now
+        rtc_wheel_start(&trend_timer, RTC_WHEEL_MS_TO_TICKS(rate.effective_period_ms),
+                        RTC_WHEEL_MS_TO_TICKS(rate.effective_period_ms));
+        printRate(TLOG_RATE_TRENDING);
+    } else {
+        rtc_wheel_stop(&trend_timer);
+        trending = false;
+        trig_sched_config(TRIGGER_RTC, 0, 0, TIME_OF_DAY_SEC * 1000);
+
+        retVal = rate_ctl_request(TIME_OF_DAY_SEC * 1000, TEMP_RES);
+        if (retVal == E_NO_ERROR) {
+            retVal = conv_sched_resume();
+        }
+        if (retVal != E_NO_ERROR) {
+            printf("\nNORMAL MODE ERROR: %d\n", retVal);
+            return;
+        }
+        printRate(TLOG_RATE_NORMAL);
+    }
+}
+
+/*
+ * Text report of one sample: trigger source, time it was taken, temperature.
+ */
+void printSample(const sample_t *sample)
 {
-    int day, hr, min, err;
-    uint32_t sec, rtc_readout;
-    double subsec;
+    tlog_id_t id;
+    uint32_t t[4];
+
+    // the source that asked for the sample, then any that shared it
+    if (trig_sched_primary(sample->trigger_source) == TRIGGER_SW2) {
+        id = (sample->trigger_source & TRIGGER_RTC) ? TLOG_SAMPLE_SW2_RTC : TLOG_SAMPLE_SW2;
+    } else {
+        id = (sample->trigger_source & TRIGGER_SW2) ? TLOG_SAMPLE_RTC_SW2 : TLOG_SAMPLE_RTC;
+    }
 
-    do {
-        err = MXC_RTC_GetSubSeconds(&rtc_readout);
-    } while (err != E_NO_ERROR);
-    subsec = rtc_readout / 4096.0;
+    timeFields(sample->rtc_seconds, sample->subseconds, t);
+    TLOG(id, t[0], t[1], t[2], t[3], (temp_q8_t)sample->raw_temp);
+}
+
+/*
+ * Binary reports (TELEMETRY), decoded on the host by host/tlm_decode.
+ */
+void sendSample(const sample_t *sample)
+{
+    uint8_t payload[TLM_SAMPLE_LEN];
+    tlm_sample_t rec;
+
+    rec.rtc_seconds = sample->rtc_seconds;
+    rec.subseconds = sample->subseconds;
+    rec.temp_q8 = (int16_t)sample->raw_temp;
+    rec.trigger_source = sample->trigger_source;
+    tlm_sample_encode(payload, &rec);
+    telemetry_send(TLM_REC_SAMPLE, payload, sizeof(payload));
+}
+
+void sendAverage(uint32_t sec, temp_q8_t temp, uint16_t count)
+{
+    uint8_t payload[TLM_AVERAGE_LEN];
+    tlm_average_t rec;
+
+    rec.rtc_seconds = sec;
+    rec.temp_q8 = temp;
+    rec.count = count;
+    tlm_average_encode(payload, &rec);
+    telemetry_send(TLM_REC_AVERAGE, payload, sizeof(payload));
+}
+
+void sendAlert(uint32_t sec, temp_q8_t temp, bool high)
+{
+    uint8_t payload[TLM_ALERT_LEN];
+    tlm_alert_t rec;
+
+    rec.rtc_seconds = sec;
+    rec.temp_q8 = temp;
+    rec.high = high;
+    tlm_alert_encode(payload, &rec);
+    telemetry_send(TLM_REC_ALERT, payload, sizeof(payload));
+}
 
-    do {
-        err = MXC_RTC_GetSeconds(&rtc_readout);
-    } while (err != E_NO_ERROR);
-    sec = rtc_readout;
+#ifdef BOOT_STATS
+/*
+ * Time from main() to the RTC start and to the first sample, which the
+ * bring-up dumps (TLOG_LEVEL_DEBUG) delay.
+ */
+void printBootStats(void)
+{
+    uint32_t cycles_per_ms = SystemCoreClock / 1000;
 
-    day = sec / SECS_PER_DAY;
-    sec -= day * SECS_PER_DAY;
+    printf("Boot: RTC started after %u ms, first sample after %u ms\n",
+           (unsigned)(boot_rtc_cycles / cycles_per_ms),
+           (unsigned)((cycle_counter_read() - boot_start) / cycles_per_ms));
+}
+#endif
 
-    hr = sec / SECS_PER_HR;
-    sec -= hr * SECS_PER_HR;
+#ifdef CONSOLE_TX
+void printConsoleStats(void)
+{
+    console_tx_stats_t stats;
 
-    min = sec / SECS_PER_MIN;
-    sec -= min * SECS_PER_MIN;
+    console_tx_get_stats(&stats);
+    printf("Console TX: %u bytes, high water %u/%d, %u writes blocked, %u dropped, "
+           "%u overwritten\n",
+           (unsigned)stats.written, (unsigned)stats.high_water, CONSOLE_TX_SIZE,
+           (unsigned)stats.blocked, (unsigned)stats.dropped, (unsigned)stats.overwritten);
+}
+#endif
 
-    subsec += sec;
+#ifdef TELEMETRY
+void printTelemetryStats(void)
+{
+    telemetry_stats_t stats;
 
-    printf("\nCurrent Time (dd:hh:mm:ss): %02d:%02d:%02d:%05.2f\n", day, hr, min, subsec);
+    telemetry_get_stats(&stats);
+    printf("Telemetry: %u records, %u bytes\n", (unsigned)stats.records, (unsigned)stats.bytes);
 }
+#endif
+
+/*
+ * Reports one stored sample and the average and alert state it feeds into,
+ * as text or, with TELEMETRY, as binary records.
+ */
+void processSample(const sample_t *sample)
+{
+    temp_q8_t temp = (temp_q8_t)sample->raw_temp;
+    PROF_BEGIN(PROF_REPORT);
+
+#ifdef TELEMETRY
+    sendSample(sample);
+#else
+    printSample(sample);
+#endif
+#ifdef BOOT_STATS
+    if (!boot_reported) {
+        boot_reported = true;
+        printBootStats();
+    }
+#endif
+
+    // only the periodic samples go into the average, trending ones are only printed
+    if ((sample->trigger_source & TRIGGER_RTC) && !trending) {
+#ifndef LP_SAMPLER
+        conv_sched_sample(sample); // LP_SAMPLER: when it is batched
+#endif
+        temp_avg_add(&temp_avg, temp);
+        if (temp_avg.count == TEMP_AVG_SAMPLES) {
+#ifdef TELEMETRY
+            sendAverage(sample->rtc_seconds, temp_avg_get(&temp_avg), temp_avg.count);
+#else
+            TLOG(TLOG_AVERAGE_TEMP, temp_avg_get(&temp_avg));
+#endif
+            temp_avg_reset(&temp_avg);
+            printStoreStats();
+#ifdef TELEMETRY
+            printTelemetryStats();
+#endif
+#ifdef CONSOLE_TX
+            printConsoleStats();
+#endif
+#ifdef LP_SAMPLER
+            printLowPowerStats();
+#else
+            printDebounceStats();
+#endif
+            printSchedStats();
+            printTriggerStats();
+#ifdef IRQ_TIME_STATS
+            printIrqTime();
+#endif
+#if FANOUT_SENSORS > 1
+            printFanout();
+#endif
+#ifdef PROF
+            prof_print(prof_table, PROF_COUNT);
+#endif
+        }
+    }
+
+    switch (temp_threshold_update(&temp_alert, temp)) {
+    case TEMP_THRESHOLD_HIGH:
+#ifdef TELEMETRY
+        sendAlert(sample->rtc_seconds, temp, true);
+#else
+        printf("ALERT: temperature reached %d C\n", TEMP_ALERT_HIGH_C);
+#endif
+        setTrending(true);
+        break;
+    case TEMP_THRESHOLD_CLEAR:
+#ifdef TELEMETRY
+        sendAlert(sample->rtc_seconds, temp, false);
+#else
+        printf("ALERT CLEARED: temperature back to %d C\n", TEMP_ALERT_LOW_C);
+#endif
+        setTrending(false);
+        break;
+    default:
+        break;
+    }
+
+    PROF_END(PROF_REPORT);
+}
+
+#ifdef LP_SAMPLER
+/*
+ * Keeps a sample in the batch until the batch is full. A sample that raises
+ * or clears the alert starts the report at once, with the batch before it;
+ * the trending samples are batched like the others. The main loop prints the
+ * report one sample per pass.
+ */
+void batchSample(const sample_t *sample)
+{
+    temp_q8_t temp = (temp_q8_t)sample->raw_temp;
+    bool alert = temp_alert.tripped ? (temp <= temp_alert.low) : (temp >= temp_alert.high);
+
+    if ((sample->trigger_source & TRIGGER_RTC) && !trending) {
+        conv_sched_sample(sample); // the latency of the trigger it belongs to
+    }
+
+    if (lp_sampler_add(sample) || alert) {
+        // drained with the batch
+        if (trending && ++trend_batches % LP_STATS_BATCHES == 0) {
+            printLowPowerStats();
+        }
+        lp_sampler_report();
+    }
+}
+#endif
+
+/*
+ * Takes one sample for source and appends it to the sample store.
+ * Nothing is printed here, so acquisition never waits behind the UART.
+ */
+void acquireSample(uint8_t source)
+{
+    int retVal;
+    PROF_BEGIN(PROF_ACQUIRE);
+
+#ifdef MASTERDMA
+    // the transfer runs on DMA; the completion IRQ appends the sample
+    retVal = acq_start(source);
+    if (retVal != E_NO_ERROR) {
+        printf("\nSPI DMA START ERROR: %d\n", retVal);
+    }
+#else
+    sample_t sample;
+    temp_q8_t temp;
+
+    // read temp LSB and MSB registers in one burst
+#if BURST_READ_CONFIG
+    retVal = max31723_read_temp_config(&sensor, &temp, NULL);
+#else
+    retVal = max31723_read_temp(&sensor, &temp);
+#endif
+    if (retVal != E_NO_ERROR) {
+        printf("\nSPI BURST READ ERROR: %d\n", retVal);
+    } else {
+        sample.raw_temp = (uint16_t)temp;
+        sample.trigger_source = source;
+        sample_mark(&sample);
+        sample_ring_push(&sample_store, &sample);
+    }
+#endif
+
+    PROF_END(PROF_ACQUIRE);
+}
+
+#ifdef TLM_BENCH
+/*
+ * Compares the samples/s the console sustains with the text report of a
+ * sample and with its binary record (DWT cycle counter; both block on the
+ * UART, so the time includes the transmission).
+ */
+void benchTelemetry(void)
+{
+    sample_t sample = { 5, 1, 0x1790, TRIGGER_RTC };
+    telemetry_stats_t before, after;
+    uint32_t start, cycles_text, cycles_tlm;
+
+    cycle_counter_enable();
+
+    start = cycle_counter_read();
+    for (int i = 0; i < TLM_BENCH_SAMPLES; i++) {
+        printSample(&sample);
+    }
+    cycles_text = (cycle_counter_read() - start) / TLM_BENCH_SAMPLES;
+
+    telemetry_get_stats(&before);
+    start = cycle_counter_read();
+    for (int i = 0; i < TLM_BENCH_SAMPLES; i++) {
+        sendSample(&sample);
+    }
+    cycles_tlm = (cycle_counter_read() - start) / TLM_BENCH_SAMPLES;
+    telemetry_get_stats(&after);
+
+    printf("\nSample report, cycles per sample: text %u (%u samples/s), "
+           "telemetry %u (%u samples/s, %u bytes)\n",
+           (unsigned)cycles_text, (unsigned)(SystemCoreClock / cycles_text), (unsigned)cycles_tlm,
+           (unsigned)(SystemCoreClock / cycles_tlm),
+           (unsigned)((after.bytes - before.bytes) / TLM_BENCH_SAMPLES));
+}
+#endif
+
+#ifdef TLOG_BENCH
+/*
+ * Compares formatting a message on the target with sending its token, in
+ * cycles per message (DWT cycle counter; both block on the UART, so the time
+ * includes the transmission) and in bytes on the wire.
+ */
+void benchLog(void)
+{
+    static const struct {
+        const char *name;
+        tlog_id_t id;
+        uint32_t args[5];
+        size_t nargs;
+    } cases[] = {
+        { "time", TLOG_TIME, { 0, 0, 1, 5 * 4096 + 512 }, 4 },
+        { "sample", TLOG_SAMPLE_RTC, { 0, 0, 1, 5 * 4096 + 512, 0x1790 }, 5 },
+        { "config", TLOG_CONFIG_READ, { 0x06 }, 1 },
+    };
+    telemetry_stats_t before, after;
+    uint32_t start, cycles_text, cycles_tlog, bytes_text;
+
+    cycle_counter_enable();
+
+    printf("\nLog message, cycles and bytes per message: formatted vs. tokenized\n");
+    for (unsigned c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const char *fmt = tlog_formats[cases[c].id];
+        int len = 0;
+
+        if (fmt == NULL) { // compiled out at this TLOG_LEVEL
+            continue;
+        }
+
+        start = cycle_counter_read();
+        for (int i = 0; i < TLOG_BENCH_MESSAGES; i++) {
+            len = tlog_print(fmt, cases[c].args, cases[c].nargs);
+        }
+        cycles_text = (cycle_counter_read() - start) / TLOG_BENCH_MESSAGES;
+
+        // stdio sends "\r\n" for each '\n'
+        bytes_text = (len > 0) ? len : 0;
+        for (const char *p = fmt; *p != '\0'; p++) {
+            bytes_text += (*p == '\n');
+        }
+
+        telemetry_get_stats(&before);
+        start = cycle_counter_read();
+        for (int i = 0; i < TLOG_BENCH_MESSAGES; i++) {
+            tlog_send(cases[c].id, cases[c].args, cases[c].nargs);
+        }
+        cycles_tlog = (cycle_counter_read() - start) / TLOG_BENCH_MESSAGES;
+        telemetry_get_stats(&after);
+
+        printf("%-6s: %u vs. %u cycles, %u vs. %u bytes\n", cases[c].name, (unsigned)cycles_text,
+               (unsigned)cycles_tlog, (unsigned)bytes_text,
+               (unsigned)((after.bytes - before.bytes) / TLOG_BENCH_MESSAGES));
+    }
+}
+#endif
+
+#ifdef TEMP_BENCH
+/*
+ * Compares the cycles needed to convert and format one reading with the
+ * double/%f path and with the Q8.8 integer path (DWT cycle counter).
+ */
+void benchTempConversion(void)
+{
+    char str[32];
+    volatile uint8_t msb = 0x17;
+    volatile uint8_t lsb = 0x90;
+    uint32_t start, cycles_double, cycles_q8;
+
+    cycle_counter_enable();
+
+    start = cycle_counter_read();
+    for (int i = 0; i < 100; i++) {
+        double temp = msb + lsb / ((float)256.0);
+        snprintf(str, sizeof(str), "%.4f", temp);
+    }
+    cycles_double = (cycle_counter_read() - start) / 100;
+
+    start = cycle_counter_read();
+    for (int i = 0; i < 100; i++) {
+        temp_q8_t temp = temp_q8_from_regs(msb, lsb);
+        temp_q8_format(str, sizeof(str), temp, TEMP_DECIMALS);
+    }
+    cycles_q8 = (cycle_counter_read() - start) / 100;
+
+    printf("\nConversion + formatting, cycles per sample: double %u, Q8.8 %u\n",
+           (unsigned)cycles_double, (unsigned)cycles_q8);
+}
+#endif
+
+/*
+ * Characterizes the link to every polled sensor; the shared clock is the
+ * slowest result.
+ */
+int characterizeLink(void)
+{
+    int retVal;
+    max31723_link_t link;
+    unsigned int hz = MAX31723_MAX_HZ;
+
+    for (int i = 0; i < FANOUT_SENSORS; i++) {
+        retVal = max31723_characterize(poll_table[i], SPI_SPEED, hz, &link);
+        if (retVal != E_NO_ERROR) {
+            return retVal;
+        }
+        hz = link.hz;
+
+        printf("\nSPI link to sensor %d: %u Hz (fastest clean step %u Hz", i, link.hz,
+               link.fastest_ok_hz);
+        if (link.failed_hz != 0) {
+            printf(", failed at %u Hz", link.failed_hz);
+        }
+        printf(", %u/%u reads bad)\n", (unsigned)link.errors, (unsigned)link.reads);
+    }
+
+    return E_NO_ERROR;
+}
+
+#ifdef FANOUT_BENCH
+/*
+ * Samples per second for 1 - FANOUT_SENSORS sensors at SCLK hz: rounds
+ * chained in the completion IRQ versus one blocking driver call per sensor.
+ */
+void benchFanoutAt(unsigned int hz)
+{
+    temp_q8_t temp;
+    uint32_t start, cycles_chained, cycles_calls;
+
+    MXC_SPI_SetFrequency(MAX31723_SPI, hz);
+
+    printf("\nFan-out throughput at %u Hz SCLK, samples/s over %d rounds:\n", hz,
+           FANOUT_BENCH_ROUNDS);
+    printf("Sensors  chained  per call\n");
+    for (int n = 1; n <= FANOUT_SENSORS; n++) {
+        start = cycle_counter_read();
+        for (int r = 0; r < FANOUT_BENCH_ROUNDS; r++) {
+            poll_read(n);
+        }
+        cycles_chained = cycle_counter_read() - start;
+
+        start = cycle_counter_read();
+        for (int r = 0; r < FANOUT_BENCH_ROUNDS; r++) {
+            for (int i = 0; i < n; i++) {
+                max31723_read_temp(poll_table[i], &temp);
+            }
+        }
+        cycles_calls = cycle_counter_read() - start;
+
+        printf("%7d  %7u  %8u\n", n,
+               (unsigned)((uint64_t)n * FANOUT_BENCH_ROUNDS * SystemCoreClock / cycles_chained),
+               (unsigned)((uint64_t)n * FANOUT_BENCH_ROUNDS * SystemCoreClock / cycles_calls));
+    }
+}
+
+/*
+ * Runs the fan-out benchmark at the characterized clock, where the
+ * per-sensor overhead is no longer hidden by the bus time, and at SPI_SPEED
+ * (DWT cycle counter).
+ */
+void benchFanout(void)
+{
+    unsigned int hz = max31723_get_link()->hz;
+
+    cycle_counter_enable();
+
+    benchFanoutAt(hz);
+    benchFanoutAt(SPI_SPEED);
+    MXC_SPI_SetFrequency(MAX31723_SPI, hz);
+}
+#endif
 
 int main(void)
 {
     int retVal;
-    mxc_spi_pins_t spi_pins;
+    uint8_t config;
+    temp_q8_t temp;
+
+#ifdef BOOT_STATS
+    cycle_counter_enable();
+    boot_start = cycle_counter_read();
+#endif
+#ifdef CONSOLE_TX
+    // printf() returns once the text is queued; the UART interrupt sends it
+    console_tx_init(MXC_UART_GET_UART(CONSOLE_UART), CONSOLE_TX_POLICY);
+#endif
+    // binary records on the console UART, between the text; TOKENIZED_LOG
+    // messages are records too
+    telemetry_init(MXC_UART_GET_UART(CONSOLE_UART));
 
     printf("\n\n\n*********************** SPI TEMPERATURE READ TEST ********************\n\n");
     printf("This example configures SPI to get a single temperture reading from\n");
@@ -200,17 +1153,6 @@ int main(void)
     printf("or by a 5-second RTC time-of-day alarm. The SW2 interrupt toggles LED1 (blue).\n");
     printf("The RTC interrupt toggles LED2 (green).\n\n");
 
-    spi_pins.clock = TRUE;
-    spi_pins.miso = TRUE;
-    spi_pins.mosi = TRUE;
-    spi_pins.sdio2 = FALSE;
-    spi_pins.sdio3 = FALSE;
-    spi_pins.ss0 = TRUE; // slave select pin 0
-    spi_pins.ss1 = FALSE; 
-    spi_pins.ss2 = FALSE;
-    spi_pins.vddioh = MXC_GPIO_VSSEL_VDDIOH;
-
-
 #ifdef BOARD_EVKIT_V1
     printf("\nBoard: BOARD_EVKIT_V1\n");
 #else
@@ -218,24 +1160,29 @@ int main(void)
 #endif
 
 
-#if MASTERSYNC
+#if defined(MASTERSYNC)
     printf("Performing blocking (synchronous) transactions...\n");
-#elif MASTERASYNC
+#elif defined(MASTERASYNC)
     printf("Performing non-blocking (asynchronous) transactions...\n");
+#elif defined(MASTERDMA)
+    printf("Performing DMA transactions...\n");
 #endif
 
-    // set up interrupt
-    MXC_NVIC_SetVector(SPI_IRQ, SPI_IRQHandler);
-    NVIC_EnableIRQ(SPI_IRQ);
-
-    // initialize the tx buffer with 0x0
-    // initialize the rx buffer with 0x0
-    memset(tx_data, 0x00, DATA_LEN * sizeof(uint8_t));
-    memset(rx_data, 0x00, DATA_LEN * sizeof(uint8_t)); 
+#ifdef CONV_ONESHOT
+    printf("One-shot conversions %d ms ahead of each RTC alarm\n",
+           MAX31723_CONV_MS(TEMP_RES) + CONV_SCHED_GUARD_MS);
+#else
+    printf("Continuous conversions\n");
+#endif
 
-    // Setup tx_data to read configuration register
-    tx_data[0] = 0x00; // configuration register address
-    tx_data[1] = 0x00; // dummy byte
+    // the handlers post into the queue as soon as they are enabled
+    work_queue_init(&work_queue);
+#ifdef IRQ_TIME_STATS
+    irq_time_init();
+#endif
+#ifdef PROF
+    prof_init(prof_table, PROF_COUNT);
+#endif
 
     /* Setup interrupt status pin as an output so we can toggle it on each interrupt. */
     gpio_interrupt_status.port = OUT_INTERRUPT_PORT;
@@ -250,6 +1197,7 @@ int main(void)
      *   Set up interrupt pin.
      *   Switch on EV kit is open when non-pressed, and grounded when pressed.  Use an internal pull-up so pin
      *     reads high when button is not pressed.
+     *   Both edges restart the debounce window; the timer reports the settled level.
      */
     gpio_interrupt.port = IN_INTERRUPT_PORT;
     gpio_interrupt.mask = IN_INTERRUPT_PIN;
@@ -258,208 +1206,132 @@ int main(void)
     gpio_interrupt.vssel = MXC_GPIO_VSSEL_VDDIOH;
     gpio_interrupt.drvstr = MXC_GPIO_DRVSTR_0;
     MXC_GPIO_Config(&gpio_interrupt);
-    MXC_GPIO_RegisterCallback(&gpio_interrupt, gpio_callback, &gpio_interrupt_status);
-    MXC_GPIO_IntConfig(&gpio_interrupt, MXC_GPIO_INT_FALLING);
-    MXC_GPIO_EnableInt(gpio_interrupt.port, gpio_interrupt.mask);
-    NVIC_EnableIRQ(MXC_GPIO_GET_IRQ(MXC_GPIO_GET_IDX(IN_INTERRUPT_PORT)));
-    MXC_NVIC_SetVector(MXC_GPIO_GET_IRQ(MXC_GPIO_GET_IDX(IN_INTERRUPT_PORT)), gpio_isr);
 
-    // Configure the peripheral
-    // initialize the SPI port
-    // master mode
-    // not quad mode
-    // 1 slave
-    // CS of ss0 is active high, 1
-    retVal = MXC_SPI_Init(SPI, MXC_SPI_TYPE_MASTER,
-        MXC_SPI_INTERFACE_STANDARD, 
-        1, 
-        1, 
-        SPI_SPEED,
-        spi_pins);
+#ifdef LP_SAMPLER
+    printf("STANDBY between the RTC alarms, samples reported %d at a time (no SW2)\n",
+           LP_BATCH_SAMPLES);
+    retVal = lp_sampler_init(MXC_UART_GET_UART(CONSOLE_UART));
     if (retVal != E_NO_ERROR) {
-        printf("SPI Initialization ERROR\n");
+        printf("Low Power Sampler Initialization ERROR: %d\n", retVal);
         return retVal;
     }
-
-    gpio_spi_pins.port = MXC_GPIO_PORT;
-    gpio_spi_pins.func = MXC_GPIO_FUNC_ALT1;
-    gpio_spi_pins.mask = MXC_GPIO_PIN_SS |
-        MXC_GPIO_PIN_MISO |
-        MXC_GPIO_PIN_MOSI |
-        MXC_GPIO_PIN_SCLK;
-    gpio_spi_pins.vssel = MXC_GPIO_VSSEL_VDDIOH;
-    MXC_GPIO_Config(&gpio_spi_pins);
-
-    printf("SPI Initialization SUCCESS\n");
-
-    // configure SPI mode
-    // for SPI_MODE_3, CPHA = CPOL = 1
-    retVal = MXC_SPI_SetMode(SPI, SPI_MODE_3);	
+#else
+    retVal = timebase_init(TIMEBASE_TMR);
     if (retVal != E_NO_ERROR) {
-        printf("SPI MODE ERROR\n");
+        printf("Timebase Initialization ERROR: %d\n", retVal);
         return retVal;
     }
 
-    printf("SPI Mode Initialization SUCCESS\n");
-
-    //SPI Request
-    req.spi = SPI;
-    req.txData = (uint8_t *)tx_data;
-    req.rxData = (uint8_t *)rx_data;
-    req.txLen = DATA_LEN;
-    req.rxLen = DATA_LEN;
-    req.ssIdx = 0;
-    req.ssDeassert = 1;
-    req.txCnt = 0;
-    req.rxCnt = 0;
-    req.completeCB = (spi_complete_cb_t)SPI_Callback;
-    SPI_FLAG = 1;
+    retVal = debounce_init(DEBOUNCE_TMR);
+    if (retVal == E_NO_ERROR) {
+        retVal = debounce_add(&sw2_debounce, IN_INTERRUPT_PORT, IN_INTERRUPT_PIN,
+                              SW2_DEBOUNCE_MS * 1000, sw2Changed, &gpio_interrupt_status);
+    }
+    if (retVal != E_NO_ERROR) {
+        printf("Debounce Initialization ERROR: %d\n", retVal);
+        return retVal;
+    }
 
-    retVal = MXC_SPI_SetDataSize(SPI, 8);
+    MXC_GPIO_RegisterCallback(&gpio_interrupt, gpio_callback, &sw2_debounce);
+    MXC_GPIO_IntConfig(&gpio_interrupt, MXC_GPIO_INT_BOTH);
+    MXC_GPIO_EnableInt(gpio_interrupt.port, gpio_interrupt.mask);
+    NVIC_EnableIRQ(MXC_GPIO_GET_IRQ(MXC_GPIO_GET_IDX(IN_INTERRUPT_PORT)));
+    MXC_NVIC_SetVector(MXC_GPIO_GET_IRQ(MXC_GPIO_GET_IDX(IN_INTERRUPT_PORT)), gpio_isr);
+#endif
 
+    retVal = completion_timer_init(COMPLETION_TMR);
     if (retVal != E_NO_ERROR) {
-        printf("\nSPI SET DATASIZE ERROR: %d\n", retVal);
+        printf("Completion Timer Initialization ERROR: %d\n", retVal);
         return retVal;
     }
 
-    retVal = MXC_SPI_SetWidth(SPI, SPI_WIDTH_STANDARD);
-
+    // SPI4 in mode 3 with active-high chip selects, see max31723.h
+    retVal = max31723_port_init_ss(SPI_SPEED, FANOUT_SS_MASK);
     if (retVal != E_NO_ERROR) {
-        printf("\nSPI SET WIDTH ERROR: %d\n", retVal);
+        printf("SPI Initialization ERROR\n");
         return retVal;
     }
 
+    printf("SPI Initialization SUCCESS\n");
+
+    max31723_init(&sensor);
+
+    // the register dumps are bring-up output (TLOG_LEVEL_DEBUG): when they
+    // are compiled out, so are the reads that only feed them
+
     // Read the configuration register
-    printf("\nReading Configuration Register...\n");
-
-    // async transaction
-    MXC_SPI_MasterTransactionAsync(&req);
-    int tempCount = 0; // allow the following while loop to only toggle the LED once
-    while (SPI_FLAG == 1) {
-        if (tempCount == 0) {
-            MXC_GPIO_OutToggle(gpio_interrupt_status.port, gpio_interrupt_status.mask);
-            tempCount++;
-        }
-    }
-    
-    printf("Configuration Register: ");
-    for (int i = 7; i >= 0; i--) {
-        printf("%d", (rx_data[1] >> i) & 1);
-        if (i == 4) {
-            printf(" ");
-        }
+    if (TLOG_ON(TLOG_CONFIG_READ)) {
+        max31723_read_config(&sensor, &config);
+        TLOG(TLOG_CONFIG_READ, config);
     }
 
     // write to configuration register
-    tx_data[0] = 0x80;
-    // config write to EEPROM, EEPROM write in progress, disable 1SHOT, interrupt mode, 12-bit precision, continuous conversion 
-    tx_data[1] = 0b01000110;
-    memset(rx_data, 0x00, DATA_LEN * sizeof(uint8_t)); 
-    printf("\n\nWriting Configuration Register...\n");
-
-    // async transaction
-    MXC_SPI_MasterTransactionAsync(&req);
-    tempCount = 0; // allow the following while loop to only toggle the LED once
-    while (SPI_FLAG == 1) {
-        if (tempCount == 0) {
-            MXC_GPIO_OutToggle(gpio_interrupt_status.port, gpio_interrupt_status.mask);
-            tempCount++;
-        }   
-    }
-    
-    printf("Configuration Register Value Sent: ");
-    for (int i = 7; i >= 0; i--) {
-        printf("%d", (tx_data[1] >> i) & 1);
-        if (i == 4) {
-            printf(" ");
-        }
-    }
-
+    // disable 1SHOT, comparator mode, TEMP_RES-bit precision,
+    // shutdown (CONV_ONESHOT) or continuous conversion (CONV_CONTINUOUS)
+    config = CONV_SCHED_CONFIG(TEMP_RES);
+    max31723_write_config(&sensor, config);
+    TLOG(TLOG_CONFIG_WRITE, config);
+    conv_sched_init(&sensor);
 
     // read configuration register
-    tx_data[0] = 0x00;
-    tx_data[1] = 0x00;
-    memset(rx_data, 0x00, DATA_LEN * sizeof(uint8_t)); 
-    printf("\n\nReading Configuration Register...\n");
-    // async transaction
-    MXC_SPI_MasterTransactionAsync(&req);
-    tempCount = 0; // allow the following while loop to only toggle the LED once
-    SPI_FLAG = 1;
-    while (SPI_FLAG == 1) {
-        if (tempCount == 0) {
-            MXC_GPIO_OutToggle(gpio_interrupt_status.port, gpio_interrupt_status.mask);
-            tempCount++;
-        }
+    if (TLOG_ON(TLOG_CONFIG_READ)) {
+        max31723_read_config(&sensor, &config);
+        TLOG(TLOG_CONFIG_READ, config);
     }
 
-    printf("Configuration Register: ");
-    for (int i = 7; i >= 0; i--) {
-        printf("%d", (rx_data[1] >> i) & 1);
-        if (i == 4) {
-            printf(" ");
-        }
+    // TEMP_RES is already set, so this request does not write the sensor
+    rate_ctl_init(&sensor);
+    rate_ctl_request(TIME_OF_DAY_SEC * 1000, TEMP_RES);
+    printRate(TLOG_RATE_NORMAL);
+
+    retVal = setupFanout();
+    if (retVal != E_NO_ERROR) {
+        printf("\nSENSOR SETUP ERROR: %d\n", retVal);
+        return retVal;
     }
 
+    retVal = characterizeLink();
+    if (retVal != E_NO_ERROR) {
+        printf("\nSPI LINK CHARACTERIZATION ERROR: %d\n", retVal);
+        return retVal;
+    }
 
-    // read temp MSB register
-    tx_data[0] = 0x02;
-    tx_data[1] = 0x00;
-    memset(rx_data, 0x00, DATA_LEN * sizeof(uint8_t));
-    printf("\n\nReading Temperature MSB...\n");
+#ifdef FANOUT_BENCH
+    benchFanout();
+#endif
 
-    // async transaction
-    MXC_SPI_MasterTransactionAsync(&req);
-    tempCount = 0; // allow the following while loop to only toggle the LED once
-    SPI_FLAG = 1;
-    while (SPI_FLAG == 1) {
-        if (tempCount == 0) {
-            MXC_GPIO_OutToggle(gpio_interrupt_status.port, gpio_interrupt_status.mask);
-            tempCount++;
+    // read temp LSB and MSB registers in one burst; MSB and LSB in binary
+    // and decimal, the LSB alone is the fraction
+    if (TLOG_ON(TLOG_TEMP_REGS)) {
+        retVal = max31723_read_temp(&sensor, &temp);
+        if (retVal != E_NO_ERROR) {
+            printf("\nSPI BURST READ ERROR: %d\n", retVal);
+            return retVal;
         }
-    }
 
-    printf("Temperature MSB: ");
-    for (int i = 7; i >= 0; i--) {
-        printf("%d", (rx_data[1] >> i) & 1);
-        if (i == 4) {
-            printf(" ");
-        }
+        TLOG(TLOG_TEMP_REGS, MAX31723_REG_TEMP_LSB, (uint8_t)((uint16_t)temp >> 8),
+             (uint8_t)((uint16_t)temp >> 8), (uint8_t)temp, (uint8_t)temp, (uint8_t)temp, temp);
     }
-    printf("\nTemperature MSB: %d ", rx_data[1]);
-    temp_MSB = rx_data[1];
-
-    // read temp LSB register
-    tx_data[0] = 0x01;
-    tx_data[1] = 0x00;
-    memset(rx_data, 0x00, DATA_LEN * sizeof(uint8_t)); 
-    printf("\n\nReading Temperature LSB...\n");
-
-    // async transaction
-    MXC_SPI_MasterTransactionAsync(&req);
-    tempCount = 0; // allow the following while loop to only toggle the LED once
-    SPI_FLAG = 1;
-    while (SPI_FLAG == 1) {
-        if (tempCount == 0) {
-            MXC_GPIO_OutToggle(gpio_interrupt_status.port, gpio_interrupt_status.mask);
-            tempCount++;
-        }
-    }
-    
-    printf("Temperature LSB: ");
-    for (int i = 7; i >= 0; i--) {
-        printf("%d", (rx_data[1] >> i) & 1);
-        if (i == 4) {
-            printf(" ");
-        }
-    }
-    printf("\nTemperature LSB: %d ", rx_data[1]);
-    temp_LSB = rx_data[1];
-    printf("\nTemp_Fraction: %.4f\n", (double)(temp_LSB/256.0f));
-    
 
-    double temp_final = temp_MSB + temp_LSB/((float)256.0);
-    printf("\nFinal Temperature: %.4f\n", temp_final);
+    temp_avg_reset(&temp_avg);
+    temp_threshold_init(&temp_alert, TEMP_Q8_FROM_C(TEMP_ALERT_HIGH_C),
+                        TEMP_Q8_FROM_C(TEMP_ALERT_LOW_C));
 
+#ifdef TEMP_BENCH
+    benchTempConversion();
+#endif
+
+#ifdef TLM_BENCH
+    benchTelemetry();
+#endif
+#ifdef TLOG_BENCH
+    benchLog();
+#endif
+
+#ifdef COMPLETION_STATS
+    printf("\n");
+    completion_print_stats("SPI", &sensor.done);
+#endif
 
 
 
@@ -476,21 +1348,9 @@ int main(void)
         while (1) {}
     }
 
-    // disable interrupt for setting up the time-of-day alarm
-    if (MXC_RTC_DisableInt(MXC_F_RTC_CTRL_TOD_ALARM_IE) == E_BUSY) {
-        return E_BUSY;
-    }
-
-    if (MXC_RTC_SetTimeofdayAlarm(TIME_OF_DAY_SEC) != E_NO_ERROR) {
-        printf("Failed RTC_SetTimeofdayAlarm\n");
-        printf("Example Failed\n");
-
-        while (1) {}
-    }
-
-    if (MXC_RTC_EnableInt(MXC_F_RTC_CTRL_TOD_ALARM_IE) == E_BUSY) {
-        return E_BUSY;
-    }
+    // time-of-day alarms at TIME_OF_DAY_SEC, 2 * TIME_OF_DAY_SEC, ...
+    tod_sched_init(TIME_OF_DAY_SEC, TIME_OF_DAY_POLICY, todAlarm, NULL);
+    tod_sched_start(TIME_OF_DAY_SEC);
 
     
 
@@ -505,66 +1365,133 @@ int main(void)
         while (1) {}
     }
 
+    // the wheel owns the sub-second alarm from here on
+    while (rtc_wheel_init() == E_BUSY) {}
+    rtc_timer_init(&trend_timer, trendExpired, NULL);
+
+#ifdef RTC_TRIM
+    rtc_trim_set(RTC_TRIM);
+#endif
+#ifdef RTC_TRIM_CAL
+    retVal = rtc_trim_init(RTC_TRIM_TMR, RTC_TRIM_CLK, RTC_TRIM_REF_HZ);
+    if (retVal != E_NO_ERROR) {
+        printf("RTC Trim Initialization ERROR: %d\n", retVal);
+        return retVal;
+    }
+    rtc_timer_init(&trim_timer, trimExpired, NULL);
+    startTrimWindow();
+#endif
+
+#ifndef LP_SAMPLER
+    // SW2 triggers are stamped on the RTC timeline from the first edge on
+    while (timebase_discipline() == E_BUSY) {}
+#endif
+
+#ifdef BOOT_STATS
+    boot_rtc_cycles = cycle_counter_read() - boot_start;
+#endif
     printf("\nRTC started");
     printTime();
 
+    // on-demand reads first; periodic triggers are late after a full period,
+    // which setTrending() follows
+    trig_sched_init();
+    trig_sched_config(TRIGGER_SW2, 1, SW2_COALESCE_MS, SW2_DEADLINE_MS);
+    trig_sched_config(TRIGGER_RTC, 0, 0, TIME_OF_DAY_SEC * 1000);
 
-    while(1){ // listen to interrupts
-        if ((ISR_SPI_FLAG || RTC_SPI_FLAG) == 1) {
-            // read temp MSB register
-            tx_data[0] = 0x02;
-            tx_data[1] = 0x00;
-            memset(rx_data, 0x00, DATA_LEN * sizeof(uint8_t));
-
-            // async transaction
-            MXC_SPI_MasterTransactionAsync(&req);
-            tempCount = 0; // allow the following while loop to only toggle the LED once
-            SPI_FLAG = 1;
-            while (SPI_FLAG == 1) {
-                if (tempCount == 0) {
-                    MXC_GPIO_OutToggle(gpio_interrupt_status.port, gpio_interrupt_status.mask);
-                    tempCount++;
-                }
-            }
+    // the first conversion leads the first alarm, later ones are armed by todAlarm()
+    conv_sched_arm(TIME_OF_DAY_SEC);
 
-            temp_MSB = rx_data[1];
-            
-
-            // read temp LSB register
-            tx_data[0] = 0x01;
-            tx_data[1] = 0x00;
-            memset(rx_data, 0x00, DATA_LEN * sizeof(uint8_t)); 
-
-            // async transaction
-            MXC_SPI_MasterTransactionAsync(&req);
-            tempCount = 0; // allow the following while loop to only toggle the LED once
-            SPI_FLAG = 1;
-            while (SPI_FLAG == 1) {
-                if (tempCount == 0) {
-                    MXC_GPIO_OutToggle(gpio_interrupt_status.port, gpio_interrupt_status.mask);
-                    tempCount++;
-                }
+    sample_ring_init(&sample_store, SAMPLE_STORE_POLICY);
+#ifdef MASTERDMA
+    acq_init(&sensor, &sample_store);
+#endif
+
+    while (1) { // listen to interrupts
+        uint8_t source;
+        sample_t sample;
+        bool idle;
+        PROF_BEGIN(PROF_LOOP);
+
+        // work posted by the interrupt handlers, then the RTC alarms and timers
+        work_run(&work_queue);
+        tod_sched_run();
+        rtc_wheel_run();
+
+        // a user read goes ahead of the periodic conversion below; periodic
+        // triggers wait for it, their release time stays on the alarm grid.
+        // Every trigger waits for a one-shot conversion started late
+        source = 0;
+        if (trig_sched_pending() && conv_sched_ready()) {
+            uint32_t now;
+
+            if (conv_sched_now(&now)) {
+                source = trig_sched_next(now);
             }
-            
-            temp_LSB = rx_data[1];
-            
-            // calculate final temperature    
-            double temp_final = temp_MSB + temp_LSB/((float)256.0);
-
-            if(ISR_SPI_FLAG) {
-                printf("\n\nSW2:");
-            } else {
-                printf("\n\nRTC: ");
+        }
+        if (trig_sched_primary(source) == TRIGGER_SW2) {
+            acquireSample(source);
+            source = 0;
+        }
+
+        // one-shot conversion ahead of the next RTC alarm
+#ifdef MASTERDMA
+        if (conv_sched_due() && !acq_busy()) {
+#else
+        if (conv_sched_due()) {
+#endif
+            PROF_BEGIN(PROF_CONV_START);
+            retVal = conv_sched_start();
+            PROF_END(PROF_CONV_START);
+            if (retVal != E_NO_ERROR) {
+                printf("\nSPI 1SHOT ERROR: %d\n", retVal);
             }
+        }
 
-            printTime();
+        // periodic acquisition; simultaneous triggers share one sample
+        if (source != 0) {
+            acquireSample(source);
+        }
 
-            printf("Final Temperature: %.4f\n", temp_final);
-            ISR_SPI_FLAG = 0;
-            RTC_SPI_FLAG = 0;
-            // enable push button interrupt
-            NVIC_EnableIRQ(MXC_GPIO_GET_IRQ(MXC_GPIO_GET_IDX(IN_INTERRUPT_PORT))); 
+        // low-priority drain: print one sample per pass so that new triggers
+        // are served between two samples
+        if (sample_ring_pop(&sample_store, &sample)) {
+            sample_timestamp(&sample);
+#ifdef LP_SAMPLER
+            batchSample(&sample);
+#else
+            processSample(&sample);
+#endif
+#ifdef COMPLETION_STATS
+            completion_print_stats("SPI", &sensor.done);
+#endif
+        }
+#ifdef LP_SAMPLER
+        // a batch report goes out the same way
+        lp_sampler_report_next(processSample);
+#endif
+
+        PROF_END(PROF_LOOP);
+
+        // sleep until the next interrupt when there is nothing to do;
+        // a pending IRQ still wakes WFI while interrupts are masked
+        __disable_irq();
+        idle = !work_pending(&work_queue) && !tod_sched_pending() && !rtc_wheel_pending() &&
+               !conv_sched_due() && (!trig_sched_pending() || !conv_sched_ready()) &&
+               sample_ring_count(&sample_store) == 0;
+#ifdef LP_SAMPLER
+        idle = idle && !lp_sampler_reporting();
+#endif
+        if (idle) {
+#if defined(LP_SAMPLER) && defined(MASTERDMA)
+            lp_sampler_sleep(acq_busy());
+#elif defined(LP_SAMPLER)
+            lp_sampler_sleep(false);
+#else
+            conv_sched_sleep();
+#endif
         }
+        __enable_irq();
     }
 
     return 0;
@@ -0,0 +1,12 @@
+/**
+ * @file    prof_probes.c
+ * @brief   Table of readTemp's profiling probes
+ */
+
+/***** Includes *****/
+#include "prof_probes.h"
+
+/***** Globals *****/
+#ifdef PROF
+prof_probe_t prof_table[PROF_COUNT] = { PROF_PROBES(PROF_ENTRY) };
+#endif
@@ -0,0 +1,27 @@
+/**
+ * @file    prof_probes.h
+ * @brief   readTemp's profiling probes (PROF_BEGIN()/PROF_END(), see prof.h)
+ * @details One entry per probe: its id and the name prof_print() shows.
+ *          Built with PROF (project.mk); otherwise the probes compile to
+ *          nothing and prof_probes.c leaves the table out.
+ */
+
+#ifndef PROF_PROBES_H_
+#define PROF_PROBES_H_
+
+/***** Includes *****/
+#include "prof.h"
+
+/***** Definitions *****/
+#define PROF_PROBES(X)                            \
+    X(PROF_RTC_IRQ, "RTC handler")                \
+    X(PROF_SW2, "SW2 press")                      \
+    X(PROF_TOD_ALARM, "time-of-day alarm")        \
+    X(PROF_CONV_START, "1SHOT start")             \
+    X(PROF_ACQUIRE, "sample acquisition")         \
+    X(PROF_REPORT, "sample report")               \
+    X(PROF_LOOP, "main loop pass")
+
+typedef enum { PROF_PROBES(PROF_ID) PROF_COUNT } prof_id_t;
+
+#endif // PROF_PROBES_H_
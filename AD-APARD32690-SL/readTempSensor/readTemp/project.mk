@@ -34,5 +34,79 @@ MXC_OPTIMIZE_CFLAGS = -O0 -Og
 # https://www.analog.com/en/education/education-library/videos/6313214207112.html
 SBT=0
 
+# transaction method: MASTERSYNC, MASTERASYNC (default) or MASTERDMA
 # METHOD ?= MASTERSYNC
-# PROJ_CFLAGS += -D$(METHOD)
\ No newline at end of file
+# PROJ_CFLAGS += -D$(METHOD)
+
+# sensor conversions: CONV_ONESHOT (default, one conversion ahead of each RTC
+# alarm) or CONV_CONTINUOUS
+# CONV_MODE ?= CONV_CONTINUOUS
+# PROJ_CFLAGS += -D$(CONV_MODE)
+
+# shared modules (completion, ...)
+VPATH += ../../../common
+IPATH += ../../../common
+
+# MAX31723s polled round-robin (1 - 4, default 1): slave selects 0 - 2, then a
+# GPIO chip enable; FANOUT_BENCH prints samples/s versus sensor count
+# PROJ_CFLAGS += -DFANOUT_SENSORS=4
+# PROJ_CFLAGS += -DFANOUT_BENCH
+
+# report the time spent in the GPIO, debounce timer, RTC and SPI/DMA handlers with
+# every average
+# PROJ_CFLAGS += -DIRQ_TIME_STATS
+
+# report idle vs. busy cycles for every SPI transaction
+# PROJ_CFLAGS += -DCOMPLETION_STATS
+
+# print the cycles per sample of the double vs. Q8.8 temperature conversion
+# PROJ_CFLAGS += -DTEMP_BENCH
+
+# non-blocking console: printf() queues into a ring that the UART interrupt
+# drains (common/console_tx.h); newlib's _write() is redirected to it
+# PROJ_CFLAGS += -DCONSOLE_TX
+# PROJ_LDFLAGS += -Wl,--wrap=_write
+# what a full ring does: CONSOLE_TX_BLOCK (default), CONSOLE_TX_DROP_NEWEST or
+# CONSOLE_TX_OVERWRITE_OLDEST; ring size in bytes (power of two, default 1024)
+# PROJ_CFLAGS += -DCONSOLE_TX_POLICY=CONSOLE_TX_DROP_NEWEST
+# PROJ_CFLAGS += -DCONSOLE_TX_SIZE=2048
+
+# tokenized log messages: TLOG() sends the message index and its arguments
+# instead of text (common/tlog.h), host/tlm_decode -t prints them;
+# TLOG_BENCH prints cycles and bytes per message, formatted vs. tokenized
+# PROJ_CFLAGS += -DTOKENIZED_LOG
+# PROJ_CFLAGS += -DTLOG_BENCH
+
+# log level and modules compiled in (tlog_msgs.h): TLOG_LEVEL_INFO leaves out
+# the configuration and temperature register dumps and their reads (default
+# TLOG_LEVEL_DEBUG, TLOG_LEVEL_INFO with NDEBUG); TLOG_MODULES is a mask of
+# TLOG_MOD_* bits. BOOT_STATS prints the time to the RTC start and first sample
+# PROJ_CFLAGS += -DTLOG_LEVEL=TLOG_LEVEL_INFO
+# PROJ_CFLAGS += -DTLOG_MODULES="(TLOG_MOD_TIME|TLOG_MOD_SAMPLE)"
+# PROJ_CFLAGS += -DBOOT_STATS
+
+# RTC trim calibration: RTC_TRIM_CAL measures the crystal against TMR2 on
+# RTC_TRIM_CLK (default MXC_TMR_APB_CLK, a reference only when the system clock
+# runs from a crystal; MXC_TMR_EXT_CLK needs RTC_TRIM_REF_HZ) for
+# RTC_TRIM_WINDOW_SEC (default 10), trims it and measures again; RTC_TRIM
+# writes a trim found earlier (-127 - 127, 1 ppm per step)
+# PROJ_CFLAGS += -DRTC_TRIM_CAL
+# PROJ_CFLAGS += -DRTC_TRIM_WINDOW_SEC=100
+# PROJ_CFLAGS += -DRTC_TRIM=-12
+
+# STANDBY between the RTC alarms instead of SLEEP (lp_sampler.h): samples are
+# kept in SRAM and reported LP_BATCH_SAMPLES (default 12) at a time, or at once
+# with an alert. The TMR clocks stop in STANDBY: no SW2, no timebase, and not
+# together with RTC_TRIM_CAL
+# PROJ_CFLAGS += -DLP_SAMPLER
+# PROJ_CFLAGS += -DLP_BATCH_SAMPLES=60
+
+# named profiling probes on the hot paths (prof_probes.h): runs, min, average,
+# max and a histogram per probe on the DWT cycle counter, printed with every
+# average; PROF_CLOCK_GETTIME times them with clock_gettime() (host builds)
+# PROJ_CFLAGS += -DPROF
+
+# report samples, averages and alerts as binary records (COBS + CRC-16) for
+# host/tlm_decode instead of text; TLM_BENCH prints samples/s text vs. binary
+# PROJ_CFLAGS += -DTELEMETRY
+# PROJ_CFLAGS += -DTLM_BENCH
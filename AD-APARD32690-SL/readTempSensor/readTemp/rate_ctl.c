@@ -0,0 +1,80 @@
+/**
+ * @file    rate_ctl.c
+ * @brief   Runtime resolution policy for the MAX31723
+ */
+
+/***** Includes *****/
+#include <string.h>
+
+#include "mxc_errors.h"
+#include "rate_ctl.h"
+
+/***** Globals *****/
+static max31723_t *rate_sensor;
+static rate_ctl_t rate;
+
+/***** Functions *****/
+int rate_ctl_pick(uint32_t period_ms, int min_bits)
+{
+    int bits;
+
+    for (bits = MAX31723_MAX_RES; bits > min_bits; bits--) {
+        if (MAX31723_CONV_MS(bits) <= period_ms) {
+            break;
+        }
+    }
+    return bits;
+}
+
+void rate_ctl_init(max31723_t *sensor)
+{
+    rate_sensor = sensor;
+    memset(&rate, 0x00, sizeof(rate));
+    if (sensor->config_valid) {
+        rate.bits = MAX31723_CFG_GET_RES(sensor->config);
+    }
+}
+
+int rate_ctl_request(uint32_t period_ms, int min_bits)
+{
+    int retVal;
+    int bits;
+
+    if (min_bits < MAX31723_MIN_RES || min_bits > MAX31723_MAX_RES || period_ms == 0) {
+        return E_BAD_PARAM;
+    }
+
+    bits = rate_ctl_pick(period_ms, min_bits);
+
+    // unchanged resolutions are not written again
+    retVal = max31723_set_resolution(rate_sensor, bits);
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+    if (bits != rate.bits) {
+        rate.changes++;
+    }
+    rate.period_ms = period_ms;
+    rate.min_bits = min_bits;
+    rate.bits = bits;
+    rate.effective_period_ms = period_ms;
+    if (MAX31723_CONV_MS(bits) > period_ms) {
+        rate.effective_period_ms = MAX31723_CONV_MS(bits);
+    }
+
+    return E_NO_ERROR;
+}
+
+void rate_ctl_get(rate_ctl_t *rc)
+{
+    *rc = rate;
+}
+
+uint32_t rate_ctl_rate_mhz(void)
+{
+    if (rate.effective_period_ms == 0) {
+        return 0;
+    }
+    return 1000000 / rate.effective_period_ms;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file    rate_ctl.h
+ * @brief   Runtime resolution policy for the MAX31723
+ * @details The conversion time doubles with every resolution bit (25 ms at
+ *          9 bits, 200 ms at 12 bits), so the resolution caps the sample
+ *          rate. Given a requested sample period and the lowest acceptable
+ *          resolution, the policy picks the highest resolution whose
+ *          conversion fits in the period. When even the minimum resolution is
+ *          too slow, the period is stretched to its conversion time instead.
+ *
+ *          The configuration register is only rewritten when the chosen
+ *          resolution changes (the driver caches it).
+ */
+
+#ifndef RATE_CTL_H_
+#define RATE_CTL_H_
+
+/***** Includes *****/
+#include <stdint.h>
+
+#include "max31723.h"
+
+/***** Definitions *****/
+typedef struct {
+    uint32_t period_ms; // requested sample period
+    int min_bits; // lowest acceptable resolution
+    int bits; // resolution in use
+    uint32_t effective_period_ms; // period the sensor can deliver at bits
+    uint32_t changes; // resolution changes written to the sensor
+} rate_ctl_t;
+
+/***** Functions *****/
+/*
+ * Highest resolution (min_bits - MAX31723_MAX_RES) whose conversion time fits
+ * in period_ms; min_bits when none does.
+ */
+int rate_ctl_pick(uint32_t period_ms, int min_bits);
+
+/*
+ * Starts from the resolution in the sensor's configuration cache.
+ */
+void rate_ctl_init(max31723_t *sensor);
+
+/*
+ * Applies the policy to the requested period and minimum resolution, and
+ * changes the sensor's resolution if needed. Uses blocking driver calls.
+ */
+int rate_ctl_request(uint32_t period_ms, int min_bits);
+
+void rate_ctl_get(rate_ctl_t *rc);
+
+/*
+ * Effective sample rate in mHz.
+ */
+uint32_t rate_ctl_rate_mhz(void);
+
+#endif // RATE_CTL_H_
@@ -0,0 +1,133 @@
+/**
+ * @file    sample_ring.c
+ * @brief   Lock-free store of timestamped samples between acquisition and printing
+ */
+
+/***** Includes *****/
+#include <string.h>
+
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "cycle_counter.h"
+#include "rtc_time.h"
+#include "sample_ring.h"
+
+#if (SAMPLE_RING_SIZE & (SAMPLE_RING_SIZE - 1)) != 0
+#error "SAMPLE_RING_SIZE must be a power of two."
+#endif
+
+/***** Definitions *****/
+#define SAMPLE_RING_MASK (SAMPLE_RING_SIZE - 1)
+
+/***** Functions *****/
+void sample_ring_init(sample_ring_t *ring, sample_ring_policy_t policy)
+{
+    memset(ring, 0x00, sizeof(*ring));
+    ring->policy = policy;
+    cycle_counter_enable();
+}
+
+void sample_mark(sample_t *sample)
+{
+    sample->taken_cycles = cycle_counter_read();
+}
+
+void sample_timestamp(sample_t *sample)
+{
+    rtc_time_t now = { 0, 0 };
+    uint64_t ticks = 0;
+    uint64_t age;
+
+    // left at 0 if the RTC stays busy
+    if (rtc_time_get(&now) == E_NO_ERROR) {
+        age = (uint64_t)(cycle_counter_read() - sample->taken_cycles) * RTC_TIME_TICKS_PER_SEC /
+              SystemCoreClock;
+        ticks = (uint64_t)now.sec * RTC_TIME_TICKS_PER_SEC + now.subsec;
+        ticks = (ticks > age) ? ticks - age : 0;
+    }
+    sample->rtc_seconds = (uint32_t)(ticks / RTC_TIME_TICKS_PER_SEC);
+    sample->subseconds = (uint16_t)(ticks % RTC_TIME_TICKS_PER_SEC);
+}
+
+bool sample_ring_push(sample_ring_t *ring, const sample_t *sample)
+{
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    uint32_t queued = head - tail;
+    sample_slot_t *slot = &ring->slot[head & SAMPLE_RING_MASK];
+
+    if (queued >= SAMPLE_RING_SIZE) {
+        if (ring->policy == SAMPLE_RING_DROP_NEWEST) {
+            ring->stats.dropped++;
+            return false;
+        }
+        // OVERWRITE_OLDEST: the consumer notices the lap and counts the loss
+        queued = SAMPLE_RING_SIZE - 1;
+    }
+
+    // odd sequence while the slot is being written
+    __atomic_store_n(&slot->seq, 2 * head + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->sample = *sample;
+    __atomic_store_n(&slot->seq, 2 * head + 2, __ATOMIC_RELEASE);
+
+    // publish the slot only after its contents are written
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    ring->stats.pushed++;
+    if (queued + 1 > ring->stats.high_water) {
+        ring->stats.high_water = queued + 1;
+    }
+
+    return true;
+}
+
+bool sample_ring_pop(sample_ring_t *ring, sample_t *sample)
+{
+    for (;;) {
+        uint32_t tail = ring->tail;
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        sample_slot_t *slot;
+        uint32_t seq;
+
+        if (head == tail) {
+            return false;
+        }
+
+        if (head - tail > SAMPLE_RING_SIZE) {
+            // the producer lapped us, skip to the oldest sample still stored
+            ring->stats.overwritten += head - tail - SAMPLE_RING_SIZE;
+            tail = head - SAMPLE_RING_SIZE;
+        }
+
+        slot = &ring->slot[tail & SAMPLE_RING_MASK];
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+        if (seq == 2 * tail + 2) {
+            *sample = slot->sample;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+            if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq) {
+                // hand the slot back only after it has been copied out
+                __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+        }
+
+        // the slot was reused while it was copied; that sample is lost
+        ring->stats.overwritten++;
+        __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    }
+}
+
+uint32_t sample_ring_count(const sample_ring_t *ring)
+{
+    uint32_t queued = ring->head - ring->tail;
+
+    return (queued > SAMPLE_RING_SIZE) ? SAMPLE_RING_SIZE : queued;
+}
+
+void sample_ring_get_stats(const sample_ring_t *ring, sample_ring_stats_t *stats)
+{
+    *stats = ring->stats;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file    sample_ring.h
+ * @brief   Lock-free store of timestamped samples between acquisition and printing
+ * @details Single producer (the acquisition path: main() in sync/async mode,
+ *          the DMA completion IRQ in DMA mode), single consumer (the
+ *          low-priority drain in main()). The producer only writes head and the
+ *          consumer only writes tail, so neither side disables interrupts.
+ *
+ *          When the ring is full the overflow policy decides what is lost:
+ *          SAMPLE_RING_DROP_NEWEST keeps the queued samples and rejects the new
+ *          one, SAMPLE_RING_OVERWRITE_OLDEST keeps the most recent samples.
+ *          In overwrite mode every slot carries a sequence number, so the
+ *          consumer detects a slot that was overwritten while it was copied.
+ *
+ *          The producer only marks a sample with the cycle counter, which the
+ *          DMA completion IRQ can read without waiting. The consumer stamps it
+ *          with the RTC time when it drains the ring: the RTC now, minus the
+ *          cycles since the mark. The RTC read retries while RDY is low, which
+ *          main() can afford and a handler cannot. The cycle counter stops in
+ *          STANDBY, so the ring must be drained before the core goes there.
+ */
+
+#ifndef SAMPLE_RING_H_
+#define SAMPLE_RING_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+
+/***** Definitions *****/
+// number of slots, must be a power of two
+#ifndef SAMPLE_RING_SIZE
+#define SAMPLE_RING_SIZE 16
+#endif
+
+// trigger sources, OR-ed together when triggers are merged into one sample
+#define TRIGGER_SW2 (1 << 0)
+#define TRIGGER_RTC (1 << 1)
+
+typedef struct {
+    uint32_t rtc_seconds; // RTC seconds when the sample was taken
+    uint16_t subseconds; // RTC sub-seconds (1/4096 s)
+    uint16_t raw_temp; // temperature register, MSB:LSB (Q8.8, 2's complement)
+    uint8_t trigger_source; // TRIGGER_* bits that requested this sample
+    uint32_t taken_cycles; // cycle counter when it was taken, see sample_mark()
+} sample_t;
+
+typedef enum {
+    SAMPLE_RING_DROP_NEWEST, // a full ring rejects new samples
+    SAMPLE_RING_OVERWRITE_OLDEST, // a full ring drops its oldest sample
+} sample_ring_policy_t;
+
+typedef struct {
+    uint32_t pushed; // samples appended
+    uint32_t dropped; // new samples rejected (DROP_NEWEST)
+    uint32_t overwritten; // queued samples lost (OVERWRITE_OLDEST)
+    uint32_t high_water; // most samples queued at once
+} sample_ring_stats_t;
+
+typedef struct {
+    volatile uint32_t seq; // 2 * index + 2 once slot holds sample index, odd while written
+    sample_t sample;
+} sample_slot_t;
+
+typedef struct {
+    sample_slot_t slot[SAMPLE_RING_SIZE];
+    volatile uint32_t head; // next sample index to write, owned by the producer
+    volatile uint32_t tail; // next sample index to read, owned by the consumer
+    sample_ring_policy_t policy;
+    sample_ring_stats_t stats; // written by the producer, except overwritten
+} sample_ring_t;
+
+/***** Functions *****/
+void sample_ring_init(sample_ring_t *ring, sample_ring_policy_t policy);
+
+/*
+ * Records when sample was taken, from any context: one cycle counter read.
+ */
+void sample_mark(sample_t *sample);
+
+/*
+ * Stamps a sample marked by sample_mark() with the RTC time it was taken.
+ * Reads the RTC, retrying while it is busy: call it from main(), within 35 s
+ * of the mark (the cycle counter wraps).
+ */
+void sample_timestamp(sample_t *sample);
+
+/*
+ * Producer side. Returns false when the sample was rejected (DROP_NEWEST on a
+ * full ring).
+ */
+bool sample_ring_push(sample_ring_t *ring, const sample_t *sample);
+
+/*
+ * Consumer side. Returns false when the ring is empty.
+ */
+bool sample_ring_pop(sample_ring_t *ring, sample_t *sample);
+
+uint32_t sample_ring_count(const sample_ring_t *ring);
+
+/*
+ * Copies the counters. They are updated from the producer context, so the
+ * copy can be a sample behind.
+ */
+void sample_ring_get_stats(const sample_ring_t *ring, sample_ring_stats_t *stats);
+
+#endif // SAMPLE_RING_H_
@@ -0,0 +1,208 @@
+/**
+ * @file    sensor_poll.c
+ * @brief   Round-robin polling of several MAX31723s on one SPI port
+ * @details The MSDK SPI driver programs the slave select per request and its
+ *          DMA transfers cannot be chained across a slave-select change, so
+ *          the chain is continued by the completion callback instead of the
+ *          DMA engine. The gap between two sensors is one IRQ entry.
+ */
+
+/***** Includes *****/
+#include <string.h>
+
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "spi.h"
+
+#include "completion.h"
+#include "sensor_poll.h"
+
+/***** Globals *****/
+static max31723_t *poll_sensors[POLL_MAX_SENSORS];
+static int poll_table_len;
+static mxc_spi_req_t poll_req[POLL_MAX_SENSORS];
+static uint8_t poll_tx[POLL_LEN];
+static uint8_t poll_rx[POLL_MAX_SENSORS][POLL_LEN];
+static int poll_status[POLL_MAX_SENSORS];
+static volatile int poll_count; // sensors in the running round
+static volatile bool in_flight;
+static volatile int round_status; // first error of the running round
+static completion_t round_done;
+static poll_stats_t poll_stats;
+
+/***** Functions *****/
+static int poll_transfer(int idx)
+{
+    poll_req[idx].txCnt = 0;
+    poll_req[idx].rxCnt = 0;
+
+    max31723_select(poll_sensors[idx], true);
+
+#if defined(MASTERSYNC)
+    int retVal = MXC_SPI_MasterTransaction(&poll_req[idx]);
+    max31723_select(poll_sensors[idx], false);
+    return retVal;
+#elif defined(MASTERDMA)
+    return MXC_SPI_MasterTransactionDMA(&poll_req[idx]);
+#else
+    return MXC_SPI_MasterTransactionAsync(&poll_req[idx]);
+#endif
+}
+
+// records the read of sensor idx
+static void poll_finish(int idx, int error)
+{
+    poll_status[idx] = error;
+    if (error != E_NO_ERROR) {
+        poll_stats.errors++;
+        if (round_status == E_NO_ERROR) {
+            round_status = error;
+        }
+    } else {
+        poll_stats.reads++;
+    }
+}
+
+static void poll_end_round(void)
+{
+    poll_stats.rounds++;
+    in_flight = false;
+    complete(&round_done, round_status);
+}
+
+#if !defined(MASTERSYNC)
+// starts the reads from idx on; a read that cannot start ends the round
+static void poll_kick(int idx)
+{
+    int retVal;
+
+    for (; idx < poll_count; idx++) {
+        retVal = poll_transfer(idx);
+        if (retVal == E_NO_ERROR) {
+            return;
+        }
+        max31723_select(poll_sensors[idx], false);
+        poll_finish(idx, retVal);
+    }
+    poll_end_round();
+}
+
+static void poll_callback(mxc_spi_req_t *req, int error)
+{
+    int idx = req - poll_req;
+
+    max31723_select(poll_sensors[idx], false);
+    poll_finish(idx, error);
+
+    // next sensor straight from the IRQ, main() only sees the whole round
+    poll_kick(idx + 1);
+}
+#endif
+
+int poll_init(max31723_t *const sensors[], int count)
+{
+    if (count < 1 || count > POLL_MAX_SENSORS) {
+        return E_BAD_PARAM;
+    }
+
+    memset(poll_tx, 0x00, sizeof(poll_tx));
+    memset(poll_rx, 0x00, sizeof(poll_rx));
+    memset(&poll_stats, 0x00, sizeof(poll_stats));
+    poll_tx[0] = POLL_START_ADDR;
+
+    poll_table_len = count;
+    poll_count = 0;
+    in_flight = false;
+    round_status = E_NO_ERROR;
+    init_completion(&round_done);
+
+    for (int i = 0; i < count; i++) {
+        poll_sensors[i] = sensors[i];
+        poll_status[i] = E_NO_DEVICE;
+
+        poll_req[i].spi = sensors[i]->spi;
+        poll_req[i].txData = poll_tx;
+        poll_req[i].rxData = poll_rx[i];
+        poll_req[i].txLen = POLL_LEN;
+        poll_req[i].rxLen = POLL_LEN;
+        poll_req[i].ssIdx = sensors[i]->ss_idx;
+        poll_req[i].ssDeassert = 1;
+        poll_req[i].txCnt = 0;
+        poll_req[i].rxCnt = 0;
+#if defined(MASTERSYNC)
+        poll_req[i].completeCB = NULL;
+#else
+        poll_req[i].completeCB = (spi_complete_cb_t)poll_callback;
+#endif
+    }
+
+    return E_NO_ERROR;
+}
+
+int poll_start(int count)
+{
+    if (count < 1 || count > poll_table_len) {
+        return E_BAD_PARAM;
+    }
+    if (in_flight) {
+        return E_BUSY;
+    }
+
+    poll_count = count;
+    round_status = E_NO_ERROR;
+    in_flight = true;
+    reinit_completion(&round_done);
+
+#if defined(MASTERSYNC)
+    for (int i = 0; i < count; i++) {
+        poll_finish(i, poll_transfer(i));
+    }
+    poll_end_round();
+#else
+    uint32_t primask = __get_PRIMASK();
+
+    // the first completion IRQ must not run before the chain is set up
+    __disable_irq();
+    poll_kick(0);
+    __set_PRIMASK(primask);
+#endif
+
+    return E_NO_ERROR;
+}
+
+bool poll_busy(void)
+{
+    return in_flight;
+}
+
+int poll_wait(void)
+{
+    return wait_for_completion(&round_done);
+}
+
+int poll_read(int count)
+{
+    int retVal = poll_start(count);
+
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+    return poll_wait();
+}
+
+int poll_get(int idx, temp_q8_t *temp)
+{
+    if (idx < 0 || idx >= poll_table_len) {
+        return E_BAD_PARAM;
+    }
+    if (poll_status[idx] == E_NO_ERROR) {
+        // rx[0] is clocked in while the address is sent
+        *temp = temp_q8_from_regs(poll_rx[idx][2], poll_rx[idx][1]);
+    }
+    return poll_status[idx];
+}
+
+const poll_stats_t *poll_get_stats(void)
+{
+    return &poll_stats;
+}
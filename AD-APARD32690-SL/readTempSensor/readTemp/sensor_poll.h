@@ -0,0 +1,72 @@
+/**
+ * @file    sensor_poll.h
+ * @brief   Round-robin polling of several MAX31723s on one SPI port
+ * @details A round reads the temperature of the first count sensors of the
+ *          table, one burst read (address 01h, LSB, MSB) per sensor, in table
+ *          order. With MASTERASYNC and MASTERDMA the completion IRQ of one read
+ *          starts the next, so the reads run back to back without main()
+ *          between them and the caller wakes up once per round instead of
+ *          once per sensor. MASTERSYNC reads the table in a loop.
+ *
+ *          The sensors may sit on the hardware slave selects or on GPIO chip
+ *          enables (see max31723.h); the poller drives the GPIOs around each
+ *          read.
+ */
+
+#ifndef SENSOR_POLL_H_
+#define SENSOR_POLL_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "max31723.h"
+#include "temp_q8.h"
+
+/***** Definitions *****/
+#define POLL_MAX_SENSORS 8
+#define POLL_START_ADDR MAX31723_REG_TEMP_LSB // temperature LSB, then MSB
+#define POLL_LEN 3 // address + LSB + MSB
+
+typedef struct {
+    uint32_t rounds; // rounds finished
+    uint32_t reads; // sensor reads finished
+    uint32_t errors; // reads that failed
+} poll_stats_t;
+
+/***** Functions *****/
+/*
+ * Prepares one request per sensor. The SPI port must already be initialized
+ * for every slave select in the table; the driver's blocking calls must not
+ * be used while a round runs.
+ */
+int poll_init(max31723_t *const sensors[], int count);
+
+/*
+ * Starts a round over the first count sensors. MASTERSYNC runs the whole
+ * round before returning; otherwise it runs from the completion IRQs.
+ * Returns E_BUSY while the previous round runs.
+ */
+int poll_start(int count);
+
+bool poll_busy(void);
+
+/*
+ * Sleeps until the round finishes. Returns the first error of the round.
+ */
+int poll_wait(void);
+
+/*
+ * poll_start() and poll_wait().
+ */
+int poll_read(int count);
+
+/*
+ * Temperature read from sensor idx in the last round, or the error of its
+ * read.
+ */
+int poll_get(int idx, temp_q8_t *temp);
+
+const poll_stats_t *poll_get_stats(void);
+
+#endif // SENSOR_POLL_H_
@@ -0,0 +1,157 @@
+/**
+ * @file    temp_acq.c
+ * @brief   DMA-backed MAX31723 acquisition engine
+ */
+
+/***** Includes *****/
+#include <string.h>
+
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "spi.h"
+#include "completion.h"
+#include "temp_acq.h"
+
+/***** Globals *****/
+static mxc_spi_req_t acq_req;
+static uint8_t acq_tx[ACQ_LEN];
+static uint8_t acq_rx[2][ACQ_LEN]; // ping-pong buffer, one half per transaction
+static volatile int fill_idx; // half the running (or next) transaction writes into
+static volatile bool in_flight;
+static volatile uint8_t active_source; // source of the running transaction
+static volatile uint8_t pending_source; // sources queued while a transaction runs
+static sample_ring_t *acq_ring;
+static acq_stats_t acq_stats;
+static completion_t acq_idle; // completed whenever the engine goes idle
+
+/***** Functions *****/
+// must be called with interrupts masked or from the completion IRQ
+static int acq_kick(uint8_t source)
+{
+    int retVal;
+
+    acq_req.rxData = acq_rx[fill_idx];
+    acq_req.txCnt = 0;
+    acq_req.rxCnt = 0;
+    active_source = source;
+    in_flight = true;
+
+    retVal = MXC_SPI_MasterTransactionDMA(&acq_req);
+    if (retVal != E_NO_ERROR) {
+        in_flight = false;
+        acq_stats.errors++;
+        return retVal;
+    }
+
+    acq_stats.started++;
+    return E_NO_ERROR;
+}
+
+static void acq_callback(mxc_spi_req_t *req, int error)
+{
+    const uint8_t *done = acq_rx[fill_idx];
+    sample_t sample;
+
+    sample.trigger_source = active_source;
+
+    // the next transaction fills the other half while this one is read
+    fill_idx ^= 1;
+    in_flight = false;
+
+    if (pending_source != 0) {
+        uint8_t next = pending_source;
+        pending_source = 0;
+        acq_kick(next);
+    }
+    if (!in_flight) {
+        complete(&acq_idle, E_NO_ERROR);
+    }
+
+    if (error != E_NO_ERROR) {
+        acq_stats.errors++;
+        return;
+    }
+
+    // done[0] is clocked in while the address is sent
+    sample.raw_temp = ((uint16_t)done[2] << 8) | done[1];
+    sample_mark(&sample); // main() stamps it, no RTC read here
+
+    if (sample_ring_push(acq_ring, &sample)) {
+        acq_stats.completed++;
+    }
+}
+
+void acq_init(const max31723_t *sensor, sample_ring_t *ring)
+{
+    memset(acq_tx, 0x00, sizeof(acq_tx));
+    memset(acq_rx, 0x00, sizeof(acq_rx));
+    memset(&acq_stats, 0x00, sizeof(acq_stats));
+    acq_tx[0] = ACQ_START_ADDR;
+
+    acq_ring = ring;
+    init_completion(&acq_idle);
+    fill_idx = 0;
+    in_flight = false;
+    active_source = 0;
+    pending_source = 0;
+
+    acq_req.spi = sensor->spi;
+    acq_req.txData = acq_tx;
+    acq_req.rxData = acq_rx[0];
+    acq_req.txLen = ACQ_LEN;
+    acq_req.rxLen = ACQ_LEN;
+    acq_req.ssIdx = sensor->ss_idx;
+    acq_req.ssDeassert = 1;
+    acq_req.txCnt = 0;
+    acq_req.rxCnt = 0;
+    acq_req.completeCB = (spi_complete_cb_t)acq_callback;
+}
+
+int acq_start(uint8_t source)
+{
+    int retVal = E_NO_ERROR;
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    if (in_flight) {
+        if (pending_source != 0) {
+            acq_stats.merged++;
+        }
+        pending_source |= source;
+    } else {
+        retVal = acq_kick(source);
+    }
+
+    __set_PRIMASK(primask);
+    return retVal;
+}
+
+bool acq_busy(void)
+{
+    return in_flight || (pending_source != 0);
+}
+
+int acq_wait_idle(uint32_t timeout_us)
+{
+    uint32_t primask = __get_PRIMASK();
+    bool busy;
+
+    // re-armed while the callback cannot run, so the idle completion is not missed
+    __disable_irq();
+    busy = acq_busy();
+    if (busy) {
+        reinit_completion(&acq_idle);
+    }
+    __set_PRIMASK(primask);
+
+    if (!busy) {
+        return E_NO_ERROR;
+    }
+    return wait_for_completion_timeout(&acq_idle, timeout_us);
+}
+
+const acq_stats_t *acq_get_stats(void)
+{
+    return &acq_stats;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file    temp_acq.h
+ * @brief   DMA-backed MAX31723 acquisition engine
+ * @details Each acquisition is one burst read (address 01h, LSB, MSB) moved by
+ *          DMA into one half of a ping-pong buffer. The completion callback
+ *          flips the buffers, converts the finished half into a sample_t
+ *          marked with the cycle counter (stamped with the RTC time when
+ *          main() drains it) and publishes it into a sample ring, so main()
+ *          never waits on the bus and the handler never waits on the RTC.
+ */
+
+#ifndef TEMP_ACQ_H_
+#define TEMP_ACQ_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "max31723.h"
+#include "sample_ring.h"
+
+/***** Definitions *****/
+#define ACQ_START_ADDR MAX31723_REG_TEMP_LSB // temperature LSB, then MSB
+#define ACQ_LEN 3 // address + LSB + MSB
+
+typedef struct {
+    uint32_t started; // DMA transactions started
+    uint32_t completed; // samples accepted by the ring
+    uint32_t merged; // triggers merged into a transaction already queued
+    uint32_t errors; // transactions that completed with an error
+} acq_stats_t;
+
+/***** Functions *****/
+/*
+ * Prepares the DMA request for sensor. Finished samples are pushed into ring.
+ * The SPI port must already be initialized with max31723_port_init(); the
+ * driver's blocking calls must not be used while acquisitions run.
+ */
+void acq_init(const max31723_t *sensor, sample_ring_t *ring);
+
+/*
+ * Requests one sample on behalf of source (TRIGGER_* bits).
+ * If a transaction is in flight, the request is queued and started from the
+ * completion IRQ; requests arriving meanwhile are merged into that one.
+ * Safe to call from main() or from an ISR.
+ */
+int acq_start(uint8_t source);
+
+bool acq_busy(void);
+
+/*
+ * Sleeps until no transaction is running or queued, for the driver's blocking
+ * calls, which must not overlap an acquisition. Call it from main(); triggers
+ * from the handlers in the meantime extend the wait. Returns E_TIME_OUT when
+ * the engine is still busy after timeout_us (a transfer that never completed),
+ * E_NO_ERROR otherwise: errors are counted in the statistics, like those of
+ * any acquisition. Needs completion_timer_init().
+ */
+int acq_wait_idle(uint32_t timeout_us);
+
+const acq_stats_t *acq_get_stats(void);
+
+#endif // TEMP_ACQ_H_
@@ -0,0 +1,13 @@
+/**
+ * @file    tlog_msgs.c
+ * @brief   Format strings of readTemp's tokenized log messages
+ * @details Referenced only where a message is formatted: by TLOG() without
+ *          TOKENIZED_LOG, by the TLOG_BENCH comparison and by host/tlm_decode.
+ *          A TOKENIZED_LOG build leaves them out of the image.
+ */
+
+/***** Includes *****/
+#include "tlog_msgs.h"
+
+/***** Globals *****/
+const char *const tlog_formats[] = { TLOG_MESSAGES(TLOG_FORMAT) };
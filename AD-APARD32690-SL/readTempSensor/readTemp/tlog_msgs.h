@@ -0,0 +1,56 @@
+/**
+ * @file    tlog_msgs.h
+ * @brief   readTemp's tokenized log messages (TLOG(), see tlog.h)
+ * @details One entry per message: its id, level, module and format. The
+ *          debug-level dumps are compiled out of release builds (see tlog.h,
+ *          TLOG_LEVEL and TLOG_MODULES in project.mk). The firmware only
+ *          needs the ids; the strings are defined in tlog_msgs.c, which
+ *          host/tlm_decode links too. New messages go at the end, so that a
+ *          decoder built from an older table still reads the messages it knows.
+ */
+
+#ifndef TLOG_MSGS_H_
+#define TLOG_MSGS_H_
+
+/***** Includes *****/
+#include "tlog.h"
+
+/***** Definitions *****/
+// RTC time split into day, hour, minute and the ticks within the minute
+#define TLOG_TIME_FMT "\nCurrent Time (dd:hh:mm:ss): %02u:%02u:%02u:%05.2t\n"
+// readings with TEMP_DECIMALS decimals
+#define TLOG_SAMPLE_FMT(source) "\n\n" source TLOG_TIME_FMT "Final Temperature: %.4q\n"
+#define TLOG_RATE_FMT(mode) mode ": %u-bit, %u ms period (%u.%03u Hz), %u resolution changes\n"
+
+// modules, for TLOG_MODULES
+#define TLOG_MOD_TIME (1u << 0) // RTC time prints
+#define TLOG_MOD_SAMPLE (1u << 1) // samples and averages
+#define TLOG_MOD_SENSOR (1u << 2) // configuration and temperature register dumps
+#define TLOG_MOD_RATE (1u << 3) // sampling rate changes
+
+#define TLOG_MESSAGES(X)                                                                      \
+    X(TLOG_TIME, TLOG_LEVEL_INFO, TLOG_MOD_TIME, TLOG_TIME_FMT)                               \
+    X(TLOG_SAMPLE_SW2, TLOG_LEVEL_INFO, TLOG_MOD_SAMPLE, TLOG_SAMPLE_FMT("SW2:"))             \
+    X(TLOG_SAMPLE_SW2_RTC, TLOG_LEVEL_INFO, TLOG_MOD_SAMPLE, TLOG_SAMPLE_FMT("SW2: (+RTC)"))  \
+    X(TLOG_SAMPLE_RTC, TLOG_LEVEL_INFO, TLOG_MOD_SAMPLE, TLOG_SAMPLE_FMT("RTC: "))            \
+    X(TLOG_SAMPLE_RTC_SW2, TLOG_LEVEL_INFO, TLOG_MOD_SAMPLE, TLOG_SAMPLE_FMT("RTC: (+SW2) ")) \
+    X(TLOG_AVERAGE_TEMP, TLOG_LEVEL_INFO, TLOG_MOD_SAMPLE, "Average Temperature: %.4q\n")     \
+    X(TLOG_SENSOR_TEMP, TLOG_LEVEL_INFO, TLOG_MOD_SAMPLE, "Sensor %d: %.4q\n")                \
+    X(TLOG_TEMP_REGS, TLOG_LEVEL_DEBUG, TLOG_MOD_SENSOR,                                      \
+      "\n\nReading Temperature (burst from 0x%02X)...\n"                                      \
+      "Temperature MSB: %b\nTemperature MSB: %u \n"                                           \
+      "Temperature LSB: %b\nTemperature LSB: %u \n"                                           \
+      "Temp_Fraction: %.4q\n\nFinal Temperature: %.4q\n")                                     \
+    X(TLOG_CONFIG_READ, TLOG_LEVEL_DEBUG, TLOG_MOD_SENSOR,                                    \
+      "\nReading Configuration Register...\nConfiguration Register: %b\n")                    \
+    X(TLOG_CONFIG_WRITE, TLOG_LEVEL_DEBUG, TLOG_MOD_SENSOR,                                   \
+      "\nWriting Configuration Register...\nConfiguration Register Value Sent: %b\n")         \
+    X(TLOG_RATE_NORMAL, TLOG_LEVEL_INFO, TLOG_MOD_RATE, TLOG_RATE_FMT("Normal mode"))         \
+    X(TLOG_RATE_TRENDING, TLOG_LEVEL_INFO, TLOG_MOD_RATE, TLOG_RATE_FMT("Trending mode"))
+
+typedef enum { TLOG_MESSAGES(TLOG_ID) TLOG_COUNT } tlog_id_t;
+
+// messages compiled in at this TLOG_LEVEL and TLOG_MODULES, one bit each
+#define TLOG_ENABLED_IDS (0 TLOG_MESSAGES(TLOG_FILTER))
+
+#endif // TLOG_MSGS_H_
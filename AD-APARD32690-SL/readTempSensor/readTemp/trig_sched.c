@@ -0,0 +1,182 @@
+/**
+ * @file    trig_sched.c
+ * @brief   Arbitration between the sample triggers (SW2, RTC)
+ */
+
+/***** Includes *****/
+#include <string.h>
+
+#include "mxc_errors.h"
+#include "trig_sched.h"
+
+/***** Definitions *****/
+#define TRIG_SCHED_MS_TO_TICKS(ms) \
+    ((((ms) * TRIG_SCHED_TICKS_PER_SEC) + 999) / 1000) // rounded up
+
+typedef struct {
+    uint8_t priority;
+    uint32_t coalesce; // ticks
+    uint32_t deadline; // ticks
+    bool pending;
+    uint32_t release; // earliest release among the merged pending triggers
+    bool served; // last_sample served this source
+    trig_stats_t stats;
+} trig_source_t;
+
+/***** Globals *****/
+static trig_source_t sources[TRIG_SCHED_SOURCES];
+static uint32_t last_sample; // dispatch time of the last sample
+
+/***** Functions *****/
+// index of a single TRIGGER_* bit, -1 if it is none
+static int source_idx(uint8_t source)
+{
+    for (int i = 0; i < TRIG_SCHED_SOURCES; i++) {
+        if (source == (1 << i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void trig_sched_init(void)
+{
+    memset(sources, 0x00, sizeof(sources));
+    last_sample = 0;
+}
+
+int trig_sched_config(uint8_t source, uint8_t priority, uint32_t coalesce_ms,
+                      uint32_t deadline_ms)
+{
+    int idx = source_idx(source);
+
+    if (idx < 0) {
+        return E_BAD_PARAM;
+    }
+
+    sources[idx].priority = priority;
+    sources[idx].coalesce = TRIG_SCHED_MS_TO_TICKS(coalesce_ms);
+    sources[idx].deadline = TRIG_SCHED_MS_TO_TICKS(deadline_ms);
+
+    return E_NO_ERROR;
+}
+
+void trig_sched_release(uint8_t source, uint32_t ticks)
+{
+    int idx = source_idx(source);
+    trig_source_t *src;
+
+    if (idx < 0) {
+        return;
+    }
+
+    src = &sources[idx];
+    src->stats.released++;
+
+    if (src->pending) {
+        // keep the earliest release, the deadline runs from it
+        src->stats.coalesced++;
+        if ((int32_t)(ticks - src->release) < 0) {
+            src->release = ticks;
+        }
+        return;
+    }
+
+    // released before, or shortly after, a sample that already served it
+    if (src->served && (int32_t)(ticks - last_sample) <= (int32_t)src->coalesce) {
+        src->stats.coalesced++;
+        return;
+    }
+
+    src->pending = true;
+    src->release = ticks;
+}
+
+bool trig_sched_pending(void)
+{
+    for (int i = 0; i < TRIG_SCHED_SOURCES; i++) {
+        if (sources[i].pending) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t trig_sched_primary(uint8_t bits)
+{
+    int best = -1;
+
+    for (int i = 0; i < TRIG_SCHED_SOURCES; i++) {
+        if ((bits & (1 << i)) && (best < 0 || sources[i].priority > sources[best].priority)) {
+            best = i;
+        }
+    }
+
+    return (best < 0) ? 0 : (uint8_t)(1 << best);
+}
+
+uint8_t trig_sched_next(uint32_t now)
+{
+    uint8_t bits = 0;
+    int first = -1;
+
+    for (int i = 0; i < TRIG_SCHED_SOURCES; i++) {
+        trig_source_t *src = &sources[i];
+
+        if (!src->pending) {
+            continue;
+        }
+        if (first < 0 || src->priority > sources[first].priority ||
+            (src->priority == sources[first].priority &&
+             (int32_t)(src->release - sources[first].release) < 0)) {
+            first = i;
+        }
+        bits |= 1 << i;
+    }
+
+    if (bits == 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < TRIG_SCHED_SOURCES; i++) {
+        trig_source_t *src = &sources[i];
+        uint32_t latency;
+
+        src->served = (bits & (1 << i)) != 0;
+        if (!src->served) {
+            continue;
+        }
+
+        // the others share the sample of the first one
+        if (i != first) {
+            src->stats.coalesced++;
+        }
+
+        src->pending = false;
+        src->stats.samples++;
+
+        latency = ((int32_t)(now - src->release) > 0) ? now - src->release : 0;
+        src->stats.latency_total += latency;
+        if (latency > src->stats.latency_max) {
+            src->stats.latency_max = latency;
+        }
+        if (latency > src->deadline) {
+            src->stats.missed++;
+        }
+    }
+
+    last_sample = now;
+    return bits;
+}
+
+void trig_sched_get_stats(uint8_t source, trig_stats_t *stats)
+{
+    int idx = source_idx(source);
+
+    if (idx < 0) {
+        memset(stats, 0x00, sizeof(*stats));
+        return;
+    }
+
+    *stats = sources[idx].stats;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file    trig_sched.h
+ * @brief   Arbitration between the sample triggers (SW2, RTC)
+ * @details The interrupt handlers stamp each trigger with its release time:
+ *          the nominal alarm time for the periodic RTC triggers, the debounced
+ *          edge for SW2. The dispatcher in main() hands the triggers to the
+ *          scheduler, which decides which sample to take next:
+ *
+ *          - the pending source with the highest priority goes first (ties:
+ *            earliest release), so a user read is served before the periodic
+ *            one-shot conversion is started and before any printing;
+ *          - every other pending trigger rides along in the same sample, since
+ *            one read of the sensor serves them all;
+ *          - a trigger released while one of the same source is still
+ *            pending, or within the source's coalescing window after a sample
+ *            that served it, is merged instead of taking another sample;
+ *          - a trigger dispatched later than its deadline after its release
+ *            counts as missed.
+ *
+ *          Periodic triggers keep their nominal release time, so a user read
+ *          neither delays nor shifts the periodic grid; the lateness against
+ *          it is what the deadline checks. Called from main() only.
+ */
+
+#ifndef TRIG_SCHED_H_
+#define TRIG_SCHED_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sample_ring.h"
+
+/***** Definitions *****/
+// trigger sources, bit n of the TRIGGER_* masks in sample_ring.h
+#define TRIG_SCHED_SOURCES 2
+
+#define TRIG_SCHED_TICKS_PER_SEC 4096 // RTC sub-second resolution
+
+typedef struct {
+    uint32_t released; // triggers received
+    uint32_t coalesced; // merged into a pending trigger or a recent sample
+    uint32_t samples; // samples taken with this source, alone or shared
+    uint32_t missed; // dispatched after the deadline
+    uint32_t latency_max; // release to dispatch, RTC ticks
+    uint64_t latency_total;
+} trig_stats_t;
+
+/***** Functions *****/
+void trig_sched_init(void);
+
+/*
+ * Sets the priority (higher first), coalescing window and deadline of one
+ * TRIGGER_* source. A zero window only merges triggers that are pending
+ * together.
+ */
+int trig_sched_config(uint8_t source, uint8_t priority, uint32_t coalesce_ms,
+                      uint32_t deadline_ms);
+
+/*
+ * Hands over a trigger of one TRIGGER_* source released at ticks (RTC time).
+ */
+void trig_sched_release(uint8_t source, uint32_t ticks);
+
+/*
+ * True when a trigger waits for a sample.
+ */
+bool trig_sched_pending(void);
+
+/*
+ * Picks the sample to take at now (RTC ticks): returns the TRIGGER_* bits it
+ * serves, 0 when nothing is pending.
+ */
+uint8_t trig_sched_next(uint32_t now);
+
+/*
+ * The source that caused the sample among the bits returned by
+ * trig_sched_next(): the one with the highest priority.
+ */
+uint8_t trig_sched_primary(uint8_t sources);
+
+void trig_sched_get_stats(uint8_t source, trig_stats_t *stats);
+
+#endif // TRIG_SCHED_H_
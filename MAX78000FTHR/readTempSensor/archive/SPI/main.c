@@ -40,6 +40,8 @@
 #include "spi.h"
 #include "uart.h"
 
+#include "completion.h"
+
 /***** Preprocessors *****/
 #define MASTERSYNC 1
 #define MASTERASYNC 0
@@ -71,8 +73,8 @@
 /***** Globals *****/
 uint16_t rx_data[DATA_LEN];
 uint16_t tx_data[DATA_LEN];
-volatile int SPI_FLAG;
-volatile uint8_t DMA_FLAG = 0;
+completion_t spi_done; // completed by SPI_Callback
+completion_t dma_done; // completed when the RX DMA channel finishes
 
 /***** Functions *****/
 void SPI_IRQHandler(void)
@@ -88,12 +90,12 @@ void DMA0_IRQHandler(void)
 void DMA1_IRQHandler(void)
 {
     MXC_DMA_Handler();
-    DMA_FLAG = 1;
+    complete(&dma_done, E_NO_ERROR);
 }
 
 void SPI_Callback(mxc_spi_req_t *req, int error)
 {
-    SPI_FLAG = error;
+    complete(&spi_done, error);
 }
 
 int main(void)
@@ -134,6 +136,9 @@ int main(void)
     printf("Performing transactions with DMA...\n");
 #endif
 
+    init_completion(&spi_done);
+    init_completion(&dma_done);
+
     for (i = 16; i < 17; i++) {
         // Sending out 2 to 16 bits
 
@@ -167,7 +172,7 @@ int main(void)
         req.txCnt = 0;
         req.rxCnt = 0;
         req.completeCB = (spi_complete_cb_t)SPI_Callback;
-        SPI_FLAG = 1;
+        reinit_completion(&spi_done);
 
         retVal = MXC_SPI_SetDataSize(SPI, i);
 
@@ -191,7 +196,7 @@ int main(void)
         NVIC_EnableIRQ(SPI_IRQ);
         MXC_SPI_MasterTransactionAsync(&req);
 
-        while (SPI_FLAG == 1) {}
+        wait_for_completion(&spi_done);
 
 #endif
 
@@ -201,11 +206,10 @@ int main(void)
 
         NVIC_EnableIRQ(DMA0_IRQn);
         NVIC_EnableIRQ(DMA1_IRQn);
+        reinit_completion(&dma_done);
         MXC_SPI_MasterTransactionDMA(&req);
 
-        while (DMA_FLAG == 0) {}
-
-        DMA_FLAG = 0;
+        wait_for_completion(&dma_done);
 #endif
 
         uint8_t bits = MXC_SPI_GetDataSize(SPI);
@@ -30,3 +30,7 @@
 
 # Add your config here!
 DEBUG=1
+
+# shared modules (completion, ...)
+VPATH += ../../../../common
+IPATH += ../../../../common
@@ -23,26 +23,30 @@
 #include "pb.h"
 #include "gpio.h"
 
+#include "irq_time.h"
+#include "max31723.h"
+#include "temp_q8.h"
+#include "work_queue.h"
+
 
 /***** Preprocessors *****/
-#define MASTERSYNC 1
+// the transaction method (MASTERSYNC, MASTERASYNC or MASTERDMA) can be set in
+// project.mk with METHOD; max31723.h falls back to MASTERSYNC on this board.
+// The SW2 ISR only posts work, so every method can be used.
 
 /***** Definitions *****/
-#define DATA_LEN 2 
-// frequency = 100 kHz
+// frequency = 100 kHz, the safe start; raised at startup to the fastest clock
+// the link carries (max31723_characterize())
 #define SPI_SPEED 100000
 
-#define SPI_INSTANCE_NUM 1
-#define SPI MXC_SPI0
-
-// MUST modify spi_pins.ss1 so the board uses chip select 1
-#define SS_IDX 1 
-
 /***** Temperature Sensor *****/
 // max conversion time is 200ms
 // resolution for the temperature reading (9 - 12 bits)
 #define TEMP_RES 12 
 
+// decimals printed for a reading, 4 is exact for 12-bit resolution
+#define TEMP_DECIMALS 4
+
 // (P1.7, SW2)
 #define IN_INTERRUPT_PORT MXC_GPIO1 
 #define IN_INTERRUPT_PIN MXC_GPIO_PIN_7
@@ -52,35 +56,50 @@
 
 
 /***** Globals *****/
-uint8_t rx_data[DATA_LEN];
-uint8_t tx_data[DATA_LEN];
-volatile int SPI_FLAG;
-volatile uint8_t DMA_FLAG = 0;
-mxc_spi_req_t req;
+max31723_t sensor; // MAX31723 on SPI0, slave select 1 (P0.11)
+work_queue_t work_queue; // work posted by the interrupt handlers, run by main()
 
-uint8_t temp_MSB; // most significant byte of temperature reading
-uint8_t temp_LSB; // least significant byte of temperature reading
+#ifdef IRQ_TIME_STATS
+irq_time_t gpio_irq_time;
+#endif
 
 /***** Functions *****/
-void SPI_IRQHandler(void)
+void printBits(const char *label, uint8_t value)
 {
-    MXC_SPI_AsyncHandler(SPI);
+    printf("%s", label);
+    for (int i = 7; i >= 0; i--) {
+        printf("%d", (value >> i) & 1);
+        if (i == 4) {
+            printf(" ");
+        }
+    }
 }
 
-void DMA0_IRQHandler(void)
+void printTemp(const char *label, temp_q8_t temp)
 {
-    MXC_DMA_Handler();
-}
+    char str[TEMP_Q8_STR_LEN];
 
-void DMA1_IRQHandler(void)
-{
-    MXC_DMA_Handler();
-    DMA_FLAG = 1;
+    temp_q8_format(str, sizeof(str), temp, TEMP_DECIMALS);
+    printf("%s%s\n", label, str);
 }
 
-void SPI_Callback(mxc_spi_req_t *req, int error)
+/*
+ * Work item posted by the SW2 interrupt: reads and prints one temperature
+ * from main(), where the bus transfer and printf() hold off no interrupt.
+ */
+void readTempWork(void *arg)
 {
-    SPI_FLAG = error;
+    int retVal;
+    temp_q8_t temp;
+
+    // read temp LSB and MSB registers in one burst
+    retVal = max31723_read_temp(&sensor, &temp);
+    if (retVal != E_NO_ERROR) {
+        printf("\nSPI READ ERROR: %d\n", retVal);
+        return;
+    }
+
+    printTemp("\nFinal Temperature: ", temp);
 }
 
 void gpio_isr(void *cbdata)
@@ -88,29 +107,29 @@ void gpio_isr(void *cbdata)
     mxc_gpio_cfg_t *cfg = cbdata;
     MXC_GPIO_OutToggle(cfg->port, cfg->mask);
 
-    // read temp MSB register
-    tx_data[0] = 0x02;
-    tx_data[1] = 0x00;
-    memset(rx_data, 0x00, DATA_LEN * sizeof(uint8_t));
-    MXC_SPI_MasterTransaction(&req);
-    temp_MSB = rx_data[1];
-    
-
-    // read temp LSB register
-    tx_data[0] = 0x01;
-    tx_data[1] = 0x00;
-    memset(rx_data, 0x00, DATA_LEN * sizeof(uint8_t)); 
-    MXC_SPI_MasterTransaction(&req);
-    temp_LSB = rx_data[1];
-
-    double temp_final = temp_MSB + temp_LSB/((float)256.0);
-    printf("\nFinal Temperature: %.4f\n", temp_final);
+    // a full queue drops the press and counts it
+    work_post(&work_queue, readTempWork, NULL);
+}
+
+void gpio_irq_handler(void)
+{
+#ifdef IRQ_TIME_STATS
+    uint32_t start = irq_time_enter();
+#endif
+
+    MXC_GPIO_Handler(MXC_GPIO_GET_IDX(IN_INTERRUPT_PORT));
+
+#ifdef IRQ_TIME_STATS
+    irq_time_exit(&gpio_irq_time, start);
+#endif
 }
 
 int main(void)
 {
     int retVal;
-    mxc_spi_pins_t spi_pins;
+    uint8_t config;
+    temp_q8_t temp;
+    max31723_link_t link;
 
     mxc_gpio_cfg_t gpio_interrupt;
     mxc_gpio_cfg_t gpio_interrupt_status;
@@ -120,35 +139,26 @@ int main(void)
     printf("MAX31723 to MAX78000 when an interrupt is triggered by pressing SW2.\n");
     printf("The interrupt also turns on LED1.\n");
 
-    spi_pins.clock = TRUE;
-    spi_pins.miso = TRUE;
-    spi_pins.mosi = TRUE;
-    spi_pins.sdio2 = FALSE;
-    spi_pins.sdio3 = FALSE;
-    spi_pins.ss0 = FALSE; // slave select pin 0
-    spi_pins.ss1 = TRUE; // P0.11
-    spi_pins.ss2 = FALSE;
-    spi_pins.vddioh = MXC_GPIO_VSSEL_VDDIOH;
-
 #ifdef BOARD_EVKIT_V1
     printf("\nBoard: BOARD_EVKIT_V1\n");
 #else
     printf("\nBoard: MAX78000FTHR\n");
 #endif
 
-#if MASTERSYNC
+#if defined(MASTERSYNC)
     printf("Performing blocking (synchronous) transactions...\n");
+#elif defined(MASTERASYNC)
+    printf("Performing non-blocking (asynchronous) transactions...\n");
+#elif defined(MASTERDMA)
+    printf("Performing DMA transactions...\n");
 #endif
 
-    // initialize the tx buffer with 0x0
-    // initialize the rx buffer with 0x0
-    memset(tx_data, 0x00, DATA_LEN * sizeof(uint8_t));
-    memset(rx_data, 0x00, DATA_LEN * sizeof(uint8_t)); 
+    // the handlers post into the queue as soon as they are enabled
+    work_queue_init(&work_queue);
+#ifdef IRQ_TIME_STATS
+    irq_time_init();
+#endif
 
-    // Setup tx_data to read configuration register
-    tx_data[0] = 0x00; // configuration register address
-    tx_data[1] = 0x00; // dummy byte
-    
     /* Setup interrupt status pin as an output so we can toggle it on each interrupt. */
     gpio_interrupt_status.port = OUT_INTERRUPT_PORT;
     gpio_interrupt_status.mask = OUT_INTERRUPT_PIN;
@@ -173,16 +183,11 @@ int main(void)
     MXC_GPIO_RegisterCallback(&gpio_interrupt, gpio_isr, &gpio_interrupt_status);
     MXC_GPIO_IntConfig(&gpio_interrupt, MXC_GPIO_INT_FALLING);
     MXC_GPIO_EnableInt(gpio_interrupt.port, gpio_interrupt.mask);
+    MXC_NVIC_SetVector(MXC_GPIO_GET_IRQ(MXC_GPIO_GET_IDX(IN_INTERRUPT_PORT)), gpio_irq_handler);
     NVIC_EnableIRQ(MXC_GPIO_GET_IRQ(MXC_GPIO_GET_IDX(IN_INTERRUPT_PORT)));
 
-
-    // Configure the peripheral
-    // initialize the SPI port
-    // master mode
-    // not quad mode
-    // 1 slave
-    // CS of ss1 is active high, 2
-    retVal = MXC_SPI_Init(SPI, 1, 0, 1, 2, SPI_SPEED, spi_pins);
+    // SPI0 in mode 3 with chip select 1 active high, see max31723.h
+    retVal = max31723_port_init(SPI_SPEED);
     if (retVal != E_NO_ERROR) {
         printf("SPI Initialization ERROR\n");
         return retVal;
@@ -190,128 +195,66 @@ int main(void)
 
     printf("SPI Initialization SUCCESS\n");
 
+    max31723_init(&sensor);
 
-    // configure SPI mode
-    // for SPI_MODE_3, CPHA = CPOL = 1
-    retVal = MXC_SPI_SetMode(SPI, SPI_MODE_3);	
-    if (retVal != E_NO_ERROR) {
-        printf("SPI MODE ERROR\n");
-        return retVal;
-    }
-
-    printf("SPI Mode Initialization SUCCESS\n");
+    // Read the configuration register
+    printf("\nReading Configuration Register...\n");
+    max31723_read_config(&sensor, &config);
+    printBits("Configuration Register: ", config);
 
-    //SPI Request
-    req.spi = SPI;
-    req.txData = (uint8_t *)tx_data;
-    req.rxData = (uint8_t *)rx_data;
-    req.txLen = DATA_LEN;
-    req.rxLen = DATA_LEN;
-    req.ssIdx = 1;
-    req.ssDeassert = 1;
-    req.txCnt = 0;
-    req.rxCnt = 0;
-    req.completeCB = (spi_complete_cb_t)SPI_Callback;
-    SPI_FLAG = 1;
+    // write to configuration register
+    // disable 1SHOT, comparator mode, TEMP_RES-bit precision, continuous conversion
+    config = MAX31723_CFG_RES(TEMP_RES);
+    printf("\n\nWriting Configuration Register...\n");
+    max31723_write_config(&sensor, config);
+    printBits("Configuration Register Value Sent: ", config);
 
-    retVal = MXC_SPI_SetDataSize(SPI, 8);
+    // read configuration register
+    printf("\n\nReading Configuration Register...\n");
+    max31723_read_config(&sensor, &config);
+    printBits("Configuration Register: ", config);
 
+    // step the clock up from SPI_SPEED and keep the fastest clean one, with margin
+    retVal = max31723_characterize(&sensor, SPI_SPEED, MAX31723_MAX_HZ, &link);
     if (retVal != E_NO_ERROR) {
-        printf("\nSPI SET DATASIZE ERROR: %d\n", retVal);
+        printf("\nSPI LINK CHARACTERIZATION ERROR: %d\n", retVal);
         return retVal;
     }
+    printf("\n\nSPI link: %u Hz (fastest clean step %u Hz, %u/%u reads bad)", link.hz,
+           link.fastest_ok_hz, (unsigned)link.errors, (unsigned)link.reads);
 
-    retVal = MXC_SPI_SetWidth(SPI, SPI_WIDTH_STANDARD);
-
+    // read temp LSB and MSB registers in one burst
+    printf("\n\nReading Temperature...\n");
+    retVal = max31723_read_temp(&sensor, &temp);
     if (retVal != E_NO_ERROR) {
-        printf("\nSPI SET WIDTH ERROR: %d\n", retVal);
+        printf("\nSPI READ ERROR: %d\n", retVal);
         return retVal;
     }
-    // clear the input buffer
-    MXC_SPI_ClearRXFIFO	(SPI);
-
-
-    // Read the configuration register
-    printf("\nReading Configuration Register...\n");
-    MXC_SPI_MasterTransaction(&req);
-    printf("Configuration Register: ");
-    for (int i = 7; i >= 0; i--) {
-        printf("%d", (rx_data[1] >> i) & 1);
-        if (i == 4) {
-            printf(" ");
-        }
-    }
 
-    // write to configuration register
-    tx_data[0] = 0x80;
-    // config write to EEPROM, EEPROM write in progress, disable 1SHOT, interrupt mode, 12-bit precision, continuous conversion 
-    tx_data[1] = 0b01000110;
-    memset(rx_data, 0x00, DATA_LEN * sizeof(uint8_t)); 
-    printf("\n\nWriting Configuration Register...\n");
-    MXC_SPI_MasterTransaction(&req);
-    printf("Configuration Register Value Sent: ");
-    for (int i = 7; i >= 0; i--) {
-        printf("%d", (tx_data[1] >> i) & 1);
-        if (i == 4) {
-            printf(" ");
-        }
-    }
+    printBits("Temperature MSB: ", (uint8_t)((uint16_t)temp >> 8));
+    printf("\nTemperature MSB: %d ", (uint8_t)((uint16_t)temp >> 8));
+    printBits("\nTemperature LSB: ", (uint8_t)temp);
+    printf("\nTemperature LSB: %d ", (uint8_t)temp);
+    printTemp("\nTemp_Fraction: ", (uint8_t)temp);
 
+    printTemp("\nFinal Temperature: ", temp);
 
-    // read configuration register
-    tx_data[0] = 0x00;
-    tx_data[1] = 0x00;
-    memset(rx_data, 0x00, DATA_LEN * sizeof(uint8_t)); 
-    printf("\n\nReading Configuration Register...\n");
-    MXC_SPI_MasterTransaction(&req);
-    printf("Configuration Register: ");
-    for (int i = 7; i >= 0; i--) {
-        printf("%d", (rx_data[1] >> i) & 1);
-        if (i == 4) {
-            printf(" ");
+    while (1) { // listen to interrupts
+        // work posted by the interrupt handlers
+        if (work_run(&work_queue) != 0) {
+#ifdef IRQ_TIME_STATS
+            irq_time_print("GPIO", &gpio_irq_time);
+#endif
+            continue;
         }
-    }
 
-
-    // read temp MSB register
-    tx_data[0] = 0x02;
-    tx_data[1] = 0x00;
-    memset(rx_data, 0x00, DATA_LEN * sizeof(uint8_t));
-    printf("\n\nReading Temperature MSB...\n");
-    MXC_SPI_MasterTransaction(&req);
-    printf("Temperature MSB: ");
-    for (int i = 7; i >= 0; i--) {
-        printf("%d", (rx_data[1] >> i) & 1);
-        if (i == 4) {
-            printf(" ");
+        // a pending IRQ still wakes WFI while interrupts are masked
+        __disable_irq();
+        if (!work_pending(&work_queue)) {
+            __WFI();
         }
+        __enable_irq();
     }
-    printf("\nTemperature MSB: %d ", rx_data[1]);
-    temp_MSB = rx_data[1];
-    
-
-    // read temp LSB register
-    tx_data[0] = 0x01;
-    tx_data[1] = 0x00;
-    memset(rx_data, 0x00, DATA_LEN * sizeof(uint8_t)); 
-    printf("\n\nReading Temperature LSB...\n");
-    MXC_SPI_MasterTransaction(&req);
-    printf("Temperature LSB: ");
-    for (int i = 7; i >= 0; i--) {
-        printf("%d", (rx_data[1] >> i) & 1);
-        if (i == 4) {
-            printf(" ");
-        }
-    }
-    printf("\nTemperature LSB: %d ", rx_data[1]);
-    temp_LSB = rx_data[1];
-    printf("\nTemp_Fraction: %.4f\n", (double)(temp_LSB/256.0f));
-    
-
-    double temp_final = temp_MSB + temp_LSB/((float)256.0);
-    printf("\nFinal Temperature: %.4f\n", temp_final);
-
-    while(1){ // listen to interrupts}
 
     return 0;
 }
@@ -30,3 +30,14 @@
 
 # Add your config here!
 DEBUG=1
+
+# transaction method: MASTERSYNC (default), MASTERASYNC or MASTERDMA
+# METHOD ?= MASTERSYNC
+# PROJ_CFLAGS += -D$(METHOD)
+
+# shared modules (max31723 driver, ...)
+VPATH += ../../../common
+IPATH += ../../../common
+
+# report the time spent in the SW2 interrupt handler after every reading
+# PROJ_CFLAGS += -DIRQ_TIME_STATS
@@ -0,0 +1,201 @@
+/**
+ * @file    completion.c
+ * @brief   Event-driven wait for transactions that complete in an IRQ
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "nvic_table.h"
+#include "completion.h"
+#include "cycle_counter.h"
+
+/***** Globals *****/
+static mxc_tmr_regs_t *wait_tmr;
+static IRQn_Type wait_irq;
+static uint32_t ticks_per_sec;
+static volatile bool wait_expired; // the running timed wait reached its deadline
+
+/***** Functions *****/
+// sleeps until an event or interrupt, unless the wait is already over
+static inline void completion_sleep(completion_t *c)
+{
+#ifdef COMPLETION_USE_WFI
+    // a masked interrupt that becomes pending still wakes WFI, so checking the
+    // flags with interrupts off closes the race with the completion IRQ
+    __disable_irq();
+    if (!c->done && !wait_expired) {
+        __WFI();
+    }
+    __enable_irq();
+#else
+    // complete() and the deadline handler execute SEV, so an IRQ that lands
+    // between the check and WFE leaves the event register set and WFE
+    // returns immediately
+    if (!c->done && !wait_expired) {
+        __WFE();
+    }
+#endif
+}
+
+static void completion_tmr_isr(void)
+{
+    MXC_TMR_ClearFlags(wait_tmr);
+    wait_expired = true;
+    __DSB();
+    __SEV();
+}
+
+void init_completion(completion_t *c)
+{
+    memset(c, 0x00, sizeof(*c));
+    cycle_counter_enable();
+}
+
+int completion_timer_init(mxc_tmr_regs_t *tmr)
+{
+    mxc_tmr_cfg_t cfg;
+    int retVal;
+
+    wait_tmr = tmr;
+    wait_irq = MXC_TMR_GET_IRQ(MXC_TMR_GET_IDX(tmr));
+    ticks_per_sec = MXC_TMR_GetPeriod(tmr, MXC_TMR_APB_CLK, COMPLETION_TMR_DIV, 1);
+    wait_expired = false;
+
+    MXC_TMR_Shutdown(tmr);
+
+    cfg.pres = COMPLETION_TMR_PRES;
+    cfg.mode = TMR_MODE_ONESHOT;
+    cfg.bitMode = TMR_BIT_MODE_32;
+    cfg.clock = MXC_TMR_APB_CLK;
+    cfg.cmp_cnt = UINT32_MAX; // set for each wait
+    cfg.pol = 0;
+
+    retVal = MXC_TMR_Init(tmr, &cfg, false);
+    if (retVal != E_NO_ERROR) {
+        wait_tmr = NULL;
+        return retVal;
+    }
+
+    MXC_TMR_EnableInt(tmr);
+    MXC_NVIC_SetVector(wait_irq, completion_tmr_isr);
+    NVIC_EnableIRQ(wait_irq);
+
+    return E_NO_ERROR;
+}
+
+void reinit_completion(completion_t *c)
+{
+    c->status = E_NO_ERROR;
+    c->done = 0;
+}
+
+void complete(completion_t *c, int status)
+{
+    c->status = status;
+    c->done = 1;
+    __DSB();
+    __SEV();
+}
+
+#ifdef COMPLETION_STATS
+static void completion_account(completion_t *c, uint32_t wait, uint32_t asleep, uint32_t sleeps)
+{
+    c->stats.transactions++;
+    c->stats.wait_cycles = wait;
+    c->stats.busy_cycles = wait - asleep;
+    c->stats.sleeps = sleeps;
+    c->stats.total_wait_cycles += wait;
+    c->stats.total_busy_cycles += wait - asleep;
+}
+#endif
+
+// sleeps until the completion is done or the timed wait's deadline passed
+static void completion_wait(completion_t *c)
+{
+#ifdef COMPLETION_STATS
+    uint32_t start = cycle_counter_read();
+    uint32_t asleep = 0;
+    uint32_t sleeps = 0;
+
+    while (!c->done && !wait_expired) {
+        uint32_t before = cycle_counter_read();
+        completion_sleep(c);
+        asleep += cycle_counter_read() - before;
+        sleeps++;
+    }
+
+    completion_account(c, cycle_counter_read() - start, asleep, sleeps);
+#else
+    while (!c->done && !wait_expired) {
+        completion_sleep(c);
+    }
+#endif
+}
+
+int wait_for_completion(completion_t *c)
+{
+    completion_wait(c);
+    return c->status;
+}
+
+int wait_for_completion_timeout(completion_t *c, uint32_t timeout_us)
+{
+    uint64_t ticks;
+
+    if (timeout_us == COMPLETION_NO_TIMEOUT) {
+        return wait_for_completion(c);
+    }
+    if (wait_tmr == NULL) {
+        return E_BAD_STATE;
+    }
+
+    // the one-shot counts 1 .. ticks; at about 1 us per tick any timeout_us fits
+    ticks = (uint64_t)timeout_us * ticks_per_sec / 1000000;
+    if (ticks == 0) {
+        ticks = 1;
+    } else if (ticks > UINT32_MAX) {
+        ticks = UINT32_MAX;
+    }
+
+    MXC_TMR_Stop(wait_tmr);
+    MXC_TMR_ClearFlags(wait_tmr);
+    NVIC_ClearPendingIRQ(wait_irq);
+    wait_expired = false;
+    MXC_TMR_SetCount(wait_tmr, 1);
+    MXC_TMR_SetCompare(wait_tmr, (uint32_t)ticks);
+    MXC_TMR_Start(wait_tmr);
+
+    completion_wait(c);
+
+    MXC_TMR_Stop(wait_tmr);
+    MXC_TMR_ClearFlags(wait_tmr);
+    NVIC_ClearPendingIRQ(wait_irq);
+    wait_expired = false;
+
+    return c->done ? c->status : E_TIME_OUT;
+}
+
+#ifdef COMPLETION_STATS
+void completion_print_stats(const char *name, const completion_t *c)
+{
+    const completion_stats_t *s = &c->stats;
+    uint32_t avg_wait = 0;
+    uint32_t avg_busy = 0;
+
+    if (s->transactions != 0) {
+        avg_wait = (uint32_t)(s->total_wait_cycles / s->transactions);
+        avg_busy = (uint32_t)(s->total_busy_cycles / s->transactions);
+    }
+
+    printf("%s: %u transactions, last: %u cycles waited, %u busy, %u idle (%u sleeps)\n", name,
+           (unsigned)s->transactions, (unsigned)s->wait_cycles, (unsigned)s->busy_cycles,
+           (unsigned)(s->wait_cycles - s->busy_cycles), (unsigned)s->sleeps);
+    printf("%s: average: %u cycles waited, %u busy, %u idle\n", name, (unsigned)avg_wait,
+           (unsigned)avg_busy, (unsigned)(avg_wait - avg_busy));
+}
+#endif
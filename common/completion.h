@@ -0,0 +1,87 @@
+/**
+ * @file    completion.h
+ * @brief   Event-driven wait for transactions that complete in an IRQ
+ * @details Replaces the `while (SPI_FLAG == 1) {}` spin loops. The transaction
+ *          callback calls complete(); the waiting code sleeps with WFE (or WFI
+ *          when COMPLETION_USE_WFI is defined) until then.
+ *
+ *          A timed wait sleeps too: a one-shot on the TMR handed to
+ *          completion_timer_init() wakes the core at the deadline.
+ *
+ *          Define COMPLETION_STATS to count, per completion, the cycles spent
+ *          sleeping (idle) versus running the wait loop (busy). The counts come
+ *          from the DWT cycle counter; on parts that gate the core clock while
+ *          sleeping, idle time shows up as the gap between wait and busy cycles.
+ */
+
+#ifndef COMPLETION_H_
+#define COMPLETION_H_
+
+/***** Includes *****/
+#include <stdint.h>
+
+#include "tmr.h"
+
+/***** Definitions *****/
+#define COMPLETION_NO_TIMEOUT 0
+
+// deadline timer resolution: APB clock / 64, about 1 us
+#define COMPLETION_TMR_PRES TMR_PRES_64
+#define COMPLETION_TMR_DIV 64
+
+typedef struct {
+    uint32_t transactions; // waits that returned, timed out or not
+    uint32_t wait_cycles; // cycles from wait entry to return, last transaction
+    uint32_t busy_cycles; // cycles spent awake in the wait loop, last transaction
+    uint32_t sleeps; // WFE/WFI executed, last transaction
+    uint64_t total_wait_cycles;
+    uint64_t total_busy_cycles;
+} completion_stats_t;
+
+typedef struct {
+    volatile uint32_t done;
+    volatile int status;
+#ifdef COMPLETION_STATS
+    completion_stats_t stats;
+#endif
+} completion_t;
+
+/***** Functions *****/
+void init_completion(completion_t *c);
+
+/*
+ * Takes tmr (a 32-bit timer) for the deadlines of the timed waits and
+ * installs its handler. The timer only runs during a timed wait.
+ */
+int completion_timer_init(mxc_tmr_regs_t *tmr);
+
+/*
+ * Re-arms the completion. Call it before starting the transaction, never
+ * after, or a fast completion IRQ can be lost.
+ */
+void reinit_completion(completion_t *c);
+
+/*
+ * Marks the transaction as finished with status and wakes the waiter.
+ * Safe to call from interrupt context.
+ */
+void complete(completion_t *c, int status);
+
+/*
+ * Sleeps until complete() is called and returns the status passed to it.
+ */
+int wait_for_completion(completion_t *c);
+
+/*
+ * Like wait_for_completion(), but gives up after timeout_us microseconds and
+ * returns E_TIME_OUT. COMPLETION_NO_TIMEOUT waits forever. Returns
+ * E_BAD_STATE without completion_timer_init(). One timed wait at a time, from
+ * main().
+ */
+int wait_for_completion_timeout(completion_t *c, uint32_t timeout_us);
+
+#ifdef COMPLETION_STATS
+void completion_print_stats(const char *name, const completion_t *c);
+#endif
+
+#endif // COMPLETION_H_
@@ -0,0 +1,223 @@
+/**
+ * @file    console_tx.c
+ * @brief   Non-blocking console output: TX ring drained by the UART interrupt
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+
+#include "board.h"
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "nvic_table.h"
+
+#include "console_tx.h"
+
+/***** Definitions *****/
+#define CONSOLE_TX_MASK (CONSOLE_TX_SIZE - 1)
+
+#if (CONSOLE_TX_SIZE & CONSOLE_TX_MASK) != 0
+#error "CONSOLE_TX_SIZE must be a power of two"
+#endif
+
+/***** Globals *****/
+static mxc_uart_regs_t *tx_uart;
+static IRQn_Type tx_irq;
+static console_tx_policy_t tx_policy;
+static uint8_t ring[CONSOLE_TX_SIZE];
+// free-running indices, only changed with interrupts masked
+static uint32_t head; // next character to queue
+static uint32_t tail; // next character to send
+static bool int_on; // TX half-empty interrupt enabled
+static console_tx_stats_t tx_stats;
+
+/***** Functions *****/
+// moves queued characters into the UART FIFO; interrupts masked
+static void fill(void)
+{
+    unsigned int room = MXC_UART_GetTXFIFOAvailable(tx_uart);
+
+    while (room > 0 && tail != head) {
+        MXC_UART_WriteCharacterRaw(tx_uart, ring[tail++ & CONSOLE_TX_MASK]);
+        tx_stats.sent++;
+        room--;
+    }
+
+    // the interrupt only runs while characters wait
+    if (tail != head && !int_on) {
+        MXC_UART_EnableInt(tx_uart, MXC_F_UART_INT_EN_TX_HE);
+        int_on = true;
+    } else if (tail == head && int_on) {
+        MXC_UART_DisableInt(tx_uart, MXC_F_UART_INT_EN_TX_HE);
+        int_on = false;
+    }
+}
+
+static void console_tx_isr(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    // writers in higher-priority handlers change head
+    __disable_irq();
+    MXC_UART_ClearFlags(tx_uart, MXC_F_UART_INT_FL_TX_HE);
+    fill();
+    __set_PRIMASK(primask);
+}
+
+int console_tx_init(mxc_uart_regs_t *uart, console_tx_policy_t policy)
+{
+    if (uart == NULL) {
+        return E_NULL_PTR;
+    }
+
+    tx_uart = uart;
+    tx_irq = MXC_UART_GET_IRQ(MXC_UART_GET_IDX(uart));
+    tx_policy = policy;
+    head = 0;
+    tail = 0;
+    int_on = false;
+    tx_stats = (console_tx_stats_t){ 0 };
+
+    MXC_UART_DisableInt(uart, MXC_F_UART_INT_EN_TX_HE);
+    MXC_UART_ClearFlags(uart, MXC_F_UART_INT_FL_TX_HE);
+    MXC_NVIC_SetVector(tx_irq, console_tx_isr);
+    NVIC_EnableIRQ(tx_irq);
+
+    return E_NO_ERROR;
+}
+
+size_t console_tx_write(const uint8_t *buf, size_t len)
+{
+    size_t done = 0;
+    bool waited = false;
+
+    if (tx_uart == NULL) {
+        return 0;
+    }
+
+    while (done < len) {
+        uint32_t primask = __get_PRIMASK();
+        uint32_t room, n;
+
+        __disable_irq();
+
+        room = CONSOLE_TX_SIZE - (head - tail);
+        n = len - done;
+        if (n > CONSOLE_TX_SIZE) {
+            n = CONSOLE_TX_SIZE;
+        }
+
+        if (n > room) {
+            switch (tx_policy) {
+            case CONSOLE_TX_DROP_NEWEST:
+                n = room;
+                if (n == 0) {
+                    tx_stats.dropped += len - done;
+                    __set_PRIMASK(primask);
+                    return done;
+                }
+                break;
+            case CONSOLE_TX_BLOCK:
+                if (room == 0) {
+                    // the handler may be masked out: refill the FIFO here
+                    fill();
+                    __set_PRIMASK(primask);
+                    waited = true;
+                    continue;
+                }
+                n = room;
+                break;
+            case CONSOLE_TX_OVERWRITE_OLDEST:
+                tail += n - room;
+                tx_stats.overwritten += n - room;
+                break;
+            }
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            ring[head++ & CONSOLE_TX_MASK] = buf[done + i];
+        }
+        tx_stats.written += n;
+        if (head - tail > tx_stats.high_water) {
+            tx_stats.high_water = head - tail;
+        }
+
+        // start the FIFO if the interrupt is idle
+        fill();
+        __set_PRIMASK(primask);
+
+        done += n;
+    }
+
+    if (waited) {
+        tx_stats.blocked++;
+    }
+
+    return done;
+}
+
+void console_tx_flush(void)
+{
+    if (tx_uart == NULL) {
+        return;
+    }
+
+    while (head != tail || MXC_UART_GetActive(tx_uart) == E_BUSY) {
+        uint32_t primask = __get_PRIMASK();
+
+        __disable_irq();
+        fill();
+        __set_PRIMASK(primask);
+    }
+}
+
+size_t console_tx_pending(void)
+{
+    return head - tail;
+}
+
+void console_tx_get_stats(console_tx_stats_t *stats)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    *stats = tx_stats;
+    __set_PRIMASK(primask);
+}
+
+#ifdef CONSOLE_TX
+/*
+ * newlib's _write(), redirected here by -Wl,--wrap=_write. Like the MSDK
+ * backend it sends "\r\n" for '\n' and ignores the file (stdout and stderr).
+ * Dropped characters still count as written, so stdio does not retry them.
+ */
+int __wrap__write(int file, char *ptr, int len)
+{
+    int start = 0;
+
+    (void)file;
+
+    if (tx_uart == NULL) {
+        mxc_uart_regs_t *uart = MXC_UART_GET_UART(CONSOLE_UART);
+
+        for (int i = 0; i < len; i++) {
+            if (ptr[i] == '\n') {
+                MXC_UART_WriteCharacter(uart, '\r');
+            }
+            MXC_UART_WriteCharacter(uart, (uint8_t)ptr[i]);
+        }
+        return len;
+    }
+
+    for (int i = 0; i < len; i++) {
+        if (ptr[i] == '\n') {
+            console_tx_write((const uint8_t *)&ptr[start], i - start);
+            console_tx_write((const uint8_t *)"\r\n", 2);
+            start = i + 1;
+        }
+    }
+    console_tx_write((const uint8_t *)&ptr[start], len - start);
+
+    return len;
+}
+#endif
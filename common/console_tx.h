@@ -0,0 +1,81 @@
+/**
+ * @file    console_tx.h
+ * @brief   Non-blocking console output: TX ring drained by the UART interrupt
+ * @details The MSDK's stdio backend writes every character with
+ *          MXC_UART_WriteCharacter(), so printf() returns only once all but
+ *          the last few characters are shifted out. Here the characters go
+ *          into a ring of CONSOLE_TX_SIZE bytes and the UART's TX half-empty
+ *          interrupt refills the hardware FIFO from it, so printf() returns
+ *          as soon as the text is copied.
+ *
+ *          When the ring is full the policy decides:
+ *          - CONSOLE_TX_DROP_NEWEST: the characters that do not fit are lost;
+ *          - CONSOLE_TX_BLOCK: the writer refills the FIFO itself until they
+ *            fit, like the blocking backend (also safe with interrupts masked);
+ *          - CONSOLE_TX_OVERWRITE_OLDEST: the oldest unsent characters make
+ *            room, so the most recent output survives.
+ *
+ *          To route stdio through the ring, build with CONSOLE_TX and link
+ *          with -Wl,--wrap=_write (see project.mk): newlib's _write() calls
+ *          then land in __wrap__write() below, which adds the '\r' before each
+ *          '\n' like the MSDK backend. Until console_tx_init() they are
+ *          written the blocking way.
+ */
+
+#ifndef CONSOLE_TX_H_
+#define CONSOLE_TX_H_
+
+/***** Includes *****/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "uart.h"
+
+/***** Definitions *****/
+// ring size in bytes, must be a power of two
+#ifndef CONSOLE_TX_SIZE
+#define CONSOLE_TX_SIZE 1024
+#endif
+
+typedef enum {
+    CONSOLE_TX_DROP_NEWEST, // a full ring rejects new characters
+    CONSOLE_TX_BLOCK, // a full ring makes the writer wait
+    CONSOLE_TX_OVERWRITE_OLDEST, // a full ring drops its oldest characters
+} console_tx_policy_t;
+
+typedef struct {
+    uint32_t written; // characters accepted into the ring
+    uint32_t sent; // characters moved into the UART FIFO
+    uint32_t dropped; // new characters rejected (DROP_NEWEST)
+    uint32_t overwritten; // queued characters lost (OVERWRITE_OLDEST)
+    uint32_t blocked; // writes that had to wait (BLOCK)
+    uint32_t high_water; // most characters queued at once
+} console_tx_stats_t;
+
+/***** Functions *****/
+/*
+ * Takes over the TX side of uart (already configured, as the console UART is
+ * by the MSDK startup code) and installs its interrupt handler.
+ */
+int console_tx_init(mxc_uart_regs_t *uart, console_tx_policy_t policy);
+
+/*
+ * Queues len raw bytes. Returns how many were accepted; only DROP_NEWEST
+ * accepts fewer than len. Callable from handlers.
+ */
+size_t console_tx_write(const uint8_t *buf, size_t len);
+
+/*
+ * Waits until the ring and the UART FIFO are empty (before a reset or deep
+ * sleep, for instance).
+ */
+void console_tx_flush(void);
+
+/*
+ * Characters waiting in the ring, not counting the UART FIFO.
+ */
+size_t console_tx_pending(void);
+
+void console_tx_get_stats(console_tx_stats_t *stats);
+
+#endif // CONSOLE_TX_H_
@@ -0,0 +1,34 @@
+/**
+ * @file    cycle_counter.h
+ * @brief   DWT cycle counter: enable and read
+ * @details The core's cycle counter times the statistics, benchmarks and
+ *          profiling probes of the projects. It counts core clock cycles
+ *          (SystemCoreClock) and wraps every 2^32 cycles, 35 s at 120 MHz, so
+ *          differences of two reads are only valid below that. It stops
+ *          while the core clock is gated (deep sleep).
+ *
+ *          Enabling it is idempotent: every module that reads it calls
+ *          cycle_counter_enable() at init, in any order.
+ */
+
+#ifndef CYCLE_COUNTER_H_
+#define CYCLE_COUNTER_H_
+
+/***** Includes *****/
+#include <stdint.h>
+
+#include "mxc_device.h"
+
+/***** Functions *****/
+static inline void cycle_counter_enable(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t cycle_counter_read(void)
+{
+    return DWT->CYCCNT;
+}
+
+#endif // CYCLE_COUNTER_H_
@@ -0,0 +1,230 @@
+/**
+ * @file    debounce.c
+ * @brief   Timer-based debouncing of GPIO inputs
+ */
+
+/***** Includes *****/
+#include <string.h>
+
+#include "mxc_errors.h"
+#include "nvic_table.h"
+
+#include "debounce.h"
+
+/***** Globals *****/
+static mxc_tmr_regs_t *deb_tmr;
+static IRQn_Type deb_irq;
+static uint32_t ticks_per_ms;
+static debounce_pin_t *pins[DEBOUNCE_MAX_PINS];
+static int pin_count;
+
+static bool armed; // the one-shot runs or has fired unhandled
+static uint32_t arm_time; // timeline when it was started, ticks
+static uint32_t arm_len; // ticks until it fires
+
+#ifdef IRQ_TIME_STATS
+irq_time_t debounce_irq_time;
+#endif
+
+/***** Functions *****/
+// current time on the timeline; it stands still while no window is open.
+// The counter starts at 1 and is reloaded with 1 when the timer fires.
+static uint32_t now_ticks(void)
+{
+    uint32_t count;
+
+    if (!armed) {
+        return arm_time;
+    }
+
+    count = MXC_TMR_GetCount(deb_tmr);
+    if (MXC_TMR_GetFlags(deb_tmr)) {
+        return arm_time + arm_len;
+    }
+    return arm_time + count - 1;
+}
+
+// restarts the one-shot for the earliest open window; interrupts masked
+static void rearm(uint32_t now)
+{
+    uint32_t next = 0;
+    bool any = false;
+
+    for (int i = 0; i < pin_count; i++) {
+        uint32_t deadline = pins[i]->last_edge + pins[i]->window;
+
+        if (pins[i]->pending && (!any || (int32_t)(deadline - next) < 0)) {
+            next = deadline;
+            any = true;
+        }
+    }
+
+    MXC_TMR_Stop(deb_tmr);
+    MXC_TMR_ClearFlags(deb_tmr);
+    NVIC_ClearPendingIRQ(deb_irq);
+
+    arm_time = now;
+    armed = any;
+    if (!any) {
+        return;
+    }
+
+    arm_len = ((int32_t)(next - now) > 0) ? next - now : 1;
+    MXC_TMR_SetCount(deb_tmr, 1);
+    MXC_TMR_SetCompare(deb_tmr, arm_len);
+    MXC_TMR_Start(deb_tmr);
+}
+
+static void debounce_tmr_isr(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t report = 0; // pins whose level changed, bit n for pins[n]
+    bool open = false;
+    uint32_t now;
+#ifdef IRQ_TIME_STATS
+    uint32_t start = irq_time_enter();
+#endif
+
+    __disable_irq();
+
+    // nothing to do if a new edge restarted the timer meanwhile
+    if (armed && MXC_TMR_GetFlags(deb_tmr)) {
+        MXC_TMR_ClearFlags(deb_tmr);
+        now = arm_time + arm_len;
+        armed = false;
+        arm_time = now;
+
+        for (int i = 0; i < pin_count; i++) {
+            debounce_pin_t *pin = pins[i];
+            uint32_t bounce_us;
+            bool level;
+
+            if (!pin->pending) {
+                continue;
+            }
+            if ((int32_t)(pin->last_edge + pin->window - now) > 0) {
+                open = true;
+                continue;
+            }
+
+            pin->pending = false;
+            bounce_us = (pin->last_edge - pin->first_edge) * 1000 / ticks_per_ms;
+            if (bounce_us > pin->stats.longest_us) {
+                pin->stats.longest_us = bounce_us;
+            }
+
+            level = MXC_GPIO_InGet(pin->port, pin->mask) != 0;
+            if (level != pin->level) {
+                pin->level = level;
+                pin->stats.changes++;
+                report |= 1u << i;
+            } else {
+                pin->stats.glitches++;
+            }
+        }
+
+        if (open) {
+            rearm(now);
+        }
+    }
+
+    __set_PRIMASK(primask);
+
+    for (int i = 0; report != 0; i++, report >>= 1) {
+        if ((report & 1) && pins[i]->fn != NULL) {
+            pins[i]->fn(pins[i]->arg, pins[i]->level);
+        }
+    }
+
+#ifdef IRQ_TIME_STATS
+    irq_time_exit(&debounce_irq_time, start);
+#endif
+}
+
+int debounce_init(mxc_tmr_regs_t *tmr)
+{
+    mxc_tmr_cfg_t cfg;
+    int retVal;
+
+    deb_tmr = tmr;
+    deb_irq = MXC_TMR_GET_IRQ(MXC_TMR_GET_IDX(tmr));
+    ticks_per_ms = MXC_TMR_GetPeriod(tmr, MXC_TMR_APB_CLK, DEBOUNCE_TMR_DIV, 1000);
+    memset(pins, 0x00, sizeof(pins));
+    pin_count = 0;
+    armed = false;
+    arm_time = 0;
+    arm_len = 0;
+
+    MXC_TMR_Shutdown(tmr);
+
+    cfg.pres = DEBOUNCE_TMR_PRES;
+    cfg.mode = TMR_MODE_ONESHOT;
+    cfg.bitMode = TMR_BIT_MODE_32;
+    cfg.clock = MXC_TMR_APB_CLK;
+    cfg.cmp_cnt = UINT32_MAX; // set for each window
+    cfg.pol = 0;
+
+    retVal = MXC_TMR_Init(tmr, &cfg, false);
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+    MXC_TMR_EnableInt(tmr);
+    MXC_NVIC_SetVector(deb_irq, debounce_tmr_isr);
+    NVIC_EnableIRQ(deb_irq);
+
+    return E_NO_ERROR;
+}
+
+int debounce_add(debounce_pin_t *pin, mxc_gpio_regs_t *port, uint32_t mask, uint32_t window_us,
+                 debounce_fn_t fn, void *arg)
+{
+    if (deb_tmr == NULL) {
+        return E_UNINITIALIZED;
+    }
+    if (pin_count >= DEBOUNCE_MAX_PINS) {
+        return E_NONE_AVAIL;
+    }
+    if (window_us == 0) {
+        return E_BAD_PARAM;
+    }
+
+    memset(pin, 0x00, sizeof(*pin));
+    pin->port = port;
+    pin->mask = mask;
+    pin->window = (uint32_t)((uint64_t)window_us * ticks_per_ms / 1000);
+    if (pin->window == 0) {
+        pin->window = 1;
+    }
+    pin->fn = fn;
+    pin->arg = arg;
+    pin->level = MXC_GPIO_InGet(port, mask) != 0;
+
+    pins[pin_count++] = pin;
+
+    return E_NO_ERROR;
+}
+
+void debounce_edge(debounce_pin_t *pin)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t now;
+
+    __disable_irq();
+
+    now = now_ticks();
+    pin->stats.edges++;
+    if (!pin->pending) {
+        pin->pending = true;
+        pin->first_edge = now;
+    }
+    pin->last_edge = now;
+
+    // a window that closes before the armed one needs the timer now; a later
+    // one is picked up when the timer fires
+    if (!armed || (int32_t)(now + pin->window - (arm_time + arm_len)) < 0) {
+        rearm(now);
+    }
+
+    __set_PRIMASK(primask);
+}
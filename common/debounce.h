@@ -0,0 +1,97 @@
+/**
+ * @file    debounce.h
+ * @brief   Timer-based debouncing of GPIO inputs
+ * @details The GPIO handler only timestamps the edge and, if needed, rearms a
+ *          one-shot timer for the end of the pin's settle window; every
+ *          further bounce restarts the window. When the window closes the
+ *          timer handler reads the pin and reports the level if it differs
+ *          from the last one reported. Neither handler waits, so a bouncing
+ *          button no longer holds off the other interrupts for the whole
+ *          debounce time.
+ *
+ *          Any number of pins (up to DEBOUNCE_MAX_PINS), each with its own
+ *          window, share one TMR. It counts the APB clock divided by
+ *          DEBOUNCE_TMR_DIV and only runs while a window is open; its counter
+ *          is also the timeline the edges are stamped on. The pin callbacks
+ *          run in the timer handler, so they should only post work (see
+ *          work_queue.h).
+ */
+
+#ifndef DEBOUNCE_H_
+#define DEBOUNCE_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "gpio.h"
+#include "mxc_device.h"
+#include "tmr.h"
+
+#include "irq_time.h"
+
+/***** Definitions *****/
+#ifndef DEBOUNCE_MAX_PINS
+#define DEBOUNCE_MAX_PINS 8
+#endif
+
+// timer resolution: APB clock / 64, about 1 us
+#define DEBOUNCE_TMR_PRES TMR_PRES_64
+#define DEBOUNCE_TMR_DIV 64
+
+typedef void (*debounce_fn_t)(void *arg, bool level);
+
+typedef struct {
+    uint32_t edges; // edges seen by debounce_edge()
+    uint32_t changes; // level changes reported
+    uint32_t glitches; // windows that closed on the level already reported
+    uint32_t longest_us; // longest bounce: first to last edge of one window
+} debounce_stats_t;
+
+typedef struct {
+    mxc_gpio_regs_t *port;
+    uint32_t mask;
+    uint32_t window; // settle window, timer ticks
+    debounce_fn_t fn;
+    void *arg;
+    volatile bool level; // last level reported
+    bool pending; // window open
+    uint32_t first_edge; // timestamps of the window's first and last edge, ticks
+    uint32_t last_edge;
+    debounce_stats_t stats;
+} debounce_pin_t;
+
+#ifdef IRQ_TIME_STATS
+// time spent in the timer handler, including the pin callbacks
+extern irq_time_t debounce_irq_time;
+#endif
+
+/***** Functions *****/
+/*
+ * Takes tmr (a 32-bit timer) for the service and installs its handler.
+ */
+int debounce_init(mxc_tmr_regs_t *tmr);
+
+/*
+ * Watches the input in mask of port: fn(arg, level) is called from the timer
+ * handler once the pin has held a new level for window_us. The current level
+ * is the starting point. Configure the pin's edge interrupt on both edges and
+ * call debounce_edge() from its callback.
+ */
+int debounce_add(debounce_pin_t *pin, mxc_gpio_regs_t *port, uint32_t mask, uint32_t window_us,
+                 debounce_fn_t fn, void *arg);
+
+/*
+ * Starts or restarts the pin's settle window. Call it from the GPIO handler.
+ */
+void debounce_edge(debounce_pin_t *pin);
+
+/*
+ * Last level reported for the pin.
+ */
+static inline bool debounce_level(const debounce_pin_t *pin)
+{
+    return pin->level;
+}
+
+#endif // DEBOUNCE_H_
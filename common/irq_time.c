@@ -0,0 +1,35 @@
+/**
+ * @file    irq_time.c
+ * @brief   Worst-case time spent in interrupt handlers
+ */
+
+/***** Includes *****/
+#include <stdio.h>
+
+#include "irq_time.h"
+
+/***** Functions *****/
+void irq_time_init(void)
+{
+    cycle_counter_enable();
+}
+
+void irq_time_exit(irq_time_t *t, uint32_t start)
+{
+    uint32_t cycles = cycle_counter_read() - start;
+
+    t->count++;
+    t->total_cycles += cycles;
+    if (cycles > t->max_cycles) {
+        t->max_cycles = cycles;
+    }
+}
+
+void irq_time_print(const char *name, const irq_time_t *t)
+{
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    uint32_t avg = (t->count != 0) ? (uint32_t)(t->total_cycles / t->count) : 0;
+
+    printf("%s handler: %u runs, avg %u us, max %u us\n", name, (unsigned)t->count,
+           (unsigned)(avg / cycles_per_us), (unsigned)(t->max_cycles / cycles_per_us));
+}
@@ -0,0 +1,44 @@
+/**
+ * @file    irq_time.h
+ * @brief   Worst-case time spent in interrupt handlers
+ * @details While a handler runs, interrupts of the same or lower priority
+ *          wait, so the longest handler bounds the latency the others see.
+ *          Bracket a handler body with irq_time_enter() / irq_time_exit() to
+ *          record how long it ran (DWT cycle counter); exception entry and exit
+ *          are not included.
+ */
+
+#ifndef IRQ_TIME_H_
+#define IRQ_TIME_H_
+
+/***** Includes *****/
+#include <stdint.h>
+
+#include "cycle_counter.h"
+
+/***** Definitions *****/
+typedef struct {
+    uint32_t count; // handler runs
+    uint32_t max_cycles; // longest run
+    uint64_t total_cycles;
+} irq_time_t;
+
+/***** Functions *****/
+/*
+ * Enables the cycle counter. Call it once before the handlers are enabled.
+ */
+void irq_time_init(void);
+
+static inline uint32_t irq_time_enter(void)
+{
+    return cycle_counter_read();
+}
+
+void irq_time_exit(irq_time_t *t, uint32_t start);
+
+/*
+ * Prints the runs, the average and the longest run in microseconds.
+ */
+void irq_time_print(const char *name, const irq_time_t *t);
+
+#endif // IRQ_TIME_H_
@@ -0,0 +1,475 @@
+/**
+ * @file    max31723.c
+ * @brief   MAX31723 SPI temperature sensor driver
+ */
+
+/***** Includes *****/
+#include <stddef.h>
+#include <string.h>
+
+#include "dma.h"
+#include "gpio.h"
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "nvic_table.h"
+#include "spi.h"
+
+#include "max31723.h"
+
+/***** Definitions *****/
+// only the upper nibble of the threshold LSB registers is compared
+#define MAX31723_LINK_LSB_MASK 0xF0
+
+/***** Globals *****/
+static max31723_link_t port_link; // result of the last characterization
+
+#if defined(IRQ_TIME_STATS) && !defined(MASTERSYNC)
+irq_time_t max31723_irq_time;
+#endif
+
+/***** Functions *****/
+#if defined(MASTERASYNC)
+static void max31723_spi_isr(void)
+{
+#ifdef IRQ_TIME_STATS
+    uint32_t start = irq_time_enter();
+#endif
+
+    MXC_SPI_AsyncHandler(MAX31723_SPI);
+
+#ifdef IRQ_TIME_STATS
+    irq_time_exit(&max31723_irq_time, start);
+#endif
+}
+#elif defined(MASTERDMA)
+// the SPI driver uses DMA channels 0 (TX) and 1 (RX)
+static void max31723_dma_isr(void)
+{
+#ifdef IRQ_TIME_STATS
+    uint32_t start = irq_time_enter();
+#endif
+
+    MXC_DMA_Handler();
+
+#ifdef IRQ_TIME_STATS
+    irq_time_exit(&max31723_irq_time, start);
+#endif
+}
+#endif
+
+#if !defined(MASTERSYNC)
+static void max31723_callback(mxc_spi_req_t *req, int error)
+{
+    max31723_t *dev = (max31723_t *)((char *)req - offsetof(max31723_t, req));
+
+    max31723_select(dev, false);
+    complete(&dev->done, error);
+}
+#endif
+
+// one chip-select window of len bytes, tx[0] holds the address
+static int max31723_transfer(max31723_t *dev, uint32_t len)
+{
+    int retVal;
+
+    dev->req.txLen = len;
+    dev->req.rxLen = len;
+    dev->req.txCnt = 0;
+    dev->req.rxCnt = 0;
+
+    max31723_select(dev, true);
+
+#if defined(MASTERSYNC)
+    retVal = MXC_SPI_MasterTransaction(&dev->req);
+    max31723_select(dev, false);
+#else
+    reinit_completion(&dev->done);
+#if defined(MASTERDMA)
+    retVal = MXC_SPI_MasterTransactionDMA(&dev->req);
+#else
+    retVal = MXC_SPI_MasterTransactionAsync(&dev->req);
+#endif
+    if (retVal != E_NO_ERROR) {
+        max31723_select(dev, false);
+        return retVal;
+    }
+
+    retVal = wait_for_completion(&dev->done);
+#endif
+
+    return retVal;
+}
+
+int max31723_port_init(unsigned int hz)
+{
+    return max31723_port_init_ss(hz, 1 << MAX31723_SS_IDX);
+}
+
+int max31723_port_init_ss(unsigned int hz, unsigned int ss_mask)
+{
+    int retVal;
+    mxc_spi_pins_t spi_pins;
+    int slaves = 0;
+    // MXC_SPI_Init() takes plain ints: the port drives the bus, on one data
+    // line each way (no quad SPI)
+    const int master_mode = 1;
+    const int quad_mode = 0;
+    // the MAX31723's chip enable is active high: one polarity bit set per
+    // slave select in use
+    const unsigned int ss_polarity = ss_mask;
+
+    if (hz > MAX31723_MAX_HZ || ss_mask == 0 || ss_mask >= (1 << MAX31723_SS_COUNT)) {
+        return E_BAD_PARAM;
+    }
+
+    for (int i = 0; i < MAX31723_SS_COUNT; i++) {
+        slaves += (ss_mask >> i) & 1;
+    }
+
+    memset(&spi_pins, 0x00, sizeof(spi_pins));
+    spi_pins.clock = true;
+    spi_pins.miso = true;
+    spi_pins.mosi = true;
+    spi_pins.ss0 = (ss_mask & (1 << 0)) != 0;
+    spi_pins.ss1 = (ss_mask & (1 << 1)) != 0;
+    spi_pins.ss2 = (ss_mask & (1 << 2)) != 0;
+    spi_pins.vddioh = MXC_GPIO_VSSEL_VDDIOH;
+
+    retVal = MXC_SPI_Init(MAX31723_SPI, master_mode, quad_mode, slaves, ss_polarity, hz, spi_pins);
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+#ifdef MAX31723_VDDIOH_PORT
+    {
+        mxc_gpio_cfg_t gpio_spi_pins;
+
+        memset(&gpio_spi_pins, 0x00, sizeof(gpio_spi_pins));
+        gpio_spi_pins.port = MAX31723_VDDIOH_PORT;
+        gpio_spi_pins.mask = MAX31723_VDDIOH_PINS;
+        gpio_spi_pins.func = MXC_GPIO_FUNC_ALT1;
+        gpio_spi_pins.vssel = MXC_GPIO_VSSEL_VDDIOH;
+        MXC_GPIO_Config(&gpio_spi_pins);
+    }
+#endif
+
+    // CPHA = 1 is required; mode 3 also idles the clock high
+    retVal = MXC_SPI_SetMode(MAX31723_SPI, SPI_MODE_3);
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+    retVal = MXC_SPI_SetDataSize(MAX31723_SPI, 8);
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+    retVal = MXC_SPI_SetWidth(MAX31723_SPI, SPI_WIDTH_STANDARD);
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+    MXC_SPI_ClearRXFIFO(MAX31723_SPI);
+
+#if defined(MASTERASYNC)
+    MXC_NVIC_SetVector(MAX31723_SPI_IRQ, max31723_spi_isr);
+    NVIC_EnableIRQ(MAX31723_SPI_IRQ);
+#elif defined(MASTERDMA)
+    MXC_DMA_ReleaseChannel(0);
+    MXC_DMA_ReleaseChannel(1);
+    MXC_NVIC_SetVector(DMA0_IRQn, max31723_dma_isr);
+    MXC_NVIC_SetVector(DMA1_IRQn, max31723_dma_isr);
+    NVIC_EnableIRQ(DMA0_IRQn);
+    NVIC_EnableIRQ(DMA1_IRQn);
+#endif
+
+    return E_NO_ERROR;
+}
+
+void max31723_init(max31723_t *dev)
+{
+    max31723_init_ss(dev, MAX31723_SS_IDX);
+}
+
+void max31723_init_ss(max31723_t *dev, int ss_idx)
+{
+    memset(dev, 0x00, sizeof(*dev));
+
+    dev->spi = MAX31723_SPI;
+    dev->ss_idx = ss_idx;
+
+    dev->req.spi = dev->spi;
+    dev->req.txData = dev->tx;
+    dev->req.rxData = dev->rx;
+    dev->req.ssIdx = dev->ss_idx;
+    dev->req.ssDeassert = 1;
+#if defined(MASTERSYNC)
+    dev->req.completeCB = NULL;
+#else
+    dev->req.completeCB = (spi_complete_cb_t)max31723_callback;
+#endif
+
+    init_completion(&dev->done);
+}
+
+void max31723_init_gpio_cs(max31723_t *dev, mxc_gpio_regs_t *port, uint32_t mask)
+{
+    mxc_gpio_cfg_t cfg;
+
+    max31723_init_ss(dev, MAX31723_SS_GPIO);
+    dev->cs_port = port;
+    dev->cs_mask = mask;
+
+    MXC_GPIO_OutClr(port, mask);
+
+    memset(&cfg, 0x00, sizeof(cfg));
+    cfg.port = port;
+    cfg.mask = mask;
+    cfg.pad = MXC_GPIO_PAD_NONE;
+    cfg.func = MXC_GPIO_FUNC_OUT;
+    cfg.vssel = MXC_GPIO_VSSEL_VDDIOH;
+    cfg.drvstr = MXC_GPIO_DRVSTR_0;
+    MXC_GPIO_Config(&cfg);
+}
+
+int max31723_read_regs(max31723_t *dev, uint8_t addr, uint8_t *data, uint32_t len)
+{
+    int retVal;
+
+    if (len == 0 || len >= MAX31723_XFER_LEN) {
+        return E_BAD_PARAM;
+    }
+
+    memset(dev->tx, 0x00, len + 1);
+    dev->tx[0] = addr;
+
+    retVal = max31723_transfer(dev, len + 1);
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+    // rx[0] is clocked in while the address is sent
+    memcpy(data, &dev->rx[1], len);
+    return E_NO_ERROR;
+}
+
+int max31723_write_regs(max31723_t *dev, uint8_t addr, const uint8_t *data, uint32_t len)
+{
+    if (len == 0 || len >= MAX31723_XFER_LEN) {
+        return E_BAD_PARAM;
+    }
+
+    dev->tx[0] = addr | MAX31723_WRITE;
+    memcpy(&dev->tx[1], data, len);
+
+    return max31723_transfer(dev, len + 1);
+}
+
+int max31723_read_config(max31723_t *dev, uint8_t *config)
+{
+    uint8_t reg;
+    int retVal = max31723_read_regs(dev, MAX31723_REG_CONFIG, &reg, 1);
+
+    if (retVal != E_NO_ERROR) {
+        dev->config_valid = false;
+        return retVal;
+    }
+
+    // the sensor clears 1SHOT on its own, keep it out of the cache
+    dev->config = reg & ~MAX31723_CFG_1SHOT;
+    dev->config_valid = true;
+    if (config != NULL) {
+        *config = reg;
+    }
+    return E_NO_ERROR;
+}
+
+int max31723_write_config(max31723_t *dev, uint8_t config)
+{
+    int retVal;
+
+    // 1SHOT starts a conversion, so it is always written
+    if (dev->config_valid && dev->config == config && !(config & MAX31723_CFG_1SHOT)) {
+        return E_NO_ERROR;
+    }
+
+    retVal = max31723_write_regs(dev, MAX31723_REG_CONFIG, &config, 1);
+
+    // the sensor clears 1SHOT itself once the conversion is done
+    dev->config = config & ~MAX31723_CFG_1SHOT;
+    dev->config_valid = (retVal == E_NO_ERROR);
+    return retVal;
+}
+
+int max31723_set_resolution(max31723_t *dev, int bits)
+{
+    int retVal;
+
+    if (bits < MAX31723_MIN_RES || bits > MAX31723_MAX_RES) {
+        return E_BAD_PARAM;
+    }
+
+    if (!dev->config_valid) {
+        retVal = max31723_read_config(dev, NULL);
+        if (retVal != E_NO_ERROR) {
+            return retVal;
+        }
+    }
+
+    return max31723_write_config(dev, (dev->config & ~MAX31723_CFG_R_MASK) |
+                                          MAX31723_CFG_RES(bits));
+}
+
+int max31723_read_temp(max31723_t *dev, temp_q8_t *temp)
+{
+    uint8_t regs[2];
+    int retVal = max31723_read_regs(dev, MAX31723_REG_TEMP_LSB, regs, sizeof(regs));
+
+    if (retVal == E_NO_ERROR) {
+        *temp = temp_q8_from_regs(regs[1], regs[0]);
+    }
+    return retVal;
+}
+
+int max31723_read_temp_config(max31723_t *dev, temp_q8_t *temp, uint8_t *config)
+{
+    uint8_t regs[3];
+    int retVal = max31723_read_regs(dev, MAX31723_REG_CONFIG, regs, sizeof(regs));
+
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+    dev->config = regs[0] & ~MAX31723_CFG_1SHOT;
+    dev->config_valid = true;
+    if (config != NULL) {
+        *config = regs[0];
+    }
+    *temp = temp_q8_from_regs(regs[2], regs[1]);
+    return E_NO_ERROR;
+}
+
+// MAX31723_LINK_READS bursts of 00h-06h at the current clock; returns the
+// number that failed or did not match
+static uint32_t max31723_link_check(max31723_t *dev, const uint8_t *pattern)
+{
+    uint8_t regs[7];
+    uint32_t errors = 0;
+
+    for (int i = 0; i < MAX31723_LINK_READS; i++) {
+        if (max31723_read_regs(dev, MAX31723_REG_CONFIG, regs, sizeof(regs)) != E_NO_ERROR ||
+            (regs[0] & ~MAX31723_CFG_1SHOT) != dev->config ||
+            (regs[3] & MAX31723_LINK_LSB_MASK) != pattern[0] || regs[4] != pattern[1] ||
+            (regs[5] & MAX31723_LINK_LSB_MASK) != pattern[2] || regs[6] != pattern[3]) {
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+int max31723_characterize(max31723_t *dev, unsigned int min_hz, unsigned int max_hz,
+                          max31723_link_t *link)
+{
+    // thresholds written while the link is characterized, alternating bits
+    static const uint8_t pattern[4] = { 0xA0, 0x5A, 0x50, 0xA5 };
+    uint8_t thresholds[4];
+    max31723_link_t result;
+    unsigned int hz;
+    uint32_t errors;
+    int retVal;
+
+    if (max_hz > MAX31723_MAX_HZ) {
+        max_hz = MAX31723_MAX_HZ;
+    }
+    if (min_hz == 0 || min_hz > max_hz) {
+        return E_BAD_PARAM;
+    }
+
+    memset(&result, 0x00, sizeof(result));
+
+    // known contents, written at the clock that is known to work
+    retVal = MXC_SPI_SetFrequency(dev->spi, min_hz);
+    if (retVal == E_NO_ERROR && !dev->config_valid) {
+        retVal = max31723_read_config(dev, NULL);
+    }
+    if (retVal == E_NO_ERROR) {
+        retVal = max31723_read_regs(dev, MAX31723_REG_THIGH_LSB, thresholds, sizeof(thresholds));
+    }
+    if (retVal == E_NO_ERROR) {
+        retVal = max31723_write_regs(dev, MAX31723_REG_THIGH_LSB, pattern, sizeof(pattern));
+    }
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+    for (hz = min_hz;; hz *= 2) {
+        if (hz > max_hz) {
+            hz = max_hz;
+        }
+
+        MXC_SPI_SetFrequency(dev->spi, hz);
+        errors = max31723_link_check(dev, pattern);
+        result.steps++;
+        result.reads += MAX31723_LINK_READS;
+        result.errors += errors;
+
+        if (errors != 0) {
+            result.failed_hz = MXC_SPI_GetFrequency(dev->spi);
+            break;
+        }
+        result.fastest_ok_hz = MXC_SPI_GetFrequency(dev->spi);
+        if (hz == max_hz) {
+            break;
+        }
+    }
+
+    // narrow the edge down between the last clean and the first failing step
+    for (int i = 0; i < MAX31723_LINK_BISECT && result.fastest_ok_hz != 0 && result.failed_hz != 0;
+         i++) {
+        hz = (result.fastest_ok_hz + result.failed_hz) / 2;
+        MXC_SPI_SetFrequency(dev->spi, hz);
+        errors = max31723_link_check(dev, pattern);
+        result.steps++;
+        result.reads += MAX31723_LINK_READS;
+        result.errors += errors;
+
+        if (errors != 0) {
+            result.failed_hz = MXC_SPI_GetFrequency(dev->spi);
+        } else {
+            result.fastest_ok_hz = MXC_SPI_GetFrequency(dev->spi);
+        }
+    }
+
+    // back off from the edge; fall back to min_hz if even that is not clean
+    result.hz = result.fastest_ok_hz;
+    if (result.failed_hz != 0 && result.fastest_ok_hz > min_hz) {
+        hz = result.fastest_ok_hz / 100 * (100 - MAX31723_LINK_MARGIN_PCT);
+        if (hz < min_hz) {
+            hz = min_hz;
+        }
+        MXC_SPI_SetFrequency(dev->spi, hz);
+        errors = max31723_link_check(dev, pattern);
+        result.reads += MAX31723_LINK_READS;
+        result.errors += errors;
+        result.hz = (errors == 0) ? MXC_SPI_GetFrequency(dev->spi) : min_hz;
+    }
+    if (result.hz == 0) {
+        result.hz = min_hz;
+    }
+
+    MXC_SPI_SetFrequency(dev->spi, min_hz);
+    retVal = max31723_write_regs(dev, MAX31723_REG_THIGH_LSB, thresholds, sizeof(thresholds));
+    MXC_SPI_SetFrequency(dev->spi, result.hz);
+
+    port_link = result;
+    if (link != NULL) {
+        *link = result;
+    }
+    return retVal;
+}
+
+const max31723_link_t *max31723_get_link(void)
+{
+    return &port_link;
+}
@@ -0,0 +1,243 @@
+/**
+ * @file    max31723.h
+ * @brief   MAX31723 SPI temperature sensor driver
+ * @details One max31723_t handle per sensor. Every register access is a single
+ *          chip-select window that starts with the register address; the
+ *          sensor auto-increments the address for each following byte.
+ *          The configuration register is cached in the handle, so changing one
+ *          field does not need a read first and unchanged values are not
+ *          written again.
+ *
+ *          The transfer backend is chosen at compile time with the project's
+ *          METHOD: MASTERSYNC (blocking driver call), MASTERASYNC (interrupt
+ *          driven, the caller sleeps in wait_for_completion()) or MASTERDMA.
+ *          Without one, the board default below is used. The SPI instance,
+ *          slave select and pins of each supported board are resolved here by
+ *          the preprocessor.
+ *
+ *          More sensors can share the port: on the other hardware slave
+ *          selects (max31723_init_ss()) or on a GPIO chip enable that the
+ *          driver drives around each transfer (max31723_init_gpio_cs()).
+ */
+
+#ifndef MAX31723_H_
+#define MAX31723_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "gpio.h"
+#include "mxc_device.h"
+#include "spi.h"
+
+#include "completion.h"
+#include "irq_time.h"
+#include "temp_q8.h"
+
+/***** Board traits *****/
+#if TARGET_NUM == 32690
+// AD-APARD32690-SL: SPI4, slave select 0 (P1.0), pins on VDDIOH
+#define MAX31723_SPI MXC_SPI4
+#define MAX31723_SPI_IRQ SPI4_IRQn
+#define MAX31723_SS_IDX 0
+#define MAX31723_VDDIOH_PORT MXC_GPIO1
+#define MAX31723_VDDIOH_PINS \
+    (MXC_GPIO_PIN_0 | MXC_GPIO_PIN_1 | MXC_GPIO_PIN_2 | MXC_GPIO_PIN_3)
+#define MAX31723_DEFAULT_METHOD_ASYNC
+#elif TARGET_NUM == 78000
+// MAX78000FTHR: SPI0, slave select 1 (P0.11)
+#define MAX31723_SPI MXC_SPI0
+#define MAX31723_SPI_IRQ SPI0_IRQn
+#define MAX31723_SS_IDX 1
+#define MAX31723_DEFAULT_METHOD_SYNC
+#else
+#error "max31723: no board traits for this target."
+#endif
+
+// hardware slave selects SS0-SS2; SS3 has no pin and is used while a GPIO
+// drives the chip enable
+#define MAX31723_SS_COUNT 3
+#define MAX31723_SS_GPIO 3
+
+#if !defined(MASTERSYNC) && !defined(MASTERASYNC) && !defined(MASTERDMA)
+#if defined(MAX31723_DEFAULT_METHOD_SYNC)
+#define MASTERSYNC 1
+#else
+#define MASTERASYNC 1
+#endif
+#endif
+
+/***** Definitions *****/
+// register addresses, set MAX31723_WRITE to write
+#define MAX31723_REG_CONFIG 0x00
+#define MAX31723_REG_TEMP_LSB 0x01
+#define MAX31723_REG_TEMP_MSB 0x02
+#define MAX31723_REG_THIGH_LSB 0x03
+#define MAX31723_REG_THIGH_MSB 0x04
+#define MAX31723_REG_TLOW_LSB 0x05
+#define MAX31723_REG_TLOW_MSB 0x06
+#define MAX31723_WRITE 0x80
+
+// configuration register
+#define MAX31723_CFG_SD (1 << 0) // shutdown: no continuous conversions
+#define MAX31723_CFG_R_SHIFT 1
+#define MAX31723_CFG_R_MASK (3 << MAX31723_CFG_R_SHIFT)
+#define MAX31723_CFG_TM (1 << 3) // thermostat interrupt mode
+#define MAX31723_CFG_1SHOT (1 << 4) // one conversion while shut down
+
+#define MAX31723_MIN_RES 9
+#define MAX31723_MAX_RES 12
+#define MAX31723_CFG_RES(bits) ((((bits) - MAX31723_MIN_RES) << MAX31723_CFG_R_SHIFT))
+#define MAX31723_CFG_GET_RES(cfg) \
+    ((((cfg) & MAX31723_CFG_R_MASK) >> MAX31723_CFG_R_SHIFT) + MAX31723_MIN_RES)
+
+// maximum conversion time: 25, 50, 100 or 200 ms for 9 to 12 bits
+#define MAX31723_CONV_MS(bits) (25 << ((bits) - MAX31723_MIN_RES))
+
+#define MAX31723_MAX_HZ 5000000
+
+// link characterization: burst reads checked per clock step, bisection steps
+// after the first failure, and how far below the fastest clean step the link
+// runs once a step has failed
+#define MAX31723_LINK_READS 32
+#define MAX31723_LINK_BISECT 3
+#define MAX31723_LINK_MARGIN_PCT 25
+
+// address + longest burst (config, LSB, MSB, TH LSB, TH MSB, TL LSB, TL MSB)
+#define MAX31723_XFER_LEN 8
+
+typedef struct {
+    mxc_spi_regs_t *spi;
+    int ss_idx;
+    mxc_gpio_regs_t *cs_port; // GPIO chip enable, NULL on a hardware slave select
+    uint32_t cs_mask;
+    uint8_t config; // cached configuration register
+    bool config_valid; // config matches the sensor
+    mxc_spi_req_t req;
+    uint8_t tx[MAX31723_XFER_LEN];
+    uint8_t rx[MAX31723_XFER_LEN];
+    completion_t done; // completed by the SPI or DMA interrupt
+} max31723_t;
+
+// result of max31723_characterize(), kept for the port
+typedef struct {
+    unsigned int hz; // clock in use
+    unsigned int fastest_ok_hz; // fastest step whose reads all matched
+    unsigned int failed_hz; // first step with a mismatch, 0 when none failed
+    int steps; // clock steps tried
+    uint32_t reads; // burst reads checked
+    uint32_t errors; // reads that failed or did not match
+} max31723_link_t;
+
+#if defined(IRQ_TIME_STATS) && !defined(MASTERSYNC)
+// time spent in the SPI (MASTERASYNC) or DMA (MASTERDMA) handler, including
+// the completion callbacks of every module using the port
+extern irq_time_t max31723_irq_time;
+#endif
+
+/***** Functions *****/
+/*
+ * Initializes the board's SPI port for the sensor (mode 3, 8-bit frames,
+ * active-high chip enable) and, for MASTERASYNC/MASTERDMA, its interrupts.
+ */
+int max31723_port_init(unsigned int hz);
+
+/*
+ * Like max31723_port_init(), with the hardware slave selects in ss_mask
+ * (bit n for SSn) routed to their pins.
+ */
+int max31723_port_init_ss(unsigned int hz, unsigned int ss_mask);
+
+/*
+ * Prepares the handle for the sensor on the board's SPI port and slave select.
+ */
+void max31723_init(max31723_t *dev);
+
+/*
+ * Prepares the handle for a sensor on hardware slave select ss_idx.
+ */
+void max31723_init_ss(max31723_t *dev, int ss_idx);
+
+/*
+ * Prepares the handle for a sensor whose chip enable is the GPIO in mask,
+ * and configures that pin as an output (inactive, low).
+ */
+void max31723_init_gpio_cs(max31723_t *dev, mxc_gpio_regs_t *port, uint32_t mask);
+
+/*
+ * Drives a GPIO chip enable; nothing to do on a hardware slave select.
+ * Call it around transfers that use dev->req-like requests of your own.
+ */
+static inline void max31723_select(const max31723_t *dev, bool active)
+{
+    if (dev->cs_port != NULL) {
+        if (active) {
+            MXC_GPIO_OutSet(dev->cs_port, dev->cs_mask);
+        } else {
+            MXC_GPIO_OutClr(dev->cs_port, dev->cs_mask);
+        }
+    }
+}
+
+/*
+ * Reads len registers starting at addr in one chip-select window.
+ */
+int max31723_read_regs(max31723_t *dev, uint8_t addr, uint8_t *data, uint32_t len);
+
+/*
+ * Writes len registers starting at addr in one chip-select window.
+ */
+int max31723_write_regs(max31723_t *dev, uint8_t addr, const uint8_t *data, uint32_t len);
+
+/*
+ * Reads the configuration register and refreshes the cache.
+ */
+int max31723_read_config(max31723_t *dev, uint8_t *config);
+
+/*
+ * Writes the configuration register, unless the cache shows it already holds
+ * config.
+ */
+int max31723_write_config(max31723_t *dev, uint8_t config);
+
+/*
+ * Changes the resolution (9-12 bits) and keeps the other configuration bits.
+ */
+int max31723_set_resolution(max31723_t *dev, int bits);
+
+/*
+ * Reads the temperature LSB and MSB in one burst.
+ */
+int max31723_read_temp(max31723_t *dev, temp_q8_t *temp);
+
+/*
+ * Reads the configuration register and the temperature in one burst from
+ * 00h; also refreshes the cache.
+ */
+int max31723_read_temp_config(max31723_t *dev, temp_q8_t *temp, uint8_t *config);
+
+/*
+ * Finds the fastest clock the link to dev carries reliably. Starting at
+ * min_hz (a clock known to work), the SPI clock doubles up to max_hz (at most
+ * MAX31723_MAX_HZ); at each step MAX31723_LINK_READS burst reads of the
+ * configuration and threshold registers must return the configuration cache
+ * and a test pattern written at min_hz. Only reads run above min_hz, so a bad
+ * step cannot corrupt the sensor.
+ *
+ * Without a failing step the fastest step is kept. Otherwise
+ * MAX31723_LINK_BISECT more steps narrow down the edge between the last clean
+ * and the first failing clock, and the link runs MAX31723_LINK_MARGIN_PCT
+ * below the fastest clean step, checked once more.
+ * The thresholds are restored and the port is left at the chosen clock; the
+ * result is kept for max31723_get_link(). Uses blocking driver calls.
+ */
+int max31723_characterize(max31723_t *dev, unsigned int min_hz, unsigned int max_hz,
+                          max31723_link_t *link);
+
+/*
+ * Result of the last max31723_characterize(); hz is 0 before the first one.
+ */
+const max31723_link_t *max31723_get_link(void);
+
+#endif // MAX31723_H_
@@ -0,0 +1,109 @@
+/**
+ * @file    prof.c
+ * @brief   Named profiling probes on the cycle counter
+ */
+
+/***** Includes *****/
+#include <stdio.h>
+#include <string.h>
+
+#include "prof.h"
+
+/***** Globals *****/
+static uint32_t ticks_per_us = 1;
+
+/***** Functions *****/
+void prof_init(prof_probe_t *table, size_t count)
+{
+#ifdef PROF_CLOCK_GETTIME
+    ticks_per_us = 1000;
+#else
+    cycle_counter_enable();
+    ticks_per_us = SystemCoreClock / 1000000;
+#endif
+
+    for (size_t i = 0; i < count; i++) {
+        const char *name = table[i].name;
+
+        memset(&table[i], 0x00, sizeof(table[i]));
+        table[i].name = name;
+        table[i].min_ticks = UINT32_MAX;
+    }
+}
+
+void prof_add(prof_probe_t *probe, uint32_t ticks)
+{
+    uint32_t us = ticks / ticks_per_us;
+    uint32_t bucket = 0;
+
+    if (us != 0) {
+        bucket = 32 - __builtin_clz(us); // 1 for 1 us, 2 for 2 - 3 us, ...
+        if (bucket >= PROF_BUCKETS) {
+            bucket = PROF_BUCKETS - 1;
+        }
+    }
+
+    probe->count++;
+    probe->total_ticks += ticks;
+    if (ticks < probe->min_ticks) {
+        probe->min_ticks = ticks;
+    }
+    if (ticks > probe->max_ticks) {
+        probe->max_ticks = ticks;
+    }
+    probe->hist[bucket]++;
+}
+
+uint32_t prof_ticks_per_us(void)
+{
+    return ticks_per_us;
+}
+
+// microseconds with two decimals
+static void print_us(const char *label, uint64_t ticks)
+{
+    uint64_t us_x100 = ticks * 100 / ticks_per_us;
+
+    printf("%s %u.%02u us", label, (unsigned)(us_x100 / 100), (unsigned)(us_x100 % 100));
+}
+
+void prof_print(const prof_probe_t *table, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        prof_probe_t p;
+
+        // a handler's probe may change while it is copied
+#ifndef PROF_CLOCK_GETTIME
+        uint32_t primask = __get_PRIMASK();
+
+        __disable_irq();
+        p = table[i];
+        __set_PRIMASK(primask);
+#else
+        p = table[i];
+#endif
+
+        if (p.count == 0) {
+            continue;
+        }
+
+        printf("Probe %s: %u runs,", p.name, (unsigned)p.count);
+        print_us(" min", p.min_ticks);
+        print_us(", avg", p.total_ticks / p.count);
+        print_us(", max", p.max_ticks);
+        printf("\n ");
+        for (int b = 0; b < PROF_BUCKETS; b++) {
+            if (p.hist[b] == 0) {
+                continue;
+            }
+            if (b == 0) {
+                printf(" <1 us: %u", (unsigned)p.hist[b]);
+            } else if (b == PROF_BUCKETS - 1) {
+                printf(" >=%u us: %u", 1u << (b - 1), (unsigned)p.hist[b]);
+            } else {
+                printf(" %u-%u us: %u", 1u << (b - 1), 1u << b, (unsigned)p.hist[b]);
+            }
+        }
+        printf("\n");
+    }
+}
@@ -0,0 +1,105 @@
+/**
+ * @file    prof.h
+ * @brief   Named profiling probes on the cycle counter
+ * @details PROF_BEGIN(id) and PROF_END(id) bracket a stretch of code within
+ *          one block; each pass adds its duration to probe id of the
+ *          project's table (prof_probes.h): runs, shortest, longest, total
+ *          and a histogram of power-of-two buckets in microseconds.
+ *          prof_print() dumps the table.
+ *
+ *          Without PROF the macros expand to nothing, and the project leaves
+ *          its table out, so an uninstrumented build carries neither.
+ *
+ *          The clock is the DWT cycle counter. PROF_CLOCK_GETTIME takes
+ *          clock_gettime(CLOCK_MONOTONIC) in nanoseconds instead, for host
+ *          builds without a DWT; in the host simulation it measures the host's
+ *          own time, leaving out the simulated bus and UART time that the
+ *          simulated DWT counts.
+ *
+ *          A probe is updated without masking interrupts: use each one from a
+ *          single context (main() or one handler). Different probes nest and
+ *          overlap freely. A pass must take less than 2^32 ticks (35 s at
+ *          120 MHz, 4 s in nanoseconds).
+ */
+
+#ifndef PROF_H_
+#define PROF_H_
+
+/***** Includes *****/
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef PROF_CLOCK_GETTIME
+#include <time.h>
+#else
+#include "cycle_counter.h"
+#endif
+
+/***** Definitions *****/
+// bucket 0: under 1 us; bucket n: 2^(n-1) - 2^n us; the last one is open
+#define PROF_BUCKETS 16
+
+typedef struct {
+    const char *name;
+    uint32_t count; // passes
+    uint32_t min_ticks;
+    uint32_t max_ticks;
+    uint64_t total_ticks;
+    uint32_t hist[PROF_BUCKETS];
+} prof_probe_t;
+
+// entries of the project's probe list: X(id, label)
+#define PROF_ID(id, label) id,
+#define PROF_ENTRY(id, label) [id] = { .name = (label), .min_ticks = UINT32_MAX },
+
+#ifdef PROF
+#define PROF_BEGIN(id) uint32_t prof_start_##id = prof_now()
+#define PROF_END(id) prof_add(&prof_table[(id)], prof_now() - prof_start_##id)
+#else
+#define PROF_BEGIN(id) \
+    do {               \
+    } while (0)
+#define PROF_END(id) \
+    do {             \
+    } while (0)
+#endif
+
+// the project's probes, indexed by id (prof_probes.c), only with PROF
+extern prof_probe_t prof_table[];
+
+/***** Functions *****/
+static inline uint32_t prof_now(void)
+{
+#ifdef PROF_CLOCK_GETTIME
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+#else
+    return cycle_counter_read();
+#endif
+}
+
+/*
+ * Clears the count probes of table and starts the clock (DWT). Call it before
+ * the first PROF_END().
+ */
+void prof_init(prof_probe_t *table, size_t count);
+
+/*
+ * Adds one pass of ticks to probe; PROF_END() calls it.
+ */
+void prof_add(prof_probe_t *probe, uint32_t ticks);
+
+/*
+ * Ticks of the clock in one microsecond.
+ */
+uint32_t prof_ticks_per_us(void);
+
+/*
+ * Prints one line per probe that ran (runs, min, average and max in
+ * microseconds) followed by its non-empty histogram buckets.
+ */
+void prof_print(const prof_probe_t *table, size_t count);
+
+#endif // PROF_H_
@@ -0,0 +1,81 @@
+/**
+ * @file    rtc_time.c
+ * @brief   Coherent RTC time reads and an integer-only time formatter
+ */
+
+/***** Includes *****/
+#include <stdio.h>
+
+#include "mxc_delay.h"
+#include "mxc_errors.h"
+#include "rtc.h"
+
+#include "rtc_time.h"
+
+/***** Definitions *****/
+// RDY stays low for one 32768 Hz cycle before the counters update
+#define RTC_TIME_RDY_US 31
+
+#define SECS_PER_MIN 60
+#define SECS_PER_HR (60 * SECS_PER_MIN)
+#define SECS_PER_DAY (24 * SECS_PER_HR)
+
+/***** Functions *****/
+int rtc_time_get(rtc_time_t *t)
+{
+    uint32_t sec, subsec, sec_after;
+
+    for (int tries = 0; tries < RTC_TIME_TRIES; tries++) {
+        if (MXC_RTC_GetSeconds(&sec) != E_NO_ERROR ||
+            MXC_RTC_GetSubSeconds(&subsec) != E_NO_ERROR ||
+            MXC_RTC_GetSeconds(&sec_after) != E_NO_ERROR) {
+            // an update is pending, the next one is 244 us away
+            MXC_Delay(MXC_DELAY_USEC(RTC_TIME_RDY_US));
+            continue;
+        }
+
+        // the sub-seconds belong to sec only if the seconds did not move;
+        // otherwise the next try starts clear of the rollover
+        if (sec == sec_after) {
+            t->sec = sec;
+            t->subsec = (uint16_t)subsec;
+            return E_NO_ERROR;
+        }
+    }
+
+    return E_BUSY;
+}
+
+int rtc_time_format(char *buf, size_t len, const rtc_time_t *t, int decimals)
+{
+    uint32_t sec = t->sec;
+    uint32_t day, hr, min;
+    uint32_t scale = 1;
+    int n;
+
+    if (decimals < 0 || decimals > RTC_TIME_MAX_DECIMALS) {
+        return -1;
+    }
+
+    day = sec / SECS_PER_DAY;
+    sec -= day * SECS_PER_DAY;
+    hr = sec / SECS_PER_HR;
+    sec -= hr * SECS_PER_HR;
+    min = sec / SECS_PER_MIN;
+    sec -= min * SECS_PER_MIN;
+
+    if (decimals == 0) {
+        n = snprintf(buf, len, "%02u:%02u:%02u:%02u", (unsigned)day, (unsigned)hr, (unsigned)min,
+                     (unsigned)sec);
+    } else {
+        for (int i = 0; i < decimals; i++) {
+            scale *= 10;
+        }
+        n = snprintf(buf, len, "%02u:%02u:%02u:%02u.%0*u", (unsigned)day, (unsigned)hr,
+                     (unsigned)min, (unsigned)sec, decimals,
+                     (unsigned)((uint64_t)(t->subsec % RTC_TIME_TICKS_PER_SEC) * scale /
+                                RTC_TIME_TICKS_PER_SEC));
+    }
+
+    return (n < 0 || (size_t)n >= len) ? -1 : n;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file    rtc_time.h
+ * @brief   Coherent RTC time reads and an integer-only time formatter
+ * @details The RTC's seconds and sub-seconds counters are separate registers,
+ *          so reading one and then the other can straddle a rollover: 5.999 s
+ *          read as 6.999 s or 5.000 s. rtc_time_get() reads seconds,
+ *          sub-seconds, seconds again and keeps the pair only when both
+ *          seconds agree. The MSDK refuses reads (E_BUSY) while RDY is low,
+ *          one 32 kHz cycle before each sub-second update; a failed try waits
+ *          that cycle out instead of spinning. After RTC_TIME_TRIES tries the
+ *          call gives up, so its time is bounded even if an interrupt keeps
+ *          preempting it across the rollover.
+ *
+ *          rtc_time_format() prints a time as "dd:hh:mm:ss.ff" with integer
+ *          math only (no double, no %f).
+ */
+
+#ifndef RTC_TIME_H_
+#define RTC_TIME_H_
+
+/***** Includes *****/
+#include <stddef.h>
+#include <stdint.h>
+
+/***** Definitions *****/
+#define RTC_TIME_TICKS_PER_SEC 4096 // sub-second resolution
+
+// a rollover or a busy counter spoils a try; two in a row need a preemption
+#define RTC_TIME_TRIES 3
+
+// longest string rtc_time_format() produces: "49710:06:28:15.999999" plus '\0'
+#define RTC_TIME_STR_LEN 22
+#define RTC_TIME_MAX_DECIMALS 6
+
+typedef struct {
+    uint32_t sec;
+    uint16_t subsec; // 1/4096 s
+} rtc_time_t;
+
+/***** Functions *****/
+/*
+ * Reads a coherent {seconds, sub-seconds} pair. Returns E_BUSY (and leaves
+ * *t unchanged) when RTC_TIME_TRIES tries were spoiled.
+ */
+int rtc_time_get(rtc_time_t *t);
+
+/*
+ * The time in RTC ticks, wrapping every 2^20 s (about 12 days).
+ */
+static inline uint32_t rtc_time_ticks(const rtc_time_t *t)
+{
+    return t->sec * RTC_TIME_TICKS_PER_SEC + t->subsec;
+}
+
+/*
+ * Writes t as "dd:hh:mm:ss" with the given number of decimals
+ * (0 - RTC_TIME_MAX_DECIMALS), truncated like a clock. Days take two digits
+ * or more. Returns the string length, or -1 if buf is too small.
+ */
+int rtc_time_format(char *buf, size_t len, const rtc_time_t *t, int decimals);
+
+#endif // RTC_TIME_H_
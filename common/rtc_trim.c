@@ -0,0 +1,244 @@
+/**
+ * @file    rtc_trim.c
+ * @brief   RTC crystal trim calibration against a TMR reference
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <string.h>
+
+#include "mxc_errors.h"
+#include "rtc.h"
+#include "rtc_time.h"
+
+#include "rtc_trim.h"
+
+/***** Definitions *****/
+#define US_PER_SEC 1000000
+#define WINDOW_MAX_SEC 3600
+
+// waiting for an edge: a preempted one, then the next, then give up
+#define EDGE_WAIT_RTC_TICKS 3
+
+/***** Globals *****/
+static mxc_tmr_regs_t *trim_tmr;
+static mxc_tmr_clock_t trim_clock;
+static uint32_t trim_hz; // reference, before the prescaler
+
+static uint32_t count_hz; // TMR counting rate of the measurement
+static uint32_t edge_gap; // TMR ticks
+static uint32_t edge_wait;
+static bool started;
+static uint32_t start_count;
+static uint32_t start_rtc; // RTC ticks
+
+static rtc_trim_stats_t trim_stats;
+
+/***** Functions *****/
+// stamps the next sub-second edge: the first read showing the new value, if
+// the read before it was close enough (not preempted in between)
+static int stamp_edge(uint32_t *count, uint32_t *rtc)
+{
+    uint32_t first = 0, ssec, primask, start = 0, before = 0, now;
+    bool have_first = false, have_start = false;
+    rtc_time_t t;
+    int err;
+
+    for (;;) {
+        primask = __get_PRIMASK();
+        __disable_irq();
+        err = MXC_RTC_GetSubSeconds(&ssec);
+        now = MXC_TMR_GetCount(trim_tmr);
+        __set_PRIMASK(primask);
+
+        if (!have_start) {
+            start = now;
+            have_start = true;
+        } else if (now - start > edge_wait) {
+            return E_BUSY;
+        }
+
+        if (err == E_NO_ERROR) {
+            if (have_first && ssec != first) {
+                if (now - before <= edge_gap) {
+                    break;
+                }
+                // preempted across the edge: wait for the next
+                trim_stats.edges_rejected++;
+                first = ssec;
+            } else if (!have_first) {
+                first = ssec;
+                have_first = true;
+            }
+        }
+        before = now;
+    }
+
+    // right after the edge: the counters read now are from the same tick
+    if (rtc_time_get(&t) != E_NO_ERROR || t.subsec != ssec) {
+        return E_BUSY;
+    }
+    *count = now;
+    *rtc = rtc_time_ticks(&t);
+    return E_NO_ERROR;
+}
+
+int rtc_trim_init(mxc_tmr_regs_t *tmr, mxc_tmr_clock_t clock, uint32_t ref_hz)
+{
+    int8_t trim;
+
+    if (ref_hz == 0) {
+        ref_hz = MXC_TMR_GetPeriod(tmr, clock, 1, 1);
+    }
+    if (ref_hz == 0) {
+        return E_BAD_PARAM;
+    }
+
+    trim_tmr = tmr;
+    trim_clock = clock;
+    trim_hz = ref_hz;
+    started = false;
+
+    // the trim written last stays in the RTC, and here
+    trim = trim_stats.trim;
+    memset(&trim_stats, 0x00, sizeof(trim_stats));
+    trim_stats.trim = trim;
+
+    return E_NO_ERROR;
+}
+
+int rtc_trim_start(uint32_t window_sec)
+{
+    mxc_tmr_cfg_t cfg;
+    mxc_tmr_pres_t pres = TMR_PRES_1;
+    int retVal;
+
+    if (trim_tmr == NULL) {
+        return E_UNINITIALIZED;
+    }
+    if (window_sec == 0 || window_sec > WINDOW_MAX_SEC) {
+        return E_BAD_PARAM;
+    }
+
+    // the fastest count that holds RTC_TRIM_SLACK windows
+    while ((uint64_t)(trim_hz >> pres) * window_sec * RTC_TRIM_SLACK > UINT32_MAX &&
+           pres < TMR_PRES_4096) {
+        pres++;
+    }
+    count_hz = trim_hz >> pres;
+    edge_gap = count_hz / US_PER_SEC * RTC_TRIM_EDGE_GAP_US;
+    if (edge_gap == 0) {
+        edge_gap = 1;
+    }
+    edge_wait = (uint32_t)((uint64_t)count_hz * EDGE_WAIT_RTC_TICKS / RTC_TIME_TICKS_PER_SEC);
+
+    MXC_TMR_Shutdown(trim_tmr);
+
+    cfg.pres = pres;
+    cfg.mode = TMR_MODE_CONTINUOUS;
+    cfg.bitMode = TMR_BIT_MODE_32;
+    cfg.clock = trim_clock;
+    cfg.cmp_cnt = UINT32_MAX;
+    cfg.pol = 0;
+
+    retVal = MXC_TMR_Init(trim_tmr, &cfg, false);
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+    MXC_TMR_ClearFlags(trim_tmr);
+    MXC_TMR_Start(trim_tmr);
+
+    started = (stamp_edge(&start_count, &start_rtc) == E_NO_ERROR);
+    if (!started) {
+        MXC_TMR_Shutdown(trim_tmr);
+        return E_BUSY;
+    }
+
+    return E_NO_ERROR;
+}
+
+int rtc_trim_finish(int32_t *error_ppb)
+{
+    uint32_t count, rtc, rtc_ticks, ref_ticks;
+    int64_t expected, diff;
+
+    if (!started) {
+        return E_BAD_STATE;
+    }
+    if (stamp_edge(&count, &rtc) != E_NO_ERROR) {
+        return E_BUSY;
+    }
+
+    started = false;
+    if (MXC_TMR_GetFlags(trim_tmr)) {
+        MXC_TMR_Shutdown(trim_tmr);
+        return E_OVERFLOW; // the counter wrapped
+    }
+    MXC_TMR_Shutdown(trim_tmr);
+
+    rtc_ticks = rtc - start_rtc;
+    ref_ticks = count - start_count;
+    if (ref_ticks == 0) {
+        return E_BAD_STATE;
+    }
+
+    // RTC ticks counted minus the ones expected at the reference's rate, both
+    // in RTC ticks * reference Hz; at most 2^44 each
+    expected = (int64_t)ref_ticks * RTC_TIME_TICKS_PER_SEC;
+    diff = (int64_t)rtc_ticks * count_hz - expected;
+    if (diff > expected / (US_PER_SEC / RTC_TRIM_RANGE_PPM) ||
+        diff < -(expected / (US_PER_SEC / RTC_TRIM_RANGE_PPM))) {
+        return E_BAD_STATE;
+    }
+
+    trim_stats.measurements++;
+    trim_stats.rtc_ticks = rtc_ticks;
+    trim_stats.ref_ticks = ref_ticks;
+    trim_stats.error_ppb = (int32_t)(diff * US_PER_SEC / (expected / 1000));
+    trim_stats.uncertainty_ppb =
+        (uint32_t)((uint64_t)(edge_gap + 1) * 1000000000 / ref_ticks);
+
+    *error_ppb = trim_stats.error_ppb;
+    return E_NO_ERROR;
+}
+
+int rtc_trim_set(int8_t trim)
+{
+    if (trim < -RTC_TRIM_MAX || trim > RTC_TRIM_MAX) {
+        return E_BAD_PARAM;
+    }
+
+    while (MXC_RTC_Trim(trim) == E_BUSY) {}
+    trim_stats.trim = trim;
+
+    return E_NO_ERROR;
+}
+
+int rtc_trim_apply(int32_t error_ppb)
+{
+    int32_t steps, trim;
+
+    // nearest step, away from zero at the half
+    if (error_ppb >= 0) {
+        steps = (error_ppb + RTC_TRIM_STEP_PPB / 2) / RTC_TRIM_STEP_PPB;
+    } else {
+        steps = (error_ppb - RTC_TRIM_STEP_PPB / 2) / RTC_TRIM_STEP_PPB;
+    }
+
+    trim = trim_stats.trim - steps;
+    if (trim > RTC_TRIM_MAX) {
+        rtc_trim_set(RTC_TRIM_MAX);
+        return E_OVERFLOW;
+    }
+    if (trim < -RTC_TRIM_MAX) {
+        rtc_trim_set(-RTC_TRIM_MAX);
+        return E_OVERFLOW;
+    }
+
+    return rtc_trim_set((int8_t)trim);
+}
+
+void rtc_trim_get_stats(rtc_trim_stats_t *stats)
+{
+    *stats = trim_stats;
+}
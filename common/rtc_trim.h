@@ -0,0 +1,95 @@
+/**
+ * @file    rtc_trim.h
+ * @brief   RTC crystal trim calibration against a TMR reference
+ * @details A 32 kHz crystal is typically 10 - 20 ppm off, up to 1.7 s a day,
+ *          and the error differs from board to board. rtc_trim_start() and
+ *          rtc_trim_finish() count RTC ticks against a TMR on a clock the
+ *          caller trusts more than the crystal, over a window of its choice:
+ *          each end is stamped on an RTC sub-second edge, the first reading
+ *          of the new sub-second value with the reading before it at most
+ *          RTC_TRIM_EDGE_GAP_US earlier. rtc_trim_apply() then corrects the
+ *          RTC with MXC_RTC_Trim(), RTC_TRIM_STEP_PPB per step, so boards
+ *          trimmed against the same reference keep the same time without a
+ *          network to share it.
+ *
+ *          The sub-second counter is the RTC divider the 512 Hz square wave
+ *          output is taken from; reading it needs no wire from the
+ *          square-wave pin to a timer input.
+ *
+ *          The window only bounds the uncertainty, about (EDGE_GAP + one
+ *          reference tick) / window: 0.2 ppm over 10 s. The TMR runs from
+ *          rtc_trim_start() to rtc_trim_finish() with a prescaler that keeps
+ *          RTC_TRIM_SLACK windows within its 32-bit counter.
+ */
+
+#ifndef RTC_TRIM_H_
+#define RTC_TRIM_H_
+
+/***** Includes *****/
+#include <stdint.h>
+
+#include "mxc_device.h"
+#include "tmr.h"
+
+/***** Definitions *****/
+// RTC frequency change per MXC_RTC_Trim() step (positive speeds it up), and the
+// register's range
+#define RTC_TRIM_STEP_PPB 1000
+#define RTC_TRIM_MAX 127
+
+// the reads around an edge at most this far apart
+#define RTC_TRIM_EDGE_GAP_US 2
+
+// rtc_trim_finish() may come this many windows after rtc_trim_start()
+#define RTC_TRIM_SLACK 4
+
+// a larger error means a wrong reference frequency or a stopped RTC
+#define RTC_TRIM_RANGE_PPM 1000
+
+typedef struct {
+    uint32_t measurements;
+    uint32_t edges_rejected; // edges passed while the stamp was preempted
+    uint32_t rtc_ticks; // counted over the last window
+    uint32_t ref_ticks;
+    int32_t error_ppb; // RTC rate against the reference, minus one, trim included
+    uint32_t uncertainty_ppb; // of error_ppb
+    int8_t trim; // value in use
+} rtc_trim_stats_t;
+
+/***** Functions *****/
+/*
+ * Takes tmr (a 32-bit timer) as the reference, counting clock. ref_hz is its
+ * frequency; 0 takes MXC_TMR_GetPeriod()'s, which an external clock has not.
+ * Leaves the trim as it is.
+ */
+int rtc_trim_init(mxc_tmr_regs_t *tmr, mxc_tmr_clock_t clock, uint32_t ref_hz);
+
+/*
+ * Starts a measurement of about window_sec seconds (1 - 3600) at the next RTC
+ * sub-second edge. Returns E_BUSY when no edge could be stamped within three
+ * RTC ticks; call again.
+ */
+int rtc_trim_start(uint32_t window_sec);
+
+/*
+ * Ends the measurement at the next edge and returns the RTC's error in ppb
+ * (positive runs fast). E_BUSY: no edge, call again. E_OVERFLOW: called more
+ * than RTC_TRIM_SLACK windows after the start. E_BAD_STATE: not started, or
+ * the error is over RTC_TRIM_RANGE_PPM. Only E_BUSY keeps the measurement.
+ */
+int rtc_trim_finish(int32_t *error_ppb);
+
+/*
+ * Changes the trim by the steps closest to -error_ppb. Returns E_OVERFLOW,
+ * with the trim at the end of its range, when that is not enough.
+ */
+int rtc_trim_apply(int32_t error_ppb);
+
+/*
+ * Writes a trim measured earlier (-RTC_TRIM_MAX - RTC_TRIM_MAX).
+ */
+int rtc_trim_set(int8_t trim);
+
+void rtc_trim_get_stats(rtc_trim_stats_t *stats);
+
+#endif // RTC_TRIM_H_
@@ -0,0 +1,456 @@
+/**
+ * @file    rtc_wheel.c
+ * @brief   Software timers multiplexed onto the RTC sub-second alarm
+ */
+
+/***** Includes *****/
+#include <stddef.h>
+#include <string.h>
+
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "rtc.h"
+#include "rtc_time.h"
+
+#include "rtc_wheel.h"
+
+/***** Definitions *****/
+#define SLOT_MASK (RTC_WHEEL_SLOTS - 1)
+#define LEVEL_SHIFT(level) ((level) * RTC_WHEEL_SLOT_BITS)
+
+// rtc_timer_t.state bits; a periodic timer can be both
+#define TIMER_ARMED 0x01 // in a slot of the wheel
+#define TIMER_QUEUED 0x02 // expired, on the ready list
+
+/***** Globals *****/
+static rtc_timer_t *slots[RTC_WHEEL_LEVELS][RTC_WHEEL_SLOTS];
+static uint64_t occupied[RTC_WHEEL_LEVELS]; // bit n: slot n holds timers
+static uint32_t wheel_now; // next tick to visit; earlier ticks are done
+
+static rtc_timer_t *ready_head; // expired timers, oldest first
+static rtc_timer_t *ready_tail;
+
+static bool alarm_on;
+static uint32_t alarm_at; // slot the sub-second alarm is set for
+static uint32_t alarm_period; // the alarm repeats every alarm_period ticks
+
+static rtc_wheel_stats_t wheel_stats;
+
+/***** Functions *****/
+static bool now_ticks(uint32_t *ticks)
+{
+    rtc_time_t now;
+
+    if (rtc_time_get(&now) != E_NO_ERROR) {
+        return false;
+    }
+    *ticks = rtc_time_ticks(&now);
+    return true;
+}
+
+// position of the first set bit at or after from, counted from from, circularly
+static uint32_t next_bit(uint64_t bits, uint32_t from)
+{
+    uint64_t rotated = (from == 0) ? bits : (bits >> from) | (bits << (RTC_WHEEL_SLOTS - from));
+
+    return (uint32_t)__builtin_ctzll(rotated);
+}
+
+static void slot_unlink(rtc_timer_t *t)
+{
+    rtc_timer_t **head = &slots[t->level][t->index];
+
+    if (t->prev != NULL) {
+        t->prev->next = t->next;
+    } else {
+        *head = t->next;
+    }
+    if (t->next != NULL) {
+        t->next->prev = t->prev;
+    }
+    if (*head == NULL) {
+        occupied[t->level] &= ~(1ULL << t->index);
+    }
+    t->state &= ~TIMER_ARMED;
+    wheel_stats.armed--;
+}
+
+static void ready_append(rtc_timer_t *t)
+{
+    t->state |= TIMER_QUEUED;
+    t->ready_next = NULL;
+    t->ready_prev = ready_tail;
+    if (ready_tail != NULL) {
+        ready_tail->ready_next = t;
+    } else {
+        ready_head = t;
+    }
+    ready_tail = t;
+}
+
+static void ready_unlink(rtc_timer_t *t)
+{
+    if (t->ready_prev != NULL) {
+        t->ready_prev->ready_next = t->ready_next;
+    } else {
+        ready_head = t->ready_next;
+    }
+    if (t->ready_next != NULL) {
+        t->ready_next->ready_prev = t->ready_prev;
+    } else {
+        ready_tail = t->ready_prev;
+    }
+    t->state &= ~TIMER_QUEUED;
+}
+
+static void place(rtc_timer_t *t);
+
+/*
+ * t is due: queues its callback and puts a periodic timer back into the
+ * wheel at its next expiry on the grid. An expiry whose previous callback
+ * has not run yet is merged into it and counted as an overrun.
+ */
+static void expire(rtc_timer_t *t)
+{
+    t->due = t->expires;
+    if (t->state & TIMER_QUEUED) {
+        wheel_stats.overruns++;
+    } else {
+        ready_append(t);
+    }
+    wheel_stats.expired++;
+
+    if (t->period != 0) {
+        uint32_t behind = wheel_now - t->expires;
+
+        // a timer started in the past joins its grid after the time now
+        t->expires += t->period;
+        if ((int32_t)behind > 0) {
+            t->expires += ((behind - 1) / t->period) * t->period;
+        }
+        place(t);
+    }
+}
+
+/*
+ * Puts t into the slot its remaining time selects: level n holds the timers
+ * due within RTC_WHEEL_SLOTS^(n+1) ticks, in the slot of their expiry's
+ * level-n digit. A timer already due expires at once.
+ */
+static void place(rtc_timer_t *t)
+{
+    uint32_t delta = t->expires - wheel_now;
+    uint8_t level = 0;
+
+    if ((int32_t)delta < 0) {
+        expire(t);
+        return;
+    }
+    while (level < RTC_WHEEL_LEVELS - 1 && delta >= (1UL << LEVEL_SHIFT(level + 1))) {
+        level++;
+    }
+
+    t->state |= TIMER_ARMED;
+    t->level = level;
+    t->index = (t->expires >> LEVEL_SHIFT(level)) & SLOT_MASK;
+    t->prev = NULL;
+    t->next = slots[level][t->index];
+    if (t->next != NULL) {
+        t->next->prev = t;
+    }
+    slots[level][t->index] = t;
+    occupied[level] |= 1ULL << t->index;
+    wheel_stats.armed++;
+}
+
+// takes the whole list out of a slot
+static rtc_timer_t *slot_take(int level, uint32_t index)
+{
+    rtc_timer_t *list = slots[level][index];
+
+    slots[level][index] = NULL;
+    occupied[level] &= ~(1ULL << index);
+    for (rtc_timer_t *t = list; t != NULL; t = t->next) {
+        t->state &= ~TIMER_ARMED;
+        wheel_stats.armed--;
+    }
+    return list;
+}
+
+/*
+ * Next tick with something to do: an occupied level-0 slot, or the start of
+ * an occupied slot of a higher level, which then cascades. A slot at level n
+ * is visited every RTC_WHEEL_SLOTS^(n+1) ticks; place() makes sure that its
+ * timers are due before the second visit.
+ */
+static bool next_event(uint32_t *at)
+{
+    uint32_t best = UINT32_MAX;
+
+    for (int level = 0; level < RTC_WHEEL_LEVELS; level++) {
+        uint32_t shift = LEVEL_SHIFT(level);
+        uint32_t first; // first slot start at or after wheel_now, in slots
+        uint32_t offset;
+
+        if (occupied[level] == 0) {
+            continue;
+        }
+
+        first = (wheel_now >> shift) + ((wheel_now & ((1UL << shift) - 1)) != 0);
+        offset = ((first + next_bit(occupied[level], first & SLOT_MASK)) << shift) - wheel_now;
+        if (offset < best) {
+            best = offset;
+        }
+    }
+
+    *at = wheel_now + best;
+    return best != UINT32_MAX;
+}
+
+// visits tick: cascades the slots that start there, then expires level 0
+static void visit(uint32_t tick)
+{
+    rtc_timer_t *t;
+
+    wheel_now = tick;
+
+    // from the top, so that a cascade into a lower slot starting at the same
+    // tick cascades again
+    for (int level = RTC_WHEEL_LEVELS - 1; level > 0; level--) {
+        uint32_t shift = LEVEL_SHIFT(level);
+
+        if ((tick & ((1UL << shift) - 1)) == 0 &&
+            (occupied[level] & (1ULL << ((tick >> shift) & SLOT_MASK))) != 0) {
+            t = slot_take(level, (tick >> shift) & SLOT_MASK);
+            while (t != NULL) {
+                rtc_timer_t *next = t->next;
+
+                place(t);
+                wheel_stats.cascaded++;
+                t = next;
+            }
+        }
+    }
+
+    // a periodic timer goes back in after tick, never into this slot's list
+    wheel_now = tick + 1;
+    t = slot_take(0, tick & SLOT_MASK);
+    while (t != NULL) {
+        rtc_timer_t *next = t->next;
+
+        expire(t);
+        t = next;
+    }
+}
+
+// visits every tick up to now that has something to do
+static void advance(uint32_t now)
+{
+    uint32_t at;
+
+    while (next_event(&at) && (int32_t)(now - at) >= 0) {
+        visit(at);
+    }
+    if ((int32_t)(now + 1 - wheel_now) > 0) {
+        wheel_now = now + 1;
+    }
+}
+
+/*
+ * Sets the alarm for the next event after now, unless it is already set for
+ * it, and turns it off when the wheel is empty. The alarm repeats on its
+ * own, so a slot one alarm period after the last one needs no register
+ * writes (two 32 kHz cycles each): a single fast periodic timer, or timers
+ * due at the same rate, run without any.
+ */
+static void program(uint32_t now)
+{
+    uint32_t at;
+
+    if (!next_event(&at)) {
+        if (alarm_on) {
+            while (MXC_RTC_DisableInt(MXC_F_RTC_CTRL_SSEC_ALARM_IE) == E_BUSY) {}
+            alarm_on = false;
+        }
+        return;
+    }
+
+    if (!alarm_on || (at != alarm_at && at - alarm_at != alarm_period)) {
+        // the sub-second alarm fires once its counter rolls over from rssa to 0;
+        // at > now after advance(now)
+        alarm_period = at - now;
+        while (MXC_RTC_DisableInt(MXC_F_RTC_CTRL_SSEC_ALARM_IE) == E_BUSY) {}
+        while (MXC_RTC_SetSubsecondAlarm(0 - alarm_period) == E_BUSY) {}
+        while (MXC_RTC_EnableInt(MXC_F_RTC_CTRL_SSEC_ALARM_IE) == E_BUSY) {}
+        alarm_on = true;
+    }
+    alarm_at = at;
+}
+
+int rtc_wheel_init(void)
+{
+    uint32_t now;
+
+    memset(slots, 0x00, sizeof(slots));
+    memset(occupied, 0x00, sizeof(occupied));
+    memset(&wheel_stats, 0x00, sizeof(wheel_stats));
+    ready_head = NULL;
+    ready_tail = NULL;
+
+    while (MXC_RTC_DisableInt(MXC_F_RTC_CTRL_SSEC_ALARM_IE) == E_BUSY) {}
+    alarm_on = false;
+
+    if (!now_ticks(&now)) {
+        return E_BUSY;
+    }
+    wheel_now = now + 1;
+
+    return E_NO_ERROR;
+}
+
+void rtc_timer_init(rtc_timer_t *t, rtc_timer_fn_t fn, void *arg)
+{
+    memset(t, 0x00, sizeof(*t));
+    t->fn = fn;
+    t->arg = arg;
+}
+
+// removes t from the wheel and the ready list; interrupts masked
+static void unlink(rtc_timer_t *t)
+{
+    if (t->state & TIMER_ARMED) {
+        slot_unlink(t);
+    }
+    if (t->state & TIMER_QUEUED) {
+        ready_unlink(t);
+    }
+}
+
+// arms t at the absolute time at; interrupts masked
+static int arm(rtc_timer_t *t, uint32_t at, uint32_t period, uint32_t now)
+{
+    if ((int32_t)(at - now) > (int32_t)RTC_WHEEL_MAX_TICKS || period > RTC_WHEEL_MAX_TICKS) {
+        return E_BAD_PARAM;
+    }
+
+    unlink(t);
+    t->expires = at;
+    t->period = period;
+
+    // the wheel catches up first, so that t is placed against the time now
+    advance(now);
+    place(t);
+    program(now);
+
+    return E_NO_ERROR;
+}
+
+int rtc_wheel_start_at(rtc_timer_t *t, uint32_t at, uint32_t period)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t now;
+    int retVal = E_BUSY;
+
+    __disable_irq();
+    if (now_ticks(&now)) {
+        retVal = arm(t, at, period, now);
+    }
+    __set_PRIMASK(primask);
+
+    return retVal;
+}
+
+int rtc_wheel_start(rtc_timer_t *t, uint32_t delay, uint32_t period)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t now;
+    int retVal = E_BUSY;
+
+    if (delay > RTC_WHEEL_MAX_TICKS) {
+        return E_BAD_PARAM;
+    }
+
+    __disable_irq();
+    if (now_ticks(&now)) {
+        retVal = arm(t, now + delay, period, now);
+    }
+    __set_PRIMASK(primask);
+
+    return retVal;
+}
+
+void rtc_wheel_stop(rtc_timer_t *t)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    // an alarm set for t only finds nothing to do
+    __disable_irq();
+    unlink(t);
+    __set_PRIMASK(primask);
+}
+
+bool rtc_timer_active(const rtc_timer_t *t)
+{
+    return t->state != 0;
+}
+
+void rtc_wheel_alarm(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t now;
+
+    // higher-priority handlers may start timers
+    __disable_irq();
+    wheel_stats.alarms++;
+    if (now_ticks(&now)) {
+        advance(now);
+        program(now);
+    }
+    // else the RTC is stuck busy; the alarm repeats and tries again
+    __set_PRIMASK(primask);
+}
+
+int rtc_wheel_run(void)
+{
+    int count = 0;
+
+    for (;;) {
+        uint32_t primask = __get_PRIMASK();
+        rtc_timer_t *t;
+        uint32_t due, now;
+
+        __disable_irq();
+        t = ready_head;
+        if (t == NULL) {
+            __set_PRIMASK(primask);
+            break;
+        }
+        ready_unlink(t);
+        due = t->due;
+        if (now_ticks(&now) && now - due > wheel_stats.latency_max) {
+            wheel_stats.latency_max = now - due;
+        }
+        __set_PRIMASK(primask);
+
+        // the callback may stop or restart t
+        t->fn(t->arg, due);
+        wheel_stats.run++;
+        count++;
+    }
+
+    return count;
+}
+
+bool rtc_wheel_pending(void)
+{
+    return ready_head != NULL;
+}
+
+void rtc_wheel_get_stats(rtc_wheel_stats_t *stats)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    *stats = wheel_stats;
+    __set_PRIMASK(primask);
+}
@@ -0,0 +1,131 @@
+/**
+ * @file    rtc_wheel.h
+ * @brief   Software timers multiplexed onto the RTC sub-second alarm
+ * @details Any number of one-shot and periodic timers share the RTC's single
+ *          sub-second alarm. Times are RTC ticks (1/4096 s, the counter
+ *          rtc_time_ticks() returns), so a periodic timer expires on its
+ *          nominal grid, start + n * period, however late its callbacks run.
+ *
+ *          The timers sit in a hierarchical wheel: RTC_WHEEL_LEVELS levels of
+ *          RTC_WHEEL_SLOTS slots, each level RTC_WHEEL_SLOTS times coarser than
+ *          the one below (244 us, 15.6 ms, 1 s, 64 s and 68 min per slot). A
+ *          timer goes into the level its remaining time selects and moves down
+ *          (cascades) when the wheel reaches its slot. A bitmap per level marks
+ *          the occupied slots, so starting and stopping a timer, and finding
+ *          the next slot to visit, take a fixed time whatever the number of
+ *          timers; the wheel only visits occupied slots.
+ *
+ *          The sub-second alarm is set for that next slot. Its handler
+ *          (rtc_wheel_alarm(), from the RTC ISR) queues the callbacks of the
+ *          expired timers, puts the periodic ones back in at their next
+ *          expiry and sets the alarm again; rtc_wheel_run() then calls the
+ *          callbacks from main(), with interrupts enabled. A periodic timer
+ *          that expires again before its callback ran gets one callback for
+ *          both (an overrun): late callbacks never pile up.
+ *
+ *          The wheel owns the sub-second alarm; the time-of-day alarm stays
+ *          free. Delays and periods are limited to RTC_WHEEL_MAX_TICKS.
+ */
+
+#ifndef RTC_WHEEL_H_
+#define RTC_WHEEL_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+
+/***** Definitions *****/
+#define RTC_WHEEL_TICKS_PER_SEC 4096 // RTC sub-second resolution
+#define RTC_WHEEL_SLOT_BITS 6
+#define RTC_WHEEL_SLOTS (1 << RTC_WHEEL_SLOT_BITS) // one bit each in a uint64_t
+#define RTC_WHEEL_LEVELS 5
+// longest delay or period, about 3 days
+#define RTC_WHEEL_MAX_TICKS ((1UL << (RTC_WHEEL_SLOT_BITS * RTC_WHEEL_LEVELS)) - 1)
+
+#define RTC_WHEEL_MS_TO_TICKS(ms) \
+    ((uint32_t)(((uint64_t)(ms) * RTC_WHEEL_TICKS_PER_SEC + 999) / 1000)) // rounded up
+
+/*
+ * Timer callback, run by rtc_wheel_run(). ticks is the time the timer was
+ * due, which the callback may take as the time of its event.
+ */
+typedef void (*rtc_timer_fn_t)(void *arg, uint32_t ticks);
+
+typedef struct rtc_timer {
+    struct rtc_timer *next; // slot
+    struct rtc_timer *prev;
+    struct rtc_timer *ready_next; // ready list
+    struct rtc_timer *ready_prev;
+    uint32_t expires; // next expiry, RTC ticks
+    uint32_t period; // RTC ticks, 0 for a one-shot timer
+    uint32_t due; // expiry the queued callback is for
+    rtc_timer_fn_t fn;
+    void *arg;
+    uint8_t state;
+    uint8_t level; // slot while armed
+    uint8_t index;
+} rtc_timer_t;
+
+typedef struct {
+    uint32_t alarms; // sub-second alarms handled
+    uint32_t expired; // expiries, overruns included
+    uint32_t cascaded; // timers moved down a level
+    uint32_t run; // callbacks run
+    uint32_t overruns; // expiries merged into a callback still waiting
+    uint32_t latency_max; // due to callback, RTC ticks
+    uint32_t armed; // timers waiting in the wheel
+} rtc_wheel_stats_t;
+
+/***** Functions *****/
+/*
+ * Takes over the sub-second alarm. The RTC must be running. The RTC ISR
+ * must call rtc_wheel_alarm() for the sub-second alarm flag.
+ * Returns E_BUSY when the RTC could not be read.
+ */
+int rtc_wheel_init(void);
+
+void rtc_timer_init(rtc_timer_t *t, rtc_timer_fn_t fn, void *arg);
+
+/*
+ * Starts t to expire at the RTC time at (ticks), then every period ticks if
+ * period is not 0. A time already past expires at once. A running timer is
+ * restarted. Returns E_BAD_PARAM when at or period is more than
+ * RTC_WHEEL_MAX_TICKS ahead, E_BUSY when the RTC could not be read.
+ * Callable from main(), the callbacks and the handlers.
+ */
+int rtc_wheel_start_at(rtc_timer_t *t, uint32_t at, uint32_t period);
+
+/*
+ * Same, delay ticks from now.
+ */
+int rtc_wheel_start(rtc_timer_t *t, uint32_t delay, uint32_t period);
+
+/*
+ * Stops t; its callback does not run until it is started again.
+ */
+void rtc_wheel_stop(rtc_timer_t *t);
+
+bool rtc_timer_active(const rtc_timer_t *t);
+
+/*
+ * Sub-second alarm handler: queues the expired timers' callbacks and sets the
+ * alarm for the next slot. Call it from the RTC ISR once the flag is
+ * cleared.
+ */
+void rtc_wheel_alarm(void);
+
+/*
+ * Runs the queued callbacks, in expiry order. Returns how many ran. Call it
+ * from main() only.
+ */
+int rtc_wheel_run(void);
+
+/*
+ * True when callbacks are waiting. Check it with interrupts masked before
+ * sleeping.
+ */
+bool rtc_wheel_pending(void);
+
+void rtc_wheel_get_stats(rtc_wheel_stats_t *stats);
+
+#endif // RTC_WHEEL_H_
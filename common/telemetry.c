@@ -0,0 +1,73 @@
+/**
+ * @file    telemetry.c
+ * @brief   Binary telemetry records on the console UART
+ */
+
+/***** Includes *****/
+#include <stdio.h>
+
+#include "mxc_errors.h"
+
+#include "telemetry.h"
+#ifdef CONSOLE_TX
+#include "console_tx.h"
+#endif
+
+/***** Globals *****/
+static mxc_uart_regs_t *tlm_uart;
+static uint8_t tlm_seq;
+static telemetry_stats_t tlm_stats;
+
+/***** Functions *****/
+void telemetry_init(mxc_uart_regs_t *uart)
+{
+    tlm_uart = uart;
+    tlm_seq = 0;
+    tlm_stats.records = 0;
+    tlm_stats.bytes = 0;
+}
+
+int telemetry_send(uint8_t type, const uint8_t *payload, size_t len)
+{
+    uint8_t frame[TLM_FRAME_MAX];
+    size_t n;
+    int retVal;
+
+    if (tlm_uart == NULL) {
+        return E_UNINITIALIZED;
+    }
+
+    n = tlm_frame_pack(type, tlm_seq, payload, len, frame);
+    if (n == 0) {
+        return E_BAD_PARAM;
+    }
+
+    // text already printed goes out first
+    fflush(stdout);
+
+#ifdef CONSOLE_TX
+    // queued behind the text; a full DROP_NEWEST ring cuts the frame short
+    retVal = (console_tx_write(frame, n) == n) ? E_NO_ERROR : E_OVERFLOW;
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+#else
+    for (size_t i = 0; i < n; i++) {
+        retVal = MXC_UART_WriteCharacter(tlm_uart, frame[i]);
+        if (retVal != E_NO_ERROR) {
+            return retVal;
+        }
+    }
+#endif
+
+    tlm_seq++;
+    tlm_stats.records++;
+    tlm_stats.bytes += n;
+
+    return E_NO_ERROR;
+}
+
+void telemetry_get_stats(telemetry_stats_t *stats)
+{
+    *stats = tlm_stats;
+}
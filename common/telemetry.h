@@ -0,0 +1,44 @@
+/**
+ * @file    telemetry.h
+ * @brief   Binary telemetry records on the console UART
+ * @details Sends tlm_frame.h records straight to the UART, bypassing stdio
+ *          (whose newline translation would corrupt binary data). Text printed
+ *          with printf() may still be interleaved between records; every
+ *          record carries the next value of an 8-bit sequence number, so the
+ *          decoder can count lost frames. With CONSOLE_TX the frames are
+ *          queued in the console ring instead (console_tx.h), behind the text.
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+/***** Includes *****/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "uart.h"
+
+#include "tlm_frame.h"
+
+/***** Definitions *****/
+typedef struct {
+    uint32_t records; // records sent
+    uint32_t bytes; // frame bytes sent, delimiters included
+} telemetry_stats_t;
+
+/***** Functions *****/
+/*
+ * Sends the records on uart, which must already be set up (the console UART
+ * is, by the MSDK startup code).
+ */
+void telemetry_init(mxc_uart_regs_t *uart);
+
+/*
+ * Frames and sends one record; blocks until it is in the UART FIFO (with
+ * CONSOLE_TX, until it is queued).
+ */
+int telemetry_send(uint8_t type, const uint8_t *payload, size_t len);
+
+void telemetry_get_stats(telemetry_stats_t *stats);
+
+#endif // TELEMETRY_H_
@@ -0,0 +1,128 @@
+/**
+ * @file    temp_q8.c
+ * @brief   Integer-only temperature samples for the MAX31723
+ */
+
+/***** Includes *****/
+#include "temp_q8.h"
+
+/***** Functions *****/
+temp_mc_t temp_q8_to_mc(temp_q8_t t)
+{
+    int32_t scaled = (int32_t)t * 1000;
+
+    // C division truncates toward zero, so round away from zero by hand
+    if (scaled >= 0) {
+        return (scaled + TEMP_Q8_ONE / 2) / TEMP_Q8_ONE;
+    }
+    return (scaled - TEMP_Q8_ONE / 2) / TEMP_Q8_ONE;
+}
+
+void temp_avg_reset(temp_avg_t *avg)
+{
+    avg->sum = 0;
+    avg->count = 0;
+}
+
+void temp_avg_add(temp_avg_t *avg, temp_q8_t t)
+{
+    avg->sum += t;
+    avg->count++;
+}
+
+temp_q8_t temp_avg_get(const temp_avg_t *avg)
+{
+    int32_t count = (int32_t)avg->count;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    if (avg->sum >= 0) {
+        return (temp_q8_t)((avg->sum + count / 2) / count);
+    }
+    return (temp_q8_t)((avg->sum - count / 2) / count);
+}
+
+void temp_threshold_init(temp_threshold_t *th, temp_q8_t high, temp_q8_t low)
+{
+    th->high = high;
+    th->low = low;
+    th->tripped = false;
+}
+
+temp_threshold_event_t temp_threshold_update(temp_threshold_t *th, temp_q8_t t)
+{
+    if (!th->tripped && t >= th->high) {
+        th->tripped = true;
+        return TEMP_THRESHOLD_HIGH;
+    }
+
+    if (th->tripped && t <= th->low) {
+        th->tripped = false;
+        return TEMP_THRESHOLD_CLEAR;
+    }
+
+    return TEMP_THRESHOLD_NONE;
+}
+
+int temp_q8_format(char *buf, size_t len, temp_q8_t t, int decimals)
+{
+    char digits[TEMP_Q8_STR_LEN];
+    uint32_t magnitude;
+    uint32_t whole;
+    uint32_t scale = 1;
+    uint32_t frac;
+    bool negative;
+    int n = 0;
+    int pos = 0;
+
+    if (decimals < 0 || decimals > TEMP_Q8_MAX_DECIMALS) {
+        return -1;
+    }
+
+    for (int i = 0; i < decimals; i++) {
+        scale *= 10;
+    }
+
+    magnitude = (t < 0) ? (uint32_t)(-(int32_t)t) : (uint32_t)t;
+    whole = magnitude >> 8;
+
+    // 1/256 has 8 decimals, so 64-bit math keeps the rounding exact
+    frac = (uint32_t)((((uint64_t)(magnitude & 0xFF) * scale) + (TEMP_Q8_ONE / 2)) >> 8);
+    if (frac >= scale) {
+        // the fraction rounded up to the next whole degree
+        frac -= scale;
+        whole++;
+    }
+
+    // no "-0.00" for values that round to zero
+    negative = (t < 0) && (whole != 0 || frac != 0);
+
+    // build the string backwards: fraction, point, whole part, sign
+    for (int i = 0; i < decimals; i++) {
+        digits[n++] = '0' + (frac % 10);
+        frac /= 10;
+    }
+    if (decimals > 0) {
+        digits[n++] = '.';
+    }
+    do {
+        digits[n++] = '0' + (whole % 10);
+        whole /= 10;
+    } while (whole != 0);
+    if (negative) {
+        digits[n++] = '-';
+    }
+
+    if ((size_t)n + 1 > len) {
+        return -1;
+    }
+
+    while (n > 0) {
+        buf[pos++] = digits[--n];
+    }
+    buf[pos] = '\0';
+
+    return pos;
+}
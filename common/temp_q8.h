@@ -0,0 +1,80 @@
+/**
+ * @file    temp_q8.h
+ * @brief   Integer-only temperature samples for the MAX31723
+ * @details The sensor's temperature register (MSB:LSB, 2's complement) already
+ *          is a Q8.8 fixed-point number of degrees Celsius, so samples stay in
+ *          that format end to end: conversion, averaging, threshold checks and
+ *          formatting use integer math only (no soft-float double, no %f).
+ */
+
+#ifndef TEMP_Q8_H_
+#define TEMP_Q8_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/***** Definitions *****/
+typedef int16_t temp_q8_t; // degrees Celsius, Q8.8
+typedef int32_t temp_mc_t; // milli-degrees Celsius
+
+#define TEMP_Q8_ONE 256
+#define TEMP_Q8_FROM_C(c) ((temp_q8_t)((c) * TEMP_Q8_ONE))
+
+// longest string temp_q8_format() produces: "-128.00390625" plus '\0'
+#define TEMP_Q8_STR_LEN 14
+#define TEMP_Q8_MAX_DECIMALS 8
+
+typedef struct {
+    int32_t sum;
+    uint32_t count;
+} temp_avg_t;
+
+typedef enum {
+    TEMP_THRESHOLD_NONE, // no crossing
+    TEMP_THRESHOLD_HIGH, // rose to or above the high limit
+    TEMP_THRESHOLD_CLEAR, // fell to or below the low limit after a high event
+} temp_threshold_event_t;
+
+// comparator with hysteresis, like the MAX31723 thermostat
+typedef struct {
+    temp_q8_t high;
+    temp_q8_t low;
+    bool tripped;
+} temp_threshold_t;
+
+/***** Functions *****/
+/*
+ * Builds a sample from the temperature MSB (02h) and LSB (01h) registers.
+ */
+static inline temp_q8_t temp_q8_from_regs(uint8_t msb, uint8_t lsb)
+{
+    return (temp_q8_t)(((uint16_t)msb << 8) | lsb);
+}
+
+/*
+ * Converts to milli-degrees, rounded to the nearest value.
+ */
+temp_mc_t temp_q8_to_mc(temp_q8_t t);
+
+void temp_avg_reset(temp_avg_t *avg);
+void temp_avg_add(temp_avg_t *avg, temp_q8_t t);
+
+/*
+ * Returns the rounded mean of the samples added since the last reset,
+ * or 0 when there are none.
+ */
+temp_q8_t temp_avg_get(const temp_avg_t *avg);
+
+void temp_threshold_init(temp_threshold_t *th, temp_q8_t high, temp_q8_t low);
+temp_threshold_event_t temp_threshold_update(temp_threshold_t *th, temp_q8_t t);
+
+/*
+ * Writes t as a decimal string with the given number of decimals
+ * (0 - TEMP_Q8_MAX_DECIMALS, 4 is exact for 12-bit readings).
+ * Returns the string length, or -1 if buf is too small.
+ */
+int temp_q8_format(char *buf, size_t len, temp_q8_t t, int decimals);
+
+#endif // TEMP_Q8_H_
@@ -0,0 +1,311 @@
+/**
+ * @file    timebase.c
+ * @brief   64-bit monotonic microsecond timebase, disciplined to the RTC
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <string.h>
+
+#include "mxc_errors.h"
+#include "nvic_table.h"
+#include "rtc.h"
+#include "rtc_time.h"
+
+#include "timebase.h"
+
+/***** Definitions *****/
+#define US_PER_SEC 1000000
+#define RTC_US64_PER_TICK 15625 // 1/4096 s in 1/64 us
+
+// the read before the edge and the one after it at most this far apart
+#define EDGE_GAP_US 2
+// waiting for an edge: a preempted one, then the next, then give up
+#define EDGE_WAIT_RTC_TICKS 3
+
+// the RTC time between two edges, 1/64 us, must fit the rate computation
+#define SPAN_MAX (1ULL << 37)
+
+/***** Globals *****/
+static mxc_tmr_regs_t *tb_tmr;
+static IRQn_Type tb_irq;
+static uint32_t nominal_scale; // us per TMR tick << 32, at the nominal APB clock
+static uint32_t edge_gap; // TMR ticks
+static uint32_t edge_wait;
+
+// written with interrupts masked, each write bumps seq
+static volatile uint32_t seq;
+static uint64_t period_base; // ticks at count 1 of the current TMR period
+static uint64_t anchor_ticks; // scale applies from here
+static uint64_t anchor_us; // timebase at anchor_ticks
+static uint32_t scale; // us per TMR tick << 32
+static int64_t rtc_offset; // timebase minus RTC time, 1/64 us
+
+// discipline state, main() only
+static bool have_edge;
+static bool have_rate;
+static uint64_t edge_ticks; // previous edge
+static uint64_t edge_rtc; // its RTC time, 1/64 us
+static uint32_t rate_scale; // us of RTC per TMR tick << 32, filtered
+
+static timebase_stats_t tb_stats;
+
+/***** Functions *****/
+// (ticks * s) >> 32 without a 96-bit product
+static inline uint64_t scale_ticks(uint64_t ticks, uint32_t s)
+{
+    return (ticks >> 32) * s + (((ticks & UINT32_MAX) * s) >> 32);
+}
+
+// TMR ticks since timebase_init(), from the period base the caller read. The
+// counter runs 1..TIMEBASE_TMR_PERIOD and is reloaded with 1 at the rollover.
+static uint64_t count_ticks(uint64_t base)
+{
+    uint32_t count = MXC_TMR_GetCount(tb_tmr);
+
+    // rolled over, handler not run yet: the count may be from either side
+    if (MXC_TMR_GetFlags(tb_tmr)) {
+        count = MXC_TMR_GetCount(tb_tmr);
+        base += TIMEBASE_TMR_PERIOD;
+    }
+    return base + count - 1;
+}
+
+static void timebase_tmr_isr(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (MXC_TMR_GetFlags(tb_tmr)) {
+        MXC_TMR_ClearFlags(tb_tmr);
+        period_base += TIMEBASE_TMR_PERIOD;
+        seq++;
+        tb_stats.overflows++;
+    }
+    __set_PRIMASK(primask);
+}
+
+uint64_t timebase_us(void)
+{
+    uint32_t start;
+    uint64_t us;
+
+    // a writer that ran between the loads changed seq: read again
+    do {
+        start = seq;
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        us = anchor_us + scale_ticks(count_ticks(period_base) - anchor_ticks, scale);
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    } while (seq != start);
+
+    return us;
+}
+
+uint32_t timebase_rtc_ticks(uint64_t us)
+{
+    uint32_t start;
+    int64_t offset;
+
+    do {
+        start = seq;
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        offset = rtc_offset;
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    } while (seq != start);
+
+    return (uint32_t)((us * 64 - (uint64_t)offset) / RTC_US64_PER_TICK);
+}
+
+// new scale from now on; the timebase carries on from its current value
+static void set_scale(uint32_t s)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint64_t ticks;
+
+    __disable_irq();
+    ticks = count_ticks(period_base);
+    anchor_us += scale_ticks(ticks - anchor_ticks, scale);
+    anchor_ticks = ticks;
+    scale = s;
+    seq++;
+    __set_PRIMASK(primask);
+}
+
+static void set_rtc_offset(int64_t offset)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    rtc_offset = offset;
+    seq++;
+    __set_PRIMASK(primask);
+}
+
+// stamps the next sub-second edge: the first read showing the new value, if
+// the read before it was close enough (not preempted in between)
+static int stamp_edge(uint64_t *ticks, rtc_time_t *rtc)
+{
+    uint32_t first = 0, ssec, primask;
+    uint64_t start = 0, before = 0, now;
+    bool have_first = false, started = false;
+    int err;
+
+    for (;;) {
+        primask = __get_PRIMASK();
+        __disable_irq();
+        err = MXC_RTC_GetSubSeconds(&ssec);
+        now = count_ticks(period_base);
+        __set_PRIMASK(primask);
+
+        if (!started) {
+            start = now;
+            started = true;
+        } else if (now - start > edge_wait) {
+            return E_BUSY;
+        }
+
+        if (err == E_NO_ERROR) {
+            if (have_first && ssec != first && now - before <= edge_gap) {
+                break;
+            }
+            // first read, or an edge missed while preempted: wait for the next
+            if (!have_first || ssec != first) {
+                first = ssec;
+                have_first = true;
+            }
+        }
+        before = now;
+    }
+
+    // right after the edge: the counters read now are from the same tick
+    if (rtc_time_get(rtc) != E_NO_ERROR || rtc->subsec != ssec) {
+        return E_BUSY;
+    }
+    *ticks = now;
+    return E_NO_ERROR;
+}
+
+int timebase_discipline(void)
+{
+    uint64_t ticks, elapsed, rtc, us;
+    int64_t offset, correction, slew;
+    uint32_t offset_us;
+    rtc_time_t now;
+
+    if (stamp_edge(&ticks, &now) != E_NO_ERROR) {
+        tb_stats.missed++;
+        return E_BUSY;
+    }
+    tb_stats.disciplines++;
+
+    rtc = ((uint64_t)now.sec * RTC_TIME_TICKS_PER_SEC + now.subsec) * RTC_US64_PER_TICK;
+    // only this function moves the anchor
+    us = anchor_us + scale_ticks(ticks - anchor_ticks, scale);
+    offset = (int64_t)(us * 64 - rtc) - rtc_offset;
+    elapsed = ticks - edge_ticks;
+
+    if (!have_edge || offset > (int64_t)TIMEBASE_STEP_US * 64 ||
+        offset < -(int64_t)TIMEBASE_STEP_US * 64 || rtc - edge_rtc >= SPAN_MAX) {
+        // first edge, the RTC was set or the last edge is too old: start over
+        if (have_edge) {
+            tb_stats.steps++;
+        }
+        set_rtc_offset((int64_t)(us * 64 - rtc));
+        have_edge = true;
+        have_rate = false;
+        edge_ticks = ticks;
+        edge_rtc = rtc;
+        tb_stats.offset_us = 0;
+        return E_NO_ERROR;
+    }
+
+    // rate from the RTC time between the edges, first measurement taken as is
+    if (elapsed > 0 && rtc > edge_rtc) {
+        uint32_t measured = (uint32_t)(((rtc - edge_rtc) << 26) / elapsed);
+
+        if (have_rate) {
+            offset_us = (uint32_t)((offset < 0 ? -offset : offset) / 64);
+            if (offset_us > tb_stats.offset_max_us) {
+                tb_stats.offset_max_us = offset_us;
+            }
+            rate_scale += ((int64_t)measured - rate_scale) / 4;
+        } else {
+            rate_scale = measured;
+            have_rate = true;
+        }
+    }
+
+    // remove the offset over as long as it took to build up
+    slew = (int64_t)nominal_scale * TIMEBASE_SLEW_PPM / US_PER_SEC;
+    correction = (elapsed > 0) ? offset * (1 << 26) / (int64_t)elapsed : 0;
+    if (correction > slew) {
+        correction = slew;
+    } else if (correction < -slew) {
+        correction = -slew;
+    }
+    set_scale((uint32_t)(rate_scale - correction));
+
+    edge_ticks = ticks;
+    edge_rtc = rtc;
+    tb_stats.offset_us = (int32_t)(offset / 64);
+    tb_stats.rate_ppb =
+        (int32_t)(((int64_t)rate_scale - nominal_scale) * 1000000000 / nominal_scale);
+
+    return E_NO_ERROR;
+}
+
+int timebase_init(mxc_tmr_regs_t *tmr)
+{
+    mxc_tmr_cfg_t cfg;
+    uint32_t hz;
+    int retVal;
+
+    hz = MXC_TMR_GetPeriod(tmr, MXC_TMR_APB_CLK, 1, 1);
+    if (hz <= US_PER_SEC) {
+        return E_BAD_PARAM;
+    }
+
+    tb_tmr = tmr;
+    tb_irq = MXC_TMR_GET_IRQ(MXC_TMR_GET_IDX(tmr));
+    nominal_scale = (uint32_t)(((uint64_t)US_PER_SEC << 32) / hz);
+    edge_gap = hz / US_PER_SEC * EDGE_GAP_US;
+    edge_wait = (uint32_t)((uint64_t)hz * EDGE_WAIT_RTC_TICKS / RTC_TIME_TICKS_PER_SEC);
+
+    period_base = 0;
+    anchor_ticks = 0;
+    anchor_us = 0;
+    scale = nominal_scale;
+    rtc_offset = 0;
+    seq = 0;
+    have_edge = false;
+    have_rate = false;
+    rate_scale = nominal_scale;
+    memset(&tb_stats, 0x00, sizeof(tb_stats));
+
+    MXC_TMR_Shutdown(tmr);
+
+    cfg.pres = TMR_PRES_1;
+    cfg.mode = TMR_MODE_CONTINUOUS;
+    cfg.bitMode = TMR_BIT_MODE_32;
+    cfg.clock = MXC_TMR_APB_CLK;
+    cfg.cmp_cnt = TIMEBASE_TMR_PERIOD;
+    cfg.pol = 0;
+
+    retVal = MXC_TMR_Init(tmr, &cfg, false);
+    if (retVal != E_NO_ERROR) {
+        return retVal;
+    }
+
+    MXC_TMR_ClearFlags(tmr);
+    MXC_TMR_EnableInt(tmr);
+    MXC_NVIC_SetVector(tb_irq, timebase_tmr_isr);
+    NVIC_EnableIRQ(tb_irq);
+    MXC_TMR_Start(tmr);
+
+    return E_NO_ERROR;
+}
+
+void timebase_get_stats(timebase_stats_t *stats)
+{
+    *stats = tb_stats;
+}
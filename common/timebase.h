@@ -0,0 +1,86 @@
+/**
+ * @file    timebase.h
+ * @brief   64-bit monotonic microsecond timebase, disciplined to the RTC
+ * @details A 32-bit TMR free-runs from the APB clock; its handler adds a
+ *          period to the upper part of the count at each rollover, so the
+ *          count never wraps in practice. timebase_us() scales it to
+ *          microseconds from timebase_init(): two register reads and a
+ *          multiply, from any context, instead of the RTC's 1/4096 s counters
+ *          and their retries.
+ *
+ *          Reads take no lock. The writers (the rollover handler and
+ *          timebase_discipline()) mask interrupts and bump a sequence count;
+ *          a reader that sees the count change, because one of them ran
+ *          between its loads, reads again. A reader that masks interrupts or
+ *          preempts the handler sees the rollover flag still set instead, and
+ *          adds the period itself.
+ *
+ *          The APB clock comes from the internal oscillator, which is far
+ *          less accurate than the 32 kHz crystal. timebase_discipline(),
+ *          called every few seconds, stamps an RTC sub-second edge with the
+ *          TMR, measures the TMR's rate against the RTC and slews the scale
+ *          so the timebase follows the RTC without ever stepping back.
+ */
+
+#ifndef TIMEBASE_H_
+#define TIMEBASE_H_
+
+/***** Includes *****/
+#include <stdint.h>
+
+#include "mxc_device.h"
+#include "tmr.h"
+
+/***** Definitions *****/
+// the counter runs 1..TIMEBASE_TMR_PERIOD, about 71 s at 60 MHz
+#define TIMEBASE_TMR_PERIOD UINT32_MAX
+
+// correction of the scale, at most, while following the RTC
+#define TIMEBASE_SLEW_PPM 500
+
+// an RTC further off than this was set: the timebase keeps going, the RTC
+// time it corresponds to is taken again
+#define TIMEBASE_STEP_US 100000
+
+typedef struct {
+    uint32_t overflows; // TMR rollovers
+    uint32_t disciplines; // RTC edges stamped
+    uint32_t missed; // timebase_discipline() calls without an edge
+    uint32_t steps; // RTC set meanwhile
+    int32_t offset_us; // timebase minus RTC at the last edge
+    uint32_t offset_max_us; // largest offset once the rate was measured
+    int32_t rate_ppb; // RTC rate against the TMR's nominal one, minus one
+} timebase_stats_t;
+
+/***** Functions *****/
+/*
+ * Takes tmr (a 32-bit timer) for the timebase, installs its handler and
+ * starts it at 0 us. The APB clock must be above 1 MHz. The RTC is only
+ * needed once timebase_discipline() is called.
+ */
+int timebase_init(mxc_tmr_regs_t *tmr);
+
+/*
+ * Microseconds since timebase_init(). Never goes back, also across calls
+ * from different interrupts. Any context, no driver call.
+ */
+uint64_t timebase_us(void);
+
+/*
+ * RTC time, in RTC ticks, at timebase time us: comparable with
+ * rtc_time_ticks(). Valid once timebase_discipline() has succeeded.
+ */
+uint32_t timebase_rtc_ticks(uint64_t us);
+
+/*
+ * Waits for the next RTC sub-second edge (up to about 1/4096 s) and follows
+ * the RTC from it. Returns E_BUSY when no edge could be stamped, for
+ * instance because interrupts kept preempting the wait. Call it from main()
+ * every few seconds, at most half an hour apart: the offset seen is removed
+ * over as long as it took to build up.
+ */
+int timebase_discipline(void);
+
+void timebase_get_stats(timebase_stats_t *stats);
+
+#endif // TIMEBASE_H_
@@ -0,0 +1,207 @@
+/**
+ * @file    tlm_frame.c
+ * @brief   Binary telemetry records: COBS framing with a CRC-16
+ */
+
+/***** Includes *****/
+#include <string.h>
+
+#include "tlm_frame.h"
+
+/***** Globals *****/
+// CRC-16/CCITT-FALSE, four bits at a time: 32 bytes of table instead of 512
+static const uint16_t crc16_nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+/***** Functions *****/
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+uint16_t tlm_crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+
+    while (len--) {
+        crc ^= (uint16_t)(*data++ << 8);
+        crc = (uint16_t)((crc << 4) ^ crc16_nibble[crc >> 12]);
+        crc = (uint16_t)((crc << 4) ^ crc16_nibble[crc >> 12]);
+    }
+
+    return crc;
+}
+
+size_t tlm_cobs_encode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t code_pos = 0; // where the current block's length code goes
+    size_t pos = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] != 0) {
+            out[pos++] = in[i];
+            code++;
+        }
+        if (in[i] == 0 || code == 0xFF) {
+            out[code_pos] = code;
+            code_pos = pos++;
+            code = 1;
+        }
+    }
+    out[code_pos] = code;
+
+    return pos;
+}
+
+int tlm_cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t out_len)
+{
+    size_t pos = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        uint8_t code = in[i++];
+
+        if (code == 0 || i + code - 1 > len) {
+            return -1;
+        }
+        for (uint8_t n = 1; n < code; n++) {
+            if (in[i] == 0 || pos >= out_len) {
+                return -1;
+            }
+            out[pos++] = in[i++];
+        }
+        // a block shorter than 254 bytes stands for a zero, except the last
+        if (code != 0xFF && i < len) {
+            if (pos >= out_len) {
+                return -1;
+            }
+            out[pos++] = 0;
+        }
+    }
+
+    return (int)pos;
+}
+
+size_t tlm_frame_pack(uint8_t type, uint8_t seq, const uint8_t *payload, size_t len,
+                      uint8_t *out)
+{
+    uint8_t raw[TLM_PAYLOAD_MAX + TLM_RECORD_OVERHEAD];
+    size_t n;
+
+    if (len > TLM_PAYLOAD_MAX) {
+        return 0;
+    }
+
+    raw[0] = type;
+    raw[1] = seq;
+    memcpy(&raw[2], payload, len);
+    put_u16(&raw[2 + len], tlm_crc16(raw, 2 + len));
+
+    out[0] = 0;
+    n = tlm_cobs_encode(raw, len + TLM_RECORD_OVERHEAD, &out[1]);
+    out[1 + n] = 0;
+
+    return n + 2;
+}
+
+bool tlm_frame_unpack(const uint8_t *frame, size_t len, tlm_record_t *rec)
+{
+    uint8_t raw[TLM_PAYLOAD_MAX + TLM_RECORD_OVERHEAD];
+    int n = tlm_cobs_decode(frame, len, raw, sizeof(raw));
+
+    if (n < TLM_RECORD_OVERHEAD) {
+        return false;
+    }
+    if (get_u16(&raw[n - 2]) != tlm_crc16(raw, n - 2)) {
+        return false;
+    }
+
+    rec->type = raw[0];
+    rec->seq = raw[1];
+    rec->len = (uint8_t)(n - TLM_RECORD_OVERHEAD);
+    memcpy(rec->payload, &raw[2], rec->len);
+
+    return true;
+}
+
+void tlm_sample_encode(uint8_t *payload, const tlm_sample_t *sample)
+{
+    put_u32(&payload[0], sample->rtc_seconds);
+    put_u16(&payload[4], sample->subseconds);
+    put_u16(&payload[6], (uint16_t)sample->temp_q8);
+    payload[8] = sample->trigger_source;
+}
+
+bool tlm_sample_decode(const tlm_record_t *rec, tlm_sample_t *sample)
+{
+    if (rec->type != TLM_REC_SAMPLE || rec->len != TLM_SAMPLE_LEN) {
+        return false;
+    }
+
+    sample->rtc_seconds = get_u32(&rec->payload[0]);
+    sample->subseconds = get_u16(&rec->payload[4]);
+    sample->temp_q8 = (int16_t)get_u16(&rec->payload[6]);
+    sample->trigger_source = rec->payload[8];
+
+    return true;
+}
+
+void tlm_average_encode(uint8_t *payload, const tlm_average_t *avg)
+{
+    put_u32(&payload[0], avg->rtc_seconds);
+    put_u16(&payload[4], (uint16_t)avg->temp_q8);
+    put_u16(&payload[6], avg->count);
+}
+
+bool tlm_average_decode(const tlm_record_t *rec, tlm_average_t *avg)
+{
+    if (rec->type != TLM_REC_AVERAGE || rec->len != TLM_AVERAGE_LEN) {
+        return false;
+    }
+
+    avg->rtc_seconds = get_u32(&rec->payload[0]);
+    avg->temp_q8 = (int16_t)get_u16(&rec->payload[4]);
+    avg->count = get_u16(&rec->payload[6]);
+
+    return true;
+}
+
+void tlm_alert_encode(uint8_t *payload, const tlm_alert_t *alert)
+{
+    put_u32(&payload[0], alert->rtc_seconds);
+    put_u16(&payload[4], (uint16_t)alert->temp_q8);
+    payload[6] = alert->high;
+}
+
+bool tlm_alert_decode(const tlm_record_t *rec, tlm_alert_t *alert)
+{
+    if (rec->type != TLM_REC_ALERT || rec->len != TLM_ALERT_LEN) {
+        return false;
+    }
+
+    alert->rtc_seconds = get_u32(&rec->payload[0]);
+    alert->temp_q8 = (int16_t)get_u16(&rec->payload[4]);
+    alert->high = rec->payload[6];
+
+    return true;
+}
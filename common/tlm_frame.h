@@ -0,0 +1,109 @@
+/**
+ * @file    tlm_frame.h
+ * @brief   Binary telemetry records: COBS framing with a CRC-16
+ * @details A record is a type byte, a sequence number, a payload of up to
+ *          TLM_PAYLOAD_MAX bytes and a CRC-16/CCITT-FALSE over the three,
+ *          sent low byte first. It is COBS-encoded so that it contains no zero
+ *          byte and sent between two zero delimiters. Text printed between two
+ *          frames stays outside both, so a decoder resynchronizes at every
+ *          zero and can pass the text through.
+ *
+ *          All multi-byte fields are little-endian. No hardware access: the
+ *          firmware (telemetry.c) and the host decoder share this file.
+ */
+
+#ifndef TLM_FRAME_H_
+#define TLM_FRAME_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/***** Definitions *****/
+#define TLM_PAYLOAD_MAX 32
+
+// type, sequence number and CRC around the payload
+#define TLM_RECORD_OVERHEAD 4
+// COBS adds one byte per 254, plus the two delimiters
+#define TLM_FRAME_MAX (TLM_PAYLOAD_MAX + TLM_RECORD_OVERHEAD + 1 + 2)
+
+// record types
+#define TLM_REC_SAMPLE 0x01 // one temperature sample
+#define TLM_REC_AVERAGE 0x02 // average of the periodic samples
+#define TLM_REC_ALERT 0x03 // temperature alert raised or cleared
+#define TLM_REC_LOG 0x04 // tokenized log message (tlog_format.h)
+
+#define TLM_SAMPLE_LEN 9
+#define TLM_AVERAGE_LEN 8
+#define TLM_ALERT_LEN 7
+
+typedef struct {
+    uint32_t rtc_seconds;
+    uint16_t subseconds; // 1/4096 s
+    int16_t temp_q8; // Q8.8 degrees C
+    uint8_t trigger_source; // TRIGGER_* bits
+} tlm_sample_t;
+
+typedef struct {
+    uint32_t rtc_seconds; // time of the last sample averaged
+    int16_t temp_q8;
+    uint16_t count; // samples averaged
+} tlm_average_t;
+
+typedef struct {
+    uint32_t rtc_seconds;
+    int16_t temp_q8;
+    uint8_t high; // 1 raised, 0 cleared
+} tlm_alert_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t seq;
+    uint8_t len;
+    uint8_t payload[TLM_PAYLOAD_MAX];
+} tlm_record_t;
+
+/***** Functions *****/
+/*
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF).
+ */
+uint16_t tlm_crc16(const uint8_t *data, size_t len);
+
+/*
+ * COBS-encodes len bytes of in into out (at least len + len / 254 + 1 bytes).
+ * Returns the encoded length, without delimiter.
+ */
+size_t tlm_cobs_encode(const uint8_t *in, size_t len, uint8_t *out);
+
+/*
+ * Decodes one COBS block (without delimiter) into out, at most out_len
+ * bytes. Returns the decoded length, -1 when the block is malformed.
+ */
+int tlm_cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t out_len);
+
+/*
+ * Builds the frame of one record into out (TLM_FRAME_MAX bytes), both
+ * delimiters included. Returns its length, 0 when the payload is too long.
+ */
+size_t tlm_frame_pack(uint8_t type, uint8_t seq, const uint8_t *payload, size_t len,
+                      uint8_t *out);
+
+/*
+ * Checks and decodes the bytes between two delimiters into rec. Returns false
+ * when they are not a valid record (bad encoding, length or CRC).
+ */
+bool tlm_frame_unpack(const uint8_t *frame, size_t len, tlm_record_t *rec);
+
+/*
+ * Payload layouts. The encoders fill TLM_*_LEN bytes; the decoders return
+ * false when the record is of another type or length.
+ */
+void tlm_sample_encode(uint8_t *payload, const tlm_sample_t *sample);
+bool tlm_sample_decode(const tlm_record_t *rec, tlm_sample_t *sample);
+void tlm_average_encode(uint8_t *payload, const tlm_average_t *avg);
+bool tlm_average_decode(const tlm_record_t *rec, tlm_average_t *avg);
+void tlm_alert_encode(uint8_t *payload, const tlm_alert_t *alert);
+bool tlm_alert_decode(const tlm_record_t *rec, tlm_alert_t *alert);
+
+#endif // TLM_FRAME_H_
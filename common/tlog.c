@@ -0,0 +1,36 @@
+/**
+ * @file    tlog.c
+ * @brief   Tokenized logging: formats stay on the host, the target sends numbers
+ */
+
+/***** Includes *****/
+#include <stdio.h>
+
+#include "mxc_errors.h"
+
+#include "telemetry.h"
+#include "tlog.h"
+
+/***** Functions *****/
+int tlog_send(uint32_t id, const uint32_t *args, size_t nargs)
+{
+    uint8_t payload[TLM_PAYLOAD_MAX];
+    size_t len = tlog_pack(payload, sizeof(payload), id, args, nargs);
+
+    if (len == 0) {
+        return E_BAD_PARAM;
+    }
+
+    return telemetry_send(TLM_REC_LOG, payload, len);
+}
+
+int tlog_print(const char *fmt, const uint32_t *args, size_t nargs)
+{
+    char line[TLOG_LINE_MAX];
+
+    if (tlog_format(line, sizeof(line), fmt, args, nargs) < 0) {
+        return E_BAD_PARAM;
+    }
+
+    return printf("%s", line);
+}
@@ -0,0 +1,92 @@
+/**
+ * @file    tlog.h
+ * @brief   Tokenized logging: formats stay on the host, the target sends numbers
+ * @details TLOG(id, args...) logs message id of the project's table
+ *          (tlog_msgs.h, see tlog_format.h) with up to TLOG_ARGS_MAX integer
+ *          arguments.
+ *
+ *          With TOKENIZED_LOG defined the target formats nothing: the call
+ *          packs the index and the arguments into a TLM_REC_LOG telemetry
+ *          record, a few bytes that host/tlm_decode turns back into the text. The format
+ *          strings are then not referenced by the image and the linker drops
+ *          them. Without it the same call formats the message on the target
+ *          and prints it, so the console reads as before.
+ *
+ *          Each message has a level and a module of the project. Messages
+ *          above TLOG_LEVEL or outside the TLOG_MODULES mask are compiled out:
+ *          TLOG() becomes dead code and their format strings are left out of
+ *          the table (tlog_formats[] holds NULL), so a release build carries
+ *          neither the calls nor the text. TLOG_LEVEL defaults to
+ *          TLOG_LEVEL_INFO with NDEBUG and to TLOG_LEVEL_DEBUG otherwise,
+ *          TLOG_MODULES to every module.
+ *
+ *          Telemetry must be initialized (telemetry_init()) before the first
+ *          tokenized message.
+ */
+
+#ifndef TLOG_H_
+#define TLOG_H_
+
+/***** Includes *****/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tlog_format.h"
+
+/***** Definitions *****/
+#define TLOG_LEVEL_ERROR 1
+#define TLOG_LEVEL_WARN 2
+#define TLOG_LEVEL_INFO 3
+#define TLOG_LEVEL_DEBUG 4 // bring-up dumps
+
+#ifndef TLOG_LEVEL
+#ifdef NDEBUG
+#define TLOG_LEVEL TLOG_LEVEL_INFO
+#else
+#define TLOG_LEVEL TLOG_LEVEL_DEBUG
+#endif
+#endif
+
+#ifndef TLOG_MODULES
+#define TLOG_MODULES 0xFFFFFFFFu // the project's TLOG_MOD_* bits
+#endif
+
+// whether messages of a level and module are compiled in
+#define TLOG_ENABLED(level, module) ((level) <= TLOG_LEVEL && ((module) & (TLOG_MODULES)) != 0)
+// whether message id is compiled in; a constant for a constant id
+#define TLOG_ON(id) (((TLOG_ENABLED_IDS) >> (id)) & 1)
+
+// the arguments as a uint32_t array, preceded by a dummy for empty lists
+#define TLOG_ARGV(...) ((const uint32_t[]){ 0, ##__VA_ARGS__ })
+#define TLOG_ARGC(...) (sizeof(TLOG_ARGV(__VA_ARGS__)) / sizeof(uint32_t) - 1)
+
+#ifdef TOKENIZED_LOG
+#define TLOG_EMIT(id, args, n) tlog_send((id), (args), (n))
+#else
+#define TLOG_EMIT(id, args, n) tlog_print(tlog_formats[(id)], (args), (n))
+#endif
+
+#define TLOG(id, ...)                                                            \
+    do {                                                                         \
+        if (TLOG_ON(id)) {                                                       \
+            TLOG_EMIT((id), TLOG_ARGV(__VA_ARGS__) + 1, TLOG_ARGC(__VA_ARGS__)); \
+        }                                                                        \
+    } while (0)
+
+// the project's format strings, indexed by message id, NULL when compiled out
+// (tlog_msgs.c)
+extern const char *const tlog_formats[];
+
+/***** Functions *****/
+/*
+ * Sends message id as a TLM_REC_LOG record. Returns the telemetry_send() result.
+ */
+int tlog_send(uint32_t id, const uint32_t *args, size_t nargs);
+
+/*
+ * Formats a message on the target and prints it with printf().
+ * Returns the number of characters printed, or a negative value.
+ */
+int tlog_print(const char *fmt, const uint32_t *args, size_t nargs);
+
+#endif // TLOG_H_
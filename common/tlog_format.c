@@ -0,0 +1,332 @@
+/**
+ * @file    tlog_format.c
+ * @brief   Tokenized log messages: argument encoding and deferred formatting
+ */
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "temp_q8.h"
+#include "tlog_format.h"
+
+/***** Definitions *****/
+#define RTC_TICKS_PER_SEC 4096
+#define TICKS_MAX_DECIMALS 9
+
+// one conversion: "%-08.3u"
+typedef struct {
+    char flags[6];
+    int width; // -1 none
+    int precision; // -1 none
+    char conv;
+} conv_spec_t;
+
+/***** Functions *****/
+// zigzag: 0, -1, 1, -2 ... to 0, 1, 2, 3 ..., so that small negative
+// arguments are short varints too
+static uint32_t zigzag(uint32_t v)
+{
+    return (v << 1) ^ (0u - (v >> 31));
+}
+
+static uint32_t unzigzag(uint32_t v)
+{
+    return (v >> 1) ^ (0u - (v & 1));
+}
+
+static size_t put_varint(uint8_t *p, size_t size, size_t pos, uint32_t v)
+{
+    do {
+        if (pos >= size) {
+            return 0;
+        }
+        p[pos++] = (uint8_t)((v & 0x7F) | ((v > 0x7F) ? 0x80 : 0));
+        v >>= 7;
+    } while (v != 0);
+
+    return pos;
+}
+
+static bool get_varint(const uint8_t *p, size_t len, size_t *pos, uint32_t *v)
+{
+    *v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*pos >= len) {
+            return false;
+        }
+        *v |= (uint32_t)(p[*pos] & 0x7F) << shift;
+        if ((p[(*pos)++] & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t tlog_pack(uint8_t *payload, size_t size, uint32_t id, const uint32_t *args,
+                 size_t nargs)
+{
+    size_t pos = put_varint(payload, size, 0, id);
+
+    for (size_t i = 0; i < nargs && pos != 0; i++) {
+        pos = put_varint(payload, size, pos, zigzag(args[i]));
+    }
+
+    return pos;
+}
+
+int tlog_unpack(const uint8_t *payload, size_t len, uint32_t *id, uint32_t *args,
+                size_t max_args)
+{
+    size_t pos = 0;
+    size_t n = 0;
+
+    if (!get_varint(payload, len, &pos, id)) {
+        return -1;
+    }
+    while (pos < len) {
+        if (n == max_args || !get_varint(payload, len, &pos, &args[n])) {
+            return -1;
+        }
+        args[n] = unzigzag(args[n]);
+        n++;
+    }
+
+    return (int)n;
+}
+
+// parses the conversion after a '%'; returns the characters used, 0 if invalid
+static size_t parse_spec(const char *fmt, conv_spec_t *spec)
+{
+    size_t i = 0;
+    size_t nflags = 0;
+
+    while (fmt[i] != '\0' && strchr("-0+ #", fmt[i]) != NULL) {
+        if (nflags == sizeof(spec->flags) - 1) {
+            return 0;
+        }
+        spec->flags[nflags++] = fmt[i++];
+    }
+    spec->flags[nflags] = '\0';
+
+    spec->width = -1;
+    while (fmt[i] >= '0' && fmt[i] <= '9') {
+        spec->width = ((spec->width < 0) ? 0 : spec->width * 10) + (fmt[i++] - '0');
+    }
+
+    spec->precision = -1;
+    if (fmt[i] == '.') {
+        i++;
+        spec->precision = 0;
+        while (fmt[i] >= '0' && fmt[i] <= '9') {
+            spec->precision = spec->precision * 10 + (fmt[i++] - '0');
+        }
+    }
+
+    if (fmt[i] == '\0' || strchr("diuxXcqtb", fmt[i]) == NULL || spec->width > 64 ||
+        spec->precision > 64) {
+        return 0;
+    }
+    spec->conv = fmt[i++];
+
+    return i;
+}
+
+// pads str to the spec's width: left with '-', zeros after the sign with '0'
+static int pad(char *out, size_t size, const char *str, const conv_spec_t *spec)
+{
+    size_t len = strlen(str);
+    size_t fill = (spec->width > (int)len) ? spec->width - len : 0;
+    size_t pos = 0;
+
+    if (len + fill >= size) {
+        return -1;
+    }
+
+    if (strchr(spec->flags, '-') != NULL) {
+        memcpy(out, str, len);
+        memset(out + len, ' ', fill);
+    } else if (strchr(spec->flags, '0') != NULL) {
+        if (str[0] == '-') {
+            out[pos++] = '-';
+        }
+        memset(out + pos, '0', fill);
+        memcpy(out + pos + fill, str + pos, len - pos);
+    } else {
+        memset(out, ' ', fill);
+        memcpy(out + fill, str, len);
+    }
+    out[len + fill] = '\0';
+
+    return (int)(len + fill);
+}
+
+// %t: ticks as seconds, truncated to the precision so that 59.999 s never
+// shows as 60.00
+static void format_ticks(char *out, size_t size, uint32_t ticks, int decimals)
+{
+    uint32_t scale = 1;
+    uint32_t whole = ticks / RTC_TICKS_PER_SEC;
+    uint32_t frac;
+
+    if (decimals > TICKS_MAX_DECIMALS) {
+        decimals = TICKS_MAX_DECIMALS;
+    }
+    for (int i = 0; i < decimals; i++) {
+        scale *= 10;
+    }
+
+    frac = (uint32_t)((uint64_t)(ticks % RTC_TICKS_PER_SEC) * scale / RTC_TICKS_PER_SEC);
+
+    if (decimals == 0) {
+        snprintf(out, size, "%u", (unsigned)whole);
+    } else {
+        snprintf(out, size, "%u.%0*u", (unsigned)whole, decimals, (unsigned)frac);
+    }
+}
+
+// %d, %i, %u, %x and %X like printf: sign or 0x prefix, zeros up to the
+// precision, then the width
+static int format_int(char *out, size_t size, const conv_spec_t *spec, uint32_t arg)
+{
+    const char *digit = (spec->conv == 'X') ? "0123456789ABCDEF" : "0123456789abcdef";
+    uint32_t base = (spec->conv == 'x' || spec->conv == 'X') ? 16 : 10;
+    bool left = strchr(spec->flags, '-') != NULL;
+    const char *prefix = "";
+    char digits[10]; // least significant first
+    size_t ndigits = 0;
+    size_t zeros, fill, len, pos = 0;
+    uint32_t v = arg;
+
+    if (spec->conv == 'd' || spec->conv == 'i') {
+        if ((int32_t)arg < 0) {
+            prefix = "-";
+            v = 0u - arg;
+        } else if (strchr(spec->flags, '+') != NULL) {
+            prefix = "+";
+        } else if (strchr(spec->flags, ' ') != NULL) {
+            prefix = " ";
+        }
+    } else if (base == 16 && arg != 0 && strchr(spec->flags, '#') != NULL) {
+        prefix = (spec->conv == 'X') ? "0X" : "0x";
+    }
+
+    // a precision of 0 prints nothing for 0
+    if (v != 0 || spec->precision != 0) {
+        do {
+            digits[ndigits++] = digit[v % base];
+            v /= base;
+        } while (v != 0);
+    }
+
+    zeros = (spec->precision > (int)ndigits) ? spec->precision - ndigits : 0;
+    len = strlen(prefix) + zeros + ndigits;
+    fill = (spec->width > (int)len) ? spec->width - len : 0;
+    if (len + fill >= size) {
+        return -1;
+    }
+
+    // '0' pads with zeros after the prefix, unless a precision is given
+    if (!left && strchr(spec->flags, '0') != NULL && spec->precision < 0) {
+        zeros += fill;
+        fill = 0;
+    }
+    if (!left) {
+        memset(out, ' ', fill);
+        pos = fill;
+    }
+    memcpy(out + pos, prefix, strlen(prefix));
+    pos += strlen(prefix);
+    memset(out + pos, '0', zeros);
+    pos += zeros;
+    while (ndigits > 0) {
+        out[pos++] = digits[--ndigits];
+    }
+    if (left) {
+        memset(out + pos, ' ', fill);
+        pos += fill;
+    }
+    out[pos] = '\0';
+
+    return (int)pos;
+}
+
+// one conversion of arg into out; returns its length or -1
+static int format_arg(char *out, size_t size, const conv_spec_t *spec, uint32_t arg)
+{
+    char str[TLOG_LINE_MAX];
+
+    switch (spec->conv) {
+    case 'q':
+        if (temp_q8_format(str, sizeof(str), (temp_q8_t)arg,
+                           (spec->precision < 0) ? 4 :
+                           (spec->precision > TEMP_Q8_MAX_DECIMALS) ? TEMP_Q8_MAX_DECIMALS :
+                                                                      spec->precision) < 0) {
+            return -1;
+        }
+        return pad(out, size, str, spec);
+    case 't':
+        format_ticks(str, sizeof(str), arg, (spec->precision < 0) ? 6 : spec->precision);
+        return pad(out, size, str, spec);
+    case 'b':
+        for (int i = 7, pos = 0; i >= 0; i--) {
+            str[pos++] = '0' + ((arg >> i) & 1);
+            if (i == 4) {
+                str[pos++] = ' ';
+            }
+            str[pos] = '\0';
+        }
+        return pad(out, size, str, spec);
+    case 'c': {
+        // a character is padded with spaces only
+        conv_spec_t plain = *spec;
+
+        strcpy(plain.flags, (strchr(spec->flags, '-') != NULL) ? "-" : "");
+        str[0] = (char)arg;
+        str[1] = '\0';
+        return pad(out, size, str, &plain);
+    }
+    default:
+        return format_int(out, size, spec, arg);
+    }
+}
+
+int tlog_format(char *out, size_t size, const char *fmt, const uint32_t *args, size_t nargs)
+{
+    size_t pos = 0;
+    size_t used = 0;
+
+    if (size == 0) {
+        return -1;
+    }
+
+    while (*fmt != '\0') {
+        conv_spec_t spec;
+        size_t n;
+        int len;
+
+        if (*fmt != '%' || fmt[1] == '%') {
+            if (pos + 1 >= size) {
+                return -1;
+            }
+            out[pos++] = *fmt;
+            fmt += (*fmt == '%') ? 2 : 1;
+            continue;
+        }
+
+        n = parse_spec(fmt + 1, &spec);
+        if (n == 0 || used == nargs) {
+            return -1;
+        }
+        len = format_arg(&out[pos], size - pos, &spec, args[used++]);
+        if (len < 0 || pos + len >= size) {
+            return -1;
+        }
+        pos += len;
+        fmt += 1 + n;
+    }
+    out[pos] = '\0';
+
+    return (used == nargs) ? (int)pos : -1;
+}
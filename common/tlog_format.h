@@ -0,0 +1,79 @@
+/**
+ * @file    tlog_format.h
+ * @brief   Tokenized log messages: argument encoding and deferred formatting
+ * @details A tokenized message is the index of its format string in the
+ *          project's message table plus its arguments, all 32-bit integers.
+ *          The firmware (tlog.h) sends only these numbers, as LEB128 varints
+ *          in a TLM_REC_LOG record; the format strings stay in the table,
+ *          which a host decoder compiles in to rebuild the text. The firmware
+ *          does not know which arguments are signed, so every argument is
+ *          zigzag-encoded as a signed 32-bit value first: -1 is one byte
+ *          instead of five, at the cost of one more byte for an unsigned
+ *          value of 64 - 127 (and of 8192 - 16383 ...).
+ *
+ *          A project lists its messages in tlog_msgs.h:
+ *
+ *              #define TLOG_MESSAGES(X) \
+ *                  X(TLOG_BOOT, TLOG_LEVEL_INFO, TLOG_MOD_MAIN, "Boot %u\n") \
+ *                  ...
+ *              typedef enum { TLOG_MESSAGES(TLOG_ID) TLOG_COUNT } tlog_id_t;
+ *              #define TLOG_ENABLED_IDS (0 TLOG_MESSAGES(TLOG_FILTER))
+ *
+ *          with its own TLOG_MOD_* bits. TLOG_ENABLED_IDS has one bit per
+ *          message, so a table holds at most 64.
+ *
+ *          and defines the strings once, in tlog_msgs.c:
+ *
+ *              const char *const tlog_formats[] = { TLOG_MESSAGES(TLOG_FORMAT) };
+ *
+ *          The formats take printf's %d, %i, %u, %x, %X, %c and %% with flags,
+ *          width and precision, formatted without printf, plus three
+ *          integer-only conversions:
+ *          - %q  Q8.8 temperature, precision = decimals (default 4)
+ *          - %t  RTC ticks (1/4096 s) as seconds, truncated like rtc_time_format()
+ *                (default 6 decimals)
+ *          - %b  low 8 bits in binary, "dddd dddd"
+ *
+ *          No hardware access: the firmware and the host decoder share this file.
+ */
+
+#ifndef TLOG_FORMAT_H_
+#define TLOG_FORMAT_H_
+
+/***** Includes *****/
+#include <stddef.h>
+#include <stdint.h>
+
+/***** Definitions *****/
+// expansions of a project's TLOG_MESSAGES(X) list; TLOG_ENABLED() is in tlog.h
+#define TLOG_ID(id, level, module, fmt) id,
+#define TLOG_FORMAT(id, level, module, fmt) TLOG_ENABLED(level, module) ? (fmt) : NULL,
+#define TLOG_FILTER(id, level, module, fmt) | (TLOG_ENABLED(level, module) ? 1ULL << (id) : 0)
+
+// most arguments one message carries
+#define TLOG_ARGS_MAX 8
+// longest text one message formats to, '\0' included
+#define TLOG_LINE_MAX 160
+
+/***** Functions *****/
+/*
+ * Encodes id and nargs arguments into payload (at most size bytes).
+ * Returns the payload length, 0 when it does not fit.
+ */
+size_t tlog_pack(uint8_t *payload, size_t size, uint32_t id, const uint32_t *args,
+                 size_t nargs);
+
+/*
+ * Decodes a payload built by tlog_pack(), at most max_args arguments.
+ * Returns the number of arguments, -1 when the payload is malformed.
+ */
+int tlog_unpack(const uint8_t *payload, size_t len, uint32_t *id, uint32_t *args,
+                size_t max_args);
+
+/*
+ * Formats fmt with exactly nargs arguments into out. Returns the text length,
+ * -1 when the arguments do not match the conversions or out is too small.
+ */
+int tlog_format(char *out, size_t size, const char *fmt, const uint32_t *args, size_t nargs);
+
+#endif // TLOG_FORMAT_H_
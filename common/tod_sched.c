@@ -0,0 +1,131 @@
+/**
+ * @file    tod_sched.c
+ * @brief   Periodic RTC time-of-day alarm on an absolute grid
+ */
+
+/***** Includes *****/
+#include <string.h>
+
+#include "mxc_device.h"
+#include "mxc_errors.h"
+#include "rtc.h"
+#include "rtc_time.h"
+
+#include "tod_sched.h"
+
+/***** Globals *****/
+static uint32_t sched_period; // seconds
+static tod_sched_policy_t sched_policy;
+static tod_sched_fn_t sched_fn;
+static void *sched_arg;
+
+static uint32_t next_sec; // next alarm on the grid
+static uint32_t alarm_sec; // second the alarm register holds
+static bool alarm_set;
+static volatile bool pending; // alarm seen by the ISR, not serviced yet
+
+static tod_sched_stats_t sched_stats;
+
+/***** Functions *****/
+// the time-of-day alarm can only be written while it is disabled
+static void set_alarm(uint32_t sec)
+{
+    while (MXC_RTC_DisableInt(MXC_F_RTC_CTRL_TOD_ALARM_IE) == E_BUSY) {}
+    while (MXC_RTC_SetTimeofdayAlarm(sec) == E_BUSY) {}
+    while (MXC_RTC_EnableInt(MXC_F_RTC_CTRL_TOD_ALARM_IE) == E_BUSY) {}
+    alarm_sec = sec;
+    alarm_set = true;
+}
+
+void tod_sched_init(uint32_t period, tod_sched_policy_t policy, tod_sched_fn_t fn, void *arg)
+{
+    sched_period = period;
+    sched_policy = policy;
+    sched_fn = fn;
+    sched_arg = arg;
+
+    pending = false;
+    alarm_set = false;
+    memset(&sched_stats, 0x00, sizeof(sched_stats));
+}
+
+void tod_sched_start(uint32_t epoch)
+{
+    next_sec = epoch;
+    pending = false;
+    set_alarm(epoch);
+}
+
+void tod_sched_alarm(void)
+{
+    sched_stats.alarms++;
+    pending = true;
+}
+
+bool tod_sched_pending(void)
+{
+    return pending;
+}
+
+int tod_sched_run(void)
+{
+    int count = 0;
+
+    if (!pending) {
+        return 0;
+    }
+    // an alarm from here on is serviced again
+    pending = false;
+
+    for (;;) {
+        rtc_time_t now;
+        uint32_t behind, due, late;
+
+        if (rtc_time_get(&now) != E_NO_ERROR) {
+            pending = true; // RTC busy: again on the next pass
+            break;
+        }
+
+        if ((int32_t)(now.sec - next_sec) < 0) {
+            if (alarm_set && alarm_sec == next_sec) {
+                break;
+            }
+            // read again: the second may have come while the alarm was set
+            set_alarm(next_sec);
+            continue;
+        }
+
+        // whole periods past the alarm: later alarms that are due as well
+        behind = (now.sec - next_sec) / sched_period;
+        if (behind > 0) {
+            sched_stats.overruns++;
+            if (sched_policy == TOD_SCHED_SKIP) {
+                sched_stats.skipped += behind;
+                next_sec += behind * sched_period;
+            }
+        }
+
+        due = next_sec;
+        late = rtc_time_ticks(&now) - due * RTC_TIME_TICKS_PER_SEC;
+        if (late > sched_stats.late_max) {
+            sched_stats.late_max = late;
+        }
+
+        next_sec += sched_period;
+        sched_stats.runs++;
+        count++;
+        sched_fn(sched_arg, due);
+    }
+
+    return count;
+}
+
+uint32_t tod_sched_next(void)
+{
+    return next_sec;
+}
+
+void tod_sched_get_stats(tod_sched_stats_t *stats)
+{
+    *stats = sched_stats;
+}
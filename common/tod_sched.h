@@ -0,0 +1,84 @@
+/**
+ * @file    tod_sched.h
+ * @brief   Periodic RTC time-of-day alarm on an absolute grid
+ * @details Alarm n is due at epoch + n * period seconds, however late its
+ *          handler ran, so the latency of one alarm never moves the next and
+ *          the schedule does not drift. The RTC ISR only records the alarm
+ *          (tod_sched_alarm()); tod_sched_run(), from main(), calls the
+ *          callback with the nominal second of the alarm and sets the next
+ *          one, so the RTC register writes, which wait for the 32 kHz
+ *          domain, happen in thread mode.
+ *
+ *          An alarm still due when the next one has passed too (main() was
+ *          held up for more than a period) is an overrun. TOD_SCHED_SKIP calls
+ *          the callback once, for the latest alarm, and counts the others as
+ *          skipped; TOD_SCHED_CATCH_UP calls it for each of them, in order.
+ *          Either way the next alarm stays on the grid.
+ *
+ *          There is one time-of-day alarm, so there is one schedule.
+ */
+
+#ifndef TOD_SCHED_H_
+#define TOD_SCHED_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+
+/***** Definitions *****/
+typedef enum {
+    TOD_SCHED_SKIP, // one callback for the latest alarm due
+    TOD_SCHED_CATCH_UP, // one callback for every alarm due
+} tod_sched_policy_t;
+
+/*
+ * Alarm callback, run by tod_sched_run(). sec is the nominal second of the
+ * alarm, epoch + n * period.
+ */
+typedef void (*tod_sched_fn_t)(void *arg, uint32_t sec);
+
+typedef struct {
+    uint32_t alarms; // alarm interrupts
+    uint32_t runs; // callbacks
+    uint32_t overruns; // alarms serviced after the next one was due
+    uint32_t skipped; // alarms without a callback (TOD_SCHED_SKIP)
+    uint32_t late_max; // nominal time to callback, RTC ticks
+} tod_sched_stats_t;
+
+/***** Functions *****/
+void tod_sched_init(uint32_t period, tod_sched_policy_t policy, tod_sched_fn_t fn, void *arg);
+
+/*
+ * Sets the first alarm for the second epoch; the grid starts there. The RTC
+ * may be stopped. The RTC ISR must then call tod_sched_alarm() for the
+ * time-of-day alarm flag.
+ */
+void tod_sched_start(uint32_t epoch);
+
+/*
+ * Time-of-day alarm handler: only records the alarm, no register access.
+ * Call it from the RTC ISR once the flag is cleared.
+ */
+void tod_sched_alarm(void);
+
+/*
+ * True when an alarm waits for tod_sched_run(). Check it with interrupts
+ * masked before sleeping.
+ */
+bool tod_sched_pending(void);
+
+/*
+ * Calls the callback for the alarms due, following the policy, and sets the
+ * alarm for the next second on the grid. Returns how many callbacks ran.
+ * Call it from main() only.
+ */
+int tod_sched_run(void);
+
+/*
+ * Second of the next alarm on the grid.
+ */
+uint32_t tod_sched_next(void);
+
+void tod_sched_get_stats(tod_sched_stats_t *stats);
+
+#endif // TOD_SCHED_H_
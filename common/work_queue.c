@@ -0,0 +1,102 @@
+/**
+ * @file    work_queue.c
+ * @brief   Lock-free deferred-work queue from interrupt handlers to main()
+ */
+
+/***** Includes *****/
+#include <string.h>
+
+#include "work_queue.h"
+
+#if (WORK_QUEUE_SIZE & (WORK_QUEUE_SIZE - 1)) != 0
+#error "WORK_QUEUE_SIZE must be a power of two."
+#endif
+
+/***** Definitions *****/
+#define WORK_QUEUE_MASK (WORK_QUEUE_SIZE - 1)
+
+/***** Functions *****/
+void work_queue_init(work_queue_t *q)
+{
+    memset(q, 0x00, sizeof(*q));
+    for (uint32_t i = 0; i < WORK_QUEUE_SIZE; i++) {
+        q->slot[i].seq = i;
+    }
+}
+
+bool work_post(work_queue_t *q, work_fn_t fn, void *arg)
+{
+    uint32_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    work_slot_t *slot;
+
+    for (;;) {
+        int32_t diff;
+
+        slot = &q->slot[pos & WORK_QUEUE_MASK];
+        diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0) {
+            // the slot is free for pos; claim it unless another producer did
+            if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, true, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // the slot still holds the item from one lap ago
+            __atomic_fetch_add(&q->stats.dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        } else {
+            pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->fn = fn;
+    slot->arg = arg;
+    // publish the item only after it is written
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    __atomic_fetch_add(&q->stats.posted, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+int work_run(work_queue_t *q)
+{
+    int count = 0;
+
+    for (;;) {
+        uint32_t pos = q->tail;
+        uint32_t queued = __atomic_load_n(&q->head, __ATOMIC_RELAXED) - pos;
+        work_slot_t *slot = &q->slot[pos & WORK_QUEUE_MASK];
+        work_fn_t fn;
+        void *arg;
+
+        // claimed but not yet filled only while its producer was preempted
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1) {
+            return count;
+        }
+
+        if (queued > q->stats.high_water) {
+            q->stats.high_water = queued;
+        }
+
+        fn = slot->fn;
+        arg = slot->arg;
+        // hand the slot back to the producers for the next lap
+        __atomic_store_n(&slot->seq, pos + WORK_QUEUE_SIZE, __ATOMIC_RELEASE);
+        __atomic_store_n(&q->tail, pos + 1, __ATOMIC_RELEASE);
+
+        fn(arg);
+        q->stats.run++;
+        count++;
+    }
+}
+
+bool work_pending(const work_queue_t *q)
+{
+    return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) != q->tail;
+}
+
+void work_queue_get_stats(const work_queue_t *q, work_queue_stats_t *stats)
+{
+    *stats = q->stats;
+}
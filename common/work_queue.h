@@ -0,0 +1,73 @@
+/**
+ * @file    work_queue.h
+ * @brief   Lock-free deferred-work queue from interrupt handlers to main()
+ * @details Interrupt handlers keep only what must happen at interrupt time
+ *          (clear the flag, re-arm, note a timestamp) and post the rest as a
+ *          work item: a function and its argument. The dispatcher in main()
+ *          runs the items in posting order with interrupts enabled, so bus
+ *          transfers and printf() no longer hold off other interrupts.
+ *
+ *          Any number of producers (handlers of any priority, or main()), one
+ *          consumer (the dispatcher). Each slot carries a sequence number;
+ *          producers claim slots with a compare-and-swap on head, so posting
+ *          never disables interrupts. A full queue rejects the item.
+ */
+
+#ifndef WORK_QUEUE_H_
+#define WORK_QUEUE_H_
+
+/***** Includes *****/
+#include <stdbool.h>
+#include <stdint.h>
+
+/***** Definitions *****/
+// number of slots, must be a power of two
+#ifndef WORK_QUEUE_SIZE
+#define WORK_QUEUE_SIZE 16
+#endif
+
+typedef void (*work_fn_t)(void *arg);
+
+typedef struct {
+    uint32_t posted; // items accepted
+    uint32_t dropped; // items rejected by a full queue
+    uint32_t run; // items run by the dispatcher
+    uint32_t high_water; // most items queued at once, seen by the dispatcher
+} work_queue_stats_t;
+
+typedef struct {
+    volatile uint32_t seq; // index once free for it, index + 1 once filled
+    work_fn_t fn;
+    void *arg;
+} work_slot_t;
+
+typedef struct {
+    work_slot_t slot[WORK_QUEUE_SIZE];
+    volatile uint32_t head; // next index to claim, shared by the producers
+    volatile uint32_t tail; // next index to run, owned by the dispatcher
+    work_queue_stats_t stats;
+} work_queue_t;
+
+/***** Functions *****/
+void work_queue_init(work_queue_t *q);
+
+/*
+ * Queues fn(arg). Safe from any interrupt handler and from main().
+ * Returns false when the queue is full.
+ */
+bool work_post(work_queue_t *q, work_fn_t fn, void *arg);
+
+/*
+ * Dispatcher: runs the queued items, including those posted meanwhile, and
+ * returns how many ran. Call it from main() only.
+ */
+int work_run(work_queue_t *q);
+
+/*
+ * True when items are queued. Check it with interrupts masked before sleeping.
+ */
+bool work_pending(const work_queue_t *q);
+
+void work_queue_get_stats(const work_queue_t *q, work_queue_stats_t *stats);
+
+#endif // WORK_QUEUE_H_